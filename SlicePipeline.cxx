@@ -1,12 +1,13 @@
 // This example illustrates the slicing and masking of a volume
 // using a combination of the following VTK algorithms:
 //
-// vtkCutter: To slice the volume
+// vtkImagePlaneCutter: To slice the volume, only visiting the voxels the
+// slice plane goes through
 //
 // vtkCylinder: Implicit function used to clip the volume
 //
 // vtkClipDataSet: Clip algorithm that clips the slice to the shape of the
-// implicit function.
+// implicit function. It only processes the slice, never the volume.
 
 
 // VTK includes
@@ -14,7 +15,6 @@
 #include <vtkCamera.h>
 #include <vtkClipDataSet.h>
 #include <vtkColorTransferFunction.h>
-#include <vtkCutter.h>
 #include <vtkCylinder.h>
 #include <vtkDataSetMapper.h>
 #include <vtkImageData.h>
@@ -30,6 +30,8 @@
 #include <vtkUnstructuredGrid.h>
 #include <vtkXMLImageDataReader.h>
 
+#include "vtkImagePlaneCutter.h"
+
 int main(int, char**)
 {
   // Read the volume file from the Data directory next to exe file
@@ -74,9 +76,9 @@ int main(int, char**)
   slicePlane->SetOrigin(18.5, 17.5, 69.3);
 
   // Slice the volume
-  vtkNew<vtkCutter> cutter;
+  vtkNew<vtkImagePlaneCutter> cutter;
   cutter->SetInputData(data);
-  cutter->SetCutFunction(slicePlane.GetPointer());
+  cutter->SetPlane(slicePlane.GetPointer());
 
   // Clip the slice with the cylindrical function
   vtkNew<vtkClipDataSet> clipData;
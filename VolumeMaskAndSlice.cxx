@@ -1,21 +1,34 @@
 // This example illustrates the masking a vtkImageData for volume rendering and
 // slicing it. The sample code applies the mask to the slices as well.
+//
+// The Up and Down keys scroll the slice through the volume. The slices are
+// computed on a background thread and shown when they are finished, so the
+// camera stays responsive however long a slice takes. The slices are cached
+// and the next ones are computed ahead in the scroll direction.
+//
+// The Right and Left keys thicken and thin the slice into a slab by one
+// voxel, and the m key cycles the slab between the maximum, minimum and mean
+// intensity projections of the voxels inside the mask.
+//
+// Usage: VolumeMaskAndSlice [mask.vti|mask.mraw]
+//
+// A mask file with the geometry of the volume, such as Data/Cylinder.vti, is
+// used instead of the cylinder. The cylinder is rasterized only the first
+// time, then mapped from the cache in the Data directory.
+//
+// Set VTK_PIPELINE_PROFILE=1 to print the time of each stage at exit, or
+// VTK_PIPELINE_PROFILE=trace.json to also write a Chrome trace.
 
 // VTK includes
 #include <vtkActor.h>
+#include <vtkCallbackCommand.h>
 #include <vtkCamera.h>
 #include <vtkColorTransferFunction.h>
-#include <vtkCylinder.h>
 #include <vtkGPUVolumeRayCastMapper.h>
 #include <vtkImageActor.h>
-#include <vtkImageCast.h>
 #include <vtkImageData.h>
-#include <vtkImageMapToColors.h>
 #include <vtkImageMapper3D.h>
-#include <vtkImageMathematics.h>
 #include <vtkImageProperty.h>
-#include <vtkImageReslice.h>
-#include <vtkImageShiftScale.h>
 #include <vtkInteractorStyleTrackballCamera.h>
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
@@ -31,13 +44,95 @@
 #include <vtkVolumeProperty.h>
 #include <vtkXMLImageDataReader.h>
 
-#include "vtkImageMapToRGBA.h"
+#include "vtkImageAsyncSliceProducer.h"
+#include "vtkImageMaskProvider.h"
+#include "vtkImageMaskedResliceToRGBA.h"
+#include "vtkImageShapeMaskSource.h"
+#include "vtkPipelineProfiler.h"
 
-int main(int, char**)
+#include <cstring>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+struct SliceScroll
+{
+  vtkImageMaskedResliceToRGBA* Slice;
+  vtkImageAsyncSliceProducer* Producer;
+  double Origin[3];
+  double Step;
+  double Range[2];
+};
+
+//-----------------------------------------------------------------------------
+// Move the slice by one voxel along z on Up and Down, change the slab on
+// Right, Left and m
+void ScrollSlice(vtkObject* caller, unsigned long, void* clientData, void*)
+{
+  vtkRenderWindowInteractor* iren =
+    static_cast<vtkRenderWindowInteractor*>(caller);
+  SliceScroll* scroll = static_cast<SliceScroll*>(clientData);
+  const char* key = iren->GetKeySym();
+  vtkImageMaskedResliceToRGBA* slice = scroll->Slice;
+  if (key && (strcmp(key, "Right") == 0 || strcmp(key, "Left") == 0))
+    {
+    double thickness = slice->GetSlabThickness() +
+      (strcmp(key, "Right") == 0 ? scroll->Step : -scroll->Step);
+    slice->SetSlabThickness(thickness > 0.0 ? thickness : 0.0);
+    scroll->Producer->RequestSlice();
+    return;
+    }
+  if (key && strcmp(key, "m") == 0)
+    {
+    slice->SetSlabMode((slice->GetSlabMode() + 1) % 3);
+    scroll->Producer->RequestSlice();
+    return;
+    }
+  double z = scroll->Origin[2];
+  if (key && strcmp(key, "Up") == 0)
+    {
+    z += scroll->Step;
+    }
+  else if (key && strcmp(key, "Down") == 0)
+    {
+    z -= scroll->Step;
+    }
+  if (z == scroll->Origin[2] || z < scroll->Range[0] || z > scroll->Range[1])
+    {
+    return;
+    }
+  scroll->Origin[2] = z;
+  slice->SetResliceAxesOrigin(scroll->Origin[0], scroll->Origin[1],
+                              scroll->Origin[2]);
+  scroll->Producer->RequestSlice();
+}
+
+//-----------------------------------------------------------------------------
+// Show the slices finished by the background thread
+void ShowSlice(vtkObject* caller, unsigned long, void* clientData, void*)
 {
+  vtkRenderWindowInteractor* iren =
+    static_cast<vtkRenderWindowInteractor*>(caller);
+  vtkImageAsyncSliceProducer* producer =
+    static_cast<vtkImageAsyncSliceProducer*>(clientData);
+  if (producer->CheckForNewSlice())
+    {
+    iren->Render();
+    }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  // Does nothing unless VTK_PIPELINE_PROFILE is set
+  vtkNew<vtkPipelineProfiler> profiler;
+
   // Read the Volume file from the Data directory next to exe file
   vtkNew<vtkXMLImageDataReader> reader;
   reader->SetFileName("Data/Volume.vti");
+  profiler->Observe(reader.GetPointer());
   reader->Update();
 
   vtkNew<vtkTriangleFilter> tf;
@@ -58,91 +153,31 @@ int main(int, char**)
     center[i] = origin[i] + spacing[i] * 0.5 * (extent[2*i] + extent[2*i+1]);
     }
 
-  // Create a mask image data with the same parameters as the volume
-  vtkNew<vtkImageData> mask;
-  mask->SetDimensions(dims);
-  mask->SetOrigin(extent[0], extent[2], extent[4]);
-  mask->SetSpacing(spacing);
-  mask->SetExtent(extent);
-  mask->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-
-  char * ptr = static_cast<char *> (mask->GetScalarPointer(0,0,0));
-
-  double radius = dims[0]/2.0 - 5.0;
-
-  // Create a cylindrical implicit function centered at the center of the mask
-  // and with a custom radius
-  vtkNew<vtkCylinder> cylinder;
-  cylinder->SetCenter(center[0], center[2], center[1]);
-  cylinder->SetRadius(radius);
-
-  // Set all values of the mask within and on the cylinder = 255 and all other
-  // values = 0.
-  // NOTE: We set 255 since that is the requirement for the GPU
-  // volume mapper binary mask.
-  for ( int z = 0; z < dims[2]; ++z)
-    {
-    for ( int y = 0; y < dims[1]; ++y)
-      {
-      for (int x = 0; x < dims[0]; ++x)
-        {
-        if (cylinder->vtkImplicitFunction::EvaluateFunction(x,z,y) > 0)
-          {
-          // point is outide cylinder
-          *ptr++ = 0;
-          }
-        else
-          {
-          *ptr++ = 255;
-          }
-        }
-      }
-    }
-
-  // Create a reslice filter with center at origin and slice as sagittal plane
-  vtkNew<vtkImageReslice> reslice;
-  reslice->SetInputConnection(reader->GetOutputPort());
-  reslice->SetOutputDimensionality(2);
-  reslice->SetResliceAxesDirectionCosines( 1,0, 0,
-                                           0,1,0,
-                                           0,0,-1);
-  reslice->SetResliceAxesOrigin(18.5, 17.5, 69.3);
-  reslice->SetInterpolationModeToLinear();
-  reslice->Update();
-
-  // Slice the volume
-  vtkNew<vtkImageData> reslicedVolume;
-  reslicedVolume->DeepCopy(reslice->GetOutput());
-
-  // Slice the mask
-  reslice->SetInputData(mask.GetPointer());
-  reslice->Update();
-  vtkNew<vtkImageData> reslicedMask;
-  reslicedMask->DeepCopy(reslice->GetOutput());
-
-  // Scale the mask to have values either 1 or 0 and the same scalar type as the
-  // volume slice. This is necessary to mask slice values
-  vtkNew<vtkImageShiftScale> shiftScale;
-  shiftScale->SetInputData(reslicedMask.GetPointer());
-  shiftScale->SetShift(0.0);
-  shiftScale->SetScale(1/255.0);
-  shiftScale->SetOutputScalarType(reslicedVolume->GetScalarType());
-  shiftScale->Update();
-
-  // Multiply the volume slice with the scaled mask slice. The result of this
-  // operation is a masked volume slice.
-  vtkNew<vtkImageMathematics> imMath;
-  imMath->SetInput1Data(reslicedVolume.GetPointer());
-  imMath->SetInput2Data(shiftScale->GetOutput());
-  imMath->SetOperationToMultiply();
+  // Load the mask file, or a cylindrical mask with the same parameters as
+  // the volume, centered at the center of the volume and with a custom
+  // radius, cached from a previous session or rasterized.
+  // NOTE: Voxels within and on the cylinder are set to 255 since that is the
+  // requirement for the GPU volume mapper binary mask.
+  vtkNew<vtkImageMaskProvider> maskProvider;
+  maskProvider->SetMaskFileName(argc > 1 ? argv[1] : NULL);
+  maskProvider->SetCacheDirectory("Data");
+  vtkImageShapeMaskSource* maskSource = maskProvider->GetShapeSource();
+  maskSource->SetShapeTypeToCylinder();
+  maskSource->SetCylinderAxis(2);
+  maskSource->SetCenter(center);
+  maskSource->SetRadius((dims[0]/2.0 - 5.0)*spacing[0]);
+  profiler->StartStage("mask");
+  vtkImageData* mask = maskProvider->GetMask(reader->GetOutput());
+  profiler->EndStage("mask",
+                     static_cast<vtkIdType>(mask->GetActualMemorySize())*1024);
 
   // Create the GPU mapper and set the mask on it
   vtkNew<vtkGPUVolumeRayCastMapper> originalVolumeMapper;
   originalVolumeMapper->SetInputConnection(reader->GetOutputPort());
   vtkNew<vtkGPUVolumeRayCastMapper> volumeMapper;
-  //volumeMapper->SetInputData(mask.GetPointer());
+  //volumeMapper->SetInputData(mask);
   volumeMapper->SetInputConnection(reader->GetOutputPort());
-  volumeMapper->SetMaskInput(mask.GetPointer());
+  volumeMapper->SetMaskInput(mask);
   volumeMapper->SetMaskTypeToBinary();
 
   // Create color transfer function
@@ -180,20 +215,35 @@ int main(int, char**)
   pwf1->AddPoint(3900.0, 1.0);
   pwf1->AddPoint(4458.0, 1.0);
 
-  vtkNew<vtkImageMapToRGBA> imageMapToRGBA;
-  imageMapToRGBA->SetInputConnection(imMath->GetOutputPort());
-  imageMapToRGBA->SetColorFunction(ctf.GetPointer());
-  imageMapToRGBA->SetOpacityFunction(pwf1.GetPointer());
+  // Reslice the volume and the mask as an axial plane, mask the slice and
+  // map it to RGBA in a single pass. The filter only holds the settings,
+  // the slices are computed by the producer off the render thread.
+  vtkNew<vtkImageMaskedResliceToRGBA> maskedSlice;
+  maskedSlice->SetInputConnection(reader->GetOutputPort());
+  maskedSlice->SetMaskInputData(mask);
+  maskedSlice->SetResliceAxesDirectionCosines( 1,0, 0,
+                                               0,1,0,
+                                               0,0,-1);
+  maskedSlice->SetResliceAxesOrigin(18.5, 17.5, 69.3);
+  maskedSlice->SetInterpolationModeToLinear();
+  maskedSlice->SetColorFunction(ctf.GetPointer());
+  maskedSlice->SetOpacityFunction(pwf1.GetPointer());
+  vtkNew<vtkImageAsyncSliceProducer> producer;
+  producer->SetSlicer(maskedSlice.GetPointer());
+  profiler->Observe(producer.GetPointer());
+  producer->RequestSlice();
+  producer->WaitForSlice();
 
   vtkNew<vtkImageProperty> imProp;
   imProp->SetInterpolationTypeToNearest();
   vtkNew<vtkImageActor> slice;
-  slice->GetMapper()->SetInputConnection(imageMapToRGBA->GetOutputPort());
+  slice->GetMapper()->SetInputConnection(producer->GetOutputPort());
   slice->SetProperty(imProp.GetPointer());
 
   // Create an outline for the volume
   vtkNew<vtkOutlineFilter> outline;
   outline->SetInputConnection(reader->GetOutputPort());
+  profiler->Observe(outline.GetPointer());
   vtkNew<vtkPolyDataMapper> outlineMapper;
   outlineMapper->SetInputConnection(outline->GetOutputPort());
   vtkNew<vtkActor> outlineActor;
@@ -203,11 +253,31 @@ int main(int, char**)
   vtkNew<vtkRenderWindow> renWin;
   renWin->SetSize(800,400);
   renWin->SetMultiSamples(0);
+  profiler->Observe(renWin.GetPointer(), "Render");
   vtkNew<vtkRenderWindowInteractor> iren;
   iren->SetRenderWindow(renWin.GetPointer());
   vtkNew<vtkInteractorStyleTrackballCamera> style;
   iren->SetInteractorStyle(style.GetPointer());
 
+  // Scroll the slice through the volume with the Up and Down keys
+  SliceScroll scroll;
+  scroll.Slice = maskedSlice.GetPointer();
+  scroll.Producer = producer.GetPointer();
+  scroll.Origin[0] = 18.5;
+  scroll.Origin[1] = 17.5;
+  scroll.Origin[2] = 69.3;
+  scroll.Step = spacing[2];
+  scroll.Range[0] = origin[2] + extent[4]*spacing[2];
+  scroll.Range[1] = origin[2] + extent[5]*spacing[2];
+  vtkNew<vtkCallbackCommand> scrollCallback;
+  scrollCallback->SetCallback(ScrollSlice);
+  scrollCallback->SetClientData(&scroll);
+  iren->AddObserver(vtkCommand::KeyPressEvent, scrollCallback.GetPointer());
+  vtkNew<vtkCallbackCommand> showCallback;
+  showCallback->SetCallback(ShowSlice);
+  showCallback->SetClientData(producer.GetPointer());
+  iren->AddObserver(vtkCommand::TimerEvent, showCallback.GetPointer());
+
   vtkNew<vtkRenderer> ren1;
   ren1->SetViewport(0,0,0.5,1);
   renWin->AddRenderer(ren1.GetPointer());
@@ -225,6 +295,7 @@ int main(int, char**)
 
   renWin->Render();
   iren->Initialize();
+  iren->CreateRepeatingTimer(15);
   iren->Start();
 
   return EXIT_SUCCESS;
@@ -2,17 +2,43 @@
 // and slicing it using the unstructured grid approach. This approach should be
 // preferred when it is required to mask parts of voxels for a smoother edge.
 //
+// Only the voxels crossed by the cylinder are clipped into tetrahedra, the
+// voxels entirely inside stay in a blanked vtkImageData (vtkUniformGrid).
+// The interior is volume rendered as an image, with a binary mask built
+// from the blanking that only keeps the points whose voxels are all kept,
+// so that it never reaches into the boundary voxels. Only the clipped
+// boundary shell is rendered with projected tetrahedra.
+//
+// Projecting the tetrahedra of the shell again every frame is slow while the
+// camera moves, so the volume is also decimated 2 and 4 times before
+// clipping, and both volumes are rendered from the coarser levels during
+// interaction. Each level keeps its interior structured and only
+// tetrahedralizes its own boundary shell. Each frame moves to a coarser
+// level when it took longer than the target frame time, and to a finer one
+// when it took less than a quarter of it. Full resolution is restored when
+// the interaction stops.
+//
+// Usage: VolumeMaskAndSlice2 [frame time in ms]
+//
+// The target frame time defaults to 66 ms, 15 frames per second.
+//
+// Set VTK_PIPELINE_PROFILE=1 to print the time of each stage at exit, or
+// VTK_PIPELINE_PROFILE=trace.json to also write a Chrome trace.
+//
 
 // VTK includes
 #include <vtkActor.h>
+#include <vtkCallbackCommand.h>
 #include <vtkCamera.h>
-#include <vtkClipDataSet.h>
 #include <vtkColorTransferFunction.h>
+#include <vtkCompositeDataGeometryFilter.h>
 #include <vtkCutter.h>
 #include <vtkCylinder.h>
-#include <vtkDataSetTriangleFilter.h>
 #include <vtkImageData.h>
+#include <vtkImageShrink3D.h>
 #include <vtkInteractorStyleTrackballCamera.h>
+#include <vtkLODProp3D.h>
+#include <vtkMultiBlockDataSet.h>
 #include <vtkNew.h>
 #include <vtkOutlineFilter.h>
 #include <vtkPiecewiseFunction.h>
@@ -24,18 +50,147 @@
 #include <vtkRenderer.h>
 #include <vtkSmartPointer.h>
 #include <vtkSmartVolumeMapper.h>
-#include <vtkVolume.h>
 #include <vtkVolumeProperty.h>
 #include <vtkXMLImageDataReader.h>
 #include <vtkTransform.h>
 #include <vtkPlane.h>
+#include <vtkUniformGrid.h>
+#include <vtkUnstructuredGrid.h>
 //#include <vtkXMLUnstructuredGridWriter.h>
 
-int main (int, char **)
+#include "vtkImageHybridClip.h"
+#include "vtkPipelineProfiler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+
+// Full resolution, then the volume decimated 2 and 4 times
+const int NumberOfLevels = 3;
+const int ShrinkFactors[NumberOfLevels] = { 1, 2, 4 };
+
+//-----------------------------------------------------------------------------
+// Levels of detail of the interior and boundary volumes, switched together
+// so that they always come from the same decimated image
+struct LevelOfDetail
+{
+  vtkLODProp3D* Volumes[2];
+  int Ids[2][NumberOfLevels];
+  vtkRenderer* Renderer;
+  double FrameTime;
+  int Level;
+  int InteractiveLevel;
+  int Interacting;
+};
+
+//-----------------------------------------------------------------------------
+void SelectLevel(LevelOfDetail* lod, int level)
+{
+  lod->Level = level;
+  for (int v = 0; v < 2; ++v)
+    {
+    lod->Volumes[v]->SetSelectedLODID(lod->Ids[v][level]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Render from the level that last met the frame time while the camera
+// moves, at full resolution once it stops. The style renders right after
+// these events.
+void ChangeInteraction(vtkObject*, unsigned long eventId, void* clientData,
+                       void*)
 {
+  LevelOfDetail* lod = static_cast<LevelOfDetail*>(clientData);
+  lod->Interacting = (eventId == vtkCommand::StartInteractionEvent);
+  SelectLevel(lod, lod->Interacting ? lod->InteractiveLevel : 0);
+}
+
+//-----------------------------------------------------------------------------
+// Move to a coarser level after a frame slower than the target, to a finer
+// one after a frame fast enough for it: a level renders about four times
+// as many tetrahedra in its shell as the next coarser one
+void AdaptLevel(vtkObject*, unsigned long, void* clientData, void*)
+{
+  LevelOfDetail* lod = static_cast<LevelOfDetail*>(clientData);
+  if (!lod->Interacting)
+    {
+    return;
+    }
+  double time = lod->Renderer->GetLastRenderTimeInSeconds();
+  if (time > lod->FrameTime && lod->Level < NumberOfLevels - 1)
+    {
+    SelectLevel(lod, lod->Level + 1);
+    }
+  else if (time < 0.25*lod->FrameTime && lod->Level > 0)
+    {
+    SelectLevel(lod, lod->Level - 1);
+    }
+  lod->InteractiveLevel = lod->Level;
+}
+
+//-----------------------------------------------------------------------------
+// Binary mask of the interior block for the volume mapper, which masks the
+// points of the image: a point is kept when none of the voxels around it is
+// blanked, so that the mask never keeps a sample of a boundary voxel
+vtkSmartPointer<vtkImageData> MakeInteriorMask(vtkUniformGrid* interior)
+{
+  int dims[3];
+  interior->GetDimensions(dims);
+  vtkIdType sliceSize = static_cast<vtkIdType>(dims[0])*dims[1];
+
+  vtkSmartPointer<vtkImageData> mask = vtkSmartPointer<vtkImageData>::New();
+  mask->SetExtent(interior->GetExtent());
+  mask->SetOrigin(interior->GetOrigin());
+  mask->SetSpacing(interior->GetSpacing());
+  mask->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  unsigned char* points =
+    static_cast<unsigned char*>(mask->GetScalarPointer());
+  memset(points, 255, static_cast<size_t>(sliceSize*dims[2]));
+
+  int cellDims[3];
+  for (int c = 0; c < 3; ++c)
+    {
+    cellDims[c] = std::max(dims[c] - 1, 1);
+    }
+  vtkIdType cellId = 0;
+  for (int k = 0; k < cellDims[2]; ++k)
+    {
+    for (int j = 0; j < cellDims[1]; ++j)
+      {
+      for (int i = 0; i < cellDims[0]; ++i, ++cellId)
+        {
+        if (interior->IsCellVisible(cellId))
+          {
+          continue;
+          }
+        // Clear the corners of the blanked voxel
+        for (int c = 0; c < 8; ++c)
+          {
+          int x = std::min(i + (c & 1), dims[0] - 1);
+          int y = std::min(j + ((c >> 1) & 1), dims[1] - 1);
+          int z = std::min(k + ((c >> 2) & 1), dims[2] - 1);
+          points[x + y*dims[0] + z*sliceSize] = 0;
+          }
+        }
+      }
+    }
+  return mask;
+}
+
+}
+
+int main (int argc, char* argv[])
+{
+  // Does nothing unless VTK_PIPELINE_PROFILE is set
+  vtkNew<vtkPipelineProfiler> profiler;
+
   // Read the volume file from the Data directory next to exe file
   vtkNew<vtkXMLImageDataReader> reader;
   reader->SetFileName("Data/Volume.vti");
+  profiler->Observe(reader.GetPointer());
   reader->Update();
 
   // Fetch volume parameters
@@ -67,31 +222,6 @@ int main (int, char **)
   cylinder->SetRadius(radius);
   cylinder->SetTransform(t.GetPointer());
 
-  // Clip the data with the cylinder function
-  vtkNew<vtkClipDataSet> clipData;
-  clipData->SetInputConnection(reader->GetOutputPort());
-  clipData->SetClipFunction(cylinder.GetPointer());
-  clipData->InsideOutOn();
-
-//  vtkNew<vtkXMLUnstructuredGridWriter> w;
-//  w->SetFileName("c.vtu");
-//  w->SetInputConnection(clipData->GetOutputPort());
-//  w->Write();
-
-  // Tetrahedralize the clipped unstructured grid
-  vtkNew<vtkDataSetTriangleFilter> tetrahedralize;
-  tetrahedralize->SetInputConnection(clipData->GetOutputPort());
-
-//  w->SetFileName("tt.vtu");
-//  w->SetInputConnection(tetrahedralize->GetOutputPort());
-//  w->Write();
-
-  // Create the volume mapper
-  vtkNew<vtkProjectedTetrahedraMapper> clippedVolumeMapper;
-  clippedVolumeMapper->SetInputConnection(tetrahedralize->GetOutputPort());
-  vtkNew<vtkSmartVolumeMapper> originalVolumeMapper;
-  originalVolumeMapper->SetInputConnection(reader->GetOutputPort());
-
   // Create color transfer function
   vtkNew<vtkColorTransferFunction> ctf;
   ctf->AddRGBPoint(1096.0, 0.7, 0.015, 0.15);
@@ -111,10 +241,79 @@ int main (int, char **)
   volumeProperty->SetInterpolationTypeToLinear();
   volumeProperty->ShadeOff();
 
-  // Create the volume
-  vtkNew<vtkVolume> clippedVolume;
-  clippedVolume->SetMapper(clippedVolumeMapper.GetPointer());
-  clippedVolume->SetProperty(volumeProperty.GetPointer());
+  // Build every level of detail up front. Each level clips its own
+  // decimated image with the cylinder function: the interior voxels stay
+  // structured, only the boundary voxels are clipped and tetrahedralized.
+  LevelOfDetail lod;
+  vtkNew<vtkLODProp3D> interiorVolume;
+  vtkNew<vtkLODProp3D> clippedVolume;
+  lod.Volumes[0] = interiorVolume.GetPointer();
+  lod.Volumes[1] = clippedVolume.GetPointer();
+  vtkSmartPointer<vtkImageHybridClip> clipData;
+  for (int level = 0; level < NumberOfLevels; ++level)
+    {
+    vtkAlgorithmOutput* port = reader->GetOutputPort();
+    if (level > 0)
+      {
+      int f = ShrinkFactors[level];
+      vtkSmartPointer<vtkImageShrink3D> shrink =
+        vtkSmartPointer<vtkImageShrink3D>::New();
+      shrink->SetInputConnection(reader->GetOutputPort());
+      shrink->SetShrinkFactors(f, f, f);
+      shrink->AveragingOn();
+      profiler->Observe(shrink);
+      shrink->Update();
+      port = shrink->GetOutputPort();
+      }
+
+    vtkSmartPointer<vtkImageHybridClip> clip =
+      vtkSmartPointer<vtkImageHybridClip>::New();
+    clip->SetInputConnection(port);
+    clip->SetClipFunction(cylinder.GetPointer());
+    clip->InsideOutOn();
+    profiler->Observe(clip);
+    clip->Update();
+
+    vtkUniformGrid* interior = vtkUniformGrid::SafeDownCast(
+      clip->GetOutput()->GetBlock(vtkImageHybridClip::INTERIOR_BLOCK));
+    vtkUnstructuredGrid* boundary = vtkUnstructuredGrid::SafeDownCast(
+      clip->GetOutput()->GetBlock(vtkImageHybridClip::BOUNDARY_BLOCK));
+
+    vtkSmartPointer<vtkSmartVolumeMapper> interiorVolumeMapper =
+      vtkSmartPointer<vtkSmartVolumeMapper>::New();
+    interiorVolumeMapper->SetInputData(interior);
+    interiorVolumeMapper->SetMaskInput(MakeInteriorMask(interior));
+    interiorVolumeMapper->SetMaskTypeToBinary();
+    vtkSmartPointer<vtkProjectedTetrahedraMapper> clippedVolumeMapper =
+      vtkSmartPointer<vtkProjectedTetrahedraMapper>::New();
+    clippedVolumeMapper->SetInputData(boundary);
+
+    lod.Ids[0][level] = interiorVolume->AddLOD(
+      interiorVolumeMapper, volumeProperty.GetPointer(), 0.0);
+    lod.Ids[1][level] = clippedVolume->AddLOD(
+      clippedVolumeMapper, volumeProperty.GetPointer(), 0.0);
+
+    // The slice is cut from the full resolution blocks
+    if (level == 0)
+      {
+      clipData = clip;
+      }
+    }
+
+  // The levels are selected by the callbacks below instead of by the
+  // estimated render times of the props
+  interiorVolume->AutomaticLODSelectionOff();
+  clippedVolume->AutomaticLODSelectionOff();
+  lod.FrameTime = (argc > 1 ? atof(argv[1]) : 66.0) / 1000.0;
+  lod.InteractiveLevel = NumberOfLevels - 1;
+  lod.Interacting = 0;
+  SelectLevel(&lod, 0);
+
+//  vtkNew<vtkXMLUnstructuredGridWriter> w;
+//  w->SetFileName("tt.vtu");
+//  w->SetInputData(clipData->GetOutput()->GetBlock(
+//    vtkImageHybridClip::BOUNDARY_BLOCK));
+//  w->Write();
 
   // Create the outline for the volumes
   vtkNew<vtkOutlineFilter> outline;
@@ -130,12 +329,17 @@ int main (int, char **)
   slicePlane->SetNormal(0, 0, -1);
   slicePlane->SetOrigin(18.5, 17.5, 69.3);
 
+  // The cutter runs on both blocks and skips the blanked interior voxels
   vtkNew<vtkCutter> cutter;
   cutter->SetInputConnection(clipData->GetOutputPort());
   cutter->SetCutFunction(slicePlane.GetPointer());
+  vtkNew<vtkCompositeDataGeometryFilter> sliceGeometry;
+  sliceGeometry->SetInputConnection(cutter->GetOutputPort());
 
   vtkNew<vtkPolyDataMapper> sliceMapper;
-  sliceMapper->SetInputConnection(cutter->GetOutputPort());
+  sliceMapper->SetInputConnection(sliceGeometry->GetOutputPort());
+  profiler->ObservePipeline(sliceGeometry.GetPointer());
+  profiler->Observe(outline.GetPointer());
   sliceMapper->SetLookupTable(ctf.GetPointer());
 
   vtkNew<vtkActor> slice;
@@ -145,10 +349,15 @@ int main (int, char **)
   vtkNew<vtkRenderWindow> renWin;
   renWin->SetSize(800,400);
   renWin->SetMultiSamples(0);
+  profiler->Observe(renWin.GetPointer(), "Render");
   vtkNew<vtkRenderWindowInteractor> iren;
   iren->SetRenderWindow(renWin.GetPointer());
   vtkNew<vtkInteractorStyleTrackballCamera> style;
   iren->SetInteractorStyle(style.GetPointer());
+  if (lod.FrameTime > 0.0)
+    {
+    iren->SetDesiredUpdateRate(1.0 / lod.FrameTime);
+    }
 
   vtkNew<vtkRenderer> ren1;
   ren1->SetViewport(0,0,0.5,1);
@@ -157,6 +366,7 @@ int main (int, char **)
   ren2->SetViewport(0.5,0,1,1);
   renWin->AddRenderer(ren2.GetPointer());
 
+  ren1->AddVolume(interiorVolume.GetPointer());
   ren1->AddVolume(clippedVolume.GetPointer());
   ren1->AddActor(outlineActor.GetPointer());
   ren1->ResetCamera();
@@ -165,6 +375,19 @@ int main (int, char **)
   ren2->AddActor(slice.GetPointer());
   ren2->ResetCamera();
 
+  lod.Renderer = ren1.GetPointer();
+  vtkNew<vtkCallbackCommand> interactionCallback;
+  interactionCallback->SetCallback(ChangeInteraction);
+  interactionCallback->SetClientData(&lod);
+  style->AddObserver(vtkCommand::StartInteractionEvent,
+                     interactionCallback.GetPointer());
+  style->AddObserver(vtkCommand::EndInteractionEvent,
+                     interactionCallback.GetPointer());
+  vtkNew<vtkCallbackCommand> adaptCallback;
+  adaptCallback->SetCallback(AdaptLevel);
+  adaptCallback->SetClientData(&lod);
+  renWin->AddObserver(vtkCommand::EndEvent, adaptCallback.GetPointer());
+
   renWin->Render();
   iren->Initialize();
   iren->Start();
@@ -0,0 +1,523 @@
+// This program renders many masked, colormapped slices of a volume to disk
+// without a render window, for batch jobs. Every slice goes through the
+// reslice, mask and colormap pipeline of VolumeMaskAndSlice.cxx, fused in
+// vtkImageMaskedResliceToRGBA, and the slices are spread over threads, each
+// with its own copy of the pipeline.
+//
+// Usage: VolumeMaskAndSliceBatch [options]
+//
+//   --input file.vti|.mraw   volume to slice (default: Data/Volume.vti).
+//                            Raw volumes written by
+//                            VolumeMaskAndSliceConvert are mapped in memory
+//                            instead of read, compressed .vti volumes are
+//                            inflated on all threads.
+//   --mask shape|file.vti    cylinder (default), sphere, none, or a binary
+//                            mask image with any geometry
+//   --center x y z           center of the mask shape (default: center of
+//                            the volume)
+//   --radius r               radius of the mask shape (default: as in
+//                            VolumeMaskAndSlice.cxx)
+//   --plane ox oy oz nx ny nz
+//                            a slice plane through (ox, oy, oz) with normal
+//                            (nx, ny, nz), can be repeated
+//   --planes file.txt        slice planes, one "ox oy oz nx ny nz" per line
+//   --sweep x|y|z first last count
+//                            count planes perpendicular to an axis, evenly
+//                            spaced from first to last along it
+//   --format png|raw         output format (default: png). Raw slices are
+//                            named prefix_NNNNN_WxH.rgba and hold W*H RGBA
+//                            pixels, rows from bottom to top.
+//   --output prefix          output file prefix (default: slice)
+//   --threads n              number of threads (default: all cores)
+//
+// Without planes, every z slice of the volume is written.
+//
+// Set VTK_PIPELINE_PROFILE=1 to print the time of each stage at exit, or
+// VTK_PIPELINE_PROFILE=trace.json to also write a Chrome trace with one
+// row per thread.
+
+// VTK includes
+#include <vtkColorTransferFunction.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkPNGWriter.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkXMLImageDataReader.h>
+
+#include "vtkImageCompactMask.h"
+#include "vtkImageMappedRawReader.h"
+#include "vtkImageMaskedResliceToRGBA.h"
+#include "vtkImageParallelXMLReader.h"
+#include "vtkImageShapeMaskSource.h"
+#include "vtkPipelineProfiler.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+struct SlicePlane
+{
+  double Origin[3];
+  double Normal[3];
+};
+
+//-----------------------------------------------------------------------------
+// The slices of one thread are planes ThreadId, ThreadId + NumberOfThreads...
+struct BatchData
+{
+  std::vector<SlicePlane> Planes;
+  std::vector<vtkSmartPointer<vtkImageMaskedResliceToRGBA> > Slicers;
+  std::vector<vtkSmartPointer<vtkPNGWriter> > Writers;
+  std::vector<int> Failures;
+  std::string Prefix;
+  bool Raw;
+};
+
+//-----------------------------------------------------------------------------
+// Reslice axes whose third column is the plane normal. The rows and columns
+// of the slice follow the two world axes least aligned with the normal, so
+// that axial slices have the orientation of VolumeMaskAndSlice.cxx.
+void ComputeResliceAxes(const SlicePlane& plane, vtkMatrix4x4* axes)
+{
+  double n[3] = { plane.Normal[0], plane.Normal[1], plane.Normal[2] };
+  vtkMath::Normalize(n);
+  int a = 0;
+  for (int b = 1; b < 3; ++b)
+    {
+    a = (fabs(n[b]) > fabs(n[a]) ? b : a);
+    }
+  double u[3] = { 0.0, 0.0, 0.0 };
+  double v[3] = { 0.0, 0.0, 0.0 };
+  u[a == 0 ? 1 : 0] = 1.0;
+  v[a == 2 ? 1 : 2] = 1.0;
+
+  // Gram-Schmidt against the normal, then against u
+  double un = vtkMath::Dot(u, n);
+  for (int i = 0; i < 3; ++i)
+    {
+    u[i] -= un*n[i];
+    }
+  vtkMath::Normalize(u);
+  double vn = vtkMath::Dot(v, n);
+  double vu = vtkMath::Dot(v, u);
+  for (int i = 0; i < 3; ++i)
+    {
+    v[i] -= vn*n[i] + vu*u[i];
+    }
+  vtkMath::Normalize(v);
+
+  axes->Identity();
+  for (int i = 0; i < 3; ++i)
+    {
+    axes->SetElement(i, 0, u[i]);
+    axes->SetElement(i, 1, v[i]);
+    axes->SetElement(i, 2, n[i]);
+    axes->SetElement(i, 3, plane.Origin[i]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool WriteRaw(vtkImageData* slice, const std::string& prefix, size_t index)
+{
+  int dims[3];
+  slice->GetDimensions(dims);
+  char name[64];
+  sprintf(name, "_%05d_%dx%d.rgba", static_cast<int>(index), dims[0],
+          dims[1]);
+  FILE* file = fopen((prefix + name).c_str(), "wb");
+  if (!file)
+    {
+    return false;
+    }
+  size_t size = 4*static_cast<size_t>(dims[0])*dims[1];
+  bool ok = (fwrite(slice->GetScalarPointer(), 1, size, file) == size);
+  return (fclose(file) == 0 && ok);
+}
+
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE SliceThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  BatchData* data = static_cast<BatchData*>(info->UserData);
+  int thread = info->ThreadID;
+  int numThreads = info->NumberOfThreads;
+  vtkImageMaskedResliceToRGBA* slicer = data->Slicers[thread];
+  vtkPNGWriter* writer = data->Writers[thread];
+
+  vtkNew<vtkMatrix4x4> axes;
+  for (size_t p = thread; p < data->Planes.size(); p += numThreads)
+    {
+    ComputeResliceAxes(data->Planes[p], axes.GetPointer());
+    slicer->SetResliceAxes(axes.GetPointer());
+    if (data->Raw)
+      {
+      slicer->Update();
+      data->Failures[thread] +=
+        !WriteRaw(slicer->GetOutput(), data->Prefix, p);
+      }
+    else
+      {
+      char name[32];
+      sprintf(name, "_%05d.png", static_cast<int>(p));
+      writer->SetFileName((data->Prefix + name).c_str());
+      writer->Write();
+      data->Failures[thread] += (writer->GetErrorCode() != 0);
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//-----------------------------------------------------------------------------
+bool ReadPlanes(const char* fileName, std::vector<SlicePlane>& planes)
+{
+  std::ifstream file(fileName);
+  if (!file)
+    {
+    return false;
+    }
+  std::string line;
+  while (std::getline(file, line))
+    {
+    if (line.find_first_not_of(" \t\r") == std::string::npos ||
+        line[line.find_first_not_of(" \t\r")] == '#')
+      {
+      continue;
+      }
+    std::istringstream stream(line);
+    SlicePlane plane;
+    stream >> plane.Origin[0] >> plane.Origin[1] >> plane.Origin[2]
+           >> plane.Normal[0] >> plane.Normal[1] >> plane.Normal[2];
+    if (!stream)
+      {
+      return false;
+      }
+    planes.push_back(plane);
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int Usage(const char* program)
+{
+  std::cerr << "Usage: " << program
+            << " [--input file.vti] [--mask cylinder|sphere|none|file.vti]"
+            << " [--center x y z] [--radius r]"
+            << " [--plane ox oy oz nx ny nz]... [--planes file.txt]"
+            << " [--sweep x|y|z first last count] [--format png|raw]"
+            << " [--output prefix] [--threads n]" << std::endl;
+  return EXIT_FAILURE;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const char* inputName = "Data/Volume.vti";
+  const char* maskName = "cylinder";
+  const char* prefix = "slice";
+  const char* format = "png";
+  int numThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  bool hasCenter = false;
+  double center[3] = { 0.0, 0.0, 0.0 };
+  double radius = -1.0;
+  std::vector<SlicePlane> planes;
+  int sweepAxis = -1;
+  double sweepRange[2] = { 0.0, 0.0 };
+  int sweepCount = 0;
+
+  for (int i = 1; i < argc; ++i)
+    {
+    std::string arg = argv[i];
+    int left = argc - i - 1;
+    if (arg == "--input" && left >= 1)
+      {
+      inputName = argv[++i];
+      }
+    else if (arg == "--mask" && left >= 1)
+      {
+      maskName = argv[++i];
+      }
+    else if (arg == "--center" && left >= 3)
+      {
+      hasCenter = true;
+      for (int c = 0; c < 3; ++c)
+        {
+        center[c] = atof(argv[++i]);
+        }
+      }
+    else if (arg == "--radius" && left >= 1)
+      {
+      radius = atof(argv[++i]);
+      }
+    else if (arg == "--plane" && left >= 6)
+      {
+      SlicePlane plane;
+      for (int c = 0; c < 6; ++c)
+        {
+        (c < 3 ? plane.Origin[c] : plane.Normal[c - 3]) = atof(argv[++i]);
+        }
+      planes.push_back(plane);
+      }
+    else if (arg == "--planes" && left >= 1)
+      {
+      if (!ReadPlanes(argv[++i], planes))
+        {
+        std::cerr << "Cannot read planes from " << argv[i] << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    else if (arg == "--sweep" && left >= 4)
+      {
+      const char* axis = argv[++i];
+      sweepAxis = (strlen(axis) == 1 && axis[0] >= 'x' && axis[0] <= 'z' ?
+                   axis[0] - 'x' : -1);
+      sweepRange[0] = atof(argv[++i]);
+      sweepRange[1] = atof(argv[++i]);
+      sweepCount = atoi(argv[++i]);
+      if (sweepAxis < 0 || sweepCount < 1)
+        {
+        return Usage(argv[0]);
+        }
+      }
+    else if (arg == "--format" && left >= 1)
+      {
+      format = argv[++i];
+      }
+    else if (arg == "--output" && left >= 1)
+      {
+      prefix = argv[++i];
+      }
+    else if (arg == "--threads" && left >= 1)
+      {
+      numThreads = atoi(argv[++i]);
+      }
+    else
+      {
+      return Usage(argv[0]);
+      }
+    }
+  bool raw = (strcmp(format, "raw") == 0);
+  if ((!raw && strcmp(format, "png") != 0) || numThreads < 1)
+    {
+    return Usage(argv[0]);
+    }
+
+  // Does nothing unless VTK_PIPELINE_PROFILE is set
+  vtkNew<vtkPipelineProfiler> profiler;
+
+  // Any plane may go through any part of the volume, read all of it.
+  // Compressed .vti files are inflated on all threads when possible.
+  vtkSmartPointer<vtkImageAlgorithm> reader;
+  vtkSmartPointer<vtkImageParallelXMLReader> parallelReader =
+    vtkSmartPointer<vtkImageParallelXMLReader>::New();
+  if (vtkImageMappedRawReader::CanReadFile(inputName))
+    {
+    vtkSmartPointer<vtkImageMappedRawReader> rawReader =
+      vtkSmartPointer<vtkImageMappedRawReader>::New();
+    rawReader->SetFileName(inputName);
+    reader = rawReader;
+    }
+  else if (parallelReader->CanReadFile(inputName))
+    {
+    parallelReader->SetFileName(inputName);
+    reader = parallelReader;
+    }
+  else
+    {
+    vtkSmartPointer<vtkXMLImageDataReader> xmlReader =
+      vtkSmartPointer<vtkXMLImageDataReader>::New();
+    xmlReader->SetFileName(inputName);
+    reader = xmlReader;
+    }
+  profiler->Observe(reader);
+  reader->Update();
+  vtkImageData* volume = reader->GetOutput();
+  int extent[6];
+  double origin[3], spacing[3];
+  volume->GetExtent(extent);
+  volume->GetOrigin(origin);
+  volume->GetSpacing(spacing);
+  if (extent[0] > extent[1])
+    {
+    std::cerr << "Cannot read " << inputName << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  double volumeCenter[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    volumeCenter[i] =
+      origin[i] + spacing[i] * 0.5 * (extent[2*i] + extent[2*i+1]);
+    }
+  if (!hasCenter)
+    {
+    for (int i = 0; i < 3; ++i)
+      {
+      center[i] = volumeCenter[i];
+      }
+    }
+  if (radius < 0.0)
+    {
+    radius = ((extent[1] - extent[0] + 1)/2.0 - 5.0)*spacing[0];
+    }
+
+  if (sweepAxis >= 0)
+    {
+    for (int s = 0; s < sweepCount; ++s)
+      {
+      SlicePlane plane;
+      for (int c = 0; c < 3; ++c)
+        {
+        plane.Origin[c] = volumeCenter[c];
+        plane.Normal[c] = (c == sweepAxis ? 1.0 : 0.0);
+        }
+      plane.Origin[sweepAxis] = (sweepCount == 1 ? sweepRange[0] :
+        sweepRange[0] + s*(sweepRange[1] - sweepRange[0])/(sweepCount - 1));
+      planes.push_back(plane);
+      }
+    }
+  if (planes.empty())
+    {
+    for (int k = extent[4]; k <= extent[5]; ++k)
+      {
+      SlicePlane plane = { { volumeCenter[0], volumeCenter[1],
+                             origin[2] + k*spacing[2] },
+                           { 0.0, 0.0, -1.0 } };
+      planes.push_back(plane);
+      }
+    }
+
+  // Shape masks are rasterized once into a compact mask that all threads
+  // read, mask files are read as images
+  vtkNew<vtkImageCompactMask> compactMask;
+  vtkNew<vtkXMLImageDataReader> maskReader;
+  vtkImageData* maskImage = NULL;
+  bool useMask = (strcmp(maskName, "none") != 0);
+  if (strcmp(maskName, "cylinder") == 0 || strcmp(maskName, "sphere") == 0)
+    {
+    profiler->StartStage("mask");
+    vtkNew<vtkImageShapeMaskSource> maskSource;
+    maskSource->SetInformationFromImage(volume);
+    if (strcmp(maskName, "cylinder") == 0)
+      {
+      maskSource->SetShapeTypeToCylinder();
+      maskSource->SetCylinderAxis(2);
+      }
+    else
+      {
+      maskSource->SetShapeTypeToSphere();
+      }
+    maskSource->SetCenter(center);
+    maskSource->SetRadius(radius);
+    maskSource->GenerateCompactMask(compactMask.GetPointer());
+    profiler->EndStage("mask", static_cast<vtkIdType>(
+                         compactMask->GetActualMemorySize())*1024);
+    }
+  else if (useMask)
+    {
+    maskReader->SetFileName(maskName);
+    profiler->Observe(maskReader.GetPointer());
+    maskReader->Update();
+    maskImage = maskReader->GetOutput();
+    if (maskImage->GetNumberOfPoints() == 0)
+      {
+      std::cerr << "Cannot read " << maskName << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  vtkNew<vtkColorTransferFunction> ctf;
+  ctf->AddRGBPoint(1096.0, 0.7, 0.015, 0.15);
+  ctf->AddRGBPoint(2777, 0.86, 0.86, 0.86);
+  ctf->AddRGBPoint(4458, 0.23, 0.3, 0.75);
+  vtkNew<vtkPiecewiseFunction> pwf;
+  pwf->AddPoint(1096.0, 0.0);
+  pwf->AddPoint(3900.0, 0.0);
+  pwf->AddPoint(3900.0, 1.0);
+  pwf->AddPoint(4458.0, 1.0);
+
+  // One pipeline per thread. The threads share the voxels through shallow
+  // copies but no pipeline object.
+  numThreads = (static_cast<size_t>(numThreads) < planes.size() ?
+                numThreads : static_cast<int>(planes.size()));
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(numThreads);
+  numThreads = threader->GetNumberOfThreads();
+  BatchData data;
+  data.Planes = planes;
+  data.Failures.resize(numThreads, 0);
+  data.Prefix = prefix;
+  data.Raw = raw;
+  for (int t = 0; t < numThreads; ++t)
+    {
+    vtkNew<vtkImageData> threadVolume;
+    threadVolume->ShallowCopy(volume);
+    vtkNew<vtkColorTransferFunction> threadCtf;
+    threadCtf->DeepCopy(ctf.GetPointer());
+    vtkNew<vtkPiecewiseFunction> threadPwf;
+    threadPwf->DeepCopy(pwf.GetPointer());
+
+    vtkSmartPointer<vtkImageMaskedResliceToRGBA> slicer =
+      vtkSmartPointer<vtkImageMaskedResliceToRGBA>::New();
+    slicer->SetNumberOfThreads(1);
+    slicer->SetInputData(threadVolume.GetPointer());
+    if (maskImage)
+      {
+      vtkNew<vtkImageData> threadMask;
+      threadMask->ShallowCopy(maskImage);
+      slicer->SetMaskInputData(threadMask.GetPointer());
+      }
+    else if (useMask)
+      {
+      slicer->SetCompactMask(compactMask.GetPointer());
+      }
+    slicer->SetInterpolationModeToLinear();
+    slicer->SetColorFunction(threadCtf.GetPointer());
+    slicer->SetOpacityFunction(threadPwf.GetPointer());
+    data.Slicers.push_back(slicer);
+    profiler->Observe(slicer);
+
+    vtkSmartPointer<vtkPNGWriter> writer =
+      vtkSmartPointer<vtkPNGWriter>::New();
+    writer->SetInputConnection(slicer->GetOutputPort());
+    data.Writers.push_back(writer);
+    profiler->Observe(writer);
+    }
+
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  threader->SetSingleMethod(SliceThread, &data);
+  threader->SingleMethodExecute();
+  timer->StopTimer();
+
+  int failures = 0;
+  for (int t = 0; t < numThreads; ++t)
+    {
+    failures += data.Failures[t];
+    }
+  double time = timer->GetElapsedTime();
+  std::cout << "slices=" << planes.size()
+            << " threads=" << numThreads
+            << " format=" << format
+            << " time=" << time << "s"
+            << " rate=" << planes.size() / time << " slices/s"
+            << " failures=" << failures << std::endl;
+
+  return (failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,2005 @@
+// This program benchmarks the masking strategies used by the examples in this
+// repository on synthetic volumes of configurable size.
+//
+// Usage: VolumeMaskAndSliceBench [size] [repeats] [threads]
+//        VolumeMaskAndSliceBench --sizes 64,128,256
+//          --strategies reslice,clip,cut
+//          --orientations axial,sagittal,coronal,oblique
+//          --shapes cylinder,sphere,box --slices 32 --repeats 3
+//          --output results.json
+//
+// The first form runs the cases below on a size^3 volume and prints one
+// line per case. The second form, selected by any option, runs the masking
+// and slicing strategy of each example on every combination of the
+// options instead, which all default to the values above except the shapes
+// (default: cylinder), and writes JSON to the output file or to the
+// standard output:
+//
+// - reslice: the image mask of vtkImageShapeMaskSource and
+//   vtkImageMaskedResliceToRGBA, as in VolumeMaskAndSlice.cxx
+// - clip: vtkImageHybridClip and vtkCutter, as in VolumeMaskAndSlice2.cxx,
+//   skipped above 256^3
+// - cut: vtkImagePlaneCutter and vtkClipDataSet, as in SlicePipeline.cxx
+//
+// Each strategy is set up once per size and shape, such as computing the
+// mask, then computes the given number of slices evenly spaced along the
+// normal through the center, repeats times. The JSON follows the layout of
+// Google Benchmark, with per case the setup time, the mean, 50th, 90th and
+// 99th percentile and maximum latency of a slice in ms, the slices per
+// second, the mean number of output pixels or cells of a slice and the peak
+// resident memory. The cases of each size, shape and strategy run in a child
+// process of their own, the same program with the hidden option --child 1,
+// so that the peak is that of these cases alone.
+//
+// mask: compares the per-voxel vtkCylinder loop of VolumeMaskAndSlice.cxx
+// against the scanline rasterizer of vtkImageShapeMaskSource.
+//
+// slice: compares the five stage reslice, mask and colormap pipeline against
+// the single pass vtkImageMaskedResliceToRGBA filter.
+//
+// compact: compares the memory and slicing speed of the image mask against
+// the run-length and bitset encodings of vtkImageCompactMask.
+//
+// cut: compares vtkCutter with a vtkPlane against vtkImagePlaneCutter on a
+// grid plane, between two grid planes and on an oblique plane.
+//
+// clip: compares vtkClipDataSet and vtkDataSetTriangleFilter against
+// vtkImageParallelClip on 1, 2, 4... up to threads threads (default: all),
+// on a volume of at most 128^3. The checksum of the parallel output must not
+// depend on the number of threads.
+//
+// raycast: renders the masked volume with vtkImageMaskedRayCastToRGBA
+// without and with empty space skipping, on a volume of at most 256^3. Both
+// images must be identical.
+//
+// bricked: slices the masked volume along the axial, sagittal, coronal and
+// an oblique direction from the image layout and from linear and Morton
+// ordered bricks of vtkImageBrickedVolume. The slices must be identical.
+//
+// load: compares reading the volume from a zlib compressed .vti file with
+// mapping it from a .mraw file with vtkImageMappedRawReader. Both files are
+// written to the current directory and removed afterwards.
+//
+// inflate: compares vtkXMLImageDataReader with vtkImageParallelXMLReader on
+// 1, 2, 4... up to threads threads, reading Data/Volume.vti tiled to size^3
+// and written with zlib, and LZ4 from VTK 8.2 on.
+//
+// provider: compares rasterizing the cylinder mask with vtkImageMaskProvider
+// on a cache miss against mapping it from the cache on a hit. The cache
+// file is written to the current directory and removed afterwards.
+//
+// labels: colors a volume split into 1, 4 and 16 labels, each with its own
+// transfer functions, with one vtkImageMapToRGBA pass per label against a
+// single vtkImageLabelMapToRGBA pass. Both images must be identical.
+//
+// oblique: slices the volume along 16 oblique planes with the general
+// linear path of vtkImageReslice, and with vtkImageMaskedResliceToRGBA
+// without and with the cylinder mask, in Mpixels per second. Whether the
+// AVX2 kernel of vtkImagePlaneSampler is used is printed too.
+//
+// slab: computes masked axial and oblique slabs 1, 4, 16 and 64 voxels thick
+// with the maximum, minimum and mean projections of
+// vtkImageMaskedResliceToRGBA, in ms per slab and ns per sample.
+//
+// mpr: computes the masked axial, coronal and sagittal slices through a
+// crosshair with three vtkImageMaskedResliceToRGBA filters one after the
+// other, and together with vtkImageMaskedMPRToRGBA, then moves the crosshair
+// along z only, which recomputes the axial slice alone. The slices must be
+// identical.
+
+// VTK includes
+#include <vtkCamera.h>
+#include <vtkCellArray.h>
+#include <vtkBox.h>
+#include <vtkClipDataSet.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkCompositeDataGeometryFilter.h>
+#include <vtkCutter.h>
+#include <vtkCylinder.h>
+#include <vtkDataSetTriangleFilter.h>
+#include <vtkImageData.h>
+#include <vtkImageMathematics.h>
+#include <vtkImageReslice.h>
+#include <vtkImageShiftScale.h>
+#include <vtkImplicitFunction.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkPlane.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkSphere.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+#include <vtkUnstructuredGrid.h>
+#include <vtkVersionMacros.h>
+#include <vtkXMLImageDataReader.h>
+#include <vtkXMLImageDataWriter.h>
+#include <vtkZLibDataCompressor.h>
+
+#if VTK_MAJOR_VERSION > 8 || \
+    (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 2)
+#include <vtkLZ4DataCompressor.h>
+#endif
+
+#include "vtkImageBrickedVolume.h"
+#include "vtkImageCompactMask.h"
+#include "vtkImageHybridClip.h"
+#include "vtkImageLabelMapToRGBA.h"
+#include "vtkImageMacrocellGrid.h"
+#include "vtkImageMappedRawReader.h"
+#include "vtkImageMappedRawWriter.h"
+#include "vtkImageMapToRGBA.h"
+#include "vtkImageMaskProvider.h"
+#include "vtkImageMaskedMPRToRGBA.h"
+#include "vtkImageMaskedRayCastToRGBA.h"
+#include "vtkImageParallelClip.h"
+#include "vtkImageParallelXMLReader.h"
+#include "vtkImagePlaneCutter.h"
+#include "vtkImagePlaneSampler.h"
+#include "vtkImageMaskedResliceToRGBA.h"
+#include "vtkImageShapeMaskSource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// The original mask generation loop of VolumeMaskAndSlice.cxx
+void ImplicitFunctionMask(vtkImageData* mask, const double center[3],
+                          double radius)
+{
+  int dims[3];
+  mask->GetDimensions(dims);
+  unsigned char* ptr =
+    static_cast<unsigned char*>(mask->GetScalarPointer());
+
+  vtkNew<vtkCylinder> cylinder;
+  cylinder->SetCenter(center[0], center[2], center[1]);
+  cylinder->SetRadius(radius);
+
+  for (int z = 0; z < dims[2]; ++z)
+    {
+    for (int y = 0; y < dims[1]; ++y)
+      {
+      for (int x = 0; x < dims[0]; ++x)
+        {
+        if (cylinder->vtkImplicitFunction::EvaluateFunction(x,z,y) > 0)
+          {
+          *ptr++ = 0;
+          }
+        else
+          {
+          *ptr++ = 255;
+          }
+        }
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkMask(int size, int repeats)
+{
+  double center[3] = { 0.5*(size - 1), 0.5*(size - 1), 0.5*(size - 1) };
+  double radius = size/2.0 - 5.0;
+
+  vtkNew<vtkImageData> reference;
+  reference->SetExtent(0, size - 1, 0, size - 1, 0, size - 1);
+  reference->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+  vtkNew<vtkTimerLog> timer;
+  double loopTime = 0.0;
+  for (int r = 0; r < repeats; ++r)
+    {
+    timer->StartTimer();
+    ImplicitFunctionMask(reference.GetPointer(), center, radius);
+    timer->StopTimer();
+    loopTime += timer->GetElapsedTime();
+    }
+
+  vtkNew<vtkImageShapeMaskSource> source;
+  source->SetWholeExtent(0, size - 1, 0, size - 1, 0, size - 1);
+  source->SetShapeTypeToCylinder();
+  source->SetCylinderAxis(2);
+  source->SetCenter(center);
+  source->SetRadius(radius);
+
+  double sourceTime = 0.0;
+  for (int r = 0; r < repeats; ++r)
+    {
+    source->Modified();
+    timer->StartTimer();
+    source->Update();
+    timer->StopTimer();
+    sourceTime += timer->GetElapsedTime();
+    }
+
+  // Both strategies must produce the same mask
+  unsigned char* a =
+    static_cast<unsigned char*>(reference->GetScalarPointer());
+  unsigned char* b =
+    static_cast<unsigned char*>(source->GetOutput()->GetScalarPointer());
+  vtkIdType n = reference->GetNumberOfPoints();
+  vtkIdType mismatches = 0;
+  for (vtkIdType i = 0; i < n; ++i)
+    {
+    mismatches += (a[i] != b[i]);
+    }
+
+  double mvoxels = static_cast<double>(n) * 1.0e-6;
+  std::cout << "mask size=" << size << "^3"
+            << " loop=" << loopTime / repeats << "s"
+            << " (" << mvoxels * repeats / loopTime << " Mvox/s)"
+            << " source=" << sourceTime / repeats << "s"
+            << " (" << mvoxels * repeats / sourceTime << " Mvox/s)"
+            << " speedup=" << loopTime / sourceTime
+            << " mismatches=" << mismatches << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+// Fill a volume with a 12-bit pattern in the range of Data/Volume.vti
+void FillVolume(vtkImageData* volume, int size)
+{
+  volume->SetExtent(0, size - 1, 0, size - 1, 0, size - 1);
+  volume->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+  unsigned short* ptr =
+    static_cast<unsigned short*>(volume->GetScalarPointer());
+  for (int z = 0; z < size; ++z)
+    {
+    for (int y = 0; y < size; ++y)
+      {
+      for (int x = 0; x < size; ++x)
+        {
+        *ptr++ =
+          static_cast<unsigned short>(1096 + (x*7 + y*13 + z*3) % 3363);
+        }
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkSlice(int size, int repeats)
+{
+  vtkNew<vtkImageData> volume;
+  FillVolume(volume.GetPointer(), size);
+
+  vtkNew<vtkImageShapeMaskSource> maskSource;
+  maskSource->SetInformationFromImage(volume.GetPointer());
+  maskSource->SetCenter(0.5*(size - 1), 0.5*(size - 1), 0.5*(size - 1));
+  maskSource->SetRadius(size/2.0 - 5.0);
+  maskSource->Update();
+  vtkImageData* mask = maskSource->GetOutput();
+
+  vtkNew<vtkColorTransferFunction> ctf;
+  ctf->AddRGBPoint(1096.0, 0.7, 0.015, 0.15);
+  ctf->AddRGBPoint(2777, 0.86, 0.86, 0.86);
+  ctf->AddRGBPoint(4458, 0.23, 0.3, 0.75);
+  vtkNew<vtkPiecewiseFunction> pwf;
+  pwf->AddPoint(1096.0, 0.0);
+  pwf->AddPoint(3900.0, 0.0);
+  pwf->AddPoint(3900.0, 1.0);
+  pwf->AddPoint(4458.0, 1.0);
+
+  vtkNew<vtkTimerLog> timer;
+
+  // Five stage pipeline of the original VolumeMaskAndSlice.cxx
+  vtkNew<vtkImageReslice> reslice;
+  reslice->SetOutputDimensionality(2);
+  reslice->SetResliceAxesDirectionCosines(1,0,0, 0,1,0, 0,0,-1);
+  reslice->SetInterpolationModeToLinear();
+  vtkNew<vtkImageShiftScale> shiftScale;
+  shiftScale->SetShift(0.0);
+  shiftScale->SetScale(1/255.0);
+  shiftScale->SetOutputScalarType(volume->GetScalarType());
+  vtkNew<vtkImageMathematics> imMath;
+  imMath->SetOperationToMultiply();
+  vtkNew<vtkImageMapToRGBA> imageMapToRGBA;
+  imageMapToRGBA->SetInputConnection(imMath->GetOutputPort());
+  imageMapToRGBA->SetColorFunction(ctf.GetPointer());
+  imageMapToRGBA->SetOpacityFunction(pwf.GetPointer());
+
+  double pipelineTime = 0.0;
+  for (int r = 0; r < repeats; ++r)
+    {
+    timer->StartTimer();
+    for (int z = 0; z < size; ++z)
+      {
+      reslice->SetResliceAxesOrigin(0.5*size, 0.5*size, z);
+      reslice->SetInputData(volume.GetPointer());
+      reslice->Update();
+      vtkNew<vtkImageData> reslicedVolume;
+      reslicedVolume->DeepCopy(reslice->GetOutput());
+      reslice->SetInputData(mask);
+      reslice->Update();
+      vtkNew<vtkImageData> reslicedMask;
+      reslicedMask->DeepCopy(reslice->GetOutput());
+      shiftScale->SetInputData(reslicedMask.GetPointer());
+      imMath->SetInput1Data(reslicedVolume.GetPointer());
+      imMath->SetInput2Data(shiftScale->GetOutput());
+      shiftScale->Update();
+      imageMapToRGBA->Update();
+      }
+    timer->StopTimer();
+    pipelineTime += timer->GetElapsedTime();
+    }
+
+  vtkNew<vtkImageMaskedResliceToRGBA> maskedSlice;
+  maskedSlice->SetInputData(volume.GetPointer());
+  maskedSlice->SetMaskInputData(mask);
+  maskedSlice->SetResliceAxesDirectionCosines(1,0,0, 0,1,0, 0,0,-1);
+  maskedSlice->SetInterpolationModeToLinear();
+  maskedSlice->SetColorFunction(ctf.GetPointer());
+  maskedSlice->SetOpacityFunction(pwf.GetPointer());
+
+  double fusedTime = 0.0;
+  for (int r = 0; r < repeats; ++r)
+    {
+    timer->StartTimer();
+    for (int z = 0; z < size; ++z)
+      {
+      maskedSlice->SetResliceAxesOrigin(0.5*size, 0.5*size, z);
+      maskedSlice->Update();
+      }
+    timer->StopTimer();
+    fusedTime += timer->GetElapsedTime();
+    }
+
+  double slices = static_cast<double>(size) * repeats;
+  std::cout << "slice size=" << size << "^3"
+            << " pipeline=" << 1000.0 * pipelineTime / slices << "ms"
+            << " (" << slices / pipelineTime << " Hz)"
+            << " fused=" << 1000.0 * fusedTime / slices << "ms"
+            << " (" << slices / fusedTime << " Hz)"
+            << " speedup=" << pipelineTime / fusedTime << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkCompactMask(int size, int repeats)
+{
+  vtkNew<vtkImageData> volume;
+  FillVolume(volume.GetPointer(), size);
+
+  vtkNew<vtkImageShapeMaskSource> maskSource;
+  maskSource->SetInformationFromImage(volume.GetPointer());
+  maskSource->SetCenter(0.5*(size - 1), 0.5*(size - 1), 0.5*(size - 1));
+  maskSource->SetRadius(size/2.0 - 5.0);
+  maskSource->Update();
+  vtkImageData* mask = maskSource->GetOutput();
+
+  vtkNew<vtkColorTransferFunction> ctf;
+  ctf->AddRGBPoint(1096.0, 0.7, 0.015, 0.15);
+  ctf->AddRGBPoint(4458, 0.23, 0.3, 0.75);
+
+  vtkNew<vtkImageMaskedResliceToRGBA> maskedSlice;
+  maskedSlice->SetInputData(volume.GetPointer());
+  maskedSlice->SetMaskInputData(mask);
+  maskedSlice->SetResliceAxesDirectionCosines(1,0,0, 0,1,0, 0,0,-1);
+  maskedSlice->SetColorFunction(ctf.GetPointer());
+
+  vtkNew<vtkTimerLog> timer;
+  const char* names[3] = { "image", "runlength", "bitset" };
+  for (int m = 0; m < 3; ++m)
+    {
+    vtkNew<vtkImageCompactMask> compact;
+    unsigned long memory = mask->GetActualMemorySize();
+    vtkIdType mismatches = 0;
+    if (m > 0)
+      {
+      compact->SetEncoding(m == 1 ? vtkImageCompactMask::RUN_LENGTH :
+                           vtkImageCompactMask::BITSET);
+      maskSource->GenerateCompactMask(compact.GetPointer());
+      memory = compact->GetActualMemorySize();
+      maskedSlice->SetCompactMask(compact.GetPointer());
+
+      // The compact mask must round trip to the image mask
+      vtkNew<vtkImageData> exported;
+      compact->ExportImage(exported.GetPointer());
+      const unsigned char* a =
+        static_cast<const unsigned char*>(mask->GetScalarPointer());
+      const unsigned char* b =
+        static_cast<const unsigned char*>(exported->GetScalarPointer());
+      vtkIdType n = mask->GetNumberOfPoints();
+      for (vtkIdType i = 0; i < n; ++i)
+        {
+        mismatches += (a[i] != b[i]);
+        }
+      }
+
+    double sliceTime = 0.0;
+    for (int r = 0; r < repeats; ++r)
+      {
+      timer->StartTimer();
+      for (int z = 0; z < size; ++z)
+        {
+        maskedSlice->SetResliceAxesOrigin(0.5*size, 0.5*size, z);
+        maskedSlice->Update();
+        }
+      timer->StopTimer();
+      sliceTime += timer->GetElapsedTime();
+      }
+    maskedSlice->SetCompactMask(NULL);
+
+    double slices = static_cast<double>(size) * repeats;
+    std::cout << "compact size=" << size << "^3"
+              << " mask=" << names[m]
+              << " memory=" << memory << "KiB"
+              << " slice=" << 1000.0 * sliceTime / slices << "ms"
+              << " mismatches=" << mismatches << std::endl;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkCut(int size, int repeats)
+{
+  vtkNew<vtkImageData> volume;
+  FillVolume(volume.GetPointer(), size);
+
+  const char* names[3] = { "grid", "between", "oblique" };
+  const double normals[3][3] = { { 0, 0, -1 }, { 0, 0, -1 }, { 0.2, 0.3, -1 } };
+  const double offsets[3] = { 0.0, 0.3, 0.3 };
+
+  vtkNew<vtkTimerLog> timer;
+  for (int p = 0; p < 3; ++p)
+    {
+    vtkNew<vtkPlane> plane;
+    plane->SetNormal(normals[p][0], normals[p][1], normals[p][2]);
+    plane->SetOrigin(0.5*size, 0.5*size, 0.5*size + offsets[p]);
+
+    vtkNew<vtkCutter> cutter;
+    cutter->SetInputData(volume.GetPointer());
+    cutter->SetCutFunction(plane.GetPointer());
+    vtkNew<vtkImagePlaneCutter> imageCutter;
+    imageCutter->SetInputData(volume.GetPointer());
+    imageCutter->SetPlane(plane.GetPointer());
+
+    double cutterTime = 0.0;
+    double imageCutterTime = 0.0;
+    for (int r = 0; r < repeats; ++r)
+      {
+      cutter->Modified();
+      timer->StartTimer();
+      cutter->Update();
+      timer->StopTimer();
+      cutterTime += timer->GetElapsedTime();
+
+      imageCutter->Modified();
+      timer->StartTimer();
+      imageCutter->Update();
+      timer->StopTimer();
+      imageCutterTime += timer->GetElapsedTime();
+      }
+
+    std::cout << "cut size=" << size << "^3 plane=" << names[p]
+              << " cutter=" << 1000.0 * cutterTime / repeats << "ms"
+              << " image=" << 1000.0 * imageCutterTime / repeats << "ms"
+              << " speedup=" << cutterTime / imageCutterTime
+              << " points=" << cutter->GetOutput()->GetNumberOfPoints()
+              << "/" << imageCutter->GetOutput()->GetNumberOfPoints()
+              << std::endl;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Order dependent checksum of the points and connectivity of a grid
+double GridChecksum(vtkUnstructuredGrid* grid)
+{
+  double checksum = 0.0;
+  for (vtkIdType i = 0; i < grid->GetNumberOfPoints(); ++i)
+    {
+    double x[3];
+    grid->GetPoint(i, x);
+    checksum += (i % 1013 + 1) * (x[0] + 3.0*x[1] + 7.0*x[2]);
+    }
+  vtkIdType n = grid->GetCells()->GetNumberOfConnectivityEntries();
+  const vtkIdType* cells = grid->GetCells()->GetPointer();
+  for (vtkIdType i = 0; i < n; ++i)
+    {
+    checksum += (i % 1009 + 1) * static_cast<double>(cells[i]);
+    }
+  return checksum;
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkClip(int size, int repeats, int maxThreads)
+{
+  // vtkClipDataSet takes minutes on the larger volumes
+  size = (size < 128 ? size : 128);
+  vtkNew<vtkImageData> volume;
+  FillVolume(volume.GetPointer(), size);
+
+  vtkNew<vtkCylinder> cylinder;
+  cylinder->SetCenter(0.5*(size - 1), 0.5*(size - 1), 0.5*(size - 1));
+  cylinder->SetRadius(size/2.0 - 5.0);
+
+  vtkNew<vtkTimerLog> timer;
+  vtkNew<vtkClipDataSet> clip;
+  clip->SetInputData(volume.GetPointer());
+  clip->SetClipFunction(cylinder.GetPointer());
+  clip->InsideOutOn();
+  vtkNew<vtkDataSetTriangleFilter> tetrahedralize;
+  tetrahedralize->SetInputConnection(clip->GetOutputPort());
+  double baselineTime = 0.0;
+  for (int r = 0; r < repeats; ++r)
+    {
+    clip->Modified();
+    timer->StartTimer();
+    tetrahedralize->Update();
+    timer->StopTimer();
+    baselineTime += timer->GetElapsedTime();
+    }
+  vtkUnstructuredGrid* baseline = tetrahedralize->GetOutput();
+  std::cout << "clip size=" << size << "^3 threads=1 filter=vtkClipDataSet"
+            << " time=" << 1000.0 * baselineTime / repeats << "ms"
+            << " points=" << baseline->GetNumberOfPoints()
+            << " cells=" << baseline->GetNumberOfCells() << std::endl;
+
+  vtkNew<vtkImageParallelClip> parallelClip;
+  parallelClip->SetInputData(volume.GetPointer());
+  parallelClip->SetClipFunction(cylinder.GetPointer());
+  parallelClip->InsideOutOn();
+  for (int threads = 1; ; threads *= 2)
+    {
+    threads = (threads < maxThreads ? threads : maxThreads);
+    vtkSMPTools::Initialize(threads);
+    double parallelTime = 0.0;
+    for (int r = 0; r < repeats; ++r)
+      {
+      parallelClip->Modified();
+      timer->StartTimer();
+      parallelClip->Update();
+      timer->StopTimer();
+      parallelTime += timer->GetElapsedTime();
+      }
+    vtkUnstructuredGrid* output = parallelClip->GetOutput();
+    std::cout << "clip size=" << size << "^3 threads=" << threads
+              << " filter=vtkImageParallelClip"
+              << " time=" << 1000.0 * parallelTime / repeats << "ms"
+              << " speedup=" << baselineTime / parallelTime
+              << " points=" << output->GetNumberOfPoints()
+              << " cells=" << output->GetNumberOfCells()
+              << " checksum=" << GridChecksum(output) << std::endl;
+    if (threads == maxThreads)
+      {
+      break;
+      }
+    }
+  vtkSMPTools::Initialize();
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkRayCast(int size, int repeats)
+{
+  size = (size < 256 ? size : 256);
+  vtkNew<vtkImageData> volume;
+  FillVolume(volume.GetPointer(), size);
+
+  double c = 0.5*(size - 1);
+  vtkNew<vtkImageShapeMaskSource> maskSource;
+  maskSource->SetInformationFromImage(volume.GetPointer());
+  maskSource->SetShapeTypeToCylinder();
+  maskSource->SetCylinderAxis(2);
+  maskSource->SetCenter(c, c, c);
+  maskSource->SetRadius(size/2.0 - 5.0);
+  maskSource->Update();
+
+  vtkNew<vtkColorTransferFunction> ctf;
+  ctf->AddRGBPoint(1096.0, 0.7, 0.015, 0.15);
+  ctf->AddRGBPoint(2777, 0.86, 0.86, 0.86);
+  ctf->AddRGBPoint(4458, 0.23, 0.3, 0.75);
+  vtkNew<vtkPiecewiseFunction> pwf;
+  pwf->AddPoint(1096.0, 0.0);
+  pwf->AddPoint(3900.0, 0.0);
+  pwf->AddPoint(3900.0, 0.05);
+  pwf->AddPoint(4458.0, 0.05);
+
+  // Oblique view of the whole volume
+  double distance = 3.0*size;
+  double view[3] = { 2.0, 1.0, 1.5 };
+  double norm = sqrt(view[0]*view[0] + view[1]*view[1] + view[2]*view[2]);
+  vtkNew<vtkCamera> camera;
+  camera->SetFocalPoint(c, c, c);
+  camera->SetPosition(c + distance*view[0]/norm, c + distance*view[1]/norm,
+                      c + distance*view[2]/norm);
+  camera->SetViewUp(0, 0, 1);
+  camera->SetViewAngle(30);
+  camera->SetClippingRange(distance - size, distance + size);
+
+  vtkNew<vtkImageMaskedRayCastToRGBA> rayCast;
+  rayCast->SetInputData(volume.GetPointer());
+  rayCast->SetMaskInputData(maskSource->GetOutput());
+  rayCast->SetCamera(camera.GetPointer());
+  rayCast->SetOutputSize(512, 512);
+  rayCast->SetSampleDistance(0.5);
+  rayCast->SetColorFunction(ctf.GetPointer());
+  rayCast->SetOpacityFunction(pwf.GetPointer());
+
+  vtkNew<vtkTimerLog> timer;
+  vtkNew<vtkImageData> images[2];
+  double times[2];
+  for (int skip = 0; skip < 2; ++skip)
+    {
+    rayCast->SetUseEmptySpaceSkipping(skip);
+    // Build the grid outside of the timed renders
+    rayCast->Update();
+    double time = 0.0;
+    for (int r = 0; r < repeats; ++r)
+      {
+      rayCast->Modified();
+      timer->StartTimer();
+      rayCast->Update();
+      timer->StopTimer();
+      time += timer->GetElapsedTime();
+      }
+    times[skip] = time;
+    images[skip]->DeepCopy(rayCast->GetOutput());
+    std::cout << "raycast size=" << size << "^3 skipping=" << skip
+              << " time=" << 1000.0 * time / repeats << "ms"
+              << " samples=" << rayCast->GetNumberOfSamples();
+    if (skip)
+      {
+      std::cout << " visible bricks="
+                << rayCast->GetMacrocellGrid()->GetNumberOfVisibleBricks();
+      }
+    std::cout << std::endl;
+    }
+
+  int identical = (memcmp(images[0]->GetScalarPointer(),
+                          images[1]->GetScalarPointer(),
+                          4*512*512) == 0);
+  std::cout << "raycast speedup=" << times[0] / times[1]
+            << " identical=" << (identical ? "yes" : "no") << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkBricked(int size, int repeats)
+{
+  vtkNew<vtkImageData> volume;
+  FillVolume(volume.GetPointer(), size);
+
+  double c = 0.5*(size - 1);
+  vtkNew<vtkImageShapeMaskSource> maskSource;
+  maskSource->SetInformationFromImage(volume.GetPointer());
+  maskSource->SetCenter(c, c, c);
+  maskSource->SetRadius(size/2.0 - 5.0);
+  maskSource->Update();
+
+  vtkNew<vtkColorTransferFunction> ctf;
+  ctf->AddRGBPoint(1096.0, 0.7, 0.015, 0.15);
+  ctf->AddRGBPoint(4458, 0.23, 0.3, 0.75);
+
+  vtkNew<vtkImageMaskedResliceToRGBA> maskedSlice;
+  maskedSlice->SetInputData(volume.GetPointer());
+  maskedSlice->SetMaskInputData(maskSource->GetOutput());
+  maskedSlice->SetInterpolationModeToLinear();
+  maskedSlice->SetColorFunction(ctf.GetPointer());
+
+  // Direction cosines of the x axis, y axis and normal of the slices
+  const double h = sqrt(0.5);
+  const double cs = sqrt(0.75);
+  const double sn = 0.5;
+  const double axes[4][9] = {
+    { 1, 0, 0,  0, 1, 0,  0, 0, -1 },
+    { 0, 1, 0,  0, 0, 1,  1, 0, 0 },
+    { 1, 0, 0,  0, 0, 1,  0, -1, 0 },
+    { cs, sn, 0,  -sn*h, cs*h, h,  sn*h, -cs*h, h } };
+  const char* orientations[4] = { "axial", "sagittal", "coronal", "oblique" };
+  const char* layouts[3] = { "image", "bricked", "morton" };
+
+  vtkNew<vtkTimerLog> timer;
+  for (int o = 0; o < 4; ++o)
+    {
+    const double* a = axes[o];
+    maskedSlice->SetResliceAxesDirectionCosines(a[0], a[1], a[2],
+                                                a[3], a[4], a[5],
+                                                a[6], a[7], a[8]);
+    vtkNew<vtkImageData> reference;
+    for (int l = 0; l < 3; ++l)
+      {
+      maskedSlice->SetUseBrickedLayout(l > 0);
+      maskedSlice->SetBrickOrder(l == 2 ? vtkImageBrickedVolume::MORTON :
+                                 vtkImageBrickedVolume::LINEAR);
+      // Build the bricks outside of the timed slices
+      maskedSlice->SetResliceAxesOrigin(c, c, c);
+      timer->StartTimer();
+      maskedSlice->Update();
+      timer->StopTimer();
+      double importTime = timer->GetElapsedTime();
+
+      // The layout must not change the middle slice
+      vtkImageData* output = maskedSlice->GetOutput();
+      int identical = 1;
+      if (l == 0)
+        {
+        reference->DeepCopy(output);
+        }
+      else
+        {
+        identical = (output->GetNumberOfPoints() ==
+                     reference->GetNumberOfPoints() &&
+                     memcmp(output->GetScalarPointer(),
+                            reference->GetScalarPointer(),
+                            4*output->GetNumberOfPoints()) == 0);
+        }
+
+      double sliceTime = 0.0;
+      for (int r = 0; r < repeats; ++r)
+        {
+        timer->StartTimer();
+        for (int t = 0; t < size; ++t)
+          {
+          double d = t - c;
+          maskedSlice->SetResliceAxesOrigin(c + d*a[6], c + d*a[7],
+                                            c + d*a[8]);
+          maskedSlice->Update();
+          }
+        timer->StopTimer();
+        sliceTime += timer->GetElapsedTime();
+        }
+
+      double slices = static_cast<double>(size) * repeats;
+      std::cout << "bricked size=" << size << "^3"
+                << " orientation=" << orientations[o]
+                << " layout=" << layouts[l]
+                << " first=" << 1000.0 * importTime << "ms"
+                << " slice=" << 1000.0 * sliceTime / slices << "ms"
+                << " identical=" << (identical ? "yes" : "no") << std::endl;
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkLoad(int size, int repeats)
+{
+  vtkNew<vtkImageData> volume;
+  FillVolume(volume.GetPointer(), size);
+
+  const char* vtiName = "VolumeMaskAndSliceBench.vti";
+  const char* rawName = "VolumeMaskAndSliceBench.mraw";
+  vtkNew<vtkZLibDataCompressor> zlib;
+  vtkNew<vtkXMLImageDataWriter> vtiWriter;
+  vtiWriter->SetFileName(vtiName);
+  vtiWriter->SetInputData(volume.GetPointer());
+  vtiWriter->SetDataModeToAppended();
+  vtiWriter->SetCompressor(zlib.GetPointer());
+  vtiWriter->Write();
+  vtkNew<vtkImageMappedRawWriter> rawWriter;
+  rawWriter->SetFileName(rawName);
+  rawWriter->SetInputData(volume.GetPointer());
+  rawWriter->Write();
+
+  // Time to the first voxel in memory. The files were just written, so
+  // both are read from the page cache.
+  vtkNew<vtkTimerLog> timer;
+  double times[2] = { 0.0, 0.0 };
+  int identical[2] = { 1, 1 };
+  size_t bytes = static_cast<size_t>(volume->GetNumberOfPoints()) *
+    volume->GetScalarSize();
+  for (int r = 0; r < repeats; ++r)
+    {
+    for (int f = 0; f < 2; ++f)
+      {
+      vtkSmartPointer<vtkImageAlgorithm> reader;
+      if (f == 0)
+        {
+        vtkSmartPointer<vtkXMLImageDataReader> xmlReader =
+          vtkSmartPointer<vtkXMLImageDataReader>::New();
+        xmlReader->SetFileName(vtiName);
+        reader = xmlReader;
+        }
+      else
+        {
+        vtkSmartPointer<vtkImageMappedRawReader> rawReader =
+          vtkSmartPointer<vtkImageMappedRawReader>::New();
+        rawReader->SetFileName(rawName);
+        reader = rawReader;
+        }
+      timer->StartTimer();
+      reader->Update();
+      timer->StopTimer();
+      times[f] += timer->GetElapsedTime();
+
+      vtkImageData* output = reader->GetOutput();
+      identical[f] = identical[f] &&
+        output->GetNumberOfPoints() == volume->GetNumberOfPoints() &&
+        memcmp(output->GetScalarPointer(), volume->GetScalarPointer(),
+               bytes) == 0;
+      }
+    }
+  remove(vtiName);
+  remove(rawName);
+
+  std::cout << "load size=" << size << "^3"
+            << " vti=" << 1000.0 * times[0] / repeats << "ms"
+            << " mraw=" << 1000.0 * times[1] / repeats << "ms"
+            << " speedup=" << times[0] / times[1]
+            << " identical="
+            << (identical[0] && identical[1] ? "yes" : "no") << std::endl;
+}
+
+
+//-----------------------------------------------------------------------------
+void BenchmarkMaskProvider(int size, int repeats)
+{
+  vtkNew<vtkImageData> volume;
+  volume->SetExtent(0, size - 1, 0, size - 1, 0, size - 1);
+  double center[3] = { 0.5*(size - 1), 0.5*(size - 1), 0.5*(size - 1) };
+  double radius = size/2.0 - 5.0;
+
+  vtkNew<vtkTimerLog> timer;
+  double times[2] = { 0.0, 0.0 };
+  int hits = 1;
+  int identical = 1;
+  std::string cacheFileName;
+  for (int r = 0; r < repeats; ++r)
+    {
+    // A miss rasterizes and writes the cache file, a hit maps it
+    for (int h = 0; h < 2; ++h)
+      {
+      vtkNew<vtkImageMaskProvider> provider;
+      provider->SetCacheDirectory(".");
+      vtkImageShapeMaskSource* source = provider->GetShapeSource();
+      source->SetShapeTypeToCylinder();
+      source->SetCylinderAxis(2);
+      source->SetCenter(center);
+      source->SetRadius(radius);
+      cacheFileName = provider->GetCacheFileName(volume.GetPointer());
+      if (h == 0)
+        {
+        remove(cacheFileName.c_str());
+        }
+
+      timer->StartTimer();
+      vtkImageData* mask = provider->GetMask(volume.GetPointer());
+      timer->StopTimer();
+      times[h] += timer->GetElapsedTime();
+
+      if (h == 1)
+        {
+        hits = hits &&
+          provider->GetProvenance() == vtkImageMaskProvider::CACHE_FILE;
+        vtkNew<vtkImageShapeMaskSource> reference;
+        reference->SetInformationFromImage(volume.GetPointer());
+        reference->SetShapeTypeToCylinder();
+        reference->SetCylinderAxis(2);
+        reference->SetCenter(center);
+        reference->SetRadius(radius);
+        reference->Update();
+        identical = identical &&
+          memcmp(mask->GetScalarPointer(),
+                 reference->GetOutput()->GetScalarPointer(),
+                 static_cast<size_t>(mask->GetNumberOfPoints())) == 0;
+        }
+      }
+    }
+  remove(cacheFileName.c_str());
+
+  std::cout << "provider size=" << size << "^3"
+            << " miss=" << 1000.0 * times[0] / repeats << "ms"
+            << " hit=" << 1000.0 * times[1] / repeats << "ms"
+            << " speedup=" << times[0] / times[1]
+            << " cached=" << (hits ? "yes" : "no")
+            << " identical=" << (identical ? "yes" : "no") << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkLabels(int size, int repeats)
+{
+  vtkNew<vtkImageData> volume;
+  FillVolume(volume.GetPointer(), size);
+  vtkIdType numPixels = volume->GetNumberOfPoints();
+  size_t bytes = 4*static_cast<size_t>(numPixels);
+
+  const int maxLabels = 16;
+  std::vector<vtkSmartPointer<vtkColorTransferFunction> > ctfs;
+  std::vector<vtkSmartPointer<vtkPiecewiseFunction> > pwfs;
+  for (int l = 0; l < maxLabels; ++l)
+    {
+    double hue = l / static_cast<double>(maxLabels);
+    vtkSmartPointer<vtkColorTransferFunction> ctf =
+      vtkSmartPointer<vtkColorTransferFunction>::New();
+    ctf->AddRGBPoint(1096.0, 0.7*hue, 0.015, 0.15);
+    ctf->AddRGBPoint(2777, 0.86, 0.86*hue, 0.86);
+    ctf->AddRGBPoint(4458, 0.23, 0.3, 0.75*hue);
+    vtkSmartPointer<vtkPiecewiseFunction> pwf =
+      vtkSmartPointer<vtkPiecewiseFunction>::New();
+    pwf->AddPoint(1096.0, 0.0);
+    pwf->AddPoint(1096.0 + 150.0*l, 0.0);
+    pwf->AddPoint(1096.0 + 150.0*l, 1.0);
+    pwf->AddPoint(4458.0, 1.0);
+    ctfs.push_back(ctf);
+    pwfs.push_back(pwf);
+    }
+
+  vtkNew<vtkTimerLog> timer;
+  for (int numLabels = 1; numLabels <= maxLabels; numLabels *= 4)
+    {
+    // Labels are slabs along x, with unlabeled voxels at both ends
+    vtkNew<vtkImageData> labelMap;
+    labelMap->SetExtent(volume->GetExtent());
+    labelMap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    unsigned char* labels =
+      static_cast<unsigned char*>(labelMap->GetScalarPointer());
+    for (vtkIdType i = 0; i < numPixels; ++i)
+      {
+      int x = static_cast<int>(i % size);
+      labels[i] = static_cast<unsigned char>(
+        x < 4 || x >= size - 4 ? 0 : 1 + (x - 4)*numLabels/(size - 8));
+      }
+
+    // One pass per label, composited by label
+    std::vector<unsigned char> composite(bytes);
+    double perLabelTime = 0.0;
+    for (int r = 0; r < repeats; ++r)
+      {
+      timer->StartTimer();
+      std::fill(composite.begin(), composite.end(), 0);
+      for (int l = 0; l < numLabels; ++l)
+        {
+        vtkNew<vtkImageMapToRGBA> mapToRGBA;
+        mapToRGBA->SetInputData(volume.GetPointer());
+        mapToRGBA->SetColorFunction(ctfs[l]);
+        mapToRGBA->SetOpacityFunction(pwfs[l]);
+        mapToRGBA->Update();
+        const unsigned char* rgba = static_cast<unsigned char*>(
+          mapToRGBA->GetOutput()->GetScalarPointer());
+        for (vtkIdType i = 0; i < numPixels; ++i)
+          {
+          if (labels[i] == l + 1)
+            {
+            memcpy(&composite[4*i], rgba + 4*i, 4);
+            }
+          }
+        }
+      timer->StopTimer();
+      perLabelTime += timer->GetElapsedTime();
+      }
+
+    vtkNew<vtkImageLabelMapToRGBA> labelMapToRGBA;
+    labelMapToRGBA->SetInputData(volume.GetPointer());
+    labelMapToRGBA->SetLabelMapInputData(labelMap.GetPointer());
+    for (int l = 0; l < numLabels; ++l)
+      {
+      labelMapToRGBA->SetLabelFunctions(l + 1, ctfs[l], pwfs[l]);
+      }
+    double singlePassTime = 0.0;
+    for (int r = 0; r < repeats; ++r)
+      {
+      labelMapToRGBA->Modified();
+      timer->StartTimer();
+      labelMapToRGBA->Update();
+      timer->StopTimer();
+      singlePassTime += timer->GetElapsedTime();
+      }
+
+    int identical = memcmp(
+      &composite[0], labelMapToRGBA->GetOutput()->GetScalarPointer(),
+      bytes) == 0;
+    std::cout << "labels size=" << size << "^3 labels=" << numLabels
+              << " per-label=" << 1000.0 * perLabelTime / repeats << "ms"
+              << " single-pass=" << 1000.0 * singlePassTime / repeats
+              << "ms speedup=" << perLabelTime / singlePassTime
+              << " identical=" << (identical ? "yes" : "no") << std::endl;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Reslice axes of an orientation, the third row is the normal of the plane
+void OrientationAxes(const std::string& orientation, double axes[9])
+{
+  const double s2 = 1.0/sqrt(2.0);
+  const double s3 = 1.0/sqrt(3.0);
+  const double s6 = 1.0/sqrt(6.0);
+  const double axial[9] = { 1,0,0, 0,1,0, 0,0,-1 };
+  const double sagittal[9] = { 0,1,0, 0,0,1, 1,0,0 };
+  const double coronal[9] = { 1,0,0, 0,0,1, 0,-1,0 };
+  const double oblique[9] =
+    { s2,-s2,0, s6,s6,-2*s6, s3,s3,s3 };
+  const double* source = (orientation == "sagittal" ? sagittal :
+                          orientation == "coronal" ? coronal :
+                          orientation == "oblique" ? oblique : axial);
+  for (int i = 0; i < 9; ++i)
+    {
+    axes[i] = source[i];
+    }
+}
+
+//-----------------------------------------------------------------------------
+// The volume, spherical mask and transfer functions of the slicing benchmarks
+struct MaskedVolume
+{
+  vtkSmartPointer<vtkImageData> Volume;
+  vtkSmartPointer<vtkImageData> Mask;
+  vtkSmartPointer<vtkColorTransferFunction> ColorFunction;
+  vtkSmartPointer<vtkPiecewiseFunction> OpacityFunction;
+};
+
+//-----------------------------------------------------------------------------
+void MakeMaskedVolume(int size, MaskedVolume* fixture)
+{
+  fixture->Volume = vtkSmartPointer<vtkImageData>::New();
+  FillVolume(fixture->Volume, size);
+  double c = 0.5*(size - 1);
+
+  vtkNew<vtkImageShapeMaskSource> maskSource;
+  maskSource->SetInformationFromImage(fixture->Volume);
+  maskSource->SetCenter(c, c, c);
+  maskSource->SetRadius(size/2.0 - 5.0);
+  maskSource->Update();
+  fixture->Mask = maskSource->GetOutput();
+
+  fixture->ColorFunction = vtkSmartPointer<vtkColorTransferFunction>::New();
+  fixture->ColorFunction->AddRGBPoint(1096.0, 0.7, 0.015, 0.15);
+  fixture->ColorFunction->AddRGBPoint(4458, 0.23, 0.3, 0.75);
+  fixture->OpacityFunction = vtkSmartPointer<vtkPiecewiseFunction>::New();
+  fixture->OpacityFunction->AddPoint(1096.0, 0.0);
+  fixture->OpacityFunction->AddPoint(4458.0, 1.0);
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkOblique(int size, int repeats)
+{
+  MaskedVolume fixture;
+  MakeMaskedVolume(size, &fixture);
+  vtkImageData* volume = fixture.Volume;
+  vtkImageData* mask = fixture.Mask;
+  vtkColorTransferFunction* ctf = fixture.ColorFunction;
+  vtkPiecewiseFunction* pwf = fixture.OpacityFunction;
+  double c = 0.5*(size - 1);
+
+  // Rows along (1, -1, 0), columns along (1, 1, -2), normal (1, 1, 1)
+  double axes[9];
+  OrientationAxes("oblique", axes);
+  const int slices = 16;
+
+  vtkNew<vtkImageReslice> reslice;
+  reslice->SetInputData(volume);
+  reslice->SetOutputDimensionality(2);
+  reslice->SetInterpolationModeToLinear();
+  reslice->SetResliceAxesDirectionCosines(axes[0], axes[1], axes[2],
+                                          axes[3], axes[4], axes[5],
+                                          axes[6], axes[7], axes[8]);
+
+  vtkNew<vtkImageMaskedResliceToRGBA> maskedSlice;
+  maskedSlice->SetInputData(volume);
+  maskedSlice->SetInterpolationModeToLinear();
+  maskedSlice->SetColorFunction(ctf);
+  maskedSlice->SetOpacityFunction(pwf);
+  maskedSlice->SetResliceAxesDirectionCosines(axes[0], axes[1], axes[2],
+                                              axes[3], axes[4], axes[5],
+                                              axes[6], axes[7], axes[8]);
+
+  vtkNew<vtkTimerLog> timer;
+  double times[3] = { 0.0, 0.0, 0.0 };
+  double pixels[3] = { 0.0, 0.0, 0.0 };
+  for (int m = 0; m < 3; ++m)
+    {
+    maskedSlice->SetMaskInputData(m == 2 ? mask : NULL);
+    for (int r = 0; r < repeats; ++r)
+      {
+      for (int i = 0; i < slices; ++i)
+        {
+        double offset = size*(0.8*(i + 0.5)/slices - 0.4);
+        double o[3] = { c + offset*axes[6], c + offset*axes[7],
+                        c + offset*axes[8] };
+        vtkImageAlgorithm* slicer;
+        if (m == 0)
+          {
+          reslice->SetResliceAxesOrigin(o[0], o[1], o[2]);
+          slicer = reslice.GetPointer();
+          }
+        else
+          {
+          maskedSlice->SetResliceAxesOrigin(o[0], o[1], o[2]);
+          slicer = maskedSlice.GetPointer();
+          }
+        timer->StartTimer();
+        slicer->Update();
+        timer->StopTimer();
+        times[m] += timer->GetElapsedTime();
+        pixels[m] += slicer->GetOutput()->GetNumberOfPoints();
+        }
+      }
+    }
+
+  vtkNew<vtkImagePlaneSampler> sampler;
+  sampler->SetImage(volume);
+  std::cout << "oblique size=" << size << "^3"
+            << " reslice=" << 1.0e-6 * pixels[0] / times[0] << " Mpix/s"
+            << " fused=" << 1.0e-6 * pixels[1] / times[1] << " Mpix/s"
+            << " masked=" << 1.0e-6 * pixels[2] / times[2] << " Mpix/s"
+            << " avx2=" << sampler->GetVectorized() << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkSlab(int size, int repeats)
+{
+  MaskedVolume fixture;
+  MakeMaskedVolume(size, &fixture);
+  vtkImageData* volume = fixture.Volume;
+  vtkImageData* mask = fixture.Mask;
+  vtkColorTransferFunction* ctf = fixture.ColorFunction;
+  vtkPiecewiseFunction* pwf = fixture.OpacityFunction;
+  double c = 0.5*(size - 1);
+
+  vtkNew<vtkImageMaskedResliceToRGBA> maskedSlice;
+  maskedSlice->SetInputData(volume);
+  maskedSlice->SetMaskInputData(mask);
+  maskedSlice->SetInterpolationModeToLinear();
+  maskedSlice->SetColorFunction(ctf);
+  maskedSlice->SetOpacityFunction(pwf);
+
+  // Axial, then rows along (1, -1, 0), columns along (1, 1, -2)
+  double axes[2][9] = { { 1,0,0, 0,1,0, 0,0,1 } };
+  OrientationAxes("oblique", axes[1]);
+  const char* orientations[2] = { "axial", "oblique" };
+  const char* modes[3] = { "max", "min", "mean" };
+  const int thicknesses[4] = { 1, 4, 16, 64 };
+
+  vtkNew<vtkTimerLog> timer;
+  for (int o = 0; o < 2; ++o)
+    {
+    const double* a = axes[o];
+    maskedSlice->SetResliceAxesDirectionCosines(a[0], a[1], a[2],
+                                                a[3], a[4], a[5],
+                                                a[6], a[7], a[8]);
+    maskedSlice->SetResliceAxesOrigin(c, c, c);
+    for (int t = 0; t < 4; ++t)
+      {
+      // A slab n voxels thick takes n samples per pixel
+      maskedSlice->SetSlabThickness(thicknesses[t] - 1);
+      for (int m = 0; m < 3; ++m)
+        {
+        maskedSlice->SetSlabMode(m);
+        double time = 0.0;
+        for (int r = 0; r < repeats; ++r)
+          {
+          maskedSlice->Modified();
+          timer->StartTimer();
+          maskedSlice->Update();
+          timer->StopTimer();
+          time += timer->GetElapsedTime();
+          }
+        time /= repeats;
+        double samples =
+          static_cast<double>(maskedSlice->GetOutput()->GetNumberOfPoints())*
+          maskedSlice->GetSlabNumberOfSamples();
+        std::cout << "slab size=" << size << "^3"
+                  << " orientation=" << orientations[o]
+                  << " thickness=" << thicknesses[t]
+                  << " mode=" << modes[m]
+                  << " time=" << 1000.0 * time << "ms"
+                  << " per_sample=" << 1.0e9 * time / samples << "ns"
+                  << std::endl;
+        }
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkMPR(int size, int repeats)
+{
+  MaskedVolume fixture;
+  MakeMaskedVolume(size, &fixture);
+  vtkImageData* volume = fixture.Volume;
+  vtkImageData* mask = fixture.Mask;
+  vtkColorTransferFunction* ctf = fixture.ColorFunction;
+  vtkPiecewiseFunction* pwf = fixture.OpacityFunction;
+  double c = 0.5*(size - 1);
+
+  vtkNew<vtkImageMaskedMPRToRGBA> mpr;
+  mpr->SetInputData(volume);
+  mpr->SetMaskInputData(mask);
+  mpr->SetColorFunction(ctf);
+  mpr->SetOpacityFunction(pwf);
+
+  // The same slices with one filter each, updated one after the other
+  vtkNew<vtkImageMaskedResliceToRGBA> slices[3];
+  for (int plane = 0; plane < 3; ++plane)
+    {
+    vtkImageMaskedResliceToRGBA* slice = slices[plane].GetPointer();
+    slice->SetInputData(volume);
+    slice->SetMaskInputData(mask);
+    slice->SetInterpolationModeToLinear();
+    slice->SetColorFunction(ctf);
+    slice->SetOpacityFunction(pwf);
+    slice->SetResliceAxes(mpr->GetResliceAxes(plane));
+    }
+
+  vtkNew<vtkTimerLog> timer;
+  double separateTime = 0.0;
+  double mprTime = 0.0;
+  double movedTime = 0.0;
+  int movedPlanes = 0;
+  int identical = 1;
+  for (int r = 0; r < repeats; ++r)
+    {
+    // A new crosshair moves all three slices
+    double offset = 0.25*size*(r % 2 ? 1 : -1);
+    mpr->SetCrosshair(c + offset, c - offset, c + offset);
+
+    timer->StartTimer();
+    for (int plane = 0; plane < 3; ++plane)
+      {
+      slices[plane]->Update();
+      }
+    timer->StopTimer();
+    separateTime += timer->GetElapsedTime();
+
+    timer->StartTimer();
+    mpr->Update();
+    timer->StopTimer();
+    mprTime += timer->GetElapsedTime();
+
+    for (int plane = 0; plane < 3; ++plane)
+      {
+      vtkImageData* reference = slices[plane]->GetOutput();
+      vtkImageData* output = mpr->GetOutput(plane);
+      identical = identical &&
+        output->GetNumberOfPoints() == reference->GetNumberOfPoints() &&
+        memcmp(output->GetScalarPointer(), reference->GetScalarPointer(),
+               4*output->GetNumberOfPoints()) == 0;
+      }
+
+    mpr->SetCrosshair(c + offset, c - offset, c + offset + 1.0);
+    timer->StartTimer();
+    mpr->Update();
+    timer->StopTimer();
+    movedTime += timer->GetElapsedTime();
+    movedPlanes += mpr->GetNumberOfUpdatedPlanes();
+    }
+
+  std::cout << "mpr size=" << size << "^3"
+            << " separate=" << 1000.0 * separateTime / repeats << "ms"
+            << " mpr=" << 1000.0 * mprTime / repeats << "ms"
+            << " speedup=" << separateTime / mprTime
+            << " moved_z=" << 1000.0 * movedTime / repeats << "ms"
+            << " planes=" << movedPlanes / static_cast<double>(repeats)
+            << " identical=" << (identical ? "yes" : "no") << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+// Tile the voxels of Data/Volume.vti over a volume of size^3, so that it
+// compresses like real data. Falls back to FillVolume() without the file.
+void FillVolumeFromSample(vtkImageData* volume, int size)
+{
+  vtkNew<vtkXMLImageDataReader> reader;
+  reader->SetFileName("Data/Volume.vti");
+  reader->Update();
+  vtkImageData* sample = reader->GetOutput();
+  if (sample->GetNumberOfPoints() == 0 ||
+      sample->GetScalarType() != VTK_UNSIGNED_SHORT)
+    {
+    FillVolume(volume, size);
+    return;
+    }
+
+  int dims[3];
+  sample->GetDimensions(dims);
+  const unsigned short* in =
+    static_cast<const unsigned short*>(sample->GetScalarPointer());
+  volume->SetExtent(0, size - 1, 0, size - 1, 0, size - 1);
+  volume->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+  unsigned short* ptr =
+    static_cast<unsigned short*>(volume->GetScalarPointer());
+  for (int z = 0; z < size; ++z)
+    {
+    for (int y = 0; y < size; ++y)
+      {
+      const unsigned short* row =
+        in + (static_cast<vtkIdType>(z % dims[2])*dims[1] + y % dims[1]) *
+        dims[0];
+      for (int x = 0; x < size; ++x)
+        {
+        *ptr++ = row[x % dims[0]];
+        }
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void BenchmarkParallelLoad(int size, int repeats, int maxThreads)
+{
+  vtkNew<vtkImageData> volume;
+  FillVolumeFromSample(volume.GetPointer(), size);
+  size_t bytes = static_cast<size_t>(volume->GetNumberOfPoints()) *
+    volume->GetScalarSize();
+
+  std::vector<vtkSmartPointer<vtkDataCompressor> > compressors;
+  compressors.push_back(vtkSmartPointer<vtkDataCompressor>::Take(
+    vtkZLibDataCompressor::New()));
+#if VTK_MAJOR_VERSION > 8 || \
+    (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 2)
+  compressors.push_back(vtkSmartPointer<vtkDataCompressor>::Take(
+    vtkLZ4DataCompressor::New()));
+#endif
+
+  const char* vtiName = "VolumeMaskAndSliceBench.vti";
+  vtkNew<vtkTimerLog> timer;
+  for (size_t c = 0; c < compressors.size(); ++c)
+    {
+    const char* codec = compressors[c]->GetClassName();
+    vtkNew<vtkXMLImageDataWriter> writer;
+    writer->SetFileName(vtiName);
+    writer->SetInputData(volume.GetPointer());
+    writer->SetDataModeToAppended();
+    writer->SetCompressor(compressors[c]);
+    writer->Write();
+
+    double baselineTime = 0.0;
+    for (int r = 0; r < repeats; ++r)
+      {
+      vtkNew<vtkXMLImageDataReader> reader;
+      reader->SetFileName(vtiName);
+      timer->StartTimer();
+      reader->Update();
+      timer->StopTimer();
+      baselineTime += timer->GetElapsedTime();
+      }
+    std::cout << "inflate size=" << size << "^3 codec=" << codec
+              << " threads=1 reader=vtkXMLImageDataReader"
+              << " time=" << 1000.0 * baselineTime / repeats << "ms"
+              << std::endl;
+
+    for (int threads = 1; ; threads *= 2)
+      {
+      threads = (threads < maxThreads ? threads : maxThreads);
+      vtkSMPTools::Initialize(threads);
+      double parallelTime = 0.0;
+      int identical = 1;
+      for (int r = 0; r < repeats; ++r)
+        {
+        vtkNew<vtkImageParallelXMLReader> reader;
+        reader->SetFileName(vtiName);
+        timer->StartTimer();
+        reader->Update();
+        timer->StopTimer();
+        parallelTime += timer->GetElapsedTime();
+        vtkImageData* output = reader->GetOutput();
+        identical = identical &&
+          output->GetNumberOfPoints() == volume->GetNumberOfPoints() &&
+          memcmp(output->GetScalarPointer(), volume->GetScalarPointer(),
+                 bytes) == 0;
+        }
+      std::cout << "inflate size=" << size << "^3 codec=" << codec
+                << " threads=" << threads
+                << " reader=vtkImageParallelXMLReader"
+                << " time=" << 1000.0 * parallelTime / repeats << "ms"
+                << " speedup=" << baselineTime / parallelTime
+                << " identical=" << (identical ? "yes" : "no") << std::endl;
+      if (threads == maxThreads)
+        {
+        break;
+        }
+      }
+    vtkSMPTools::Initialize();
+    }
+  remove(vtiName);
+}
+
+//-----------------------------------------------------------------------------
+// Peak resident memory of the process in MB. It never decreases, so the
+// suite measures it in a child process per strategy.
+double PeakMemory()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                            sizeof(counters)))
+    {
+    return 0.0;
+    }
+  return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+    return 0.0;
+    }
+#if defined(__APPLE__)
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Split a comma separated list of the suite options
+std::vector<std::string> SplitList(const char* list)
+{
+  std::vector<std::string> items;
+  std::string item;
+  for (const char* c = list; ; ++c)
+    {
+    if (*c == ',' || *c == '\0')
+      {
+      if (!item.empty())
+        {
+        items.push_back(item);
+        }
+      item.clear();
+      if (*c == '\0')
+        {
+        break;
+        }
+      }
+    else
+      {
+      item += *c;
+      }
+    }
+  return items;
+}
+
+//-----------------------------------------------------------------------------
+// Return 1 when all the items are in the known list
+int CheckList(const std::vector<std::string>& items, const char* known[],
+              int numberOfKnown)
+{
+  for (size_t i = 0; i < items.size(); ++i)
+    {
+    int found = 0;
+    for (int k = 0; k < numberOfKnown; ++k)
+      {
+      found |= (items[i] == known[k]);
+      }
+    if (!found)
+      {
+      std::cerr << "Unknown suite parameter " << items[i] << std::endl;
+      return 0;
+      }
+    }
+  return !items.empty();
+}
+
+//-----------------------------------------------------------------------------
+// The implicit function of a shape, the same shape is rasterized by
+// maskSource
+vtkSmartPointer<vtkImplicitFunction> MakeShape(
+  const std::string& shape, int size, vtkImageShapeMaskSource* maskSource)
+{
+  double c = 0.5*(size - 1);
+  double center[3] = { c, c, c };
+  double radius = size/2.0 - 5.0;
+  maskSource->SetWholeExtent(0, size - 1, 0, size - 1, 0, size - 1);
+  maskSource->SetCenter(center);
+  maskSource->SetRadius(radius);
+
+  if (shape == "sphere")
+    {
+    maskSource->SetShapeTypeToSphere();
+    vtkSmartPointer<vtkSphere> sphere = vtkSmartPointer<vtkSphere>::New();
+    sphere->SetCenter(center);
+    sphere->SetRadius(radius);
+    return sphere;
+    }
+  if (shape == "box")
+    {
+    double bounds[6] =
+      { c - radius, c + radius, c - radius, c + radius, c - radius,
+        c + radius };
+    maskSource->SetShapeTypeToBox();
+    maskSource->SetBoxBounds(bounds);
+    vtkSmartPointer<vtkBox> box = vtkSmartPointer<vtkBox>::New();
+    box->SetBounds(bounds);
+    return box;
+    }
+
+  // Cylinder along z, as in the examples
+  maskSource->SetShapeTypeToCylinder();
+  maskSource->SetCylinderAxis(2);
+  vtkNew<vtkTransform> t;
+  t->PostMultiply();
+  t->Translate(-center[0], -center[1], -center[2]);
+  t->RotateX(90);
+  t->Translate(center[0], center[1], center[2]);
+  vtkSmartPointer<vtkCylinder> cylinder = vtkSmartPointer<vtkCylinder>::New();
+  cylinder->SetCenter(center);
+  cylinder->SetRadius(radius);
+  cylinder->SetTransform(t.GetPointer());
+  return cylinder;
+}
+
+//-----------------------------------------------------------------------------
+// A way of masking and slicing the volume, as done by one of the examples
+class SliceStrategy
+{
+public:
+  virtual ~SliceStrategy() {}
+
+  // Description:
+  // Prepare the slicing of volume masked by the shape
+  virtual void Setup(vtkImageData* volume, vtkImplicitFunction* function,
+                     vtkImageShapeMaskSource* maskSource) = 0;
+
+  // Description:
+  // Compute the slice through origin along the reslice axes, return the
+  // number of output pixels or cells
+  virtual vtkIdType Slice(const double origin[3], const double axes[9]) = 0;
+
+  // Description:
+  // Unit of the output counts
+  virtual const char* GetOutputUnit() = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Image mask and vtkImageMaskedResliceToRGBA, as in VolumeMaskAndSlice.cxx
+class ResliceStrategy : public SliceStrategy
+{
+public:
+  ResliceStrategy()
+    {
+    this->ColorFunction->AddRGBPoint(1096.0, 0.7, 0.015, 0.15);
+    this->ColorFunction->AddRGBPoint(2777, 0.86, 0.86, 0.86);
+    this->ColorFunction->AddRGBPoint(4458, 0.23, 0.3, 0.75);
+    this->OpacityFunction->AddPoint(1096.0, 0.0);
+    this->OpacityFunction->AddPoint(4458.0, 1.0);
+    this->Slicer->SetInterpolationModeToLinear();
+    this->Slicer->SetColorFunction(this->ColorFunction.GetPointer());
+    this->Slicer->SetOpacityFunction(this->OpacityFunction.GetPointer());
+    }
+
+  void Setup(vtkImageData* volume, vtkImplicitFunction*,
+             vtkImageShapeMaskSource* maskSource)
+    {
+    maskSource->Update();
+    this->Slicer->SetInputData(volume);
+    this->Slicer->SetMaskInputData(maskSource->GetOutput());
+    }
+
+  vtkIdType Slice(const double origin[3], const double axes[9])
+    {
+    this->Slicer->SetResliceAxesDirectionCosines(axes[0], axes[1], axes[2],
+                                                 axes[3], axes[4], axes[5],
+                                                 axes[6], axes[7], axes[8]);
+    this->Slicer->SetResliceAxesOrigin(origin[0], origin[1], origin[2]);
+    this->Slicer->Update();
+    return this->Slicer->GetOutput()->GetNumberOfPoints();
+    }
+
+  const char* GetOutputUnit() { return "pixels"; }
+
+protected:
+  vtkNew<vtkColorTransferFunction> ColorFunction;
+  vtkNew<vtkPiecewiseFunction> OpacityFunction;
+  vtkNew<vtkImageMaskedResliceToRGBA> Slicer;
+};
+
+//-----------------------------------------------------------------------------
+// vtkImageHybridClip once, then vtkCutter per slice, as in
+// VolumeMaskAndSlice2.cxx
+class ClipStrategy : public SliceStrategy
+{
+public:
+  void Setup(vtkImageData* volume, vtkImplicitFunction* function,
+             vtkImageShapeMaskSource*)
+    {
+    this->Clip->SetInputData(volume);
+    this->Clip->SetClipFunction(function);
+    this->Clip->InsideOutOn();
+    this->Clip->Update();
+    this->Cutter->SetInputConnection(this->Clip->GetOutputPort());
+    this->Cutter->SetCutFunction(this->Plane.GetPointer());
+    this->Geometry->SetInputConnection(this->Cutter->GetOutputPort());
+    }
+
+  vtkIdType Slice(const double origin[3], const double axes[9])
+    {
+    this->Plane->SetOrigin(origin);
+    this->Plane->SetNormal(axes + 6);
+    this->Geometry->Update();
+    return this->Geometry->GetOutput()->GetNumberOfCells();
+    }
+
+  const char* GetOutputUnit() { return "cells"; }
+
+protected:
+  vtkNew<vtkImageHybridClip> Clip;
+  vtkNew<vtkPlane> Plane;
+  vtkNew<vtkCutter> Cutter;
+  vtkNew<vtkCompositeDataGeometryFilter> Geometry;
+};
+
+//-----------------------------------------------------------------------------
+// vtkImagePlaneCutter, then vtkClipDataSet of the slice, as in
+// SlicePipeline.cxx
+class CutStrategy : public SliceStrategy
+{
+public:
+  void Setup(vtkImageData* volume, vtkImplicitFunction* function,
+             vtkImageShapeMaskSource*)
+    {
+    this->Cutter->SetInputData(volume);
+    this->Cutter->SetPlane(this->Plane.GetPointer());
+    this->Clip->SetInputConnection(this->Cutter->GetOutputPort());
+    this->Clip->SetClipFunction(function);
+    this->Clip->InsideOutOn();
+    }
+
+  vtkIdType Slice(const double origin[3], const double axes[9])
+    {
+    this->Plane->SetOrigin(origin);
+    this->Plane->SetNormal(axes + 6);
+    this->Clip->Update();
+    return this->Clip->GetOutput()->GetNumberOfCells();
+    }
+
+  const char* GetOutputUnit() { return "cells"; }
+
+protected:
+  vtkNew<vtkPlane> Plane;
+  vtkNew<vtkImagePlaneCutter> Cutter;
+  vtkNew<vtkClipDataSet> Clip;
+};
+
+//-----------------------------------------------------------------------------
+SliceStrategy* NewStrategy(const std::string& strategy)
+{
+  if (strategy == "clip")
+    {
+    return new ClipStrategy;
+    }
+  if (strategy == "cut")
+    {
+    return new CutStrategy;
+    }
+  return new ResliceStrategy;
+}
+
+//-----------------------------------------------------------------------------
+// Nearest rank percentile of sorted values
+double Percentile(const std::vector<double>& values, double percent)
+{
+  size_t rank = static_cast<size_t>(ceil(percent/100.0 * values.size()));
+  return values[rank > 0 ? rank - 1 : 0];
+}
+
+//-----------------------------------------------------------------------------
+// Start the JSON object of a case
+void WriteCaseStart(std::ostream& os, bool first,
+                    const std::string& strategy, const std::string& shape,
+                    const std::string& orientation, int size)
+{
+  os << (first ? "" : ",\n") << "    {\n"
+     << "      \"name\": \"" << strategy << "/" << shape << "/"
+     << orientation << "/" << size << "\",\n"
+     << "      \"strategy\": \"" << strategy << "\",\n"
+     << "      \"shape\": \"" << shape << "\",\n"
+     << "      \"orientation\": \"" << orientation << "\",\n"
+     << "      \"size\": " << size << ",\n";
+}
+
+//-----------------------------------------------------------------------------
+// Run the cases of a strategy on every orientation and write their JSON
+// objects, separated by commas
+void RunSuiteCases(std::ostream& os, int size, const std::string& shape,
+                   const std::string& strategyName,
+                   const std::vector<std::string>& orientations, int slices,
+                   int repeats)
+{
+  bool first = true;
+
+  // The tetrahedra of the clipped boundary do not fit in memory beyond
+  // 256^3
+  if (strategyName == "clip" && size > 256)
+    {
+    for (size_t o = 0; o < orientations.size(); ++o)
+      {
+      WriteCaseStart(os, first, strategyName, shape, orientations[o], size);
+      os << "      \"error_occurred\": true,\n"
+         << "      \"error_message\": \"skipped above 256^3\"\n"
+         << "    }";
+      first = false;
+      }
+    return;
+    }
+
+  vtkNew<vtkImageData> volume;
+  FillVolume(volume.GetPointer(), size);
+  double c = 0.5*(size - 1);
+  vtkNew<vtkImageShapeMaskSource> maskSource;
+  vtkSmartPointer<vtkImplicitFunction> function =
+    MakeShape(shape, size, maskSource.GetPointer());
+
+  std::cerr << strategyName << "/" << shape << "/" << size << std::endl;
+  vtkNew<vtkTimerLog> timer;
+  SliceStrategy* strategy = NewStrategy(strategyName);
+  timer->StartTimer();
+  strategy->Setup(volume.GetPointer(), function, maskSource.GetPointer());
+  timer->StopTimer();
+  double setupTime = timer->GetElapsedTime();
+
+  for (size_t o = 0; o < orientations.size(); ++o)
+    {
+    double axes[9];
+    OrientationAxes(orientations[o], axes);
+
+    // Planes evenly spaced along the normal through the center
+    std::vector<double> latencies;
+    double totalTime = 0.0;
+    double outputs = 0.0;
+    for (int r = 0; r < repeats; ++r)
+      {
+      for (int i = 0; i < slices; ++i)
+        {
+        double offset = size*(0.8*(i + 0.5)/slices - 0.4);
+        double origin[3] = { c + offset*axes[6], c + offset*axes[7],
+                             c + offset*axes[8] };
+        timer->StartTimer();
+        outputs += strategy->Slice(origin, axes);
+        timer->StopTimer();
+        latencies.push_back(1000.0 * timer->GetElapsedTime());
+        totalTime += timer->GetElapsedTime();
+        }
+      }
+    std::sort(latencies.begin(), latencies.end());
+
+    WriteCaseStart(os, first, strategyName, shape, orientations[o], size);
+    os << "      \"iterations\": " << latencies.size() << ",\n"
+       << "      \"setup_time\": " << 1000.0 * setupTime << ",\n"
+       << "      \"real_time\": "
+       << 1000.0 * totalTime / latencies.size() << ",\n"
+       << "      \"p50_time\": " << Percentile(latencies, 50) << ",\n"
+       << "      \"p90_time\": " << Percentile(latencies, 90) << ",\n"
+       << "      \"p99_time\": " << Percentile(latencies, 99) << ",\n"
+       << "      \"max_time\": " << latencies.back() << ",\n"
+       << "      \"time_unit\": \"ms\",\n"
+       << "      \"items_per_second\": "
+       << latencies.size() / totalTime << ",\n"
+       << "      \"outputs\": " << outputs / latencies.size() << ",\n"
+       << "      \"output_unit\": \"" << strategy->GetOutputUnit()
+       << "\",\n"
+       << "      \"peak_rss_mb\": " << PeakMemory() << "\n"
+       << "    }";
+    first = false;
+    }
+  delete strategy;
+}
+
+//-----------------------------------------------------------------------------
+// Run the cases of a strategy in a child process, whose peak resident
+// memory is theirs alone, and append their JSON objects
+void RunChildCases(std::ostream& os, bool& first, const char* program,
+                   int size, const std::string& shape,
+                   const std::string& strategy,
+                   const std::vector<std::string>& orientations, int slices,
+                   int repeats)
+{
+  std::ostringstream command;
+  command << "\"" << program << "\" --child 1 --sizes " << size
+          << " --shapes " << shape << " --strategies " << strategy
+          << " --orientations ";
+  for (size_t o = 0; o < orientations.size(); ++o)
+    {
+    command << (o > 0 ? "," : "") << orientations[o];
+    }
+  command << " --slices " << slices << " --repeats " << repeats;
+
+#if defined(_WIN32)
+  FILE* pipe = _popen(command.str().c_str(), "r");
+#else
+  FILE* pipe = popen(command.str().c_str(), "r");
+#endif
+  std::string cases;
+  int status = -1;
+  if (pipe)
+    {
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+      {
+      cases.append(buffer, n);
+      }
+#if defined(_WIN32)
+    status = _pclose(pipe);
+#else
+    status = pclose(pipe);
+#endif
+    }
+
+  if (status != 0 || cases.empty())
+    {
+    for (size_t o = 0; o < orientations.size(); ++o)
+      {
+      WriteCaseStart(os, first, strategy, shape, orientations[o], size);
+      os << "      \"error_occurred\": true,\n"
+         << "      \"error_message\": \"the child process failed\"\n"
+         << "    }";
+      first = false;
+      }
+    return;
+    }
+  os << (first ? "" : ",\n") << cases;
+  first = false;
+}
+
+//-----------------------------------------------------------------------------
+// Run every combination of the suite options, see the usage at the top
+int RunSuite(int argc, char* argv[])
+{
+  const char* strategyNames[3] = { "reslice", "clip", "cut" };
+  const char* orientationNames[4] =
+    { "axial", "sagittal", "coronal", "oblique" };
+  const char* shapeNames[3] = { "cylinder", "sphere", "box" };
+
+  std::vector<std::string> sizeList = SplitList("64,128,256");
+  std::vector<std::string> strategies = SplitList("reslice,clip,cut");
+  std::vector<std::string> orientations =
+    SplitList("axial,sagittal,coronal,oblique");
+  std::vector<std::string> shapes = SplitList("cylinder");
+  int slices = 32;
+  int repeats = 3;
+  const char* outputFileName = NULL;
+  int child = 0;
+
+  int valid = 1;
+  for (int i = 1; i < argc && valid; i += 2)
+    {
+    const char* value = (i + 1 < argc ? argv[i + 1] : NULL);
+    if (!value)
+      {
+      valid = 0;
+      }
+    else if (strcmp(argv[i], "--sizes") == 0)
+      {
+      sizeList = SplitList(value);
+      }
+    else if (strcmp(argv[i], "--strategies") == 0)
+      {
+      strategies = SplitList(value);
+      }
+    else if (strcmp(argv[i], "--orientations") == 0)
+      {
+      orientations = SplitList(value);
+      }
+    else if (strcmp(argv[i], "--shapes") == 0)
+      {
+      shapes = SplitList(value);
+      }
+    else if (strcmp(argv[i], "--slices") == 0)
+      {
+      slices = atoi(value);
+      }
+    else if (strcmp(argv[i], "--repeats") == 0)
+      {
+      repeats = atoi(value);
+      }
+    else if (strcmp(argv[i], "--output") == 0)
+      {
+      outputFileName = value;
+      }
+    else if (strcmp(argv[i], "--child") == 0)
+      {
+      child = atoi(value);
+      }
+    else
+      {
+      valid = 0;
+      }
+    }
+
+  std::vector<int> sizes;
+  for (size_t i = 0; i < sizeList.size(); ++i)
+    {
+    sizes.push_back(atoi(sizeList[i].c_str()));
+    valid &= (sizes.back() >= 16 && sizes.back() <= 1024);
+    }
+  valid = (valid && !sizes.empty() && slices >= 1 && repeats >= 1 &&
+           CheckList(strategies, strategyNames, 3) &&
+           CheckList(orientations, orientationNames, 4) &&
+           CheckList(shapes, shapeNames, 3));
+  if (!valid)
+    {
+    std::cerr << "Usage: " << argv[0] << " [--sizes 64,128,256]"
+              << " [--strategies reslice,clip,cut]"
+              << " [--orientations axial,sagittal,coronal,oblique]"
+              << " [--shapes cylinder,sphere,box] [--slices 32]"
+              << " [--repeats 3] [--output file.json]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A child process runs a single strategy, see RunChildCases()
+  if (child)
+    {
+    vtkSMPTools::Initialize();
+    RunSuiteCases(std::cout, sizes[0], shapes[0], strategies[0],
+                  orientations, slices, repeats);
+    return EXIT_SUCCESS;
+    }
+
+  std::ofstream file;
+  if (outputFileName)
+    {
+    file.open(outputFileName);
+    if (!file)
+      {
+      std::cerr << "Cannot write " << outputFileName << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  std::ostream& os = (outputFileName ? file : std::cout);
+
+  vtkSMPTools::Initialize();
+  os << "{\n"
+     << "  \"context\": {\n"
+     << "    \"vtk_version\": \"" << VTK_VERSION << "\",\n"
+     << "    \"num_threads\": "
+     << vtkMultiThreader::GetGlobalDefaultNumberOfThreads() << ",\n"
+     << "    \"slices\": " << slices << ",\n"
+     << "    \"repeats\": " << repeats << "\n"
+     << "  },\n"
+     << "  \"benchmarks\": [\n";
+
+  bool first = true;
+  for (size_t z = 0; z < sizes.size(); ++z)
+    {
+    for (size_t h = 0; h < shapes.size(); ++h)
+      {
+      for (size_t s = 0; s < strategies.size(); ++s)
+        {
+        RunChildCases(os, first, argv[0], sizes[z], shapes[h],
+                      strategies[s], orientations, slices, repeats);
+        }
+      }
+    }
+
+  os << "\n  ]\n}\n";
+  return EXIT_SUCCESS;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc > 1 && strncmp(argv[1], "--", 2) == 0)
+    {
+    return RunSuite(argc, argv);
+    }
+
+  int size = (argc > 1 ? atoi(argv[1]) : 256);
+  int repeats = (argc > 2 ? atoi(argv[2]) : 3);
+  int threads = (argc > 3 ? atoi(argv[3]) :
+                 vtkMultiThreader::GetGlobalDefaultNumberOfThreads());
+  if (size < 16 || repeats < 1 || threads < 1)
+    {
+    std::cerr << "Usage: " << argv[0]
+              << " [size >= 16] [repeats >= 1] [threads >= 1]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkSMPTools::Initialize();
+  BenchmarkMask(size, repeats);
+  BenchmarkSlice(size, repeats);
+  BenchmarkCompactMask(size, repeats);
+  BenchmarkCut(size, repeats);
+  BenchmarkClip(size, repeats, threads);
+  BenchmarkRayCast(size, repeats);
+  BenchmarkBricked(size, repeats);
+  BenchmarkLoad(size, repeats);
+  BenchmarkParallelLoad(size, repeats, threads);
+  BenchmarkMaskProvider(size, repeats);
+  BenchmarkLabels(size, repeats);
+  BenchmarkOblique(size, repeats);
+  BenchmarkSlab(size, repeats);
+  BenchmarkMPR(size, repeats);
+
+  return EXIT_SUCCESS;
+}
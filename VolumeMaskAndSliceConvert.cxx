@@ -0,0 +1,81 @@
+// This program converts a volume from the compressed .vti format the examples
+// ship with to the raw .mraw format of vtkImageMappedRawReader, which maps
+// the file in memory instead of decompressing it at every start.
+//
+// Usage: VolumeMaskAndSliceConvert [input.vti] [output.mraw]
+//
+// The default converts Data/Volume.vti to Data/Volume.mraw. The times to
+// read the .vti file and to map the .mraw file are printed, and the voxels
+// of both are compared.
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkTimerLog.h>
+#include <vtkXMLImageDataReader.h>
+
+#include "vtkImageMappedRawReader.h"
+#include "vtkImageMappedRawWriter.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+  const char* inputName = (argc > 1 ? argv[1] : "Data/Volume.vti");
+  const char* outputName = (argc > 2 ? argv[2] : "Data/Volume.mraw");
+  if (argc > 3)
+    {
+    std::cerr << "Usage: " << argv[0] << " [input.vti] [output.mraw]"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  vtkNew<vtkXMLImageDataReader> reader;
+  reader->SetFileName(inputName);
+  reader->Update();
+  timer->StopTimer();
+  double readTime = timer->GetElapsedTime();
+  vtkImageData* volume = reader->GetOutput();
+  if (volume->GetNumberOfPoints() == 0 || !volume->GetScalarPointer())
+    {
+    std::cerr << "Cannot read " << inputName << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkImageMappedRawWriter> writer;
+  writer->SetFileName(outputName);
+  writer->SetInputData(volume);
+  writer->Write();
+  if (writer->GetErrorCode() != 0 ||
+      !vtkImageMappedRawReader::CanReadFile(outputName))
+    {
+    std::cerr << "Cannot write " << outputName << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  timer->StartTimer();
+  vtkNew<vtkImageMappedRawReader> rawReader;
+  rawReader->SetFileName(outputName);
+  rawReader->Update();
+  timer->StopTimer();
+  double mapTime = timer->GetElapsedTime();
+
+  vtkImageData* mapped = rawReader->GetOutput();
+  size_t size = static_cast<size_t>(volume->GetNumberOfPoints()) *
+    volume->GetNumberOfScalarComponents() * volume->GetScalarSize();
+  int identical =
+    (mapped->GetNumberOfPoints() == volume->GetNumberOfPoints() &&
+     memcmp(mapped->GetScalarPointer(), volume->GetScalarPointer(),
+            size) == 0);
+  std::cout << inputName << " -> " << outputName
+            << " size=" << size / (1024.0 * 1024.0) << "MB"
+            << " read=" << 1000.0 * readTime << "ms"
+            << " map=" << 1000.0 * mapTime << "ms"
+            << " identical=" << (identical ? "yes" : "no") << std::endl;
+
+  return (identical ? EXIT_SUCCESS : EXIT_FAILURE);
+}
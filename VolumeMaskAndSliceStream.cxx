@@ -0,0 +1,196 @@
+// This program colormaps every masked axial slice of a volume without ever
+// loading the whole volume. The reader and the mask source only produce the
+// slab of slices each reslice plane passes through, which is what
+// vtkImageMaskedResliceToRGBA requests from them, so the peak memory is
+// bounded by a few slices instead of volume + mask + resliced copies.
+//
+// Usage: VolumeMaskAndSliceStream [file.vti|file.mraw] [--whole]
+//
+// Raw volumes written by VolumeMaskAndSliceConvert are mapped in memory: each
+// slab is then a view of the mapping, and only the pages of its slices are
+// loaded.
+//
+// With --whole the volume is read entirely first, as the other examples do,
+// so that the peak memory of both approaches can be compared.
+
+// VTK includes
+#include <vtkColorTransferFunction.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTimerLog.h>
+#include <vtkXMLImageDataReader.h>
+
+#include "vtkImageMappedRawReader.h"
+#include "vtkImageMaskedResliceToRGBA.h"
+#include "vtkImageShapeMaskSource.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Peak resident memory of the process in MB
+double PeakMemory()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                            sizeof(counters)))
+    {
+    return 0.0;
+    }
+  return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+    return 0.0;
+    }
+#if defined(__APPLE__)
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const char* fileName = "Data/Volume.vti";
+  bool whole = false;
+  for (int i = 1; i < argc; ++i)
+    {
+    if (strcmp(argv[i], "--whole") == 0)
+      {
+      whole = true;
+      }
+    else
+      {
+      fileName = argv[i];
+      }
+    }
+
+  // Only read the meta data, the voxels are read piece by piece
+  vtkSmartPointer<vtkImageAlgorithm> reader;
+  if (vtkImageMappedRawReader::CanReadFile(fileName))
+    {
+    vtkSmartPointer<vtkImageMappedRawReader> rawReader =
+      vtkSmartPointer<vtkImageMappedRawReader>::New();
+    rawReader->SetFileName(fileName);
+    reader = rawReader;
+    }
+  else
+    {
+    vtkSmartPointer<vtkXMLImageDataReader> xmlReader =
+      vtkSmartPointer<vtkXMLImageDataReader>::New();
+    xmlReader->SetFileName(fileName);
+    reader = xmlReader;
+    }
+  reader->UpdateInformation();
+  vtkInformation* info = reader->GetOutputInformation(0);
+  int extent[6];
+  double origin[3], spacing[3];
+  info->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent);
+  info->Get(vtkDataObject::ORIGIN(), origin);
+  info->Get(vtkDataObject::SPACING(), spacing);
+  if (extent[0] > extent[1])
+    {
+    std::cerr << "Cannot read " << fileName << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (whole)
+    {
+    reader->Update();
+    }
+
+  double center[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    center[i] = origin[i] + spacing[i] * 0.5 * (extent[2*i] + extent[2*i+1]);
+    }
+
+  // Same cylindrical mask as VolumeMaskAndSlice.cxx
+  vtkNew<vtkImageShapeMaskSource> maskSource;
+  maskSource->SetWholeExtent(extent);
+  maskSource->SetOrigin(origin);
+  maskSource->SetSpacing(spacing);
+  maskSource->SetShapeTypeToCylinder();
+  maskSource->SetCylinderAxis(2);
+  maskSource->SetCenter(center);
+  maskSource->SetRadius(
+    ((extent[1] - extent[0] + 1)/2.0 - 5.0)*spacing[0]);
+
+  vtkNew<vtkColorTransferFunction> ctf;
+  ctf->AddRGBPoint(1096.0, 0.7, 0.015, 0.15);
+  ctf->AddRGBPoint(2777, 0.86, 0.86, 0.86);
+  ctf->AddRGBPoint(4458, 0.23, 0.3, 0.75);
+  vtkNew<vtkPiecewiseFunction> pwf;
+  pwf->AddPoint(1096.0, 0.0);
+  pwf->AddPoint(3900.0, 0.0);
+  pwf->AddPoint(3900.0, 1.0);
+  pwf->AddPoint(4458.0, 1.0);
+
+  vtkNew<vtkImageMaskedResliceToRGBA> maskedSlice;
+  maskedSlice->SetInputConnection(reader->GetOutputPort());
+  maskedSlice->SetMaskInputConnection(maskSource->GetOutputPort());
+  maskedSlice->SetResliceAxesDirectionCosines(1,0,0, 0,1,0, 0,0,-1);
+  maskedSlice->SetInterpolationModeToLinear();
+  maskedSlice->SetColorFunction(ctf.GetPointer());
+  maskedSlice->SetOpacityFunction(pwf.GetPointer());
+
+  // Colormap every slice and count the opaque pixels so that the work
+  // cannot be optimized away
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  vtkIdType maxPieceVoxels = 0;
+  vtkIdType opaque = 0;
+  for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+    maskedSlice->SetResliceAxesOrigin(center[0], center[1],
+                                      origin[2] + k*spacing[2]);
+    maskedSlice->Update();
+
+    vtkIdType pieceVoxels = reader->GetOutput()->GetNumberOfPoints();
+    maxPieceVoxels = (pieceVoxels > maxPieceVoxels ?
+                      pieceVoxels : maxPieceVoxels);
+
+    vtkImageData* slice = maskedSlice->GetOutput();
+    const unsigned char* rgba =
+      static_cast<const unsigned char*>(slice->GetScalarPointer());
+    vtkIdType n = slice->GetNumberOfPoints();
+    for (vtkIdType i = 0; i < n; ++i)
+      {
+      opaque += (rgba[4*i+3] != 0);
+      }
+    }
+  timer->StopTimer();
+
+  vtkIdType wholeVoxels =
+    static_cast<vtkIdType>(extent[1] - extent[0] + 1) *
+    (extent[3] - extent[2] + 1) * (extent[5] - extent[4] + 1);
+  std::cout << "slices=" << extent[5] - extent[4] + 1
+            << " mode=" << (whole ? "whole" : "streamed")
+            << " time=" << timer->GetElapsedTime() << "s"
+            << " maxPieceVoxels=" << maxPieceVoxels
+            << " wholeVoxels=" << wholeVoxels
+            << " opaquePixels=" << opaque
+            << " peakMemory=" << PeakMemory() << "MB" << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,502 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageAsyncSliceProducer.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageAsyncSliceProducer.h"
+
+#include "vtkImageCachedResliceToRGBA.h"
+#include "vtkImageCompactMask.h"
+#include "vtkRGBATransferTable.h"
+
+#include <vtkAtomicInt.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkConditionVariable.h>
+#include <vtkDataObject.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+
+vtkStandardNewMacro(vtkImageAsyncSliceProducer);
+vtkCxxSetObjectMacro(vtkImageAsyncSliceProducer, Slicer,
+                     vtkImageMaskedResliceToRGBA);
+
+//-----------------------------------------------------------------------------
+// Filter of the background thread. Recent slices are cached, so scrolling
+// back does not recompute them, and the execution in progress can be
+// abandoned from another thread.
+class vtkImageAsyncSliceFilter : public vtkImageCachedResliceToRGBA
+{
+public:
+  static vtkImageAsyncSliceFilter* New();
+  vtkTypeMacro(vtkImageAsyncSliceFilter, vtkImageCachedResliceToRGBA);
+
+  // Abandon the execution in progress at the next row, without modifying
+  // the filter
+  void Cancel() { this->AbortExecute = 1; }
+  void Resume() { this->AbortExecute = 0; }
+
+protected:
+  vtkImageAsyncSliceFilter() {}
+  ~vtkImageAsyncSliceFilter() {}
+
+private:
+  vtkImageAsyncSliceFilter(const vtkImageAsyncSliceFilter&); // Not implemented
+  void operator=(const vtkImageAsyncSliceFilter&); // Not implemented
+};
+
+vtkStandardNewMacro(vtkImageAsyncSliceFilter);
+
+//-----------------------------------------------------------------------------
+// Inputs and settings of the slicer the background filter was set up with
+struct vtkImageAsyncSliceSettings
+{
+  unsigned long Times[4];
+  int InterpolationMode;
+  double BackgroundValue;
+  double SlabThickness;
+  int SlabMode;
+  int Bricks[3];
+
+  bool operator==(const vtkImageAsyncSliceSettings& other) const
+    {
+    return (std::equal(this->Times, this->Times + 4, other.Times) &&
+            this->InterpolationMode == other.InterpolationMode &&
+            this->BackgroundValue == other.BackgroundValue &&
+            this->SlabThickness == other.SlabThickness &&
+            this->SlabMode == other.SlabMode &&
+            std::equal(this->Bricks, this->Bricks + 3, other.Bricks));
+    }
+};
+
+//-----------------------------------------------------------------------------
+class vtkImageAsyncSliceProducerInternals
+{
+public:
+  vtkImageAsyncSliceProducerInternals()
+    {
+    this->ThreadId = -1;
+    this->Busy = 0;
+    this->Terminate = 0;
+    this->HasPending = 0;
+    this->PendingGeneration = 0;
+    this->HasSettings = 0;
+    for (int b = 0; b < 3; ++b)
+      {
+      this->Slots[b] = vtkSmartPointer<vtkImageData>::New();
+      this->SlotGenerations[b] = 0;
+      }
+    this->Front = 0;
+    this->Reading = -1;
+    this->Published = 0;
+    this->Finished = 0;
+    this->Cancelled = 0;
+    this->Current = vtkSmartPointer<vtkImageData>::New();
+    this->CurrentGeneration = 0;
+    }
+
+  // Copy a finished slice into a buffer that is neither the front one nor
+  // the one the reader uses, and make it the front one. One of the three
+  // buffers is always free, so the writer never waits. Only the background
+  // thread writes. The reader only takes the front buffer after checking
+  // that it is still the front one, and the buffer written is not the
+  // front one until the copy is done.
+  void Publish(vtkImageData* slice, int generation)
+    {
+    int front = this->Front;
+    int reading = this->Reading;
+    int back = 0;
+    while (back == front || back == reading)
+      {
+      ++back;
+      }
+    this->Slots[back]->DeepCopy(slice);
+    this->SlotGenerations[back] = generation;
+    this->Front = back;
+    this->Published = generation;
+    }
+
+  // Copy the front buffer into a new current slice. Only the thread that
+  // updates the output reads.
+  void Acquire()
+    {
+    int front;
+    for (;;)
+      {
+      front = this->Front;
+      this->Reading = front;
+      if (this->Front == front)
+        {
+        break;
+        }
+      this->Reading = -1;
+      }
+    vtkSmartPointer<vtkImageData> current =
+      vtkSmartPointer<vtkImageData>::New();
+    current->DeepCopy(this->Slots[front]);
+    this->CurrentGeneration = this->SlotGenerations[front];
+    this->Reading = -1;
+    this->Current = current;
+    }
+
+  // Job queue of a single slot, guarded by Lock. A newer request replaces
+  // the pending one.
+  vtkNew<vtkMutexLock> Lock;
+  vtkNew<vtkConditionVariable> Condition;
+  vtkNew<vtkMultiThreader> Threader;
+  int ThreadId;
+  int Busy;
+  int Terminate;
+  int HasPending;
+  double PendingAxes[12];
+  int PendingGeneration;
+
+  // Background filter and its copies of the transfer functions. Only
+  // configured while the thread is not busy.
+  vtkNew<vtkImageAsyncSliceFilter> Filter;
+  vtkNew<vtkMatrix4x4> Axes;
+  vtkNew<vtkColorTransferFunction> ColorFunction;
+  vtkNew<vtkPiecewiseFunction> OpacityFunction;
+  vtkImageAsyncSliceSettings Settings;
+  int HasSettings;
+
+  // Triple buffered handoff between the background thread and the output
+  vtkSmartPointer<vtkImageData> Slots[3];
+  int SlotGenerations[3];
+  vtkAtomicInt<int> Front;
+  vtkAtomicInt<int> Reading;
+  vtkAtomicInt<int> Published;
+  vtkAtomicInt<int> Finished;
+  vtkAtomicInt<int> Cancelled;
+
+  // Slice of the output, only used by the thread that updates it
+  vtkSmartPointer<vtkImageData> Current;
+  int CurrentGeneration;
+};
+
+//-----------------------------------------------------------------------------
+vtkImageAsyncSliceProducer::vtkImageAsyncSliceProducer()
+{
+  this->Slicer = NULL;
+  this->NumberOfRequestedSlices = 0;
+  this->Internals = new vtkImageAsyncSliceProducerInternals;
+  vtkImageAsyncSliceProducerInternals* s = this->Internals;
+  s->Filter->SetResliceAxes(s->Axes.GetPointer());
+  this->SetNumberOfInputPorts(0);
+}
+
+//-----------------------------------------------------------------------------
+vtkImageAsyncSliceProducer::~vtkImageAsyncSliceProducer()
+{
+  vtkImageAsyncSliceProducerInternals* s = this->Internals;
+  s->Lock->Lock();
+  s->Terminate = 1;
+  s->HasPending = 0;
+  s->Filter->Cancel();
+  s->Condition->Broadcast();
+  s->Lock->Unlock();
+  if (s->ThreadId >= 0)
+    {
+    s->Threader->TerminateThread(s->ThreadId);
+    }
+  delete this->Internals;
+  this->SetSlicer(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageAsyncSliceProducer::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Slicer: " << this->Slicer << "\n";
+  os << indent << "NumberOfRequestedSlices: "
+     << this->NumberOfRequestedSlices << "\n";
+  os << indent << "NumberOfFinishedSlices: "
+     << this->GetNumberOfFinishedSlices() << "\n";
+  os << indent << "NumberOfCancelledSlices: "
+     << this->GetNumberOfCancelledSlices() << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkImageAsyncSliceProducer::GetNumberOfFinishedSlices()
+{
+  return this->Internals->Finished;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageAsyncSliceProducer::GetNumberOfCancelledSlices()
+{
+  return this->Internals->Cancelled;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageAsyncSliceProducer::RequestSlice()
+{
+  if (!this->Slicer)
+    {
+    vtkErrorMacro(<< "No slicer set");
+    return;
+    }
+
+  double axes[12];
+  vtkMatrix4x4* matrix = this->Slicer->GetResliceAxes();
+  for (int i = 0; i < 12; ++i)
+    {
+    axes[i] = (matrix ? matrix->GetElement(i / 4, i % 4) : (i % 5 == 0));
+    }
+
+  // Bring the whole inputs of the slicer up to date, the slices may be
+  // anywhere in them
+  for (int port = 0; port < 2; ++port)
+    {
+    if (this->Slicer->GetNumberOfInputConnections(port) > 0)
+      {
+      this->Slicer->GetInputAlgorithm(port, 0)->UpdateWholeExtent();
+      }
+    }
+
+  vtkImageAsyncSliceProducerInternals* s = this->Internals;
+  s->Lock->Lock();
+  std::copy(axes, axes + 12, s->PendingAxes);
+  s->PendingGeneration = ++this->NumberOfRequestedSlices;
+  s->HasPending = 1;
+  s->Filter->Cancel();
+  this->ConfigureFilter();
+  if (s->ThreadId < 0)
+    {
+    s->ThreadId = s->Threader->SpawnThread(
+      &vtkImageAsyncSliceProducer::JobThread, s);
+    }
+  s->Condition->Broadcast();
+  s->Lock->Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageAsyncSliceProducer::ConfigureFilter()
+{
+  vtkImageAsyncSliceProducerInternals* s = this->Internals;
+  vtkImageMaskedResliceToRGBA* slicer = this->Slicer;
+
+  vtkImageData* inputs[2] = { NULL, NULL };
+  for (int port = 0; port < 2; ++port)
+    {
+    if (slicer->GetNumberOfInputConnections(port) > 0)
+      {
+      inputs[port] =
+        vtkImageData::SafeDownCast(slicer->GetInputDataObject(port, 0));
+      }
+    }
+  vtkImageCompactMask* compactMask = slicer->GetCompactMask();
+
+  vtkImageAsyncSliceSettings settings;
+  settings.Times[0] = (inputs[0] ? inputs[0]->GetMTime() : 0);
+  settings.Times[1] = (inputs[1] ? inputs[1]->GetMTime() : 0);
+  settings.Times[2] = (compactMask ? compactMask->GetMTime() : 0);
+  settings.Times[3] = slicer->GetLookupTable()->GetMTime();
+  settings.InterpolationMode = slicer->GetInterpolationMode();
+  settings.BackgroundValue = slicer->GetBackgroundValue();
+  settings.SlabThickness = slicer->GetSlabThickness();
+  settings.SlabMode = slicer->GetSlabMode();
+  settings.Bricks[0] = slicer->GetUseBrickedLayout();
+  settings.Bricks[1] = slicer->GetBrickSize();
+  settings.Bricks[2] = slicer->GetBrickOrder();
+  if (s->HasSettings && s->Settings == settings)
+    {
+    return;
+    }
+
+  // The job in progress was cancelled, wait for it to return
+  while (s->Busy)
+    {
+    s->Condition->Wait(s->Lock.GetPointer());
+    }
+
+  vtkImageAsyncSliceFilter* filter = s->Filter.GetPointer();
+  if (inputs[0])
+    {
+    vtkNew<vtkImageData> volumeCopy;
+    volumeCopy->ShallowCopy(inputs[0]);
+    filter->SetInputData(volumeCopy.GetPointer());
+    }
+  else
+    {
+    filter->SetInputData(NULL);
+    }
+  if (inputs[1] && !compactMask)
+    {
+    vtkNew<vtkImageData> maskCopy;
+    maskCopy->ShallowCopy(inputs[1]);
+    filter->SetMaskInputData(maskCopy.GetPointer());
+    }
+  else
+    {
+    filter->SetMaskInputData(NULL);
+    }
+  filter->SetCompactMask(compactMask);
+  filter->SetInterpolationMode(slicer->GetInterpolationMode());
+  filter->SetBackgroundValue(slicer->GetBackgroundValue());
+  filter->SetSlabThickness(slicer->GetSlabThickness());
+  filter->SetSlabMode(slicer->GetSlabMode());
+  filter->SetUseBrickedLayout(slicer->GetUseBrickedLayout());
+  filter->SetBrickSize(slicer->GetBrickSize());
+  filter->SetBrickOrder(slicer->GetBrickOrder());
+  filter->SetNumberOfColors(slicer->GetNumberOfColors());
+  if (slicer->GetColorFunction())
+    {
+    s->ColorFunction->DeepCopy(slicer->GetColorFunction());
+    filter->SetColorFunction(s->ColorFunction.GetPointer());
+    }
+  else
+    {
+    filter->SetColorFunction(NULL);
+    }
+  if (slicer->GetOpacityFunction())
+    {
+    s->OpacityFunction->DeepCopy(slicer->GetOpacityFunction());
+    filter->SetOpacityFunction(s->OpacityFunction.GetPointer());
+    }
+  else
+    {
+    filter->SetOpacityFunction(NULL);
+    }
+  s->Settings = settings;
+  s->HasSettings = 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageAsyncSliceProducer::CheckForNewSlice()
+{
+  if (this->Internals->Published != this->Internals->CurrentGeneration)
+    {
+    this->Modified();
+    return 1;
+    }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageAsyncSliceProducer::WaitForSlice()
+{
+  vtkImageAsyncSliceProducerInternals* s = this->Internals;
+  s->Lock->Lock();
+  while (s->ThreadId >= 0 && !s->Terminate &&
+         s->Published < this->NumberOfRequestedSlices)
+    {
+    s->Condition->Wait(s->Lock.GetPointer());
+    }
+  s->Lock->Unlock();
+  this->CheckForNewSlice();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageAsyncSliceProducer::AcquirePublishedSlice()
+{
+  if (this->Internals->Published != this->Internals->CurrentGeneration)
+    {
+    this->Internals->Acquire();
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkImageAsyncSliceProducer::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  this->AcquirePublishedSlice();
+  vtkImageData* current = this->Internals->Current;
+
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),
+               current->GetExtent(), 6);
+  outInfo->Set(vtkDataObject::ORIGIN(), current->GetOrigin(), 3);
+  outInfo->Set(vtkDataObject::SPACING(), current->GetSpacing(), 3);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageAsyncSliceProducer::RequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  vtkImageData* output = vtkImageData::GetData(outputVector);
+  output->ShallowCopy(this->Internals->Current);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkImageAsyncSliceProducer::JobThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkImageAsyncSliceProducerInternals* s =
+    static_cast<vtkImageAsyncSliceProducerInternals*>(info->UserData);
+  vtkImageAsyncSliceFilter* filter = s->Filter.GetPointer();
+
+  s->Lock->Lock();
+  for (;;)
+    {
+    while (!s->Terminate && !s->HasPending)
+      {
+      s->Condition->Wait(s->Lock.GetPointer());
+      }
+    if (s->Terminate)
+      {
+      break;
+      }
+    double axes[12];
+    std::copy(s->PendingAxes, s->PendingAxes + 12, axes);
+    int generation = s->PendingGeneration;
+    s->HasPending = 0;
+    s->Busy = 1;
+    filter->Resume();
+    s->Lock->Unlock();
+
+    for (int i = 0; i < 12; ++i)
+      {
+      s->Axes->SetElement(i / 4, i % 4, axes[i]);
+      }
+    // A cancelled execution leaves the output incomplete, even for the
+    // same axes
+    filter->Modified();
+    filter->Update();
+
+    s->Lock->Lock();
+    if (s->HasPending || s->Terminate || filter->GetAbortExecute())
+      {
+      ++s->Cancelled;
+      s->Busy = 0;
+      s->Condition->Broadcast();
+      continue;
+      }
+    s->Lock->Unlock();
+
+    s->Publish(filter->GetOutput(), generation);
+    ++s->Finished;
+
+    s->Lock->Lock();
+    s->Busy = 0;
+    s->Condition->Broadcast();
+    }
+  s->Lock->Unlock();
+  return VTK_THREAD_RETURN_VALUE;
+}
@@ -0,0 +1,125 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageAsyncSliceProducer.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageAsyncSliceProducer - compute masked RGBA slices on a
+// background thread and publish the latest finished one.
+//
+// .SECTION Description
+// vtkImageAsyncSliceProducer is a source whose output is the most recent
+// slice computed off the calling thread. The inputs and settings of the
+// slices are those of a vtkImageMaskedResliceToRGBA given with SetSlicer(),
+// which is never executed itself. Each call to RequestSlice() takes the
+// current reslice axes of the slicer and queues a job for the background
+// thread; a job not started yet is replaced by the newer one, and a job
+// being computed is cancelled. The background thread runs a private
+// multithreaded copy of the slicer, so a single slice still uses all cores.
+//
+// Finished slices are handed over through three buffers: the background
+// thread writes one that is neither the published one nor the one the
+// output is reading from, which always exists, and then publishes it with
+// an atomic index, so neither side waits for the other.
+// The application polls CheckForNewSlice(), typically from a repeating
+// interactor timer, and renders when it returns 1. Rendering never waits for
+// a slice, however long it takes to compute.
+//
+// When the settings of the slicer or its inputs change, the next
+// RequestSlice() cancels the job in progress and hands shallow copies of
+// the updated inputs to the background thread.
+//
+// .SECTION see also
+// vtkImageMaskedResliceToRGBA vtkImageCachedResliceToRGBA
+
+#ifndef __vtkImageAsyncSliceProducer_h
+#define __vtkImageAsyncSliceProducer_h
+
+#include <vtkImageAlgorithm.h>
+#include <vtkMultiThreader.h> // For VTK_THREAD_RETURN_TYPE
+
+// Forward declarations
+class vtkImageAsyncSliceProducerInternals;
+class vtkImageMaskedResliceToRGBA;
+
+class vtkImageAsyncSliceProducer : public vtkImageAlgorithm
+{
+public:
+  static vtkImageAsyncSliceProducer* New();
+  vtkTypeMacro(vtkImageAsyncSliceProducer, vtkImageAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/Get the filter whose inputs, settings and reslice axes the slices
+  // are computed with
+  virtual void SetSlicer(vtkImageMaskedResliceToRGBA* slicer);
+  vtkGetObjectMacro(Slicer, vtkImageMaskedResliceToRGBA);
+
+  // Description:
+  // Queue the slice at the current reslice axes of the slicer, cancelling
+  // the pending and running ones. Must be called from the thread that
+  // updates the output.
+  void RequestSlice();
+
+  // Description:
+  // Return 1 and mark the output out of date when a slice was finished
+  // since the output was last updated, 0 otherwise. Never blocks.
+  int CheckForNewSlice();
+
+  // Description:
+  // Block until the last requested slice is finished, e.g. to have an
+  // output before the first render
+  void WaitForSlice();
+
+  // Description:
+  // Get the number of slices requested, finished and abandoned for a newer
+  // request
+  vtkGetMacro(NumberOfRequestedSlices, int);
+  int GetNumberOfFinishedSlices();
+  int GetNumberOfCancelledSlices();
+
+protected:
+  vtkImageAsyncSliceProducer();
+  ~vtkImageAsyncSliceProducer();
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector);
+
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  // Description:
+  // Hand the current inputs and settings of the slicer to the background
+  // filter if they changed since the last request. Called with the job
+  // lock held and the background thread idle.
+  void ConfigureFilter();
+
+  // Description:
+  // Take the most recently published slice, if newer than the current one
+  void AcquirePublishedSlice();
+
+  // Description:
+  // Body of the background thread
+  static VTK_THREAD_RETURN_TYPE JobThread(void* arg);
+
+  vtkImageMaskedResliceToRGBA* Slicer;
+  int NumberOfRequestedSlices;
+
+  vtkImageAsyncSliceProducerInternals* Internals;
+
+private:
+  vtkImageAsyncSliceProducer(const vtkImageAsyncSliceProducer&); // Not implemented
+  void operator=(const vtkImageAsyncSliceProducer&); // Not implemented
+};
+
+#endif //__vtkImageAsyncSliceProducer_h
@@ -0,0 +1,284 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageBrickedVolume.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageBrickedVolume.h"
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+vtkStandardNewMacro(vtkImageBrickedVolume);
+
+//-----------------------------------------------------------------------------
+// Spread the lower 21 bits of x three bits apart
+static vtkTypeUInt64 vtkMortonSpread(vtkTypeUInt64 x)
+{
+  x &= 0x1fffff;
+  x = (x | (x << 32)) & 0x1f00000000ffffULL;
+  x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+  x = (x | (x << 8)) & 0x100f00f00f00f00fULL;
+  x = (x | (x << 4)) & 0x10c30c30c30c30c3ULL;
+  x = (x | (x << 2)) & 0x1249249249249249ULL;
+  return x;
+}
+
+//-----------------------------------------------------------------------------
+// Copies the voxels of a range of bricks from the image
+template <class T>
+class vtkImageBrickedVolumeImportFunctor
+{
+public:
+  const T* Scalars;
+  vtkIdType Increments[3];
+  int Dimensions[3];
+  int BrickSize;
+  int GridDimensions[3];
+  const vtkIdType* BrickOffsets;
+  T* Bricks;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    const int size = this->BrickSize;
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      int lo[3];
+      lo[0] = static_cast<int>(b % this->GridDimensions[0])*size;
+      lo[1] = static_cast<int>((b / this->GridDimensions[0]) %
+                               this->GridDimensions[1])*size;
+      lo[2] = static_cast<int>(b / (static_cast<vtkIdType>(
+        this->GridDimensions[0])*this->GridDimensions[1]))*size;
+      int n[3];
+      for (int c = 0; c < 3; ++c)
+        {
+        n[c] = std::min(size, this->Dimensions[c] - lo[c]);
+        }
+
+      // Padding voxels are never sampled, but keep them deterministic
+      T* brick = this->Bricks + this->BrickOffsets[b];
+      if (n[0] < size || n[1] < size || n[2] < size)
+        {
+        std::fill(brick, brick + size*size*size, T(0));
+        }
+      for (int k = 0; k < n[2]; ++k)
+        {
+        for (int j = 0; j < n[1]; ++j)
+          {
+          const T* in = this->Scalars + lo[0]*this->Increments[0] +
+            (lo[1] + j)*this->Increments[1] + (lo[2] + k)*this->Increments[2];
+          T* out = brick + (k*size + j)*size;
+          for (int i = 0; i < n[0]; ++i, in += this->Increments[0])
+            {
+            out[i] = *in;
+            }
+          }
+        }
+      }
+    }
+};
+
+//-----------------------------------------------------------------------------
+vtkImageBrickedVolume::vtkImageBrickedVolume()
+{
+  this->BrickOrder = LINEAR;
+  this->BrickSize = 16;
+  this->BrickShift = 4;
+  for (int c = 0; c < 3; ++c)
+    {
+    this->Extent[2*c] = 0;
+    this->Extent[2*c+1] = -1;
+    this->Origin[c] = 0.0;
+    this->Spacing[c] = 1.0;
+    this->GridDimensions[c] = 0;
+    }
+  this->Scalars = NULL;
+}
+
+//-----------------------------------------------------------------------------
+vtkImageBrickedVolume::~vtkImageBrickedVolume()
+{
+  if (this->Scalars)
+    {
+    this->Scalars->Delete();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageBrickedVolume::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "BrickOrder: "
+     << (this->BrickOrder == MORTON ? "Morton" : "Linear") << "\n";
+  os << indent << "BrickSize: " << this->BrickSize << "\n";
+  os << indent << "Extent: ";
+  for (int i = 0; i < 6; ++i)
+    {
+    os << this->Extent[i] << (i < 5 ? " " : "\n");
+    }
+  os << indent << "GridDimensions: " << this->GridDimensions[0] << " "
+     << this->GridDimensions[1] << " " << this->GridDimensions[2] << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkImageBrickedVolume::SetBrickSize(int size)
+{
+  int shift = 0;
+  while (shift < 8 && (2 << shift) <= size)
+    {
+    ++shift;
+    }
+  if (this->BrickShift != shift)
+    {
+    this->BrickShift = shift;
+    this->BrickSize = 1 << shift;
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkImageBrickedVolume::GetScalarType()
+{
+  return this->Scalars ? this->Scalars->GetDataType() : VTK_VOID;
+}
+
+//----------------------------------------------------------------------------
+void* vtkImageBrickedVolume::GetScalarPointer()
+{
+  return this->Scalars ? this->Scalars->GetVoidPointer(0) : NULL;
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImageBrickedVolume::GetActualMemorySize()
+{
+  unsigned long size = static_cast<unsigned long>(
+    this->BrickOffsets.size()*sizeof(vtkIdType) / 1024);
+  return size + (this->Scalars ? this->Scalars->GetActualMemorySize() : 0);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageBrickedVolume::ImportImage(vtkImageData* image)
+{
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  if (!scalars)
+    {
+    vtkErrorMacro(<< "ImportImage: the image has no scalars");
+    return 0;
+    }
+
+  int extent[6];
+  image->GetExtent(extent);
+  unsigned long importTime = this->ImportTime.GetMTime();
+  if (this->Scalars && importTime > image->GetMTime() &&
+      importTime > this->GetMTime() &&
+      std::equal(extent, extent + 6, this->Extent) &&
+      this->Scalars->GetDataType() == scalars->GetDataType())
+    {
+    return 1;
+    }
+
+  std::copy(extent, extent + 6, this->Extent);
+  image->GetOrigin(this->Origin);
+  image->GetSpacing(this->Spacing);
+  int dims[3];
+  vtkIdType numBricks = 1;
+  for (int c = 0; c < 3; ++c)
+    {
+    dims[c] = std::max(extent[2*c+1] - extent[2*c] + 1, 0);
+    this->GridDimensions[c] =
+      (dims[c] + this->BrickSize - 1) >> this->BrickShift;
+    numBricks *= this->GridDimensions[c];
+    }
+
+  // Bricks are numbered x fastest in the grid; their rank in memory is the
+  // same number, or the rank of their Morton code
+  vtkIdType brickVoxels = static_cast<vtkIdType>(this->BrickSize) *
+    this->BrickSize*this->BrickSize;
+  this->BrickOffsets.resize(numBricks);
+  if (this->BrickOrder == MORTON)
+    {
+    std::vector<std::pair<vtkTypeUInt64, vtkIdType> > codes(numBricks);
+    vtkIdType b = 0;
+    for (int k = 0; k < this->GridDimensions[2]; ++k)
+      {
+      for (int j = 0; j < this->GridDimensions[1]; ++j)
+        {
+        for (int i = 0; i < this->GridDimensions[0]; ++i, ++b)
+          {
+          codes[b].first = vtkMortonSpread(i) | (vtkMortonSpread(j) << 1) |
+            (vtkMortonSpread(k) << 2);
+          codes[b].second = b;
+          }
+        }
+      }
+    std::sort(codes.begin(), codes.end());
+    for (vtkIdType r = 0; r < numBricks; ++r)
+      {
+      this->BrickOffsets[codes[r].second] = r*brickVoxels;
+      }
+    }
+  else
+    {
+    for (vtkIdType b = 0; b < numBricks; ++b)
+      {
+      this->BrickOffsets[b] = b*brickVoxels;
+      }
+    }
+
+  if (this->Scalars &&
+      this->Scalars->GetDataType() != scalars->GetDataType())
+    {
+    this->Scalars->Delete();
+    this->Scalars = NULL;
+    }
+  if (!this->Scalars)
+    {
+    this->Scalars = vtkDataArray::CreateDataArray(scalars->GetDataType());
+    }
+  this->Scalars->SetNumberOfTuples(numBricks*brickVoxels);
+  if (numBricks == 0)
+    {
+    this->ImportTime.Modified();
+    return 1;
+    }
+
+  vtkIdType increments[3];
+  image->GetIncrements(increments[0], increments[1], increments[2]);
+  void* inPtr = image->GetScalarPointer();
+  void* outPtr = this->Scalars->GetVoidPointer(0);
+  switch (scalars->GetDataType())
+    {
+    vtkTemplateMacro(
+      vtkImageBrickedVolumeImportFunctor<VTK_TT> functor;
+      functor.Scalars = static_cast<const VTK_TT*>(inPtr);
+      std::copy(increments, increments + 3, functor.Increments);
+      std::copy(dims, dims + 3, functor.Dimensions);
+      functor.BrickSize = this->BrickSize;
+      std::copy(this->GridDimensions, this->GridDimensions + 3,
+                functor.GridDimensions);
+      functor.BrickOffsets = &this->BrickOffsets[0];
+      functor.Bricks = static_cast<VTK_TT*>(outPtr);
+      vtkSMPTools::For(0, numBricks, 1, functor));
+    default:
+      vtkErrorMacro(<< "ImportImage: Unknown input ScalarType");
+      return 0;
+    }
+
+  this->ImportTime.Modified();
+  return 1;
+}
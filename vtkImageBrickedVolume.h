@@ -0,0 +1,140 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageBrickedVolume.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageBrickedVolume - the scalars of an image stored in cubic
+// bricks, for cache friendly access along any direction.
+//
+// .SECTION Description
+// vtkImageData stores its voxels x fastest, so walking along x touches
+// consecutive bytes while walking along z jumps by a whole slice at every
+// step. vtkImageBrickedVolume stores the first scalar component of an image
+// in bricks of BrickSize^3 voxels instead, each brick contiguous and x
+// fastest inside. Any small neighbourhood of voxels then lies in a few
+// bricks, whatever the direction it is walked along, so reslicing a
+// sagittal, coronal or oblique plane reads memory about as well as an axial
+// one.
+//
+// The bricks are stored in x, y, z order of the brick grid (LINEAR), or
+// along a Z-order curve of the brick grid (MORTON) so that neighbouring
+// bricks in all three directions tend to be close in memory too. The bricks
+// on the upper sides of the extent are padded to the full brick size.
+//
+// Build the bricks with ImportImage(), then address voxels with
+// GetOffset() into GetScalarPointer().
+//
+// .SECTION see also
+// vtkImageMaskedResliceToRGBA vtkImageCompactMask
+
+#ifndef __vtkImageBrickedVolume_h
+#define __vtkImageBrickedVolume_h
+
+#include <vtkObject.h>
+#include <vtkType.h>
+
+#include <vector>
+
+// Forward declarations
+class vtkDataArray;
+class vtkImageData;
+
+class vtkImageBrickedVolume : public vtkObject
+{
+public:
+  static vtkImageBrickedVolume* New();
+  vtkTypeMacro(vtkImageBrickedVolume, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  enum
+    {
+    LINEAR = 0,
+    MORTON
+    };
+
+  // Description:
+  // Set/Get the order of the bricks in memory (default: LINEAR). Takes
+  // effect at the next ImportImage().
+  vtkSetClampMacro(BrickOrder, int, LINEAR, MORTON);
+  vtkGetMacro(BrickOrder, int);
+  void SetBrickOrderToLinear()
+    { this->SetBrickOrder(LINEAR); }
+  void SetBrickOrderToMorton()
+    { this->SetBrickOrder(MORTON); }
+
+  // Description:
+  // Set/Get the number of voxels along each side of a brick, rounded down
+  // to a power of two (default: 16). Takes effect at the next
+  // ImportImage(). GetBrickShift() returns its base 2 logarithm.
+  virtual void SetBrickSize(int size);
+  vtkGetMacro(BrickSize, int);
+  vtkGetMacro(BrickShift, int);
+
+  // Description:
+  // Copy the first scalar component of an image into bricks. Does nothing
+  // when the bricks are newer than the image and hold its extent. Returns
+  // 0 if the image has no scalars.
+  int ImportImage(vtkImageData* image);
+
+  // Description:
+  // Get the geometry of the image the bricks were imported from
+  vtkGetVector6Macro(Extent, int);
+  vtkGetVector3Macro(Origin, double);
+  vtkGetVector3Macro(Spacing, double);
+
+  // Description:
+  // Get the scalar type and the bricked scalars. Valid after ImportImage().
+  int GetScalarType();
+  void* GetScalarPointer();
+
+  // Description:
+  // Return the offset in scalars of voxel (i, j, k), counted from the
+  // first voxel of the extent
+  vtkIdType GetOffset(int i, int j, int k) const
+    {
+    const int s = this->BrickShift;
+    const int m = this->BrickSize - 1;
+    vtkIdType brick = (static_cast<vtkIdType>(k >> s)*this->GridDimensions[1]
+                       + (j >> s))*this->GridDimensions[0] + (i >> s);
+    return this->BrickOffsets[brick] +
+      ((((k & m) << s) | (j & m)) << s | (i & m));
+    }
+
+  // Description:
+  // Return the memory used by the bricks in kibibytes, like
+  // vtkDataObject::GetActualMemorySize()
+  unsigned long GetActualMemorySize();
+
+protected:
+  vtkImageBrickedVolume();
+  ~vtkImageBrickedVolume();
+
+  int BrickOrder;
+  int BrickSize;
+  int BrickShift;
+  int Extent[6];
+  double Origin[3];
+  double Spacing[3];
+  int GridDimensions[3];
+
+  // Offset of the first scalar of every brick, indexed by brick grid
+  // position x fastest
+  std::vector<vtkIdType> BrickOffsets;
+  vtkDataArray* Scalars;
+  vtkTimeStamp ImportTime;
+
+private:
+  vtkImageBrickedVolume(const vtkImageBrickedVolume&); // Not implemented
+  void operator=(const vtkImageBrickedVolume&); // Not implemented
+};
+
+#endif //__vtkImageBrickedVolume_h
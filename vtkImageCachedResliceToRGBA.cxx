@@ -0,0 +1,529 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageCachedResliceToRGBA.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageCachedResliceToRGBA.h"
+
+#include "vtkImageCompactMask.h"
+#include "vtkRGBATransferTable.h"
+
+#include <vtkColorTransferFunction.h>
+#include <vtkConditionVariable.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <list>
+#include <map>
+#include <utility>
+
+vtkStandardNewMacro(vtkImageCachedResliceToRGBA);
+
+//-----------------------------------------------------------------------------
+// Everything a cached slice depends on. The upper 3x4 part of the reslice
+// axes is quantized so that positions computed in different ways compare
+// equal.
+struct vtkImageCachedResliceKey
+{
+  vtkTypeInt64 Axes[12];
+  int Extent[6];
+  int InterpolationMode;
+  double BackgroundValue;
+  double SlabThickness;
+  int SlabMode;
+  unsigned long Times[3];
+
+  bool operator<(const vtkImageCachedResliceKey& other) const
+    {
+    if (!std::equal(this->Axes, this->Axes + 12, other.Axes))
+      {
+      return std::lexicographical_compare(this->Axes, this->Axes + 12,
+                                          other.Axes, other.Axes + 12);
+      }
+    if (!std::equal(this->Extent, this->Extent + 6, other.Extent))
+      {
+      return std::lexicographical_compare(this->Extent, this->Extent + 6,
+                                          other.Extent, other.Extent + 6);
+      }
+    if (this->InterpolationMode != other.InterpolationMode)
+      {
+      return this->InterpolationMode < other.InterpolationMode;
+      }
+    if (this->BackgroundValue != other.BackgroundValue)
+      {
+      return this->BackgroundValue < other.BackgroundValue;
+      }
+    if (this->SlabThickness != other.SlabThickness)
+      {
+      return this->SlabThickness < other.SlabThickness;
+      }
+    if (this->SlabMode != other.SlabMode)
+      {
+      return this->SlabMode < other.SlabMode;
+      }
+    return std::lexicographical_compare(this->Times, this->Times + 3,
+                                        other.Times, other.Times + 3);
+    }
+
+  // Whether both slices come from the same inputs and settings
+  bool SameSettings(const vtkImageCachedResliceKey& other) const
+    {
+    return (this->InterpolationMode == other.InterpolationMode &&
+            this->BackgroundValue == other.BackgroundValue &&
+            this->SlabThickness == other.SlabThickness &&
+            this->SlabMode == other.SlabMode &&
+            std::equal(this->Times, this->Times + 3, other.Times));
+    }
+};
+
+//-----------------------------------------------------------------------------
+// A slice for the background thread to compute
+struct vtkImageCachedReslicePrefetch
+{
+  double Axes[12];
+  vtkImageCachedResliceKey Key;
+};
+
+//-----------------------------------------------------------------------------
+class vtkImageCachedResliceToRGBAInternals
+{
+public:
+  typedef std::list<std::pair<vtkImageCachedResliceKey,
+                              vtkSmartPointer<vtkImageData> > > EntryList;
+  typedef std::map<vtkImageCachedResliceKey, EntryList::iterator> EntryMap;
+
+  vtkImageCachedResliceToRGBAInternals()
+    {
+    this->ThreadId = -1;
+    this->Busy = 0;
+    this->Terminate = 0;
+    this->HasPrefetcher = 0;
+    this->HasLastAxes = 0;
+    this->Quantum = 1.0;
+    this->MaximumNumberOfSlices = 1;
+    }
+
+  // Return the slice of a key and make it the most recently used, or NULL
+  vtkImageData* Find(const vtkImageCachedResliceKey& key)
+    {
+    EntryMap::iterator it = this->Index.find(key);
+    if (it == this->Index.end())
+      {
+      return NULL;
+      }
+    this->Entries.splice(this->Entries.begin(), this->Entries, it->second);
+    return it->second->second;
+    }
+
+  // Add a slice as the most recently used, evicting the least recently
+  // used ones beyond the capacity
+  void Insert(const vtkImageCachedResliceKey& key, vtkImageData* slice)
+    {
+    EntryMap::iterator it = this->Index.find(key);
+    if (it != this->Index.end())
+      {
+      this->Entries.erase(it->second);
+      this->Index.erase(it);
+      }
+    this->Entries.push_front(std::make_pair(
+      key, vtkSmartPointer<vtkImageData>(slice)));
+    this->Index[key] = this->Entries.begin();
+    while (static_cast<int>(this->Entries.size()) >
+           this->MaximumNumberOfSlices)
+      {
+      this->Index.erase(this->Entries.back().first);
+      this->Entries.pop_back();
+      }
+    }
+
+  // Cache, guarded by Lock
+  EntryList Entries;
+  EntryMap Index;
+  int MaximumNumberOfSlices;
+
+  // Prefetch requests and background thread state, guarded by Lock
+  std::deque<vtkImageCachedReslicePrefetch> Queue;
+  vtkNew<vtkMutexLock> Lock;
+  vtkNew<vtkConditionVariable> Condition;
+  vtkNew<vtkMultiThreader> Threader;
+  int ThreadId;
+  int Busy;
+  int Terminate;
+
+  // Private filter of the background thread, and the key of the settings
+  // it was last set up with. Only modified while the thread is not busy.
+  vtkNew<vtkImageMaskedResliceToRGBA> Prefetcher;
+  vtkNew<vtkColorTransferFunction> ColorFunction;
+  vtkNew<vtkPiecewiseFunction> OpacityFunction;
+  vtkImageCachedResliceKey PrefetcherKey;
+  int HasPrefetcher;
+
+  // Axes of the previous execution, to find the scroll direction
+  double LastAxes[12];
+  int HasLastAxes;
+  double Quantum;
+};
+
+//-----------------------------------------------------------------------------
+static void vtkGetResliceAxes(vtkMatrix4x4* matrix, double axes[12])
+{
+  for (int i = 0; i < 12; ++i)
+    {
+    axes[i] = (matrix ? matrix->GetElement(i / 4, i % 4) : (i % 5 == 0));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Directions to 1e-9, positions to the given quantum
+static void vtkQuantizeResliceAxes(const double axes[12], double quantum,
+                                   vtkTypeInt64 key[12])
+{
+  for (int i = 0; i < 12; ++i)
+    {
+    double q = (i % 4 == 3 ? quantum : 1e-9);
+    key[i] = static_cast<vtkTypeInt64>(floor(axes[i] / q + 0.5));
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkImageCachedResliceToRGBA::vtkImageCachedResliceToRGBA()
+{
+  this->MaximumNumberOfSlices = 64;
+  this->NumberOfPrefetchedSlices = 2;
+  this->NumberOfCacheHits = 0;
+  this->NumberOfCacheMisses = 0;
+  this->Internals = new vtkImageCachedResliceToRGBAInternals;
+  this->Internals->Prefetcher->SetNumberOfThreads(1);
+}
+
+//-----------------------------------------------------------------------------
+vtkImageCachedResliceToRGBA::~vtkImageCachedResliceToRGBA()
+{
+  vtkImageCachedResliceToRGBAInternals* s = this->Internals;
+  s->Lock->Lock();
+  s->Terminate = 1;
+  s->Queue.clear();
+  s->Condition->Broadcast();
+  s->Lock->Unlock();
+  if (s->ThreadId >= 0)
+    {
+    s->Threader->TerminateThread(s->ThreadId);
+    }
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageCachedResliceToRGBA::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "MaximumNumberOfSlices: "
+     << this->MaximumNumberOfSlices << "\n";
+  os << indent << "NumberOfPrefetchedSlices: "
+     << this->NumberOfPrefetchedSlices << "\n";
+  os << indent << "NumberOfCachedSlices: "
+     << this->GetNumberOfCachedSlices() << "\n";
+  os << indent << "NumberOfCacheHits: " << this->NumberOfCacheHits << "\n";
+  os << indent << "NumberOfCacheMisses: "
+     << this->NumberOfCacheMisses << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkImageCachedResliceToRGBA::GetNumberOfCachedSlices()
+{
+  this->Internals->Lock->Lock();
+  int n = static_cast<int>(this->Internals->Entries.size());
+  this->Internals->Lock->Unlock();
+  return n;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageCachedResliceToRGBA::ClearCache()
+{
+  vtkImageCachedResliceToRGBAInternals* s = this->Internals;
+  s->Lock->Lock();
+  s->Queue.clear();
+  s->Entries.clear();
+  s->Index.clear();
+  s->Lock->Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageCachedResliceToRGBA::ComputeKey(vtkImageData* volume,
+                                             vtkImageData* mask,
+                                             const int extent[6],
+                                             vtkImageCachedResliceKey& key)
+{
+  double* spacing = volume->GetSpacing();
+  double quantum = fabs(spacing[0]);
+  for (int c = 1; c < 3; ++c)
+    {
+    quantum = (fabs(spacing[c]) < quantum ? fabs(spacing[c]) : quantum);
+    }
+  this->Internals->Quantum = (quantum > 0.0 ? 1e-3*quantum : 1e-6);
+
+  double axes[12];
+  vtkGetResliceAxes(this->ResliceAxes, axes);
+  vtkQuantizeResliceAxes(axes, this->Internals->Quantum, key.Axes);
+  std::copy(extent, extent + 6, key.Extent);
+  key.InterpolationMode = this->InterpolationMode;
+  key.BackgroundValue = this->BackgroundValue;
+  key.SlabThickness = this->SlabThickness;
+  key.SlabMode = this->SlabMode;
+  key.Times[0] = volume->GetMTime();
+  key.Times[1] = (this->CompactMask ? this->CompactMask->GetMTime() :
+                  (mask ? mask->GetMTime() : 0));
+  key.Times[2] = this->LookupTable->GetMTime();
+}
+
+//----------------------------------------------------------------------------
+int vtkImageCachedResliceToRGBA::RequestData(
+  vtkInformation* request,
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkImageData* volume = vtkImageData::GetData(inputVector[0]);
+  vtkImageData* mask = vtkImageData::GetData(inputVector[1]);
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkImageData* output = vtkImageData::GetData(outInfo);
+  if (!volume || !output)
+    {
+    return this->Superclass::RequestData(request, inputVector, outputVector);
+    }
+
+  int extent[6];
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), extent);
+  vtkImageCachedResliceKey key;
+  this->ComputeKey(volume, mask, extent, key);
+
+  // The cached slices are never shared with the pipeline, so that the
+  // background thread is the only other one to reference them
+  vtkImageCachedResliceToRGBAInternals* s = this->Internals;
+  s->Lock->Lock();
+  s->MaximumNumberOfSlices = this->MaximumNumberOfSlices;
+  vtkImageData* cached = s->Find(key);
+  if (cached)
+    {
+    output->DeepCopy(cached);
+    }
+  s->Lock->Unlock();
+
+  if (cached)
+    {
+    ++this->NumberOfCacheHits;
+    }
+  else
+    {
+    if (!this->Superclass::RequestData(request, inputVector, outputVector))
+      {
+      return 0;
+      }
+    if (this->AbortExecute)
+      {
+      // The slice is incomplete, neither cache it nor look ahead
+      return 1;
+      }
+    ++this->NumberOfCacheMisses;
+    vtkNew<vtkImageData> slice;
+    slice->DeepCopy(output);
+    s->Lock->Lock();
+    s->Insert(key, slice.GetPointer());
+    s->Lock->Unlock();
+    }
+
+  this->SchedulePrefetch(key, volume, mask);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageCachedResliceToRGBA::SchedulePrefetch(
+  const vtkImageCachedResliceKey& key, vtkImageData* volume,
+  vtkImageData* mask)
+{
+  vtkImageCachedResliceToRGBAInternals* s = this->Internals;
+  double axes[12];
+  vtkGetResliceAxes(this->ResliceAxes, axes);
+
+  // Scrolling is a translation of unchanged axes
+  double delta[3] = { 0.0, 0.0, 0.0 };
+  bool scrolling = (s->HasLastAxes != 0);
+  for (int i = 0; i < 12 && scrolling; ++i)
+    {
+    if (i % 4 == 3)
+      {
+      delta[i / 4] = axes[i] - s->LastAxes[i];
+      }
+    else
+      {
+      scrolling = (axes[i] == s->LastAxes[i]);
+      }
+    }
+  scrolling = (scrolling && (fabs(delta[0]) > s->Quantum ||
+                             fabs(delta[1]) > s->Quantum ||
+                             fabs(delta[2]) > s->Quantum));
+  std::copy(axes, axes + 12, s->LastAxes);
+  s->HasLastAxes = 1;
+  if (!scrolling || this->NumberOfPrefetchedSlices == 0)
+    {
+    return;
+    }
+
+  s->Lock->Lock();
+  s->Queue.clear();
+
+  if (!s->HasPrefetcher || !s->PrefetcherKey.SameSettings(key))
+    {
+    // Wait for the slice in progress, computed from the old settings
+    while (s->Busy)
+      {
+      s->Condition->Wait(s->Lock.GetPointer());
+      }
+
+    vtkImageMaskedResliceToRGBA* prefetcher = s->Prefetcher.GetPointer();
+    vtkNew<vtkImageData> volumeCopy;
+    volumeCopy->ShallowCopy(volume);
+    prefetcher->SetInputData(volumeCopy.GetPointer());
+    if (mask && !this->CompactMask)
+      {
+      vtkNew<vtkImageData> maskCopy;
+      maskCopy->ShallowCopy(mask);
+      prefetcher->SetMaskInputData(maskCopy.GetPointer());
+      }
+    else
+      {
+      prefetcher->SetMaskInputData(NULL);
+      }
+    prefetcher->SetCompactMask(this->CompactMask);
+    prefetcher->SetInterpolationMode(this->InterpolationMode);
+    prefetcher->SetBackgroundValue(this->BackgroundValue);
+    prefetcher->SetSlabThickness(this->SlabThickness);
+    prefetcher->SetSlabMode(this->SlabMode);
+    prefetcher->SetUseBrickedLayout(this->UseBrickedLayout);
+    prefetcher->SetBrickSize(this->BrickSize);
+    prefetcher->SetBrickOrder(this->BrickOrder);
+    prefetcher->SetNumberOfColors(this->GetNumberOfColors());
+    if (this->GetColorFunction())
+      {
+      s->ColorFunction->DeepCopy(this->GetColorFunction());
+      prefetcher->SetColorFunction(s->ColorFunction.GetPointer());
+      }
+    else
+      {
+      prefetcher->SetColorFunction(NULL);
+      }
+    if (this->GetOpacityFunction())
+      {
+      s->OpacityFunction->DeepCopy(this->GetOpacityFunction());
+      prefetcher->SetOpacityFunction(s->OpacityFunction.GetPointer());
+      }
+    else
+      {
+      prefetcher->SetOpacityFunction(NULL);
+      }
+    s->PrefetcherKey = key;
+    s->HasPrefetcher = 1;
+    }
+
+  for (int n = 1; n <= this->NumberOfPrefetchedSlices; ++n)
+    {
+    vtkImageCachedReslicePrefetch prefetch;
+    std::copy(axes, axes + 12, prefetch.Axes);
+    for (int c = 0; c < 3; ++c)
+      {
+      prefetch.Axes[4*c + 3] += n*delta[c];
+      }
+    prefetch.Key = key;
+    vtkQuantizeResliceAxes(prefetch.Axes, s->Quantum, prefetch.Key.Axes);
+    if (s->Index.find(prefetch.Key) == s->Index.end())
+      {
+      s->Queue.push_back(prefetch);
+      }
+    }
+
+  if (s->ThreadId < 0)
+    {
+    s->ThreadId = s->Threader->SpawnThread(
+      &vtkImageCachedResliceToRGBA::PrefetchThread, s);
+    }
+  s->Condition->Broadcast();
+  s->Lock->Unlock();
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkImageCachedResliceToRGBA::PrefetchThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkImageCachedResliceToRGBAInternals* s =
+    static_cast<vtkImageCachedResliceToRGBAInternals*>(info->UserData);
+  vtkNew<vtkMatrix4x4> axes;
+
+  s->Lock->Lock();
+  for (;;)
+    {
+    while (!s->Terminate && s->Queue.empty())
+      {
+      s->Condition->Wait(s->Lock.GetPointer());
+      }
+    if (s->Terminate)
+      {
+      break;
+      }
+    vtkImageCachedReslicePrefetch prefetch = s->Queue.front();
+    s->Queue.pop_front();
+    if (s->Index.find(prefetch.Key) != s->Index.end())
+      {
+      continue;
+      }
+    s->Busy = 1;
+    s->Lock->Unlock();
+
+    axes->Identity();
+    for (int i = 0; i < 12; ++i)
+      {
+      axes->SetElement(i / 4, i % 4, prefetch.Axes[i]);
+      }
+    s->Prefetcher->SetResliceAxes(axes.GetPointer());
+    s->Prefetcher->Update();
+
+    // Only keep the slice when it is the one the key describes
+    vtkImageData* output = s->Prefetcher->GetOutput();
+    int extent[6];
+    output->GetExtent(extent);
+    vtkSmartPointer<vtkImageData> slice;
+    if (std::equal(extent, extent + 6, prefetch.Key.Extent))
+      {
+      slice = vtkSmartPointer<vtkImageData>::New();
+      slice->DeepCopy(output);
+      }
+
+    s->Lock->Lock();
+    s->Busy = 0;
+    if (slice)
+      {
+      s->Insert(prefetch.Key, slice);
+      }
+    s->Condition->Broadcast();
+    }
+  s->Lock->Unlock();
+  return VTK_THREAD_RETURN_VALUE;
+}
@@ -0,0 +1,119 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageCachedResliceToRGBA.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageCachedResliceToRGBA - vtkImageMaskedResliceToRGBA with a
+// cache of the recent slices and prefetching in the scroll direction.
+//
+// .SECTION Description
+// vtkImageCachedResliceToRGBA keeps the last MaximumNumberOfSlices masked
+// RGBA slices it produced in a least recently used cache. A slice is served
+// from the cache when the reslice axes, the output extent, the
+// interpolation mode, the background value, the modification times of the
+// volume and of the mask, and the modification time of the transfer
+// functions all match. Reslice axes are compared to a thousandth of the
+// smallest voxel spacing.
+//
+// When the reslice axes are translated, as when scrolling through slices,
+// the next NumberOfPrefetchedSlices slices along the same translation are
+// computed on a background thread, by a private copy of the filter that
+// shares the input voxels. Scrolling back is then served from the cache,
+// and scrolling forward finds the slices already computed.
+//
+// .SECTION Caveats
+// The cached slices are keyed on the modification time of the input data,
+// so slices computed from different pieces of a streamed input are never
+// shared. Read or generate the whole volume and mask to benefit from the
+// cache.
+//
+// .SECTION see also
+// vtkImageMaskedResliceToRGBA
+
+#ifndef __vtkImageCachedResliceToRGBA_h
+#define __vtkImageCachedResliceToRGBA_h
+
+#include "vtkImageMaskedResliceToRGBA.h"
+
+#include <vtkMultiThreader.h> // For VTK_THREAD_RETURN_TYPE
+
+// Forward declarations
+class vtkImageCachedResliceToRGBAInternals;
+struct vtkImageCachedResliceKey;
+
+class vtkImageCachedResliceToRGBA : public vtkImageMaskedResliceToRGBA
+{
+public:
+  static vtkImageCachedResliceToRGBA* New();
+  vtkTypeMacro(vtkImageCachedResliceToRGBA, vtkImageMaskedResliceToRGBA);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/Get the maximum number of slices kept in the cache (default: 64)
+  vtkSetClampMacro(MaximumNumberOfSlices, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MaximumNumberOfSlices, int);
+
+  // Description:
+  // Set/Get the number of slices computed ahead in the scroll direction
+  // (default: 2). 0 disables prefetching.
+  vtkSetClampMacro(NumberOfPrefetchedSlices, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfPrefetchedSlices, int);
+
+  // Description:
+  // Get the number of slices in the cache
+  int GetNumberOfCachedSlices();
+
+  // Description:
+  // Get the number of executions served from the cache and computed
+  vtkGetMacro(NumberOfCacheHits, int);
+  vtkGetMacro(NumberOfCacheMisses, int);
+
+  // Description:
+  // Empty the cache and cancel the pending prefetches
+  void ClearCache();
+
+protected:
+  vtkImageCachedResliceToRGBA();
+  ~vtkImageCachedResliceToRGBA();
+
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  // Description:
+  // Compute the cache key of the slice the current settings produce
+  void ComputeKey(vtkImageData* volume, vtkImageData* mask,
+                  const int extent[6], vtkImageCachedResliceKey& key);
+
+  // Description:
+  // Queue the slices ahead of the current one in the scroll direction,
+  // refreshing the inputs of the background filter first when needed
+  void SchedulePrefetch(const vtkImageCachedResliceKey& key,
+                        vtkImageData* volume, vtkImageData* mask);
+
+  // Description:
+  // Body of the background thread
+  static VTK_THREAD_RETURN_TYPE PrefetchThread(void* arg);
+
+  int MaximumNumberOfSlices;
+  int NumberOfPrefetchedSlices;
+  int NumberOfCacheHits;
+  int NumberOfCacheMisses;
+
+  vtkImageCachedResliceToRGBAInternals* Internals;
+
+private:
+  vtkImageCachedResliceToRGBA(const vtkImageCachedResliceToRGBA&); // Not implemented
+  void operator=(const vtkImageCachedResliceToRGBA&); // Not implemented
+};
+
+#endif //__vtkImageCachedResliceToRGBA_h
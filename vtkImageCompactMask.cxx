@@ -0,0 +1,386 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageCompactMask.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageCompactMask.h"
+
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+
+#include <cstring>
+
+vtkStandardNewMacro(vtkImageCompactMask);
+
+//-----------------------------------------------------------------------------
+vtkImageCompactMask::vtkImageCompactMask()
+{
+  this->Encoding = RUN_LENGTH;
+  for (int i = 0; i < 3; ++i)
+    {
+    this->Extent[2*i] = 0;
+    this->Extent[2*i+1] = -1;
+    this->Origin[i] = 0.0;
+    this->Spacing[i] = 1.0;
+    }
+  this->WordsPerScanline = 0;
+}
+
+//-----------------------------------------------------------------------------
+vtkImageCompactMask::~vtkImageCompactMask()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkImageCompactMask::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Encoding: "
+     << (this->Encoding == BITSET ? "Bitset" : "RunLength") << "\n";
+  os << indent << "Extent: (" << this->Extent[0];
+  for (int i = 1; i < 6; ++i)
+    {
+    os << ", " << this->Extent[i];
+    }
+  os << ")\n";
+  os << indent << "Origin: (" << this->Origin[0] << ", " << this->Origin[1]
+     << ", " << this->Origin[2] << ")\n";
+  os << indent << "Spacing: (" << this->Spacing[0] << ", "
+     << this->Spacing[1] << ", " << this->Spacing[2] << ")\n";
+  os << indent << "ActualMemorySize: " << this->GetActualMemorySize()
+     << " KiB\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkImageCompactMask::AllocateStorage()
+{
+  vtkIdType numRows = 0;
+  if (this->Extent[0] <= this->Extent[1] &&
+      this->Extent[2] <= this->Extent[3] &&
+      this->Extent[4] <= this->Extent[5])
+    {
+    numRows = static_cast<vtkIdType>(this->Extent[3] - this->Extent[2] + 1) *
+      (this->Extent[5] - this->Extent[4] + 1);
+    }
+
+  // Release the memory of the other encoding
+  std::vector<vtkIdType>().swap(this->ScanlineStart);
+  std::vector<int>().swap(this->ScanlineCount);
+  std::vector<int>().swap(this->Spans);
+  std::vector<vtkTypeUInt64>().swap(this->Bits);
+  this->WordsPerScanline = 0;
+
+  if (this->Encoding == BITSET)
+    {
+    if (numRows > 0)
+      {
+      this->WordsPerScanline = (this->Extent[1] - this->Extent[0] + 64) / 64;
+      }
+    this->Bits.resize(numRows*this->WordsPerScanline, 0);
+    }
+  else
+    {
+    this->ScanlineStart.resize(numRows, 0);
+    this->ScanlineCount.resize(numRows, 0);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageCompactMask::Initialize(const int extent[6],
+                                     const double origin[3],
+                                     const double spacing[3])
+{
+  for (int i = 0; i < 3; ++i)
+    {
+    this->Extent[2*i] = extent[2*i];
+    this->Extent[2*i+1] = extent[2*i+1];
+    this->Origin[i] = origin[i];
+    this->Spacing[i] = spacing[i];
+    }
+  this->AllocateStorage();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageCompactMask::SetEncoding(int encoding)
+{
+  encoding = (encoding == BITSET ? BITSET : RUN_LENGTH);
+  if (this->Encoding == encoding)
+    {
+    return;
+    }
+
+  // Re-encode the scanlines that have spans
+  std::vector<int> rows;
+  std::vector<int> spans;
+  std::vector<int> counts;
+  for (int k = this->Extent[4]; k <= this->Extent[5]; ++k)
+    {
+    for (int j = this->Extent[2]; j <= this->Extent[3]; ++j)
+      {
+      std::vector<int> rowSpans;
+      int n = this->GetScanlineSpans(j, k, rowSpans);
+      if (n > 0)
+        {
+        rows.push_back(j);
+        rows.push_back(k);
+        counts.push_back(n);
+        spans.insert(spans.end(), rowSpans.begin(), rowSpans.end());
+        }
+      }
+    }
+
+  this->Encoding = encoding;
+  this->AllocateStorage();
+  size_t offset = 0;
+  for (size_t r = 0; r < counts.size(); ++r)
+    {
+    this->SetScanlineSpans(rows[2*r], rows[2*r+1], &spans[offset],
+                           counts[r]);
+    offset += 2*counts[r];
+    }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageCompactMask::SetScanlineSpans(int j, int k, const int* spans,
+                                           int n)
+{
+  if (j < this->Extent[2] || j > this->Extent[3] ||
+      k < this->Extent[4] || k > this->Extent[5])
+    {
+    vtkErrorMacro(<< "Scanline (" << j << ", " << k
+                  << ") is outside of the extent");
+    return;
+    }
+
+  vtkIdType row = this->GetScanlineId(j, k);
+  if (this->Encoding == BITSET)
+    {
+    vtkTypeUInt64* words = &this->Bits[row*this->WordsPerScanline];
+    memset(words, 0, this->WordsPerScanline*sizeof(vtkTypeUInt64));
+    for (int s = 0; s < n; ++s)
+      {
+      int x0 = spans[2*s] - this->Extent[0];
+      int x1 = spans[2*s+1] - this->Extent[0];
+      for (int x = x0; x <= x1; ++x)
+        {
+        // Fill whole words at once
+        if ((x & 63) == 0 && x + 63 <= x1)
+          {
+          words[x >> 6] = ~static_cast<vtkTypeUInt64>(0);
+          x += 63;
+          continue;
+          }
+        words[x >> 6] |= static_cast<vtkTypeUInt64>(1) << (x & 63);
+        }
+      }
+    }
+  else
+    {
+    this->ScanlineStart[row] =
+      static_cast<vtkIdType>(this->Spans.size() / 2);
+    this->ScanlineCount[row] = n;
+    this->Spans.insert(this->Spans.end(), spans, spans + 2*n);
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkImageCompactMask::GetScanlineSpans(int j, int k,
+                                          std::vector<int>& spans) const
+{
+  spans.clear();
+  if (this->Extent[0] > this->Extent[1] ||
+      j < this->Extent[2] || j > this->Extent[3] ||
+      k < this->Extent[4] || k > this->Extent[5])
+    {
+    return 0;
+    }
+
+  vtkIdType row = this->GetScanlineId(j, k);
+  if (this->Encoding != BITSET)
+    {
+    const int* rowSpans = this->GetRunLengthSpans(row);
+    spans.assign(rowSpans, rowSpans + 2*this->ScanlineCount[row]);
+    return this->ScanlineCount[row];
+    }
+
+  // Walk the bits, skipping words that are all outside or all inside the
+  // current span
+  const vtkTypeUInt64* words = &this->Bits[row*this->WordsPerScanline];
+  const vtkTypeUInt64 full = ~static_cast<vtkTypeUInt64>(0);
+  int nx = this->Extent[1] - this->Extent[0] + 1;
+  int inside = 0;
+  for (int x = 0; x < nx; )
+    {
+    vtkTypeUInt64 word = words[x >> 6];
+    if ((x & 63) == 0 && word == (inside ? full : 0))
+      {
+      x += 64;
+      continue;
+      }
+    int bit = static_cast<int>((word >> (x & 63)) & 1);
+    if (bit != inside)
+      {
+      spans.push_back(this->Extent[0] + x - (inside ? 1 : 0));
+      inside = bit;
+      }
+    ++x;
+    }
+  if (inside)
+    {
+    spans.push_back(this->Extent[1]);
+    }
+  return static_cast<int>(spans.size() / 2);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageCompactMask::IsScanlineEmpty(int j, int k) const
+{
+  if (this->Extent[0] > this->Extent[1] ||
+      j < this->Extent[2] || j > this->Extent[3] ||
+      k < this->Extent[4] || k > this->Extent[5])
+    {
+    return 1;
+    }
+
+  vtkIdType row = this->GetScanlineId(j, k);
+  if (this->Encoding != BITSET)
+    {
+    return this->ScanlineCount[row] == 0;
+    }
+  const vtkTypeUInt64* words = &this->Bits[row*this->WordsPerScanline];
+  for (vtkIdType w = 0; w < this->WordsPerScanline; ++w)
+    {
+    if (words[w])
+      {
+      return 0;
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageCompactMask::ImportImage(vtkImageData* image)
+{
+  if (!image || image->GetScalarType() != VTK_UNSIGNED_CHAR)
+    {
+    vtkErrorMacro(<< "ImportImage: the image must be of type unsigned char");
+    return 0;
+    }
+
+  int extent[6];
+  image->GetExtent(extent);
+  this->Initialize(extent, image->GetOrigin(), image->GetSpacing());
+  if (image->GetNumberOfPoints() == 0)
+    {
+    return 1;
+    }
+
+  int numComponents = image->GetNumberOfScalarComponents();
+  std::vector<int> spans;
+  for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+    for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+      const unsigned char* ptr = static_cast<const unsigned char*>(
+        image->GetScalarPointer(extent[0], j, k));
+      spans.clear();
+      int inside = 0;
+      for (int i = extent[0]; i <= extent[1]; ++i, ptr += numComponents)
+        {
+        int bit = (*ptr != 0);
+        if (bit != inside)
+          {
+          spans.push_back(inside ? i - 1 : i);
+          inside = bit;
+          }
+        }
+      if (inside)
+        {
+        spans.push_back(extent[1]);
+        }
+      if (!spans.empty())
+        {
+        this->SetScanlineSpans(j, k, &spans[0],
+                               static_cast<int>(spans.size() / 2));
+        }
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageCompactMask::ExportImage(vtkImageData* image,
+                                      unsigned char insideValue,
+                                      unsigned char outsideValue)
+{
+  if (!image)
+    {
+    return;
+    }
+  image->SetExtent(this->Extent);
+  image->SetOrigin(this->Origin);
+  image->SetSpacing(this->Spacing);
+  image->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  if (image->GetNumberOfPoints() == 0)
+    {
+    return;
+    }
+
+  int nx = this->Extent[1] - this->Extent[0] + 1;
+  std::vector<int> spans;
+  for (int k = this->Extent[4]; k <= this->Extent[5]; ++k)
+    {
+    for (int j = this->Extent[2]; j <= this->Extent[3]; ++j)
+      {
+      unsigned char* row = static_cast<unsigned char*>(
+        image->GetScalarPointer(this->Extent[0], j, k));
+      memset(row, outsideValue, nx);
+      int n = this->GetScanlineSpans(j, k, spans);
+      for (int s = 0; s < n; ++s)
+        {
+        memset(row + spans[2*s] - this->Extent[0], insideValue,
+               spans[2*s+1] - spans[2*s] + 1);
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImageCompactMask::GetNumberOfInsideVoxels() const
+{
+  vtkIdType count = 0;
+  std::vector<int> spans;
+  for (int k = this->Extent[4]; k <= this->Extent[5]; ++k)
+    {
+    for (int j = this->Extent[2]; j <= this->Extent[3]; ++j)
+      {
+      int n = this->GetScanlineSpans(j, k, spans);
+      for (int s = 0; s < n; ++s)
+        {
+        count += spans[2*s+1] - spans[2*s] + 1;
+        }
+      }
+    }
+  return count;
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImageCompactMask::GetActualMemorySize() const
+{
+  size_t size = this->ScanlineStart.capacity()*sizeof(vtkIdType) +
+    this->ScanlineCount.capacity()*sizeof(int) +
+    this->Spans.capacity()*sizeof(int) +
+    this->Bits.capacity()*sizeof(vtkTypeUInt64);
+  return static_cast<unsigned long>((size + 1023) / 1024);
+}
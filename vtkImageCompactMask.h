@@ -0,0 +1,213 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageCompactMask.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageCompactMask - a binary image mask stored as run-length
+// encoded scanlines or as one bit per voxel.
+//
+// .SECTION Description
+// vtkImageCompactMask holds the same information as a VTK_UNSIGNED_CHAR
+// mask image whose voxels are either zero or not, at a fraction of its
+// memory. It has the geometry of an image (extent, origin and spacing) and
+// one of two encodings:
+//
+// RUN_LENGTH stores, for every x scanline (j, k), the list of inside spans
+// [i0, i1]. Shapes such as the cylinder of VolumeMaskAndSlice.cxx need one
+// span per scanline, so a 1024^3 mask takes a few tens of MB instead of
+// 1 GB. Point queries are a binary search in the scanline spans.
+//
+// BITSET stores one bit per voxel, each scanline padded to 64 bits. It takes
+// 1/8 of the memory of the image whatever the shape is, and point queries
+// are a single bit test.
+//
+// Both encodings answer span queries, so that consumers can skip whole
+// empty scanlines, and convert to and from vtkImageData.
+//
+// Build the mask with ImportImage(), with
+// vtkImageShapeMaskSource::GenerateCompactMask(), or by calling Initialize()
+// followed by SetScanlineSpans() for the scanlines that have inside voxels.
+//
+// .SECTION see also
+// vtkImageShapeMaskSource vtkImageMaskedResliceToRGBA vtkImageStencilData
+
+#ifndef __vtkImageCompactMask_h
+#define __vtkImageCompactMask_h
+
+#include <vtkObject.h>
+#include <vtkType.h>
+
+#include <vector>
+
+// Forward declarations
+class vtkImageData;
+
+class vtkImageCompactMask : public vtkObject
+{
+public:
+  static vtkImageCompactMask* New();
+  vtkTypeMacro(vtkImageCompactMask, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  enum
+    {
+    RUN_LENGTH = 0,
+    BITSET
+    };
+
+  // Description:
+  // Set/Get the encoding (default: RUN_LENGTH). Changing the encoding of a
+  // mask that holds data converts the data.
+  virtual void SetEncoding(int encoding);
+  vtkGetMacro(Encoding, int);
+  void SetEncodingToRunLength()
+    { this->SetEncoding(RUN_LENGTH); }
+  void SetEncodingToBitset()
+    { this->SetEncoding(BITSET); }
+
+  // Description:
+  // Set the geometry of the mask and make every voxel outside
+  void Initialize(const int extent[6], const double origin[3],
+                  const double spacing[3]);
+
+  // Description:
+  // Get the geometry of the mask
+  vtkGetVector6Macro(Extent, int);
+  vtkGetVector3Macro(Origin, double);
+  vtkGetVector3Macro(Spacing, double);
+
+  // Description:
+  // Set the inside spans of scanline (j, k) to the n spans
+  // [spans[2*s], spans[2*s+1]], which must be sorted, disjoint and within
+  // the x extent. With RUN_LENGTH, each scanline may only be set once
+  // after Initialize().
+  void SetScanlineSpans(int j, int k, const int* spans, int n);
+
+  // Description:
+  // Return the inside spans of scanline (j, k) as pairs of first and last
+  // x index. Returns the number of spans.
+  int GetScanlineSpans(int j, int k, std::vector<int>& spans) const;
+
+  // Description:
+  // Return 1 when scanline (j, k) has no inside voxel
+  int IsScanlineEmpty(int j, int k) const;
+
+  // Description:
+  // Return 1 when voxel (i, j, k) is inside the mask. Voxels outside the
+  // extent are outside the mask.
+  int IsInside(int i, int j, int k) const
+    {
+    if (i < this->Extent[0] || i > this->Extent[1] ||
+        j < this->Extent[2] || j > this->Extent[3] ||
+        k < this->Extent[4] || k > this->Extent[5])
+      {
+      return 0;
+      }
+    vtkIdType row = this->GetScanlineId(j, k);
+    if (this->Encoding == BITSET)
+      {
+      int x = i - this->Extent[0];
+      vtkTypeUInt64 word = this->Bits[row*this->WordsPerScanline + (x >> 6)];
+      return static_cast<int>((word >> (x & 63)) & 1);
+      }
+    const int* spans = this->GetRunLengthSpans(row);
+    return vtkImageCompactMask::SpansContain(
+      spans, this->ScanlineCount[row], i);
+    }
+
+  // Description:
+  // Return 1 when x is in one of the n sorted spans
+  static int SpansContain(const int* spans, int n, int x)
+    {
+    int lo = 0;
+    int hi = n - 1;
+    while (lo <= hi)
+      {
+      int mid = (lo + hi) / 2;
+      if (x < spans[2*mid])
+        {
+        hi = mid - 1;
+        }
+      else if (x > spans[2*mid+1])
+        {
+        lo = mid + 1;
+        }
+      else
+        {
+        return 1;
+        }
+      }
+    return 0;
+    }
+
+  // Description:
+  // Build the mask from a VTK_UNSIGNED_CHAR image, voxels that are not zero
+  // are inside. Returns 0 if the image has another scalar type.
+  int ImportImage(vtkImageData* image);
+
+  // Description:
+  // Allocate the image with the geometry of the mask and fill it with
+  // insideValue and outsideValue
+  void ExportImage(vtkImageData* image, unsigned char insideValue = 255,
+                   unsigned char outsideValue = 0);
+
+  // Description:
+  // Return the number of inside voxels
+  vtkIdType GetNumberOfInsideVoxels() const;
+
+  // Description:
+  // Return the memory used by the mask in kibibytes, like
+  // vtkDataObject::GetActualMemorySize()
+  unsigned long GetActualMemorySize() const;
+
+protected:
+  vtkImageCompactMask();
+  ~vtkImageCompactMask();
+
+  vtkIdType GetScanlineId(int j, int k) const
+    {
+    return static_cast<vtkIdType>(k - this->Extent[4]) *
+      (this->Extent[3] - this->Extent[2] + 1) + (j - this->Extent[2]);
+    }
+
+  const int* GetRunLengthSpans(vtkIdType row) const
+    {
+    return this->Spans.empty() ? NULL :
+      &this->Spans[2*this->ScanlineStart[row]];
+    }
+
+  // Description:
+  // Reset the storage of the current encoding for the current extent
+  void AllocateStorage();
+
+  int Encoding;
+  int Extent[6];
+  double Origin[3];
+  double Spacing[3];
+
+  // RUN_LENGTH: the spans of scanline r are the ScanlineCount[r] pairs
+  // starting at pair ScanlineStart[r] of Spans
+  std::vector<vtkIdType> ScanlineStart;
+  std::vector<int> ScanlineCount;
+  std::vector<int> Spans;
+
+  // BITSET: WordsPerScanline words per scanline, bit x of a scanline is
+  // voxel Extent[0] + x
+  std::vector<vtkTypeUInt64> Bits;
+  vtkIdType WordsPerScanline;
+
+private:
+  vtkImageCompactMask(const vtkImageCompactMask&); // Not implemented
+  void operator=(const vtkImageCompactMask&); // Not implemented
+};
+
+#endif //__vtkImageCompactMask_h
@@ -0,0 +1,261 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageHybridClip.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageHybridClip.h"
+
+#include <vtkCellData.h>
+#include <vtkClipDataSet.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataSetTriangleFilter.h>
+#include <vtkIdList.h>
+#include <vtkImageData.h>
+#include <vtkImplicitFunction.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkUniformGrid.h>
+#include <vtkUnstructuredGrid.h>
+
+#include <map>
+
+vtkStandardNewMacro(vtkImageHybridClip);
+vtkCxxSetObjectMacro(vtkImageHybridClip, ClipFunction, vtkImplicitFunction);
+
+//-----------------------------------------------------------------------------
+vtkImageHybridClip::vtkImageHybridClip()
+{
+  this->ClipFunction = NULL;
+  this->Value = 0.0;
+  this->InsideOut = 0;
+  this->Tetrahedralize = 1;
+}
+
+//-----------------------------------------------------------------------------
+vtkImageHybridClip::~vtkImageHybridClip()
+{
+  this->SetClipFunction(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHybridClip::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ClipFunction: " << this->ClipFunction << "\n";
+  os << indent << "Value: " << this->Value << "\n";
+  os << indent << "InsideOut: " << this->InsideOut << "\n";
+  os << indent << "Tetrahedralize: " << this->Tetrahedralize << "\n";
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImageHybridClip::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  if (this->ClipFunction && this->ClipFunction->GetMTime() > mTime)
+    {
+    mTime = this->ClipFunction->GetMTime();
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageHybridClip::FillInputPortInformation(int vtkNotUsed(port),
+                                                 vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageHybridClip::RequestData(vtkInformation* vtkNotUsed(request),
+                                    vtkInformationVector** inputVector,
+                                    vtkInformationVector* outputVector)
+{
+  vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+  vtkMultiBlockDataSet* output = vtkMultiBlockDataSet::GetData(outputVector);
+  if (!input || !output)
+    {
+    return 0;
+    }
+  if (!this->ClipFunction)
+    {
+    vtkErrorMacro(<< "No clip function specified");
+    return 0;
+    }
+
+  int dims[3];
+  input->GetDimensions(dims);
+  if (dims[0] < 2 || dims[1] < 2 || dims[2] < 2)
+    {
+    vtkErrorMacro(<< "The input must be a 3D image");
+    return 0;
+    }
+
+  std::vector<unsigned char> pointClass;
+  this->ClassifyPoints(input, pointClass);
+
+  vtkNew<vtkUniformGrid> interior;
+  interior->ShallowCopy(input);
+  std::vector<vtkIdType> boundaryCells;
+  this->ClassifyVoxels(input, pointClass, interior.GetPointer(),
+                       boundaryCells);
+  std::vector<unsigned char>().swap(pointClass);
+
+  vtkNew<vtkUnstructuredGrid> boundary;
+  this->ClipBoundary(input, boundaryCells, boundary.GetPointer());
+
+  output->SetNumberOfBlocks(2);
+  output->SetBlock(INTERIOR_BLOCK, interior.GetPointer());
+  output->GetMetaData(static_cast<unsigned int>(INTERIOR_BLOCK))->Set(
+    vtkCompositeDataSet::NAME(), "Interior");
+  output->SetBlock(BOUNDARY_BLOCK, boundary.GetPointer());
+  output->GetMetaData(static_cast<unsigned int>(BOUNDARY_BLOCK))->Set(
+    vtkCompositeDataSet::NAME(), "Boundary");
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHybridClip::ClassifyPoints(
+  vtkImageData* input, std::vector<unsigned char>& pointClass)
+{
+  vtkIdType numPts = input->GetNumberOfPoints();
+  pointClass.resize(numPts);
+  for (vtkIdType id = 0; id < numPts; ++id)
+    {
+    double x[3];
+    input->GetPoint(id, x);
+    double v = this->ClipFunction->FunctionValue(x) - this->Value;
+    if (v == 0.0)
+      {
+      pointClass[id] = 2;
+      }
+    else
+      {
+      pointClass[id] = ((v > 0.0) != (this->InsideOut != 0));
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHybridClip::ClassifyVoxels(
+  vtkImageData* input, const std::vector<unsigned char>& pointClass,
+  vtkUniformGrid* interior, std::vector<vtkIdType>& boundaryCells)
+{
+  int dims[3];
+  input->GetDimensions(dims);
+  vtkIdType rowSize = dims[0];
+  vtkIdType sliceSize = rowSize*dims[1];
+
+  // Offsets of the eight corners of a voxel from its first point
+  vtkIdType corners[8];
+  for (int c = 0; c < 8; ++c)
+    {
+    corners[c] = (c & 1) + ((c >> 1) & 1)*rowSize + ((c >> 2) & 1)*sliceSize;
+    }
+
+  boundaryCells.clear();
+  vtkIdType cellId = 0;
+  for (int k = 0; k < dims[2] - 1; ++k)
+    {
+    for (int j = 0; j < dims[1] - 1; ++j)
+      {
+      const unsigned char* p = &pointClass[k*sliceSize + j*rowSize];
+      for (int i = 0; i < dims[0] - 1; ++i, ++p, ++cellId)
+        {
+        int kept = 0;
+        int removed = 0;
+        for (int c = 0; c < 8; ++c)
+          {
+          kept += (p[corners[c]] == 1);
+          removed += (p[corners[c]] == 0);
+          }
+        if (kept == 8)
+          {
+          continue;
+          }
+        interior->BlankCell(cellId);
+        if (removed < 8)
+          {
+          boundaryCells.push_back(cellId);
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHybridClip::ClipBoundary(
+  vtkImageData* input, const std::vector<vtkIdType>& boundaryCells,
+  vtkUnstructuredGrid* boundary)
+{
+  // Extract the boundary voxels with the points they use
+  vtkNew<vtkUnstructuredGrid> voxels;
+  vtkNew<vtkPoints> points;
+  vtkPointData* inPD = input->GetPointData();
+  vtkCellData* inCD = input->GetCellData();
+  vtkPointData* outPD = voxels->GetPointData();
+  vtkCellData* outCD = voxels->GetCellData();
+  outPD->CopyAllocate(inPD, 8*static_cast<vtkIdType>(boundaryCells.size()));
+  outCD->CopyAllocate(inCD, static_cast<vtkIdType>(boundaryCells.size()));
+  voxels->Allocate(static_cast<vtkIdType>(boundaryCells.size()));
+
+  std::map<vtkIdType, vtkIdType> pointMap;
+  vtkNew<vtkIdList> cellPoints;
+  for (size_t c = 0; c < boundaryCells.size(); ++c)
+    {
+    input->GetCellPoints(boundaryCells[c], cellPoints.GetPointer());
+    vtkIdType ids[8];
+    for (int v = 0; v < 8; ++v)
+      {
+      vtkIdType inId = cellPoints->GetId(v);
+      std::map<vtkIdType, vtkIdType>::iterator it = pointMap.find(inId);
+      if (it == pointMap.end())
+        {
+        double x[3];
+        input->GetPoint(inId, x);
+        ids[v] = points->InsertNextPoint(x);
+        outPD->CopyData(inPD, inId, ids[v]);
+        pointMap[inId] = ids[v];
+        }
+      else
+        {
+        ids[v] = it->second;
+        }
+      }
+    vtkIdType outId = voxels->InsertNextCell(VTK_VOXEL, 8, ids);
+    outCD->CopyData(inCD, boundaryCells[c], outId);
+    }
+  voxels->SetPoints(points.GetPointer());
+
+  // Only these few voxels go through the unstructured clip
+  vtkNew<vtkClipDataSet> clip;
+  clip->SetInputData(voxels.GetPointer());
+  clip->SetClipFunction(this->ClipFunction);
+  clip->SetValue(this->Value);
+  clip->SetInsideOut(this->InsideOut);
+  if (!this->Tetrahedralize)
+    {
+    clip->Update();
+    boundary->ShallowCopy(clip->GetOutput());
+    return;
+    }
+
+  vtkNew<vtkDataSetTriangleFilter> tetrahedralize;
+  tetrahedralize->SetInputConnection(clip->GetOutputPort());
+  tetrahedralize->Update();
+  boundary->ShallowCopy(tetrahedralize->GetOutput());
+}
@@ -0,0 +1,137 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageHybridClip.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageHybridClip - clip a volume with an implicit function,
+// keeping the voxels that are not cut as structured cells.
+//
+// .SECTION Description
+// vtkImageHybridClip produces the same clipped volume as vtkClipDataSet on
+// a vtkImageData, without converting every kept voxel into explicit points
+// and cells. The output is a vtkMultiBlockDataSet with two blocks:
+//
+// Block 0 ("Interior") is a vtkUniformGrid sharing the input geometry and
+// point data, where every voxel that is not entirely kept is blanked. Only
+// a visibility array is allocated.
+//
+// Block 1 ("Boundary") is a vtkUnstructuredGrid holding the voxels crossed
+// or touched by the clip surface, clipped with vtkClipDataSet and, when
+// Tetrahedralize is on (default), converted to tetrahedra with
+// vtkDataSetTriangleFilter.
+//
+// A voxel is classified from the implicit function values at its corners,
+// which is also all vtkClipDataSet looks at: it is interior when all of them
+// are kept, dropped when none of them is and clipped otherwise. Points are
+// kept where the function is greater than Value, or lower when InsideOut is
+// on, as with vtkClipDataSet.
+//
+// .SECTION see also
+// vtkClipDataSet vtkDataSetTriangleFilter vtkUniformGrid
+
+#ifndef __vtkImageHybridClip_h
+#define __vtkImageHybridClip_h
+
+#include <vtkMultiBlockDataSetAlgorithm.h>
+
+#include <vector>
+
+// Forward declarations
+class vtkImageData;
+class vtkImplicitFunction;
+class vtkInformation;
+class vtkInformationVector;
+class vtkUniformGrid;
+class vtkUnstructuredGrid;
+
+class vtkImageHybridClip : public vtkMultiBlockDataSetAlgorithm
+{
+public:
+  static vtkImageHybridClip* New();
+  vtkTypeMacro(vtkImageHybridClip, vtkMultiBlockDataSetAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  enum
+    {
+    INTERIOR_BLOCK = 0,
+    BOUNDARY_BLOCK
+    };
+
+  // Description:
+  // Set/Get the implicit function to clip with
+  virtual void SetClipFunction(vtkImplicitFunction* function);
+  vtkGetObjectMacro(ClipFunction, vtkImplicitFunction);
+
+  // Description:
+  // Set/Get the clipping value of the implicit function (default: 0)
+  vtkSetMacro(Value, double);
+  vtkGetMacro(Value, double);
+
+  // Description:
+  // Set/Get whether the points where the function is lower than Value are
+  // kept instead of the ones where it is greater (default: off)
+  vtkSetMacro(InsideOut, int);
+  vtkGetMacro(InsideOut, int);
+  vtkBooleanMacro(InsideOut, int);
+
+  // Description:
+  // Set/Get whether the clipped boundary voxels are converted to
+  // tetrahedra (default: on)
+  vtkSetMacro(Tetrahedralize, int);
+  vtkGetMacro(Tetrahedralize, int);
+  vtkBooleanMacro(Tetrahedralize, int);
+
+  // Description:
+  // Include the clip function modification time
+  unsigned long GetMTime();
+
+protected:
+  vtkImageHybridClip();
+  ~vtkImageHybridClip();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info);
+
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  // Description:
+  // Classify the points of the input: 1 when kept, 0 when removed and 2
+  // when the function is exactly Value
+  virtual void ClassifyPoints(vtkImageData* input,
+                              std::vector<unsigned char>& pointClass);
+
+  // Description:
+  // Blank the voxels of the interior grid that are not entirely kept and
+  // collect the ids of the boundary voxels
+  void ClassifyVoxels(vtkImageData* input,
+                      const std::vector<unsigned char>& pointClass,
+                      vtkUniformGrid* interior,
+                      std::vector<vtkIdType>& boundaryCells);
+
+  // Description:
+  // Clip the boundary voxels of the input into an unstructured grid
+  void ClipBoundary(vtkImageData* input,
+                    const std::vector<vtkIdType>& boundaryCells,
+                    vtkUnstructuredGrid* boundary);
+
+  vtkImplicitFunction* ClipFunction;
+  double Value;
+  int InsideOut;
+  int Tetrahedralize;
+
+private:
+  vtkImageHybridClip(const vtkImageHybridClip&); // Not implemented
+  void operator=(const vtkImageHybridClip&); // Not implemented
+};
+
+#endif //__vtkImageHybridClip_h
@@ -0,0 +1,591 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageLabelMapToRGBA.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageLabelMapToRGBA.h"
+
+#include <vtkColorTransferFunction.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <vector>
+
+vtkStandardNewMacro(vtkImageLabelMapToRGBA);
+
+//-----------------------------------------------------------------------------
+struct vtkImageLabelMapToRGBALabel
+{
+  vtkSmartPointer<vtkColorTransferFunction> ColorFunction;
+  vtkSmartPointer<vtkPiecewiseFunction> OpacityFunction;
+  int Slot;
+};
+
+//-----------------------------------------------------------------------------
+// What the threads read: RGBA entries of label l and bin b are at
+// Table[LabelOffsets[l] + b]
+struct vtkImageLabelMapToRGBATables
+{
+  const vtkTypeUInt32* Table;
+  const vtkTypeUInt32* LabelOffsets;
+  const vtkTypeUInt32* Bins;
+  double Range0;
+  double Scale;
+  int LastBin;
+
+  vtkTypeUInt32 Bin(double v) const
+    {
+    double d = (v - this->Range0) * this->Scale;
+    return static_cast<vtkTypeUInt32>(
+      d <= 0.0 ? 0 : (d >= this->LastBin ? this->LastBin :
+                      static_cast<int>(d)));
+    }
+};
+
+//-----------------------------------------------------------------------------
+class vtkImageLabelMapToRGBAInternals
+{
+public:
+  std::map<int, vtkImageLabelMapToRGBALabel> Labels;
+  vtkTimeStamp LabelsTime;
+
+  // Slot 0 is transparent black, for labels without functions
+  std::vector<vtkTypeUInt32> Table;
+  int NumberOfSlots;
+  int TableNumberOfColors;
+  double TableRange[2];
+  vtkTimeStamp TableTime;
+
+  std::vector<vtkTypeUInt32> LabelOffsets;
+  int LabelType;
+  int LabelMin;
+
+  std::vector<vtkTypeUInt32> Bins;
+  int BinsScalarType;
+  int ScalarMin;
+
+  vtkImageLabelMapToRGBATables Tables;
+};
+
+//-----------------------------------------------------------------------------
+// Samples the functions of labels [begin, end) into their slots of Table
+class vtkImageLabelMapToRGBASampler
+{
+public:
+  std::vector<vtkImageLabelMapToRGBALabel*> Labels;
+  double Range[2];
+  int NumberOfColors;
+  vtkTypeUInt32* Table;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    int n = this->NumberOfColors;
+    std::vector<double> rgb(3*static_cast<size_t>(n));
+    std::vector<double> alpha(static_cast<size_t>(n));
+    for (vtkIdType l = begin; l < end; ++l)
+      {
+      vtkImageLabelMapToRGBALabel* label = this->Labels[l];
+      label->ColorFunction->GetTable(this->Range[0], this->Range[1], n,
+                                     &rgb[0]);
+      std::fill(alpha.begin(), alpha.end(), 1.0);
+      if (label->OpacityFunction)
+        {
+        label->OpacityFunction->GetTable(this->Range[0], this->Range[1], n,
+                                         &alpha[0]);
+        }
+      unsigned char* out = reinterpret_cast<unsigned char*>(
+        this->Table + static_cast<size_t>(label->Slot)*n);
+      for (int i = 0; i < n; ++i)
+        {
+        out[4*i] = static_cast<unsigned char>(rgb[3*i]*255.0 + 0.5);
+        out[4*i+1] = static_cast<unsigned char>(rgb[3*i+1]*255.0 + 0.5);
+        out[4*i+2] = static_cast<unsigned char>(rgb[3*i+2]*255.0 + 0.5);
+        out[4*i+3] = static_cast<unsigned char>(alpha[i]*255.0 + 0.5);
+        }
+      }
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Get the range of the 8 and 16 bit integer types, return 0 for others
+static int vtkImageLabelMapToRGBATypeRange(int type, int range[2])
+{
+  switch (type)
+    {
+    case VTK_CHAR:
+      range[0] = VTK_CHAR_MIN;
+      range[1] = VTK_CHAR_MAX;
+      return 1;
+    case VTK_SIGNED_CHAR:
+      range[0] = VTK_SIGNED_CHAR_MIN;
+      range[1] = VTK_SIGNED_CHAR_MAX;
+      return 1;
+    case VTK_UNSIGNED_CHAR:
+      range[0] = VTK_UNSIGNED_CHAR_MIN;
+      range[1] = VTK_UNSIGNED_CHAR_MAX;
+      return 1;
+    case VTK_SHORT:
+      range[0] = VTK_SHORT_MIN;
+      range[1] = VTK_SHORT_MAX;
+      return 1;
+    case VTK_UNSIGNED_SHORT:
+      range[0] = VTK_UNSIGNED_SHORT_MIN;
+      range[1] = VTK_UNSIGNED_SHORT_MAX;
+      return 1;
+    }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Bin a scalar. 8 and 16 bit integer types go through the bin table,
+// everything else through the range.
+template <class T>
+static inline vtkTypeUInt32 vtkImageLabelMapToRGBABin(
+  const vtkImageLabelMapToRGBATables& tables, T v)
+{
+  return tables.Bin(static_cast<double>(v));
+}
+
+#define vtkImageLabelMapToRGBAIntegerBinMacro(type) \
+static inline vtkTypeUInt32 vtkImageLabelMapToRGBABin( \
+  const vtkImageLabelMapToRGBATables& tables, type v) \
+{ \
+  return tables.Bins[static_cast<int>(v)]; \
+}
+
+vtkImageLabelMapToRGBAIntegerBinMacro(char)
+vtkImageLabelMapToRGBAIntegerBinMacro(signed char)
+vtkImageLabelMapToRGBAIntegerBinMacro(unsigned char)
+vtkImageLabelMapToRGBAIntegerBinMacro(short)
+vtkImageLabelMapToRGBAIntegerBinMacro(unsigned short)
+
+//-----------------------------------------------------------------------------
+// Color the first component of each input pixel in outExt with the
+// functions of its label
+template <class T, class L>
+static void vtkImageLabelMapToRGBAExecute(
+  const vtkImageLabelMapToRGBATables& tables, vtkImageData* inData,
+  const T* inPtr, vtkImageData* labelData, const L* labelPtr,
+  vtkImageData* outData, unsigned char* outPtr, int outExt[6])
+{
+  int numComponents = inData->GetNumberOfScalarComponents();
+  int labelComponents = labelData->GetNumberOfScalarComponents();
+  vtkIdType rowLength = outExt[1] - outExt[0] + 1;
+  vtkIdType inIncX, inIncY, inIncZ;
+  vtkIdType labelIncX, labelIncY, labelIncZ;
+  vtkIdType outIncX, outIncY, outIncZ;
+  inData->GetContinuousIncrements(outExt, inIncX, inIncY, inIncZ);
+  labelData->GetContinuousIncrements(outExt, labelIncX, labelIncY,
+                                     labelIncZ);
+  outData->GetContinuousIncrements(outExt, outIncX, outIncY, outIncZ);
+
+  const vtkTypeUInt32* table = tables.Table;
+  const vtkTypeUInt32* offsets = tables.LabelOffsets;
+  for (int k = outExt[4]; k <= outExt[5]; ++k)
+    {
+    for (int j = outExt[2]; j <= outExt[3]; ++j)
+      {
+      for (vtkIdType i = 0; i < rowLength; ++i)
+        {
+        vtkTypeUInt32 bin = vtkImageLabelMapToRGBABin(tables, *inPtr);
+        memcpy(outPtr, table + offsets[static_cast<int>(*labelPtr)] + bin, 4);
+        inPtr += numComponents;
+        labelPtr += labelComponents;
+        outPtr += 4;
+        }
+      inPtr += inIncY;
+      labelPtr += labelIncY;
+      outPtr += outIncY;
+      }
+    inPtr += inIncZ;
+    labelPtr += labelIncZ;
+    outPtr += outIncZ;
+    }
+}
+
+//-----------------------------------------------------------------------------
+template <class L>
+static void vtkImageLabelMapToRGBAScalars(
+  const vtkImageLabelMapToRGBATables& tables, vtkImageData* inData,
+  void* inPtr, vtkImageData* labelData, const L* labelPtr,
+  vtkImageData* outData, unsigned char* outPtr, int outExt[6])
+{
+  switch (inData->GetScalarType())
+    {
+    vtkTemplateMacro(
+      vtkImageLabelMapToRGBAExecute(tables, inData,
+                                    static_cast<const VTK_TT*>(inPtr),
+                                    labelData, labelPtr, outData, outPtr,
+                                    outExt));
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkImageLabelMapToRGBA::vtkImageLabelMapToRGBA()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetNumberOfOutputPorts(1);
+
+  this->NumberOfColors = 256;
+
+  this->Internals = new vtkImageLabelMapToRGBAInternals;
+  this->Internals->NumberOfSlots = 0;
+  this->Internals->TableNumberOfColors = 0;
+  this->Internals->TableRange[0] = 0.0;
+  this->Internals->TableRange[1] = 1.0;
+  this->Internals->LabelType = VTK_VOID;
+  this->Internals->LabelMin = 0;
+  this->Internals->BinsScalarType = VTK_VOID;
+  this->Internals->ScalarMin = 0;
+  memset(&this->Internals->Tables, 0, sizeof(this->Internals->Tables));
+}
+
+//-----------------------------------------------------------------------------
+vtkImageLabelMapToRGBA::~vtkImageLabelMapToRGBA()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelMapToRGBA::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfColors: " << this->NumberOfColors << "\n";
+  os << indent << "NumberOfLabels: " << this->GetNumberOfLabels() << "\n";
+  std::map<int, vtkImageLabelMapToRGBALabel>::const_iterator it;
+  for (it = this->Internals->Labels.begin();
+       it != this->Internals->Labels.end(); ++it)
+    {
+    os << indent << "Label " << it->first << ": ColorFunction "
+       << it->second.ColorFunction.GetPointer() << ", OpacityFunction "
+       << it->second.OpacityFunction.GetPointer() << "\n";
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelMapToRGBA::SetLabelMapInputData(vtkImageData* labelMap)
+{
+  this->SetInputData(1, labelMap);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelMapToRGBA::SetLabelMapInputConnection(
+  vtkAlgorithmOutput* port)
+{
+  this->SetInputConnection(1, port);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelMapToRGBA::SetLabelFunctions(int label,
+                                               vtkColorTransferFunction* cf,
+                                               vtkPiecewiseFunction* pwf)
+{
+  std::map<int, vtkImageLabelMapToRGBALabel>::iterator it =
+    this->Internals->Labels.find(label);
+  if (it != this->Internals->Labels.end() &&
+      it->second.ColorFunction == cf && it->second.OpacityFunction == pwf)
+    {
+    return;
+    }
+  vtkImageLabelMapToRGBALabel& entry = this->Internals->Labels[label];
+  entry.ColorFunction = cf;
+  entry.OpacityFunction = pwf;
+  entry.Slot = 0;
+  this->Internals->LabelsTime.Modified();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelMapToRGBA::RemoveLabel(int label)
+{
+  if (this->Internals->Labels.erase(label))
+    {
+    this->Internals->LabelsTime.Modified();
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelMapToRGBA::RemoveAllLabels()
+{
+  if (!this->Internals->Labels.empty())
+    {
+    this->Internals->Labels.clear();
+    this->Internals->LabelsTime.Modified();
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkImageLabelMapToRGBA::GetNumberOfLabels()
+{
+  return static_cast<int>(this->Internals->Labels.size());
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImageLabelMapToRGBA::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  std::map<int, vtkImageLabelMapToRGBALabel>::const_iterator it;
+  for (it = this->Internals->Labels.begin();
+       it != this->Internals->Labels.end(); ++it)
+    {
+    if (it->second.ColorFunction &&
+        it->second.ColorFunction->GetMTime() > mTime)
+      {
+      mTime = it->second.ColorFunction->GetMTime();
+      }
+    if (it->second.OpacityFunction &&
+        it->second.OpacityFunction->GetMTime() > mTime)
+      {
+      mTime = it->second.OpacityFunction->GetMTime();
+      }
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageLabelMapToRGBA::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelMapToRGBA::UpdateTables(int labelType, int scalarType)
+{
+  vtkImageLabelMapToRGBAInternals* internals = this->Internals;
+  unsigned long tableTime = internals->TableTime.GetMTime();
+  int n = this->NumberOfColors;
+
+  // The table spans the union of the ranges of the color functions, so
+  // that a scalar has the same bin whatever its label
+  double range[2] = { VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  int numberOfSlots = 1;
+  std::map<int, vtkImageLabelMapToRGBALabel>::iterator it;
+  for (it = internals->Labels.begin(); it != internals->Labels.end(); ++it)
+    {
+    vtkImageLabelMapToRGBALabel& label = it->second;
+    label.Slot = 0;
+    if (!label.ColorFunction)
+      {
+      continue;
+      }
+    label.Slot = numberOfSlots++;
+    double* labelRange = label.ColorFunction->GetRange();
+    range[0] = std::min(range[0], labelRange[0]);
+    range[1] = std::max(range[1], labelRange[1]);
+    }
+  if (numberOfSlots == 1)
+    {
+    range[0] = 0.0;
+    range[1] = 1.0;
+    }
+
+  // Changes of the set of labels, of the number of colors or of the range
+  // move every entry
+  int layout = tableTime > internals->LabelsTime.GetMTime() &&
+    n == internals->TableNumberOfColors &&
+    numberOfSlots == internals->NumberOfSlots &&
+    range[0] == internals->TableRange[0] &&
+    range[1] == internals->TableRange[1];
+
+  vtkImageLabelMapToRGBASampler sampler;
+  for (it = internals->Labels.begin(); it != internals->Labels.end(); ++it)
+    {
+    vtkImageLabelMapToRGBALabel& label = it->second;
+    if (label.Slot &&
+        (!layout || label.ColorFunction->GetMTime() > tableTime ||
+         (label.OpacityFunction &&
+          label.OpacityFunction->GetMTime() > tableTime)))
+      {
+      sampler.Labels.push_back(&label);
+      }
+    }
+
+  if (!layout)
+    {
+    internals->Table.assign(static_cast<size_t>(numberOfSlots)*n, 0);
+    internals->NumberOfSlots = numberOfSlots;
+    internals->TableNumberOfColors = n;
+    internals->TableRange[0] = range[0];
+    internals->TableRange[1] = range[1];
+    }
+  if (!layout || !sampler.Labels.empty())
+    {
+    sampler.Range[0] = range[0];
+    sampler.Range[1] = range[1];
+    sampler.NumberOfColors = n;
+    sampler.Table = &internals->Table[0];
+    vtkSMPTools::For(0, static_cast<vtkIdType>(sampler.Labels.size()),
+                     sampler);
+    internals->TableTime.Modified();
+    }
+
+  // Labels of the label map's type to the offsets of their slots
+  int typeRange[2];
+  vtkImageLabelMapToRGBATypeRange(labelType, typeRange);
+  if (!layout || labelType != internals->LabelType)
+    {
+    internals->LabelOffsets.assign(
+      static_cast<size_t>(typeRange[1] - typeRange[0]) + 1, 0);
+    for (it = internals->Labels.begin(); it != internals->Labels.end();
+         ++it)
+      {
+      if (it->first >= typeRange[0] && it->first <= typeRange[1])
+        {
+        internals->LabelOffsets[it->first - typeRange[0]] =
+          static_cast<vtkTypeUInt32>(it->second.Slot)*n;
+        }
+      }
+    internals->LabelType = labelType;
+    internals->LabelMin = typeRange[0];
+    }
+
+  vtkImageLabelMapToRGBATables& tables = internals->Tables;
+  double width = range[1] - range[0];
+  tables.Table = &internals->Table[0];
+  tables.LabelOffsets = &internals->LabelOffsets[0] - internals->LabelMin;
+  tables.Range0 = range[0];
+  tables.Scale = (width > 0.0 ? n / width : 0.0);
+  tables.LastBin = n - 1;
+  tables.Bins = NULL;
+
+  // Integer scalars to their bins
+  if (vtkImageLabelMapToRGBATypeRange(scalarType, typeRange))
+    {
+    if (!layout || scalarType != internals->BinsScalarType)
+      {
+      size_t size = static_cast<size_t>(typeRange[1] - typeRange[0]) + 1;
+      internals->Bins.resize(size);
+      for (size_t i = 0; i < size; ++i)
+        {
+        internals->Bins[i] =
+          tables.Bin(static_cast<double>(typeRange[0]) + i);
+        }
+      internals->BinsScalarType = scalarType;
+      internals->ScalarMin = typeRange[0];
+      }
+    tables.Bins = &internals->Bins[0] - internals->ScalarMin;
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkImageLabelMapToRGBA::RequestData(vtkInformation* request,
+                                        vtkInformationVector** inputVector,
+                                        vtkInformationVector* outputVector)
+{
+  vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+  vtkImageData* labelMap = vtkImageData::GetData(inputVector[1]);
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  if (!input || !labelMap)
+    {
+    vtkErrorMacro(<< "An input and a label map are required");
+    return 0;
+    }
+
+  int typeRange[2];
+  if (!vtkImageLabelMapToRGBATypeRange(labelMap->GetScalarType(), typeRange))
+    {
+    vtkErrorMacro(<< "The label map must have 8 or 16 bit integer scalars, "
+                  << "not " << labelMap->GetScalarTypeAsString());
+    return 0;
+    }
+
+  int outExt[6], labelExt[6];
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), outExt);
+  labelMap->GetExtent(labelExt);
+  for (int i = 0; i < 3; ++i)
+    {
+    if (outExt[2*i] <= outExt[2*i+1] &&
+        (labelExt[2*i] > outExt[2*i] || labelExt[2*i+1] < outExt[2*i+1]))
+      {
+      vtkErrorMacro(<< "The label map does not cover the input extent");
+      return 0;
+      }
+    }
+
+  // The tables are shared by all threads and must be up to date before
+  // they start
+  this->UpdateTables(labelMap->GetScalarType(), input->GetScalarType());
+
+  return this->Superclass::RequestData(request, inputVector, outputVector);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelMapToRGBA::ThreadedRequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* vtkNotUsed(outputVector),
+  vtkImageData*** inData,
+  vtkImageData** outData,
+  int outExt[6], int vtkNotUsed(threadId))
+{
+  vtkImageData* input = inData[0][0];
+  vtkImageData* labelMap = inData[1][0];
+  vtkImageData* output = outData[0];
+  void* inPtr = input->GetScalarPointerForExtent(outExt);
+  void* labelPtr = labelMap->GetScalarPointerForExtent(outExt);
+  unsigned char* outPtr =
+    static_cast<unsigned char*>(output->GetScalarPointerForExtent(outExt));
+  if (!inPtr || !labelPtr || !outPtr)
+    {
+    return;
+    }
+
+  const vtkImageLabelMapToRGBATables& tables = this->Internals->Tables;
+  switch (labelMap->GetScalarType())
+    {
+    case VTK_CHAR:
+      vtkImageLabelMapToRGBAScalars(tables, input, inPtr, labelMap,
+                                    static_cast<const char*>(labelPtr),
+                                    output, outPtr, outExt);
+      break;
+    case VTK_SIGNED_CHAR:
+      vtkImageLabelMapToRGBAScalars(tables, input, inPtr, labelMap,
+                                    static_cast<const signed char*>(labelPtr),
+                                    output, outPtr, outExt);
+      break;
+    case VTK_UNSIGNED_CHAR:
+      vtkImageLabelMapToRGBAScalars(
+        tables, input, inPtr, labelMap,
+        static_cast<const unsigned char*>(labelPtr), output, outPtr, outExt);
+      break;
+    case VTK_SHORT:
+      vtkImageLabelMapToRGBAScalars(tables, input, inPtr, labelMap,
+                                    static_cast<const short*>(labelPtr),
+                                    output, outPtr, outExt);
+      break;
+    case VTK_UNSIGNED_SHORT:
+      vtkImageLabelMapToRGBAScalars(
+        tables, input, inPtr, labelMap,
+        static_cast<const unsigned short*>(labelPtr), output, outPtr,
+        outExt);
+      break;
+    default:
+      vtkErrorMacro(<< "Execute: Unknown label map ScalarType");
+      return;
+    }
+}
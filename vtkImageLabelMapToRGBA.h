@@ -0,0 +1,129 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageLabelMapToRGBA.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageLabelMapToRGBA - map an image to RGBA with one color and
+// opacity function per label of a label map, in a single pass.
+//
+// .SECTION Description
+// vtkImageLabelMapToRGBA takes the image to color on input port 0 and a
+// label map with the same extent on input port 1. Each label is given its
+// own vtkColorTransferFunction and vtkPiecewiseFunction with
+// SetLabelFunctions(), and every pixel is colored with the functions of its
+// label. Pixels whose label has no functions, such as the background label
+// 0, are transparent black. A binary mask is the label map with a single
+// label 255.
+//
+// The functions of all labels are sampled into one combined table of
+// NumberOfColors entries per label, over the union of the ranges of the
+// color functions, and the label map is turned into a table of offsets into
+// it. Coloring a pixel is then two lookups whatever the number of labels,
+// and 8 and 16 bit integer scalars are binned with a third lookup instead
+// of floating point arithmetic. The table entries of a label are only
+// resampled when its functions change.
+//
+// The label map must have 8 or 16 bit integer scalars, only the first
+// component of both inputs is used.
+//
+// .SECTION see also
+// vtkImageMapToRGBA vtkRGBATransferTable vtkImageMaskedResliceToRGBA
+
+#ifndef __vtkImageLabelMapToRGBA_h
+#define __vtkImageLabelMapToRGBA_h
+
+#include <vtkThreadedImageAlgorithm.h>
+
+// Forward declarations
+class vtkAlgorithmOutput;
+class vtkColorTransferFunction;
+class vtkImageData;
+class vtkImageLabelMapToRGBAInternals;
+class vtkInformation;
+class vtkInformationVector;
+class vtkPiecewiseFunction;
+
+class vtkImageLabelMapToRGBA : public vtkThreadedImageAlgorithm
+{
+public:
+  static vtkImageLabelMapToRGBA* New();
+  vtkTypeMacro(vtkImageLabelMapToRGBA, vtkThreadedImageAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set the label map, on input port 1
+  void SetLabelMapInputData(vtkImageData* labelMap);
+  void SetLabelMapInputConnection(vtkAlgorithmOutput* port);
+
+  // Description:
+  // Set the color and opacity functions of a label. Without an opacity
+  // function the label is opaque, without a color function it is not
+  // shown.
+  void SetLabelFunctions(int label, vtkColorTransferFunction* cf,
+                         vtkPiecewiseFunction* pwf);
+
+  // Description:
+  // Remove the functions of one or of all labels
+  void RemoveLabel(int label);
+  void RemoveAllLabels();
+
+  // Description:
+  // Get the number of labels with functions
+  int GetNumberOfLabels();
+
+  // Description:
+  // Set/Get the number of table entries per label (default: 256)
+  vtkSetClampMacro(NumberOfColors, int, 2, 65536);
+  vtkGetMacro(NumberOfColors, int);
+
+  // Description:
+  // Include the functions' modification times, so that editing a function
+  // re-executes the filter on the next update
+  unsigned long GetMTime();
+
+protected:
+  vtkImageLabelMapToRGBA();
+  ~vtkImageLabelMapToRGBA();
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector);
+
+  // Description:
+  // Bring the tables up to date before the threads start
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  // Description:
+  // This is called by the superclass for each piece of the output
+  virtual void ThreadedRequestData(vtkInformation* request,
+                                   vtkInformationVector** inputVector,
+                                   vtkInformationVector* outputVector,
+                                   vtkImageData*** inData,
+                                   vtkImageData** outData,
+                                   int outExt[6], int threadId);
+
+  // Description:
+  // Sample the functions of the labels that changed into the combined
+  // table and map the labels of the label map's type to table offsets
+  void UpdateTables(int labelType, int scalarType);
+
+  int NumberOfColors;
+  vtkImageLabelMapToRGBAInternals* Internals;
+
+private:
+  vtkImageLabelMapToRGBA(const vtkImageLabelMapToRGBA&); // Not implemented
+  void operator=(const vtkImageLabelMapToRGBA&); // Not implemented
+};
+
+#endif //__vtkImageLabelMapToRGBA_h
@@ -0,0 +1,293 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMacrocellGrid.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageMacrocellGrid.h"
+
+#include "vtkRGBATransferTable.h"
+
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+
+vtkStandardNewMacro(vtkImageMacrocellGrid);
+
+//-----------------------------------------------------------------------------
+// Computes the range, the mask occupancy and the bounds of the inside
+// voxels of a range of bricks. The voxels of brick b along an axis are
+// [b*BrickSize, (b + 1)*BrickSize] from the start of the extent.
+template <class T>
+class vtkImageMacrocellGridBuildFunctor
+{
+public:
+  const T* Scalars;
+  const unsigned char* Mask;
+  int Extent[6];
+  int Components;
+  int BrickSize;
+  int GridDimensions[3];
+  double* Ranges;
+  unsigned char* Occupied;
+  int* Bounds;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    int n[3];
+    for (int c = 0; c < 3; ++c)
+      {
+      n[c] = this->Extent[2*c+1] - this->Extent[2*c];
+      }
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      int brick[3];
+      brick[0] = static_cast<int>(b % this->GridDimensions[0]);
+      brick[1] = static_cast<int>((b / this->GridDimensions[0]) %
+                                  this->GridDimensions[1]);
+      brick[2] = static_cast<int>(b / (static_cast<vtkIdType>(
+        this->GridDimensions[0])*this->GridDimensions[1]));
+      int lo[3], hi[3];
+      for (int c = 0; c < 3; ++c)
+        {
+        lo[c] = brick[c]*this->BrickSize;
+        hi[c] = std::min(lo[c] + this->BrickSize, n[c]);
+        }
+
+      double vmin = VTK_DOUBLE_MAX;
+      double vmax = -VTK_DOUBLE_MAX;
+      int* bounds = this->Bounds + 6*b;
+      bounds[0] = bounds[2] = bounds[4] = VTK_INT_MAX;
+      bounds[1] = bounds[3] = bounds[5] = -VTK_INT_MAX;
+      int occupied = (this->Mask == NULL);
+      for (int k = lo[2]; k <= hi[2]; ++k)
+        {
+        for (int j = lo[1]; j <= hi[1]; ++j)
+          {
+          // The mask has the extent of the volume and a single component
+          vtkIdType voxel = (static_cast<vtkIdType>(k)*(n[1] + 1) + j)*
+            (n[0] + 1) + lo[0];
+          const T* s = this->Scalars + voxel*this->Components;
+          for (int i = lo[0]; i <= hi[0]; ++i, s += this->Components)
+            {
+            double v = static_cast<double>(*s);
+            vmin = (v < vmin ? v : vmin);
+            vmax = (v > vmax ? v : vmax);
+            }
+          if (!this->Mask)
+            {
+            continue;
+            }
+          const unsigned char* m = this->Mask + voxel;
+          for (int i = lo[0]; i <= hi[0]; ++i, ++m)
+            {
+            if (*m)
+              {
+              occupied = 1;
+              bounds[0] = std::min(bounds[0], i);
+              bounds[1] = std::max(bounds[1], i);
+              bounds[2] = std::min(bounds[2], j);
+              bounds[3] = std::max(bounds[3], j);
+              bounds[4] = std::min(bounds[4], k);
+              bounds[5] = std::max(bounds[5], k);
+              }
+            }
+          }
+        }
+      this->Ranges[2*b] = vmin;
+      this->Ranges[2*b+1] = vmax;
+      this->Occupied[b] = static_cast<unsigned char>(occupied);
+      }
+    }
+};
+
+//-----------------------------------------------------------------------------
+vtkImageMacrocellGrid::vtkImageMacrocellGrid()
+{
+  this->BrickSize = 8;
+  for (int c = 0; c < 3; ++c)
+    {
+    this->Extent[2*c] = this->MaskBounds[2*c] = 0;
+    this->Extent[2*c+1] = this->MaskBounds[2*c+1] = -1;
+    this->GridDimensions[c] = 0;
+    }
+  this->NumberOfVisibleBricks = 0;
+  this->BuiltWithMask = 0;
+}
+
+//-----------------------------------------------------------------------------
+vtkImageMacrocellGrid::~vtkImageMacrocellGrid()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMacrocellGrid::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "BrickSize: " << this->BrickSize << "\n";
+  os << indent << "GridDimensions: " << this->GridDimensions[0] << " "
+     << this->GridDimensions[1] << " " << this->GridDimensions[2] << "\n";
+  os << indent << "MaskBounds: ";
+  for (int i = 0; i < 6; ++i)
+    {
+    os << this->MaskBounds[i] << (i < 5 ? " " : "\n");
+    }
+  os << indent << "NumberOfVisibleBricks: "
+     << this->NumberOfVisibleBricks << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMacrocellGrid::Build(vtkImageData* volume, vtkImageData* mask)
+{
+  if (!volume || volume->GetNumberOfPoints() == 0)
+    {
+    vtkErrorMacro(<< "Build: empty volume");
+    return 0;
+    }
+  int extent[6];
+  volume->GetExtent(extent);
+  if (mask)
+    {
+    int maskExtent[6];
+    mask->GetExtent(maskExtent);
+    if (!std::equal(extent, extent + 6, maskExtent))
+      {
+      vtkErrorMacro(<< "Build: the mask must have the extent of the volume");
+      return 0;
+      }
+    if (mask->GetScalarType() != VTK_UNSIGNED_CHAR)
+      {
+      vtkErrorMacro(<< "Build: the mask must be of type unsigned char, got "
+                    << mask->GetScalarTypeAsString());
+      return 0;
+      }
+    }
+
+  unsigned long buildTime = this->BuildTime.GetMTime();
+  if (buildTime > this->GetMTime() && buildTime > volume->GetMTime() &&
+      (!mask || buildTime > mask->GetMTime()) &&
+      this->BuiltWithMask == (mask != NULL) &&
+      std::equal(extent, extent + 6, this->Extent))
+    {
+    return 1;
+    }
+
+  vtkIdType numBricks = 1;
+  for (int c = 0; c < 3; ++c)
+    {
+    int cells = extent[2*c+1] - extent[2*c];
+    this->GridDimensions[c] =
+      (cells > 0 ? (cells + this->BrickSize - 1) / this->BrickSize : 1);
+    numBricks *= this->GridDimensions[c];
+    }
+  std::copy(extent, extent + 6, this->Extent);
+  this->Ranges.resize(2*numBricks);
+  this->Occupied.resize(numBricks);
+  this->Visible.assign(numBricks, 0);
+  std::vector<int> bounds(6*numBricks);
+
+  void* scalars = volume->GetScalarPointer();
+  switch (volume->GetScalarType())
+    {
+    vtkTemplateMacro(
+      vtkImageMacrocellGridBuildFunctor<VTK_TT> functor;
+      functor.Scalars = static_cast<const VTK_TT*>(scalars);
+      functor.Mask = (mask ? static_cast<const unsigned char*>(
+        mask->GetScalarPointer()) : NULL);
+      std::copy(extent, extent + 6, functor.Extent);
+      functor.Components = volume->GetNumberOfScalarComponents();
+      functor.BrickSize = this->BrickSize;
+      std::copy(this->GridDimensions, this->GridDimensions + 3,
+                functor.GridDimensions);
+      functor.Ranges = &this->Ranges[0];
+      functor.Occupied = &this->Occupied[0];
+      functor.Bounds = &bounds[0];
+      vtkSMPTools::For(0, numBricks, 1, functor));
+    default:
+      vtkErrorMacro(<< "Build: Unknown input ScalarType");
+      return 0;
+    }
+
+  if (mask)
+    {
+    // The bounds were computed relative to the start of the extent
+    this->MaskBounds[0] = this->MaskBounds[2] = this->MaskBounds[4] =
+      VTK_INT_MAX;
+    this->MaskBounds[1] = this->MaskBounds[3] = this->MaskBounds[5] =
+      -VTK_INT_MAX;
+    for (vtkIdType b = 0; b < numBricks; ++b)
+      {
+      if (!this->Occupied[b])
+        {
+        continue;
+        }
+      for (int c = 0; c < 3; ++c)
+        {
+        this->MaskBounds[2*c] = std::min(this->MaskBounds[2*c],
+                                         extent[2*c] + bounds[6*b+2*c]);
+        this->MaskBounds[2*c+1] = std::max(this->MaskBounds[2*c+1],
+                                           extent[2*c] + bounds[6*b+2*c+1]);
+        }
+      }
+    if (this->MaskBounds[0] > this->MaskBounds[1])
+      {
+      for (int c = 0; c < 3; ++c)
+        {
+        this->MaskBounds[2*c] = extent[2*c];
+        this->MaskBounds[2*c+1] = extent[2*c] - 1;
+        }
+      }
+    }
+  else
+    {
+    std::copy(extent, extent + 6, this->MaskBounds);
+    }
+
+  this->BuiltWithMask = (mask != NULL);
+  this->BuildTime.Modified();
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMacrocellGrid::Classify(vtkRGBATransferTable* table)
+{
+  if (this->ClassifyTime > this->BuildTime &&
+      this->ClassifyTime > table->GetMTime())
+    {
+    return;
+    }
+
+  this->NumberOfVisibleBricks = 0;
+  for (size_t b = 0; b < this->Occupied.size(); ++b)
+    {
+    this->Visible[b] = 0;
+    if (!this->Occupied[b])
+      {
+      continue;
+      }
+    // The table is monotonic in the scalar, so the entries of the values
+    // of the brick are the ones between the entries of its range
+    const unsigned char* first = table->MapValue(this->Ranges[2*b]);
+    const unsigned char* last = table->MapValue(this->Ranges[2*b+1]);
+    for (const unsigned char* e = first; e <= last; e += 4)
+      {
+      if (e[3] != 0)
+        {
+        this->Visible[b] = 1;
+        ++this->NumberOfVisibleBricks;
+        break;
+        }
+      }
+    }
+  this->ClassifyTime.Modified();
+}
@@ -0,0 +1,121 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMacrocellGrid.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageMacrocellGrid - coarse grid of bricks of a volume and its
+// binary mask, for empty space skipping.
+//
+// .SECTION Description
+// vtkImageMacrocellGrid splits a volume into bricks of BrickSize^3 cells
+// and stores, for every brick, the scalar range of the voxels its cells
+// touch and whether any of these voxels is inside a binary mask. Two
+// neighbouring bricks share their common layer of voxels, so that any
+// trilinear or nearest neighbour sample taken in a brick only reads voxels
+// whose range and mask occupancy the brick records.
+//
+// Classify() combines the ranges with the opacity of a transfer table: a
+// brick is visible when it has a voxel inside the mask and the table has a
+// non zero opacity somewhere over the brick's range. Every sample taken in
+// an invisible brick is therefore transparent, and rays may skip the brick
+// without changing the image.
+//
+// The grid also keeps the index bounds of the voxels inside the mask, which
+// rays are clipped to before they start.
+//
+// .SECTION see also
+// vtkImageMaskedRayCastToRGBA vtkRGBATransferTable
+
+#ifndef __vtkImageMacrocellGrid_h
+#define __vtkImageMacrocellGrid_h
+
+#include <vtkObject.h>
+
+#include <vector>
+
+// Forward declarations
+class vtkImageData;
+class vtkRGBATransferTable;
+
+class vtkImageMacrocellGrid : public vtkObject
+{
+public:
+  static vtkImageMacrocellGrid* New();
+  vtkTypeMacro(vtkImageMacrocellGrid, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/Get the number of cells along each side of a brick (default: 8)
+  vtkSetClampMacro(BrickSize, int, 1, 256);
+  vtkGetMacro(BrickSize, int);
+
+  // Description:
+  // Compute the scalar range and mask occupancy of the bricks of a volume.
+  // The mask, if any, must be of type unsigned char and have the extent of
+  // the volume. Does nothing when the grid is newer than the volume, the
+  // mask and the brick size. Returns 0 on error.
+  int Build(vtkImageData* volume, vtkImageData* mask);
+
+  // Description:
+  // Compute the visibility of the bricks for a built table. Does nothing
+  // when up to date with the table and the last Build().
+  void Classify(vtkRGBATransferTable* table);
+
+  // Description:
+  // Get the extent of the volume and the number of bricks along each axis.
+  // Valid after Build().
+  vtkGetVector6Macro(Extent, int);
+  vtkGetVector3Macro(GridDimensions, int);
+
+  // Description:
+  // Get the index bounds of the voxels inside the mask, or the extent of
+  // the volume without mask. Empty when no voxel is inside.
+  vtkGetVector6Macro(MaskBounds, int);
+
+  // Description:
+  // Return 1 when brick (i, j, k) may hold a visible sample. Valid after
+  // Classify().
+  int IsBrickVisible(int i, int j, int k) const
+    {
+    return this->Visible[(static_cast<size_t>(k)*this->GridDimensions[1] +
+                          j)*this->GridDimensions[0] + i];
+    }
+
+  // Description:
+  // Get the number of visible bricks. Valid after Classify().
+  vtkGetMacro(NumberOfVisibleBricks, int);
+
+protected:
+  vtkImageMacrocellGrid();
+  ~vtkImageMacrocellGrid();
+
+  int BrickSize;
+  int Extent[6];
+  int GridDimensions[3];
+  int MaskBounds[6];
+  int NumberOfVisibleBricks;
+  int BuiltWithMask;
+
+  // Per brick: scalar range, mask occupancy and visibility
+  std::vector<double> Ranges;
+  std::vector<unsigned char> Occupied;
+  std::vector<unsigned char> Visible;
+
+  vtkTimeStamp BuildTime;
+  vtkTimeStamp ClassifyTime;
+
+private:
+  vtkImageMacrocellGrid(const vtkImageMacrocellGrid&); // Not implemented
+  void operator=(const vtkImageMacrocellGrid&); // Not implemented
+};
+
+#endif //__vtkImageMacrocellGrid_h
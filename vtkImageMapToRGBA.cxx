@@ -14,17 +14,74 @@
 =========================================================================*/
 #include "vtkImageMapToRGBA.h"
 
-#include <vtkCommand.h>
+#include "vtkRGBATransferTable.h"
+
+#include <vtkColorTransferFunction.h>
 #include <vtkImageData.h>
-#include <vtkImageMapToColors.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
-#include <vtkLookupTable.h>
 #include <vtkObjectFactory.h>
+#include <vtkPiecewiseFunction.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 
+#include <algorithm>
+#include <cmath>
+
 vtkStandardNewMacro(vtkImageMapToRGBA);
 
+//-----------------------------------------------------------------------------
+// Map one row of scalars. 8 and 16 bit integer types go through the integer
+// table, everything else through the sampled table.
+template <class T>
+static inline void vtkImageMapToRGBARow(vtkRGBATransferTable* table,
+                                        const T* in, int inStride,
+                                        unsigned char* out, vtkIdType n)
+{
+  table->MapScalars(in, inStride, out, n);
+}
+
+#define vtkImageMapToRGBAIntegerRowMacro(type) \
+static inline void vtkImageMapToRGBARow(vtkRGBATransferTable* table, \
+                                        const type* in, int inStride, \
+                                        unsigned char* out, vtkIdType n) \
+{ \
+  table->MapIntegers(in, inStride, out, n); \
+}
+
+vtkImageMapToRGBAIntegerRowMacro(char)
+vtkImageMapToRGBAIntegerRowMacro(signed char)
+vtkImageMapToRGBAIntegerRowMacro(unsigned char)
+vtkImageMapToRGBAIntegerRowMacro(short)
+vtkImageMapToRGBAIntegerRowMacro(unsigned short)
+
+//-----------------------------------------------------------------------------
+// Map the first component of each input pixel in outExt to RGBA
+template <class T>
+static void vtkImageMapToRGBAExecute(vtkRGBATransferTable* table,
+                                     vtkImageData* inData, T* inPtr,
+                                     vtkImageData* outData,
+                                     unsigned char* outPtr, int outExt[6])
+{
+  int numComponents = inData->GetNumberOfScalarComponents();
+  vtkIdType rowLength = outExt[1] - outExt[0] + 1;
+  vtkIdType inIncX, inIncY, inIncZ;
+  vtkIdType outIncX, outIncY, outIncZ;
+  inData->GetContinuousIncrements(outExt, inIncX, inIncY, inIncZ);
+  outData->GetContinuousIncrements(outExt, outIncX, outIncY, outIncZ);
+
+  for (int k = outExt[4]; k <= outExt[5]; ++k)
+    {
+    for (int j = outExt[2]; j <= outExt[3]; ++j)
+      {
+      vtkImageMapToRGBARow(table, inPtr, numComponents, outPtr, rowLength);
+      inPtr += rowLength*numComponents + inIncY;
+      outPtr += rowLength*4 + outIncY;
+      }
+    inPtr += inIncZ;
+    outPtr += outIncZ;
+    }
+}
+
 //-----------------------------------------------------------------------------
 vtkImageMapToRGBA::vtkImageMapToRGBA()
 {
@@ -34,10 +91,9 @@ vtkImageMapToRGBA::vtkImageMapToRGBA()
   this->ColorFunction = NULL;
   this->OpacityFunction = NULL;
   this->NumberOfColors = 256;
+  this->ExactIntegerMapping = 0;
 
-  this->LookupTable = vtkLookupTable::New();
-  this->LookupTable->SetNumberOfTableValues(256);
-  this->LookupTable->Build();
+  this->LookupTable = vtkRGBATransferTable::New();
 }
 
 //-----------------------------------------------------------------------------
@@ -73,6 +129,9 @@ void vtkImageMapToRGBA::PrintSelf(ostream &os, vtkIndent indent)
     os << indent << "OpacityFunction: ";
     this->OpacityFunction->PrintSelf(os, indent.GetNextIndent());
     }
+  os << indent << "NumberOfColors: " << this->NumberOfColors << "\n";
+  os << indent << "ExactIntegerMapping: " << this->ExactIntegerMapping
+     << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -91,9 +150,6 @@ void vtkImageMapToRGBA::SetColorFunction(
     if (this->ColorFunction != NULL)
       {
       this->ColorFunction->Register(this);
-      this->ColorFunction->AddObserver(vtkCommand::ModifiedEvent, this,
-                          &vtkImageMapToRGBA::UpdateLookupTable);
-      this->UpdateLookupTable();
       }
     this->Modified();
     }
@@ -115,67 +171,148 @@ void vtkImageMapToRGBA::SetOpacityFunction(
     if (this->OpacityFunction != NULL)
       {
       this->OpacityFunction->Register(this);
-      this->OpacityFunction->AddObserver(vtkCommand::ModifiedEvent, this,
-                          &vtkImageMapToRGBA::UpdateLookupTable);
-      this->UpdateLookupTable();
       }
     this->Modified();
     }
 }
 
 //----------------------------------------------------------------------------
-int vtkImageMapToRGBA::RequestData(vtkInformation* vtkNotUsed(request),
-                                                 vtkInformationVector** inputVector,
-                                                 vtkInformationVector* outputVector)
+int vtkImageMapToRGBA::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
 {
-  // During RequestData, this filter examines the color and opacity
-  // functions and fills in that empty lookup table with real
-  // data values
-  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
-  vtkImageData* input = vtkImageData::SafeDownCast(
-                            inInfo->Get(vtkDataObject::DATA_OBJECT()));
-
   vtkInformation* outInfo = outputVector->GetInformationObject(0);
-  vtkImageData* output = vtkImageData::SafeDownCast(
-                              outInfo->Get(vtkDataObject::DATA_OBJECT()));
-
-  vtkImageMapToColors* imageMap = vtkImageMapToColors::New();
-  imageMap->SetInputData(input);
-  imageMap->SetLookupTable(this->LookupTable);
-  imageMap->SetOutputFormatToRGBA();
-  imageMap->Update();
-
-  output->DeepCopy(imageMap->GetOutput());
-
-  imageMap->Delete();
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
   return 1;
 }
 
 //----------------------------------------------------------------------------
-void vtkImageMapToRGBA::UpdateLookupTable(void)
+int vtkImageMapToRGBA::RequestData(vtkInformation* request,
+                                   vtkInformationVector** inputVector,
+                                   vtkInformationVector* outputVector)
 {
-  this->LookupTable->SetNumberOfTableValues(this->NumberOfColors);
-  this->LookupTable->Build();
+  // The table is shared by all threads and must be up to date before they
+  // start
+  this->UpdateLookupTable();
 
-  if (this->ColorFunction)
+  vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+  int typeRange[2] = { 0, -1 };
+  switch (input ? input->GetScalarType() : VTK_VOID)
+    {
+    case VTK_CHAR:
+      typeRange[0] = VTK_CHAR_MIN;
+      typeRange[1] = VTK_CHAR_MAX;
+      break;
+    case VTK_SIGNED_CHAR:
+      typeRange[0] = VTK_SIGNED_CHAR_MIN;
+      typeRange[1] = VTK_SIGNED_CHAR_MAX;
+      break;
+    case VTK_UNSIGNED_CHAR:
+      typeRange[0] = VTK_UNSIGNED_CHAR_MIN;
+      typeRange[1] = VTK_UNSIGNED_CHAR_MAX;
+      break;
+    case VTK_SHORT:
+      typeRange[0] = VTK_SHORT_MIN;
+      typeRange[1] = VTK_SHORT_MAX;
+      break;
+    case VTK_UNSIGNED_SHORT:
+      typeRange[0] = VTK_UNSIGNED_SHORT_MIN;
+      typeRange[1] = VTK_UNSIGNED_SHORT_MAX;
+      break;
+    }
+
+  if (typeRange[0] <= typeRange[1])
     {
-    double colorRange[2];
-    this->ColorFunction->GetRange(colorRange);
-    this->LookupTable->SetRange(colorRange);
-    for (vtkIdType i = 0; i < this->NumberOfColors; ++i)
+    if (this->ExactIntegerMapping)
       {
-      double value = i*(colorRange[1] - colorRange[0]) / 
-                          (this->NumberOfColors - 1) + colorRange[0];
-      double rgb[3];
-      this->ColorFunction->GetColor(value, rgb);
-      double o = 1.0;
-      if (this->OpacityFunction)
+      // Clamped functions are constant outside of their ranges, so only
+      // the integers in these ranges need sampling, and the input does not
+      // have to be scanned for its range on every execution
+      double range[2] = { static_cast<double>(typeRange[0]),
+                          static_cast<double>(typeRange[1]) };
+      vtkColorTransferFunction* cf = this->ColorFunction;
+      vtkPiecewiseFunction* pwf = this->OpacityFunction;
+      if (cf && cf->GetClamping() && (!pwf || pwf->GetClamping()))
         {
-        o = this->OpacityFunction->GetValue(value);
+        cf->GetRange(range);
+        if (pwf)
+          {
+          double* opacityRange = pwf->GetRange();
+          range[0] = std::min(range[0], opacityRange[0]);
+          range[1] = std::max(range[1], opacityRange[1]);
+          }
+        range[0] = std::max(floor(range[0]),
+                            static_cast<double>(typeRange[0]));
+        range[1] = std::min(ceil(range[1]),
+                            static_cast<double>(typeRange[1]));
         }
-      this->LookupTable->SetTableValue(i, rgb[0], rgb[1], rgb[2], o);
+      this->LookupTable->BuildExactIntegerTable(
+        typeRange[0], typeRange[1], static_cast<int>(range[0]),
+        static_cast<int>(range[1]));
+      }
+    else
+      {
+      this->LookupTable->BuildIntegerTable(typeRange[0], typeRange[1]);
       }
     }
 
-  this->Modified();
+  return this->Superclass::RequestData(request, inputVector, outputVector);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMapToRGBA::ThreadedRequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* vtkNotUsed(outputVector),
+  vtkImageData*** inData,
+  vtkImageData** outData,
+  int outExt[6], int vtkNotUsed(threadId))
+{
+  vtkImageData* input = inData[0][0];
+  vtkImageData* output = outData[0];
+  void* inPtr = input->GetScalarPointerForExtent(outExt);
+  unsigned char* outPtr =
+    static_cast<unsigned char*>(output->GetScalarPointerForExtent(outExt));
+  if (!inPtr || !outPtr)
+    {
+    return;
+    }
+
+  switch (input->GetScalarType())
+    {
+    vtkTemplateMacro(
+      vtkImageMapToRGBAExecute(this->LookupTable, input,
+                               static_cast<VTK_TT*>(inPtr), output, outPtr,
+                               outExt));
+    default:
+      vtkErrorMacro(<< "Execute: Unknown input ScalarType");
+      return;
+    }
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImageMapToRGBA::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  if (this->ColorFunction && this->ColorFunction->GetMTime() > mTime)
+    {
+    mTime = this->ColorFunction->GetMTime();
+    }
+  if (this->OpacityFunction && this->OpacityFunction->GetMTime() > mTime)
+    {
+    mTime = this->OpacityFunction->GetMTime();
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMapToRGBA::UpdateLookupTable(void)
+{
+  // Only rebuilds the entries affected by changes since the last execution,
+  // however many times the functions were modified in between
+  this->LookupTable->SetColorFunction(this->ColorFunction);
+  this->LookupTable->SetOpacityFunction(this->OpacityFunction);
+  this->LookupTable->SetNumberOfColors(this->NumberOfColors);
+  this->LookupTable->Build();
 }
@@ -25,33 +25,37 @@
 // same color and opacity functions to the slice. The output of
 // this filter is a vtkImageData.
 //
-// This class leverages the vtkImageMapToColors functionality by supporting
-// vtkPiecewiseFunction for opacity values.
+// The functions are sampled into a flat RGBA8 table (see
+// vtkRGBATransferTable) that the threaded per-scalar-type kernels index
+// straight into the output buffer. 8 and 16 bit integer scalars are mapped
+// through a table with one entry per possible value, without any floating
+// point conversion.
 //
 // .SECTION see also
 // vtkLookupTable vtkColorTransferFunction vtkPiecewiseFunction
-// vtkImageMapToColors
+// vtkImageMapToColors vtkRGBATransferTable
 
 #ifndef __vtkImageMapToRGBA_h
 #define __vtkImageMapToRGBA_h
 
-#include <vtkImageAlgorithm.h>
+#include <vtkThreadedImageAlgorithm.h>
 #include <vtkColorTransferFunction.h>
 #include <vtkPiecewiseFunction.h>
 
 // Forward declarations
+class vtkImageData;
 class vtkInformation;
 class vtkInformationVector;
-class vtkLookupTable;
+class vtkRGBATransferTable;
 
-class vtkImageMapToRGBA : public vtkImageAlgorithm
+class vtkImageMapToRGBA : public vtkThreadedImageAlgorithm
 {
 public:
-  vtkTypeMacro(vtkImageMapToRGBA, vtkAlgorithm);
+  vtkTypeMacro(vtkImageMapToRGBA, vtkThreadedImageAlgorithm);
   void PrintSelf(ostream &os, vtkIndent indent);
 
   // Description:
-  // Create a default vtkLookupTable with 256 colors and
+  // Create a default lookup table with 256 colors and
   // values ranging from 0.0 to 1.0
   static vtkImageMapToRGBA* New();
 
@@ -71,25 +75,58 @@ public:
   vtkSetMacro(NumberOfColors, int);
   vtkGetMacro(NumberOfColors, int);
 
+  // Description:
+  // When on, 8 and 16 bit integer inputs are mapped through a table with
+  // one entry per integer value of the input's type, sampled exactly from
+  // the functions instead of from NumberOfColors bins. Only the integers in
+  // the ranges of clamped functions are sampled, the others take the values
+  // of the range ends. Sharp steps in the functions are then preserved at
+  // no extra cost per pixel.
+  // Other scalar types ignore this flag. (default: off)
+  vtkSetMacro(ExactIntegerMapping, int);
+  vtkGetMacro(ExactIntegerMapping, int);
+  vtkBooleanMacro(ExactIntegerMapping, int);
+
+  // Description:
+  // Include the functions' modification times, so that editing a function
+  // re-executes the filter on the next update
+  unsigned long GetMTime();
+
 protected:
   vtkImageMapToRGBA();
   ~vtkImageMapToRGBA();
 
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector);
+
   // Description:
-  // This is called by the superclass
+  // Bring the lookup table up to date before the threads start
   virtual int RequestData(vtkInformation* request,
                           vtkInformationVector** inputVector,
                           vtkInformationVector* outputVector);
 
   // Description:
-  // Update internal lookup table based on functions provided
+  // This is called by the superclass for each piece of the output
+  virtual void ThreadedRequestData(vtkInformation* request,
+                                   vtkInformationVector** inputVector,
+                                   vtkInformationVector* outputVector,
+                                   vtkImageData*** inData,
+                                   vtkImageData** outData,
+                                   int outExt[6], int threadId);
+
+  // Description:
+  // Bring the internal lookup table up to date with the functions. Called
+  // once per execution, so that function edits between two renders are
+  // coalesced into a single rebuild.
   void UpdateLookupTable(void);
 
   vtkColorTransferFunction* ColorFunction;
   vtkPiecewiseFunction* OpacityFunction;
-  vtkLookupTable* LookupTable;
+  vtkRGBATransferTable* LookupTable;
 
   int NumberOfColors;
+  int ExactIntegerMapping;
 
 private:
   vtkImageMapToRGBA(const vtkImageMapToRGBA&); // Not implemented
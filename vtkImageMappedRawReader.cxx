@@ -0,0 +1,361 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMappedRawReader.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageMappedRawReader.h"
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationObjectBaseKey.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+vtkStandardNewMacro(vtkImageMappedRawReader);
+vtkInformationKeyMacro(vtkImageMappedRawReader, MAPPED_FILE, ObjectBase);
+
+static const char vtkImageMappedRawMagic[8] =
+  { 'V', 'T', 'K', 'M', 'R', 'A', 'W', '1' };
+static const vtkTypeUInt32 vtkImageMappedRawByteOrderMark = 0x01020304;
+static const vtkTypeInt64 vtkImageMappedRawDataOffset = 4096;
+
+//-----------------------------------------------------------------------------
+static int vtkImageMappedRawIsScalarType(int type)
+{
+  switch (type)
+    {
+    vtkTemplateMacro(return 1);
+    }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// A whole file mapped read only, or copy on write, unmapped when the last
+// scalars using it are deleted
+class vtkImageMappedRawFile : public vtkObject
+{
+public:
+  static vtkImageMappedRawFile* New();
+  vtkTypeMacro(vtkImageMappedRawFile, vtkObject);
+
+  // Map the file, return 0 on error
+  int Open(const char* fileName, int copyOnWrite)
+    {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+      {
+      return 0;
+      }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+      {
+      CloseHandle(file);
+      return 0;
+      }
+    HANDLE mapping =
+      CreateFileMappingA(file, NULL,
+                         copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY,
+                         0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+      {
+      return 0;
+      }
+    void* data = MapViewOfFile(
+      mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+      {
+      return 0;
+      }
+    this->Size = size.QuadPart;
+#else
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+      {
+      return 0;
+      }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+      {
+      close(fd);
+      return 0;
+      }
+    void* data = mmap(NULL, static_cast<size_t>(st.st_size),
+                      copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+      {
+      return 0;
+      }
+    this->Size = st.st_size;
+#endif
+    this->Data = static_cast<char*>(data);
+    return 1;
+    }
+
+  char* Data;
+  vtkTypeInt64 Size;
+
+protected:
+  vtkImageMappedRawFile() : Data(NULL), Size(0) {}
+  ~vtkImageMappedRawFile()
+    {
+    if (this->Data)
+      {
+#if defined(_WIN32)
+      UnmapViewOfFile(this->Data);
+#else
+      munmap(this->Data, static_cast<size_t>(this->Size));
+#endif
+      }
+    }
+
+private:
+  vtkImageMappedRawFile(const vtkImageMappedRawFile&); // Not implemented
+  void operator=(const vtkImageMappedRawFile&); // Not implemented
+};
+
+vtkStandardNewMacro(vtkImageMappedRawFile);
+
+//-----------------------------------------------------------------------------
+vtkImageMappedRawReader::vtkImageMappedRawReader()
+{
+  this->FileName = NULL;
+  this->File = NULL;
+  this->CopyOnWrite = 0;
+  this->SetNumberOfInputPorts(0);
+}
+
+//-----------------------------------------------------------------------------
+vtkImageMappedRawReader::~vtkImageMappedRawReader()
+{
+  this->SetFileName(NULL);
+  if (this->File)
+    {
+    this->File->Delete();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMappedRawReader::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(none)") << "\n";
+  os << indent << "CopyOnWrite: " << this->CopyOnWrite << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMappedRawReader::InitializeHeader(
+  vtkImageMappedRawHeader* header, int scalarType, int numberOfComponents,
+  const int extent[6], const double origin[3], const double spacing[3])
+{
+  memset(header, 0, sizeof(vtkImageMappedRawHeader));
+  memcpy(header->Magic, vtkImageMappedRawMagic, 8);
+  header->ByteOrderMark = vtkImageMappedRawByteOrderMark;
+  header->ScalarType = scalarType;
+  header->NumberOfComponents = numberOfComponents;
+  vtkTypeInt64 numberOfValues = numberOfComponents;
+  for (int i = 0; i < 3; ++i)
+    {
+    header->Extent[2*i] = extent[2*i];
+    header->Extent[2*i+1] = extent[2*i+1];
+    header->Origin[i] = origin[i];
+    header->Spacing[i] = spacing[i];
+    numberOfValues *= (extent[2*i] <= extent[2*i+1] ?
+                       extent[2*i+1] - extent[2*i] + 1 : 0);
+    }
+  header->DataOffset = vtkImageMappedRawDataOffset;
+  header->DataSize = numberOfValues*vtkDataArray::GetDataTypeSize(scalarType);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMappedRawReader::ValidateHeader(
+  const vtkImageMappedRawHeader* header, vtkTypeInt64 fileSize)
+{
+  if (memcmp(header->Magic, vtkImageMappedRawMagic, 8) != 0 ||
+      header->ByteOrderMark != vtkImageMappedRawByteOrderMark ||
+      header->NumberOfComponents < 1 ||
+      !vtkImageMappedRawIsScalarType(header->ScalarType) ||
+      header->DataOffset < static_cast<vtkTypeInt64>(sizeof(*header)) ||
+      header->DataOffset % vtkImageMappedRawDataOffset != 0)
+    {
+    return 0;
+    }
+
+  vtkImageMappedRawHeader expected;
+  int extent[6];
+  double origin[3], spacing[3];
+  for (int i = 0; i < 6; ++i)
+    {
+    extent[i] = header->Extent[i];
+    }
+  std::copy(header->Origin, header->Origin + 3, origin);
+  std::copy(header->Spacing, header->Spacing + 3, spacing);
+  vtkImageMappedRawReader::InitializeHeader(
+    &expected, header->ScalarType, header->NumberOfComponents, extent,
+    origin, spacing);
+  return (header->DataSize == expected.DataSize &&
+          header->DataOffset + header->DataSize <= fileSize);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMappedRawReader::CanReadFile(const char* fileName)
+{
+  if (!fileName)
+    {
+    return 0;
+    }
+  std::ifstream file(fileName, std::ios::in | std::ios::binary);
+  vtkImageMappedRawHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+    return 0;
+    }
+  file.seekg(0, std::ios::end);
+  return vtkImageMappedRawReader::ValidateHeader(
+    &header, static_cast<vtkTypeInt64>(file.tellg()));
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMappedRawReader::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  // Map the file again in case it was replaced, this costs no read
+  if (this->File)
+    {
+    this->File->Delete();
+    this->File = NULL;
+    }
+  if (!this->FileName)
+    {
+    vtkErrorMacro(<< "No FileName set");
+    return 0;
+    }
+  vtkImageMappedRawFile* file = vtkImageMappedRawFile::New();
+  if (!file->Open(this->FileName, this->CopyOnWrite))
+    {
+    vtkErrorMacro(<< "Cannot map " << this->FileName);
+    file->Delete();
+    return 0;
+    }
+  const vtkImageMappedRawHeader* header =
+    reinterpret_cast<const vtkImageMappedRawHeader*>(file->Data);
+  if (file->Size < static_cast<vtkTypeInt64>(sizeof(*header)) ||
+      !vtkImageMappedRawReader::ValidateHeader(header, file->Size))
+    {
+    vtkErrorMacro(<< this->FileName << " is not a valid .mraw file");
+    file->Delete();
+    return 0;
+    }
+  this->File = file;
+
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  int extent[6];
+  for (int i = 0; i < 6; ++i)
+    {
+    extent[i] = header->Extent[i];
+    }
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
+  outInfo->Set(vtkDataObject::ORIGIN(), header->Origin, 3);
+  outInfo->Set(vtkDataObject::SPACING(), header->Spacing, 3);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, header->ScalarType,
+                                              header->NumberOfComponents);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMappedRawReader::RequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkImageData* output = vtkImageData::GetData(outInfo);
+  if (!this->File)
+    {
+    vtkErrorMacro(<< "The file is not mapped");
+    return 0;
+    }
+  const vtkImageMappedRawHeader* header =
+    reinterpret_cast<const vtkImageMappedRawHeader*>(this->File->Data);
+
+  int wholeExt[6], updateExt[6];
+  for (int i = 0; i < 6; ++i)
+    {
+    wholeExt[i] = header->Extent[i];
+    }
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), updateExt);
+
+  // A slab of whole slices is contiguous, anything else is served by the
+  // whole extent
+  int extent[6];
+  std::copy(wholeExt, wholeExt + 6, extent);
+  if (updateExt[0] <= wholeExt[0] && updateExt[1] >= wholeExt[1] &&
+      updateExt[2] <= wholeExt[2] && updateExt[3] >= wholeExt[3] &&
+      updateExt[4] <= updateExt[5])
+    {
+    extent[4] = std::max(updateExt[4], wholeExt[4]);
+    extent[5] = std::min(updateExt[5], wholeExt[5]);
+    }
+  if (extent[4] > extent[5])
+    {
+    std::copy(wholeExt, wholeExt + 6, extent);
+    }
+
+  vtkIdType rowValues = static_cast<vtkIdType>(header->NumberOfComponents)*
+    (wholeExt[1] - wholeExt[0] + 1);
+  vtkIdType sliceValues = rowValues*(wholeExt[3] - wholeExt[2] + 1);
+  vtkIdType numberOfValues = sliceValues*(extent[5] - extent[4] + 1);
+  if (wholeExt[0] > wholeExt[1] || wholeExt[2] > wholeExt[3] ||
+      wholeExt[4] > wholeExt[5])
+    {
+    numberOfValues = 0;
+    }
+  vtkIdType offset = sliceValues*(extent[4] - wholeExt[4])*
+    vtkDataArray::GetDataTypeSize(header->ScalarType);
+
+  vtkDataArray* scalars = vtkDataArray::CreateDataArray(header->ScalarType);
+  scalars->SetName("Scalars");
+  scalars->SetNumberOfComponents(header->NumberOfComponents);
+  scalars->SetVoidArray(this->File->Data + header->DataOffset + offset,
+                        numberOfValues, 1);
+  scalars->GetInformation()->Set(vtkImageMappedRawReader::MAPPED_FILE(),
+                                 this->File);
+
+  output->SetExtent(extent);
+  output->GetPointData()->SetScalars(scalars);
+  scalars->Delete();
+  return 1;
+}
@@ -0,0 +1,132 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMappedRawReader.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageMappedRawReader - read a raw volume file by mapping it in
+// memory, without copying the voxels.
+//
+// .SECTION Description
+// vtkImageMappedRawReader reads the .mraw files written by
+// vtkImageMappedRawWriter. Such a file is a vtkImageMappedRawHeader, padded
+// to DataOffset bytes, followed by the uncompressed scalars of the image in
+// VTK order. The reader maps the file in memory and wraps the scalars of its
+// output around the mapping, so producing the output costs no read and no
+// copy: the pages are loaded by the operating system when first touched,
+// and are shared through the page cache by all the processes mapping the
+// same file.
+//
+// The file is mapped read only, so writing to the output scalars crashes.
+// With CopyOnWrite on, filters modifying the scalars in place only
+// duplicate the pages they write to, at the cost of commit charge for the
+// whole file. The mapping stays alive as long as the output scalars, even
+// after the reader is deleted.
+//
+// When the update extent spans whole x rows and y slices, as the slabs
+// requested by vtkImageMaskedResliceToRGBA do, the output is the slab of z
+// slices covering it, which is contiguous in the file and only pages these
+// slices in. Otherwise the output is the whole extent.
+//
+// The header is stored in native byte order and is rejected when read on a
+// machine of the other endianness.
+//
+// .SECTION see also
+// vtkImageMappedRawWriter vtkXMLImageDataReader
+
+#ifndef __vtkImageMappedRawReader_h
+#define __vtkImageMappedRawReader_h
+
+#include <vtkImageAlgorithm.h>
+#include <vtkType.h>
+
+// Forward declarations
+class vtkImageMappedRawFile;
+class vtkInformation;
+class vtkInformationObjectBaseKey;
+class vtkInformationVector;
+
+// Header at the start of a .mraw file. The scalars start at DataOffset, a
+// multiple of the page size, and take DataSize bytes.
+struct vtkImageMappedRawHeader
+{
+  char Magic[8];
+  vtkTypeUInt32 ByteOrderMark;
+  vtkTypeInt32 ScalarType;
+  vtkTypeInt32 NumberOfComponents;
+  vtkTypeInt32 Extent[6];
+  vtkTypeInt32 Reserved;
+  double Origin[3];
+  double Spacing[3];
+  vtkTypeInt64 DataOffset;
+  vtkTypeInt64 DataSize;
+};
+
+class vtkImageMappedRawReader : public vtkImageAlgorithm
+{
+public:
+  static vtkImageMappedRawReader* New();
+  vtkTypeMacro(vtkImageMappedRawReader, vtkImageAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/Get the name of the file to read
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+
+  // Description:
+  // Map the file copy on write instead of read only, so that the output
+  // scalars can be modified in place. Off by default.
+  vtkSetMacro(CopyOnWrite, int);
+  vtkGetMacro(CopyOnWrite, int);
+  vtkBooleanMacro(CopyOnWrite, int);
+
+  // Description:
+  // Return 1 if the file starts with a valid header
+  static int CanReadFile(const char* fileName);
+
+  // Description:
+  // Fill a header for an image with the given scalars, or check one read
+  // from a file. ValidateHeader() returns 0 if the header is not one of a
+  // .mraw file of this machine, or if the file is shorter than its data.
+  static void InitializeHeader(vtkImageMappedRawHeader* header,
+                               int scalarType, int numberOfComponents,
+                               const int extent[6], const double origin[3],
+                               const double spacing[3]);
+  static int ValidateHeader(const vtkImageMappedRawHeader* header,
+                            vtkTypeInt64 fileSize);
+
+  // Description:
+  // Key of the output scalars information holding the mapping of the file
+  static vtkInformationObjectBaseKey* MAPPED_FILE();
+
+protected:
+  vtkImageMappedRawReader();
+  ~vtkImageMappedRawReader();
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector);
+
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  char* FileName;
+  vtkImageMappedRawFile* File;
+  int CopyOnWrite;
+
+private:
+  vtkImageMappedRawReader(const vtkImageMappedRawReader&); // Not implemented
+  void operator=(const vtkImageMappedRawReader&); // Not implemented
+};
+
+#endif //__vtkImageMappedRawReader_h
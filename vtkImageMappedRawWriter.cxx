@@ -0,0 +1,120 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMappedRawWriter.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageMappedRawWriter.h"
+
+#include "vtkImageMappedRawReader.h"
+
+#include <vtkDataArray.h>
+#include <vtkErrorCode.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+vtkStandardNewMacro(vtkImageMappedRawWriter);
+
+//-----------------------------------------------------------------------------
+vtkImageMappedRawWriter::vtkImageMappedRawWriter()
+{
+  this->FileName = NULL;
+}
+
+//-----------------------------------------------------------------------------
+vtkImageMappedRawWriter::~vtkImageMappedRawWriter()
+{
+  this->SetFileName(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMappedRawWriter::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(none)") << "\n";
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkImageMappedRawWriter::GetInput()
+{
+  return vtkImageData::SafeDownCast(this->Superclass::GetInput());
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMappedRawWriter::FillInputPortInformation(
+  int vtkNotUsed(port), vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMappedRawWriter::WriteData()
+{
+  vtkImageData* input = this->GetInput();
+  vtkDataArray* scalars =
+    (input ? input->GetPointData()->GetScalars() : NULL);
+  if (!scalars)
+    {
+    vtkErrorMacro(<< "The input has no scalars");
+    return;
+    }
+  if (!this->FileName)
+    {
+    vtkErrorMacro(<< "No FileName set");
+    return;
+    }
+
+  int extent[6];
+  double origin[3], spacing[3];
+  input->GetExtent(extent);
+  input->GetOrigin(origin);
+  input->GetSpacing(spacing);
+  vtkImageMappedRawHeader header;
+  vtkImageMappedRawReader::InitializeHeader(
+    &header, scalars->GetDataType(), scalars->GetNumberOfComponents(),
+    extent, origin, spacing);
+  if (header.DataSize != static_cast<vtkTypeInt64>(
+        scalars->GetNumberOfValues())*scalars->GetDataTypeSize())
+    {
+    vtkErrorMacro(<< "The scalars do not match the extent of the input");
+    return;
+    }
+
+  std::ofstream file(this->FileName,
+                     std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file)
+    {
+    vtkErrorMacro(<< "Cannot open " << this->FileName);
+    this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    return;
+    }
+
+  // The padding keeps the scalars page aligned in the mapping
+  std::vector<char> padding(static_cast<size_t>(header.DataOffset), 0);
+  memcpy(&padding[0], &header, sizeof(header));
+  file.write(&padding[0], static_cast<std::streamsize>(padding.size()));
+  file.write(static_cast<const char*>(scalars->GetVoidPointer(0)),
+             static_cast<std::streamsize>(header.DataSize));
+  file.close();
+  if (!file)
+    {
+    vtkErrorMacro(<< "Cannot write " << this->FileName);
+    this->SetErrorCode(vtkErrorCode::OutOfDiskSpaceError);
+    }
+}
@@ -0,0 +1,70 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMappedRawWriter.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageMappedRawWriter - write an image as an uncompressed raw
+// volume file that vtkImageMappedRawReader can map in memory.
+//
+// .SECTION Description
+// vtkImageMappedRawWriter writes the geometry and the active scalars of its
+// input to a .mraw file: a vtkImageMappedRawHeader padded to a page, then
+// the scalars as they are laid out in memory. Only the active scalars are
+// written, other point and cell arrays are dropped.
+//
+// Use it to convert a compressed .vti file once, so that the programs
+// reading the volume start without decompressing it.
+//
+// .SECTION see also
+// vtkImageMappedRawReader vtkXMLImageDataWriter
+
+#ifndef __vtkImageMappedRawWriter_h
+#define __vtkImageMappedRawWriter_h
+
+#include <vtkWriter.h>
+
+// Forward declarations
+class vtkImageData;
+class vtkInformation;
+
+class vtkImageMappedRawWriter : public vtkWriter
+{
+public:
+  static vtkImageMappedRawWriter* New();
+  vtkTypeMacro(vtkImageMappedRawWriter, vtkWriter);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/Get the name of the file to write
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+
+  // Description:
+  // Get the input to this writer
+  vtkImageData* GetInput();
+
+protected:
+  vtkImageMappedRawWriter();
+  ~vtkImageMappedRawWriter();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info);
+
+  virtual void WriteData();
+
+  char* FileName;
+
+private:
+  vtkImageMappedRawWriter(const vtkImageMappedRawWriter&); // Not implemented
+  void operator=(const vtkImageMappedRawWriter&); // Not implemented
+};
+
+#endif //__vtkImageMappedRawWriter_h
@@ -0,0 +1,432 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMaskProvider.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageMaskProvider.h"
+
+#include "vtkImageCompactMask.h"
+#include "vtkImageMappedRawReader.h"
+#include "vtkImageMappedRawWriter.h"
+#include "vtkImageParallelXMLReader.h"
+#include "vtkImageShapeMaskSource.h"
+
+#include <vtkDataArray.h>
+#include <vtkErrorCode.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkXMLImageDataReader.h>
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <io.h>
+#include <process.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+vtkStandardNewMacro(vtkImageMaskProvider);
+
+namespace
+{
+// Bump when the cache files or the key change, so that stale files are not
+// found anymore
+const vtkTypeUInt64 vtkMaskCacheVersion = 1;
+
+// 64 bit FNV-1a, stable across platforms and sessions
+class vtkMaskKeyHash
+{
+public:
+  vtkMaskKeyHash() : Value(14695981039346656037ULL) {}
+
+  void AddBytes(const void* data, size_t size)
+    {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+      {
+      this->Value = (this->Value ^ bytes[i])*1099511628211ULL;
+      }
+    }
+
+  void Add(int value) { this->AddBytes(&value, sizeof(value)); }
+
+  void Add(double value)
+    {
+    // -0.0 and 0.0 give the same mask
+    value = (value == 0.0 ? 0.0 : value);
+    this->AddBytes(&value, sizeof(value));
+    }
+
+  void Add(const int* values, int n)
+    {
+    for (int i = 0; i < n; ++i)
+      {
+      this->Add(values[i]);
+      }
+    }
+
+  void Add(const double* values, int n)
+    {
+    for (int i = 0; i < n; ++i)
+      {
+      this->Add(values[i]);
+      }
+    }
+
+  vtkTypeUInt64 Value;
+};
+
+// Create a temporary file next to fileName that no other process or
+// session uses, and return its name, or an empty string on failure
+std::string vtkMaskCacheCreateTemporary(const std::string& fileName)
+{
+#if defined(_WIN32)
+  std::ostringstream name;
+  name << fileName << "." << _getpid() << ".tmp";
+  int fd = _open(name.str().c_str(), _O_CREAT | _O_EXCL | _O_WRONLY,
+                 _S_IREAD | _S_IWRITE);
+  if (fd < 0)
+    {
+    return std::string();
+    }
+  _close(fd);
+  return name.str();
+#else
+  // mkstemp() creates the file with O_EXCL under a unique name
+  std::string name = fileName + ".XXXXXX";
+  int fd = mkstemp(&name[0]);
+  if (fd < 0)
+    {
+    return std::string();
+    }
+  // As readable by the other sessions as a file the writer creates
+  fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  close(fd);
+  return name;
+#endif
+}
+
+// Flush the contents of a file to the disk, so that moving it in place never
+// publishes a file whose data did not reach the disk yet
+bool vtkMaskCacheSync(const std::string& fileName)
+{
+#if defined(_WIN32)
+  int fd = _open(fileName.c_str(), _O_WRONLY);
+  bool synced = (fd >= 0 && _commit(fd) == 0);
+  if (fd >= 0)
+    {
+    _close(fd);
+    }
+#else
+  int fd = open(fileName.c_str(), O_WRONLY);
+  bool synced = (fd >= 0 && fsync(fd) == 0);
+  if (fd >= 0)
+    {
+    close(fd);
+    }
+#endif
+  return synced;
+}
+
+// Move a temporary file over fileName, replacing a file another session
+// cached there. On Windows a target still mapped by another session cannot
+// be replaced, it holds the same mask so the temporary file is dropped.
+bool vtkMaskCacheReplace(const std::string& tmpFileName,
+                         const std::string& fileName)
+{
+#if defined(_WIN32)
+  if (MoveFileExA(tmpFileName.c_str(), fileName.c_str(),
+                  MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+    return true;
+    }
+  if (GetFileAttributesA(fileName.c_str()) != INVALID_FILE_ATTRIBUTES)
+    {
+    remove(tmpFileName.c_str());
+    return true;
+    }
+  return false;
+#else
+  return (rename(tmpFileName.c_str(), fileName.c_str()) == 0);
+#endif
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkImageMaskProvider::vtkImageMaskProvider()
+{
+  this->MaskFileName = NULL;
+  this->CacheDirectory = NULL;
+  this->ShapeSource = vtkImageShapeMaskSource::New();
+  this->Mask = vtkImageData::New();
+  this->CompactMask = vtkImageCompactMask::New();
+  this->Provenance = NONE;
+  this->Key = 0;
+}
+
+//-----------------------------------------------------------------------------
+vtkImageMaskProvider::~vtkImageMaskProvider()
+{
+  this->SetMaskFileName(NULL);
+  this->SetCacheDirectory(NULL);
+  this->ShapeSource->Delete();
+  this->Mask->Delete();
+  this->CompactMask->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskProvider::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "MaskFileName: "
+     << (this->MaskFileName ? this->MaskFileName : "(none)") << "\n";
+  os << indent << "CacheDirectory: "
+     << (this->CacheDirectory ? this->CacheDirectory : "(none)") << "\n";
+  os << indent << "Provenance: " << this->Provenance << "\n";
+  os << indent << "ShapeSource:\n";
+  this->ShapeSource->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskProvider::IsCompatible(vtkImageData* mask,
+                                       vtkImageData* volume)
+{
+  if (!mask || !volume || !mask->GetPointData()->GetScalars() ||
+      mask->GetScalarType() != VTK_UNSIGNED_CHAR ||
+      mask->GetNumberOfScalarComponents() != 1)
+    {
+    return 0;
+    }
+
+  int maskExtent[6], volumeExtent[6];
+  mask->GetExtent(maskExtent);
+  volume->GetExtent(volumeExtent);
+  for (int i = 0; i < 6; ++i)
+    {
+    if (maskExtent[i] != volumeExtent[i])
+      {
+      return 0;
+      }
+    }
+
+  // Files store the geometry in ASCII or in single precision, so compare
+  // it up to a small fraction of a voxel
+  const double tol = 1e-6;
+  double* maskOrigin = mask->GetOrigin();
+  double* maskSpacing = mask->GetSpacing();
+  double* volumeOrigin = volume->GetOrigin();
+  double* volumeSpacing = volume->GetSpacing();
+  for (int i = 0; i < 3; ++i)
+    {
+    double spacing = fabs(volumeSpacing[i]);
+    if (fabs(maskSpacing[i] - volumeSpacing[i]) > tol*spacing ||
+        fabs(maskOrigin[i] - volumeOrigin[i]) > tol*spacing)
+      {
+      return 0;
+      }
+    }
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkImageMaskProvider::ComputeKey(vtkImageData* volume)
+{
+  vtkImageShapeMaskSource* source = this->ShapeSource;
+  vtkMaskKeyHash hash;
+  hash.AddBytes(&vtkMaskCacheVersion, sizeof(vtkMaskCacheVersion));
+  hash.Add(volume->GetExtent(), 6);
+  hash.Add(volume->GetOrigin(), 3);
+  hash.Add(volume->GetSpacing(), 3);
+  hash.Add(source->GetShapeType());
+  hash.Add(source->GetCenter(), 3);
+  hash.Add(source->GetRadius());
+  hash.Add(source->GetCylinderAxis());
+  hash.Add(source->GetBoxBounds(), 6);
+  hash.Add(source->GetNormal(), 3);
+  hash.Add(static_cast<int>(source->GetInsideValue()));
+  hash.Add(static_cast<int>(source->GetOutsideValue()));
+  return hash.Value;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkImageMaskProvider::GetCacheFileName(vtkImageData* volume)
+{
+  if (!this->CacheDirectory || !*this->CacheDirectory || !volume)
+    {
+    return std::string();
+    }
+
+  char name[32];
+  vtkTypeUInt64 key = this->ComputeKey(volume);
+  sprintf(name, "mask-%08x%08x.mraw",
+          static_cast<unsigned int>(key >> 32),
+          static_cast<unsigned int>(key & 0xffffffffU));
+  std::string fileName = this->CacheDirectory;
+  char last = fileName[fileName.size() - 1];
+  if (last != '/' && last != '\\')
+    {
+    fileName += '/';
+    }
+  return fileName + name;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskProvider::ReadMask(const char* fileName, vtkImageData* volume)
+{
+  if (vtkImageMappedRawReader::CanReadFile(fileName))
+    {
+    vtkNew<vtkImageMappedRawReader> reader;
+    reader->SetFileName(fileName);
+    reader->Update();
+    this->Mask->ShallowCopy(reader->GetOutput());
+    }
+  else
+    {
+    vtkNew<vtkImageParallelXMLReader> parallelReader;
+    if (parallelReader->CanReadFile(fileName))
+      {
+      parallelReader->SetFileName(fileName);
+      parallelReader->Update();
+      this->Mask->ShallowCopy(parallelReader->GetOutput());
+      }
+    else
+      {
+      vtkNew<vtkXMLImageDataReader> reader;
+      if (!reader->CanReadFile(fileName))
+        {
+        return 0;
+        }
+      reader->SetFileName(fileName);
+      reader->Update();
+      this->Mask->ShallowCopy(reader->GetOutput());
+      }
+    }
+
+  return vtkImageMaskProvider::IsCompatible(this->Mask, volume);
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkImageMaskProvider::GetMask(vtkImageData* volume)
+{
+  if (!volume)
+    {
+    vtkErrorMacro(<< "No volume given");
+    return NULL;
+    }
+
+  // Only the geometry of the volume is hashed, its scalars may not even
+  // be loaded yet
+  this->ShapeSource->SetInformationFromImage(volume);
+  vtkTypeUInt64 key = this->ComputeKey(volume);
+  if (this->Provenance != NONE && key == this->Key &&
+      this->MaskTime > this->GetMTime())
+    {
+    return this->Mask;
+    }
+
+  this->Provenance = NONE;
+  this->Key = key;
+  this->Mask->Initialize();
+
+  if (this->MaskFileName)
+    {
+    if (this->ReadMask(this->MaskFileName, volume))
+      {
+      this->Provenance = MASK_FILE;
+      }
+    else
+      {
+      vtkWarningMacro(<< "Ignoring " << this->MaskFileName
+                      << ": it is not a binary mask with the extent, origin"
+                      << " and spacing of the volume");
+      }
+    }
+
+  std::string cacheFileName = this->GetCacheFileName(volume);
+  if (this->Provenance == NONE && !cacheFileName.empty() &&
+      this->ReadMask(cacheFileName.c_str(), volume))
+    {
+    this->Provenance = CACHE_FILE;
+    }
+
+  if (this->Provenance == NONE)
+    {
+    this->ShapeSource->Update();
+    this->Mask->ShallowCopy(this->ShapeSource->GetOutput());
+    this->Provenance = GENERATED;
+
+    // Write to a temporary file of this process first, so that other
+    // sessions never map a partially written mask nor write the same file
+    std::string tmpFileName;
+    if (!cacheFileName.empty())
+      {
+      tmpFileName = vtkMaskCacheCreateTemporary(cacheFileName);
+      if (tmpFileName.empty())
+        {
+        vtkWarningMacro(<< "Cannot cache the mask in " << cacheFileName);
+        }
+      }
+    if (!tmpFileName.empty())
+      {
+      vtkNew<vtkImageMappedRawWriter> writer;
+      writer->SetFileName(tmpFileName.c_str());
+      writer->SetInputData(this->Mask);
+      writer->Write();
+      if (writer->GetErrorCode() != vtkErrorCode::NoError ||
+          !vtkMaskCacheSync(tmpFileName) ||
+          !vtkMaskCacheReplace(tmpFileName, cacheFileName))
+        {
+        vtkWarningMacro(<< "Cannot cache the mask in " << cacheFileName);
+        remove(tmpFileName.c_str());
+        }
+      }
+    }
+
+  this->MaskTime.Modified();
+  return this->Mask;
+}
+
+//----------------------------------------------------------------------------
+vtkImageCompactMask* vtkImageMaskProvider::GetCompactMask(
+  vtkImageData* volume)
+{
+  if (!this->GetMask(volume))
+    {
+    return NULL;
+    }
+  if (this->CompactMaskTime > this->MaskTime &&
+      this->CompactMaskTime > this->CompactMask->GetMTime())
+    {
+    return this->CompactMask;
+    }
+
+  // Shapes are encoded span by span, without going through the image
+  if (this->Provenance == GENERATED)
+    {
+    this->ShapeSource->GenerateCompactMask(this->CompactMask);
+    }
+  else if (!this->CompactMask->ImportImage(this->Mask))
+    {
+    return NULL;
+    }
+  this->CompactMaskTime.Modified();
+  return this->CompactMask;
+}
@@ -0,0 +1,135 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMaskProvider.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageMaskProvider - binary mask of a volume, loaded from disk
+// when possible and generated only when not.
+//
+// .SECTION Description
+// vtkImageMaskProvider returns the binary mask of a volume from the first
+// of these sources that works:
+//
+// 1. MaskFileName, a precomputed mask such as Data/Cylinder.vti. Files
+//    written by vtkImageMappedRawWriter are mapped in memory, .vti files
+//    are read with vtkImageParallelXMLReader or vtkXMLImageDataReader.
+// 2. The cache: a .mraw file in CacheDirectory whose name is a hash of the
+//    shape parameters of ShapeSource and of the geometry of the volume.
+//    The file is mapped in memory, so loading costs no read.
+// 3. ShapeSource, which rasterizes the shape. The mask is then written to
+//    the cache, so the next session with the same volume and shape finds
+//    it there.
+//
+// A mask is only used when it is a single component VTK_UNSIGNED_CHAR
+// image with the extent, origin and spacing of the volume. Otherwise the
+// next source is tried, with a warning for MaskFileName.
+//
+// The mask is kept until the volume geometry, the shape or the provider
+// change, and GetCompactMask() also returns it in the encoding of
+// vtkImageCompactMask.
+//
+// .SECTION see also
+// vtkImageShapeMaskSource vtkImageCompactMask vtkImageMappedRawReader
+
+#ifndef __vtkImageMaskProvider_h
+#define __vtkImageMaskProvider_h
+
+#include <vtkObject.h>
+#include <vtkType.h>
+
+#include <string>
+
+// Forward declarations
+class vtkImageCompactMask;
+class vtkImageData;
+class vtkImageShapeMaskSource;
+
+class vtkImageMaskProvider : public vtkObject
+{
+public:
+  static vtkImageMaskProvider* New();
+  vtkTypeMacro(vtkImageMaskProvider, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/Get the file of a precomputed mask (default: none)
+  vtkSetStringMacro(MaskFileName);
+  vtkGetStringMacro(MaskFileName);
+
+  // Description:
+  // Set/Get the directory generated masks are cached in (default: none, no
+  // cache)
+  vtkSetStringMacro(CacheDirectory);
+  vtkGetStringMacro(CacheDirectory);
+
+  // Description:
+  // Get the source that rasterizes the mask when it is not found on disk.
+  // Set its shape parameters, its geometry is taken from the volume.
+  vtkGetObjectMacro(ShapeSource, vtkImageShapeMaskSource);
+
+  // Description:
+  // Return the mask of a volume, NULL on error
+  vtkImageData* GetMask(vtkImageData* volume);
+
+  // Description:
+  // Return the mask of a volume as a compact mask in the encoding it is set
+  // to, NULL on error
+  vtkImageCompactMask* GetCompactMask(vtkImageData* volume);
+
+  enum
+    {
+    NONE = 0,
+    MASK_FILE,
+    CACHE_FILE,
+    GENERATED
+    };
+
+  // Description:
+  // Get where the last mask came from
+  vtkGetMacro(Provenance, int);
+
+  // Description:
+  // Return the name of the cache file of the mask of a volume, empty
+  // without CacheDirectory
+  std::string GetCacheFileName(vtkImageData* volume);
+
+  // Description:
+  // Return 1 if a mask is a single component unsigned char image with the
+  // extent, origin and spacing of a volume
+  static int IsCompatible(vtkImageData* mask, vtkImageData* volume);
+
+protected:
+  vtkImageMaskProvider();
+  ~vtkImageMaskProvider();
+
+  // Hash of the shape parameters and of the volume geometry
+  vtkTypeUInt64 ComputeKey(vtkImageData* volume);
+
+  // Read a mask file into Mask, return 1 if it is compatible with volume
+  int ReadMask(const char* fileName, vtkImageData* volume);
+
+  char* MaskFileName;
+  char* CacheDirectory;
+  vtkImageShapeMaskSource* ShapeSource;
+  vtkImageData* Mask;
+  vtkImageCompactMask* CompactMask;
+  int Provenance;
+  vtkTypeUInt64 Key;
+  vtkTimeStamp MaskTime;
+  vtkTimeStamp CompactMaskTime;
+
+private:
+  vtkImageMaskProvider(const vtkImageMaskProvider&); // Not implemented
+  void operator=(const vtkImageMaskProvider&); // Not implemented
+};
+
+#endif //__vtkImageMaskProvider_h
@@ -0,0 +1,419 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMaskedMPRToRGBA.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageMaskedMPRToRGBA.h"
+
+#include "vtkImageCompactMask.h"
+#include "vtkImageMaskedResliceToRGBA.h"
+#include "vtkRGBATransferTable.h"
+
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTimeStamp.h>
+
+vtkStandardNewMacro(vtkImageMaskedMPRToRGBA);
+vtkCxxSetObjectMacro(vtkImageMaskedMPRToRGBA, CompactMask,
+                     vtkImageCompactMask);
+
+//-----------------------------------------------------------------------------
+class vtkImageMaskedMPRToRGBAInternals
+{
+public:
+  vtkImageMaskedMPRToRGBAInternals()
+    {
+    this->Volume = NULL;
+    this->VolumeTime = 0;
+    this->Mask = NULL;
+    this->MaskTime = 0;
+    this->NumberOfStalePlanes = 0;
+    }
+
+  // One filter per slice, each reading its own shallow copies of the
+  // inputs so that they can be updated concurrently
+  vtkNew<vtkImageMaskedResliceToRGBA> Planes[3];
+  vtkNew<vtkImageData> VolumeCopies[3];
+  vtkNew<vtkImageData> MaskCopies[3];
+  vtkTimeStamp UpdateTimes[3];
+
+  // Inputs the copies were made from
+  vtkImageData* Volume;
+  unsigned long VolumeTime;
+  vtkImageData* Mask;
+  unsigned long MaskTime;
+
+  // Slices to recompute in the current execution
+  int StalePlanes[3];
+  int NumberOfStalePlanes;
+  vtkNew<vtkMultiThreader> Threader;
+};
+
+//-----------------------------------------------------------------------------
+vtkImageMaskedMPRToRGBA::vtkImageMaskedMPRToRGBA()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetNumberOfOutputPorts(3);
+
+  this->CompactMask = NULL;
+  this->InterpolationMode = vtkImageMaskedResliceToRGBA::LINEAR;
+  this->BackgroundValue = 0.0;
+  this->SlabThickness = 0.0;
+  this->SlabMode = vtkImageMaskedResliceToRGBA::SLAB_MAX;
+  this->NumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  this->NumberOfUpdatedPlanes = 0;
+  this->LookupTable = vtkRGBATransferTable::New();
+  this->Internals = new vtkImageMaskedMPRToRGBAInternals;
+  for (int c = 0; c < 3; ++c)
+    {
+    this->Crosshair[c] = 0.0;
+    }
+
+  // Rows, columns and normal of each slice, as in vtkImageReslice
+  static const double axes[3][9] = {
+    { 1, 0, 0,  0, 1, 0,  0, 0, 1 },
+    { 1, 0, 0,  0, 0, 1,  0,-1, 0 },
+    { 0, 1, 0,  0, 0, 1,  1, 0, 0 } };
+  for (int plane = 0; plane < 3; ++plane)
+    {
+    const double* a = axes[plane];
+    vtkImageMaskedResliceToRGBA* filter =
+      this->Internals->Planes[plane].GetPointer();
+    filter->SetResliceAxesDirectionCosines(a[0], a[1], a[2],
+                                           a[3], a[4], a[5],
+                                           a[6], a[7], a[8]);
+    filter->SetResliceAxesOrigin(0.0, 0.0, 0.0);
+    filter->SetLookupTable(this->LookupTable);
+    filter->SetInputData(this->Internals->VolumeCopies[plane].GetPointer());
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkImageMaskedMPRToRGBA::~vtkImageMaskedMPRToRGBA()
+{
+  this->SetCompactMask(NULL);
+  delete this->Internals;
+  this->LookupTable->Delete();
+  this->LookupTable = NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedMPRToRGBA::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Crosshair: " << this->Crosshair[0] << " "
+     << this->Crosshair[1] << " " << this->Crosshair[2] << "\n";
+  os << indent << "CompactMask: " << this->CompactMask << "\n";
+  os << indent << "InterpolationMode: " << this->InterpolationMode << "\n";
+  os << indent << "BackgroundValue: " << this->BackgroundValue << "\n";
+  os << indent << "SlabThickness: " << this->SlabThickness << "\n";
+  os << indent << "SlabMode: " << this->SlabMode << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "NumberOfUpdatedPlanes: " << this->NumberOfUpdatedPlanes
+     << "\n";
+  os << indent << "LookupTable: ";
+  this->LookupTable->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedMPRToRGBA::SetMaskInputData(vtkImageData* mask)
+{
+  this->SetInputData(1, mask);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedMPRToRGBA::SetMaskInputConnection(
+  vtkAlgorithmOutput* port)
+{
+  this->SetInputConnection(1, port);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedMPRToRGBA::SetCrosshair(double x, double y, double z)
+{
+  if (x == this->Crosshair[0] && y == this->Crosshair[1] &&
+      z == this->Crosshair[2])
+    {
+    return;
+    }
+  this->Crosshair[0] = x;
+  this->Crosshair[1] = y;
+  this->Crosshair[2] = z;
+
+  // Each slice only moves with the crosshair along its normal, the axes of
+  // the others keep their modification time
+  this->Internals->Planes[AXIAL]->SetResliceAxesOrigin(0.0, 0.0, z);
+  this->Internals->Planes[CORONAL]->SetResliceAxesOrigin(0.0, y, 0.0);
+  this->Internals->Planes[SAGITTAL]->SetResliceAxesOrigin(x, 0.0, 0.0);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMatrix4x4* vtkImageMaskedMPRToRGBA::GetResliceAxes(int plane)
+{
+  if (plane < AXIAL || plane > SAGITTAL)
+    {
+    vtkErrorMacro(<< "No slice " << plane);
+    return NULL;
+    }
+  return this->Internals->Planes[plane]->GetResliceAxes();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedMPRToRGBA::SetColorFunction(vtkColorTransferFunction* cf)
+{
+  this->LookupTable->SetColorFunction(cf);
+}
+
+//----------------------------------------------------------------------------
+vtkColorTransferFunction* vtkImageMaskedMPRToRGBA::GetColorFunction()
+{
+  return this->LookupTable->GetColorFunction();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedMPRToRGBA::SetOpacityFunction(vtkPiecewiseFunction* pwf)
+{
+  this->LookupTable->SetOpacityFunction(pwf);
+}
+
+//----------------------------------------------------------------------------
+vtkPiecewiseFunction* vtkImageMaskedMPRToRGBA::GetOpacityFunction()
+{
+  return this->LookupTable->GetOpacityFunction();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedMPRToRGBA::SetNumberOfColors(int n)
+{
+  this->LookupTable->SetNumberOfColors(n);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedMPRToRGBA::GetNumberOfColors()
+{
+  return this->LookupTable->GetNumberOfColors();
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImageMaskedMPRToRGBA::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  if (this->CompactMask && this->CompactMask->GetMTime() > mTime)
+    {
+    mTime = this->CompactMask->GetMTime();
+    }
+  if (this->LookupTable->GetMTime() > mTime)
+    {
+    mTime = this->LookupTable->GetMTime();
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedMPRToRGBA::FillInputPortInformation(
+  int port, vtkInformation* info)
+{
+  this->Superclass::FillInputPortInformation(port, info);
+  if (port == 1)
+    {
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedMPRToRGBA::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  int inExt[6];
+  double inOrigin[3], inSpacing[3];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), inExt);
+  inInfo->Get(vtkDataObject::ORIGIN(), inOrigin);
+  inInfo->Get(vtkDataObject::SPACING(), inSpacing);
+
+  // Each output has the geometry its slice filter will compute from the
+  // same volume
+  for (int plane = 0; plane < 3; ++plane)
+    {
+    vtkInformation* outInfo = outputVector->GetInformationObject(plane);
+    int outExt[6];
+    double outOrigin[3], outSpacing[3];
+    this->Internals->Planes[plane]->ComputeOutputInformation(
+      inExt, inOrigin, inSpacing, outExt, outOrigin, outSpacing);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),
+                 outExt, 6);
+    outInfo->Set(vtkDataObject::ORIGIN(), outOrigin, 3);
+    outInfo->Set(vtkDataObject::SPACING(), outSpacing, 3);
+    vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR,
+                                                4);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedMPRToRGBA::RequestUpdateExtent(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* vtkNotUsed(outputVector))
+{
+  // The three slices together span the whole inputs
+  for (int port = 0; port < 2; ++port)
+    {
+    for (int i = 0; i < inputVector[port]->GetNumberOfInformationObjects();
+         ++i)
+      {
+      vtkInformation* inInfo = inputVector[port]->GetInformationObject(i);
+      int inExt[6];
+      inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), inExt);
+      if (port == 1 && this->CompactMask)
+        {
+        inExt[1] = inExt[0] - 1;
+        }
+      inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+                  inExt, 6);
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedMPRToRGBA::ConfigurePlanes(vtkImageData* volume,
+                                              vtkImageData* mask)
+{
+  vtkImageMaskedMPRToRGBAInternals* s = this->Internals;
+  mask = (this->CompactMask ? NULL : mask);
+  int volumeChanged = (volume != s->Volume ||
+                       volume->GetMTime() != s->VolumeTime);
+  int maskChanged = (mask != s->Mask ||
+                     (mask && mask->GetMTime() != s->MaskTime));
+
+  for (int plane = 0; plane < 3; ++plane)
+    {
+    vtkImageMaskedResliceToRGBA* filter = s->Planes[plane].GetPointer();
+    if (volumeChanged)
+      {
+      s->VolumeCopies[plane]->ShallowCopy(volume);
+      filter->Modified();
+      }
+    if (maskChanged)
+      {
+      if (mask)
+        {
+        s->MaskCopies[plane]->ShallowCopy(mask);
+        filter->SetMaskInputData(s->MaskCopies[plane].GetPointer());
+        }
+      else
+        {
+        filter->SetMaskInputData(NULL);
+        }
+      filter->Modified();
+      }
+    // The setters only modify the filters whose settings differ
+    filter->SetCompactMask(this->CompactMask);
+    filter->SetInterpolationMode(this->InterpolationMode);
+    filter->SetBackgroundValue(this->BackgroundValue);
+    filter->SetSlabThickness(this->SlabThickness);
+    filter->SetSlabMode(this->SlabMode);
+    }
+
+  s->Volume = volume;
+  s->VolumeTime = volume->GetMTime();
+  s->Mask = mask;
+  s->MaskTime = (mask ? mask->GetMTime() : 0);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedMPRToRGBA::RequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkImageData* volume = vtkImageData::GetData(inputVector[0]);
+  vtkImageData* mask = vtkImageData::GetData(inputVector[1]);
+  if (!volume)
+    {
+    return 1;
+    }
+  if (mask && !this->CompactMask &&
+      mask->GetScalarType() != VTK_UNSIGNED_CHAR)
+    {
+    vtkErrorMacro(<< "Mask must be of type unsigned char, got "
+                  << mask->GetScalarTypeAsString());
+    return 0;
+    }
+
+  // The table is shared by the slices and must be up to date before they
+  // start
+  this->LookupTable->Build();
+  this->ConfigurePlanes(volume, mask);
+
+  // Only the slices whose filter changed since their last update are
+  // recomputed, each with a share of the threads
+  vtkImageMaskedMPRToRGBAInternals* s = this->Internals;
+  s->NumberOfStalePlanes = 0;
+  for (int plane = 0; plane < 3; ++plane)
+    {
+    if (s->Planes[plane]->GetMTime() > s->UpdateTimes[plane].GetMTime())
+      {
+      s->StalePlanes[s->NumberOfStalePlanes++] = plane;
+      }
+    }
+  int n = s->NumberOfStalePlanes;
+  if (n > 0)
+    {
+    int threads = this->NumberOfThreads / n;
+    for (int i = 0; i < n; ++i)
+      {
+      s->Planes[s->StalePlanes[i]]->SetNumberOfThreads(
+        threads > 1 ? threads : 1);
+      }
+    s->Threader->SetNumberOfThreads(n);
+    s->Threader->SetSingleMethod(&vtkImageMaskedMPRToRGBA::UpdatePlaneThread,
+                                 s);
+    s->Threader->SingleMethodExecute();
+    for (int i = 0; i < n; ++i)
+      {
+      s->UpdateTimes[s->StalePlanes[i]].Modified();
+      }
+    }
+  this->NumberOfUpdatedPlanes = n;
+
+  for (int plane = 0; plane < 3; ++plane)
+    {
+    vtkImageData* output = vtkImageData::GetData(outputVector, plane);
+    output->ShallowCopy(s->Planes[plane]->GetOutput());
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkImageMaskedMPRToRGBA::UpdatePlaneThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkImageMaskedMPRToRGBAInternals* s =
+    static_cast<vtkImageMaskedMPRToRGBAInternals*>(info->UserData);
+  if (info->ThreadID < s->NumberOfStalePlanes)
+    {
+    s->Planes[s->StalePlanes[info->ThreadID]]->Update();
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
@@ -0,0 +1,193 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMaskedMPRToRGBA.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageMaskedMPRToRGBA - compute the axial, coronal and sagittal
+// masked RGBA slices through a crosshair together.
+//
+// .SECTION Description
+// vtkImageMaskedMPRToRGBA produces the three orthogonal slices of a
+// multi-planar reconstruction on its three output ports, AXIAL, CORONAL and
+// SAGITTAL, each one the output of vtkImageMaskedResliceToRGBA through the
+// Crosshair point. The inputs are the same as those of
+// vtkImageMaskedResliceToRGBA: the volume, and a binary mask image on port
+// 1 or a compact mask.
+//
+// The three slices share one vtkRGBATransferTable, whose functions are
+// sampled once per change. Each slice only depends on the coordinate of
+// the crosshair along its normal, so moving the crosshair recomputes only
+// the slices whose plane moved, and changing the inputs or the settings
+// recomputes all of them. The slices to recompute are computed
+// concurrently, each on its share of the threads.
+//
+// The slices are in the coordinate frame of their reslice axes, which
+// GetResliceAxes() returns, e.g. to be set as the user matrix of an image
+// actor. Rows and columns run along x and y for the axial slice, x and z
+// for the coronal one, y and z for the sagittal one. The whole inputs are
+// requested, as the three planes together span them.
+//
+// .SECTION see also
+// vtkImageMaskedResliceToRGBA vtkRGBATransferTable
+
+#ifndef __vtkImageMaskedMPRToRGBA_h
+#define __vtkImageMaskedMPRToRGBA_h
+
+#include <vtkImageAlgorithm.h>
+#include <vtkMultiThreader.h> // For VTK_THREAD_RETURN_TYPE
+
+// Forward declarations
+class vtkAlgorithmOutput;
+class vtkColorTransferFunction;
+class vtkImageCompactMask;
+class vtkImageData;
+class vtkImageMaskedMPRToRGBAInternals;
+class vtkInformation;
+class vtkInformationVector;
+class vtkMatrix4x4;
+class vtkPiecewiseFunction;
+class vtkRGBATransferTable;
+
+class vtkImageMaskedMPRToRGBA : public vtkImageAlgorithm
+{
+public:
+  static vtkImageMaskedMPRToRGBA* New();
+  vtkTypeMacro(vtkImageMaskedMPRToRGBA, vtkImageAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Output ports of the slices
+  enum
+    {
+    AXIAL = 0,
+    CORONAL,
+    SAGITTAL
+    };
+
+  // Description:
+  // Set the binary mask. The mask must be of type VTK_UNSIGNED_CHAR.
+  void SetMaskInputData(vtkImageData* mask);
+  void SetMaskInputConnection(vtkAlgorithmOutput* port);
+
+  // Description:
+  // Set/Get a compact mask to use instead of the mask input
+  virtual void SetCompactMask(vtkImageCompactMask* mask);
+  vtkGetObjectMacro(CompactMask, vtkImageCompactMask);
+
+  // Description:
+  // Set/Get the point in world coordinates the three slices go through
+  void SetCrosshair(double x, double y, double z);
+  void SetCrosshair(const double point[3])
+    { this->SetCrosshair(point[0], point[1], point[2]); }
+  vtkGetVector3Macro(Crosshair, double);
+
+  // Description:
+  // Get the reslice axes of a slice, AXIAL, CORONAL or SAGITTAL
+  vtkMatrix4x4* GetResliceAxes(int plane);
+
+  // Description:
+  // Set/Get the interpolation mode of the volume, NEAREST or LINEAR of
+  // vtkImageMaskedResliceToRGBA (default: linear)
+  vtkSetClampMacro(InterpolationMode, int, 0, 1);
+  vtkGetMacro(InterpolationMode, int);
+
+  // Description:
+  // Set/Get the scalar value whose color is given to masked out pixels
+  vtkSetMacro(BackgroundValue, double);
+  vtkGetMacro(BackgroundValue, double);
+
+  // Description:
+  // Set/Get the thickness and the mode of the slabs, see
+  // vtkImageMaskedResliceToRGBA (default: 0, a single slice)
+  vtkSetClampMacro(SlabThickness, double, 0.0, VTK_DOUBLE_MAX);
+  vtkGetMacro(SlabThickness, double);
+  vtkSetClampMacro(SlabMode, int, 0, 2);
+  vtkGetMacro(SlabMode, int);
+
+  // Description:
+  // Set/Get the number of threads shared by the slices computed together
+  // (default: the global default of vtkMultiThreader)
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  // Description:
+  // Set/Get the color transfer function
+  void SetColorFunction(vtkColorTransferFunction* cf);
+  vtkColorTransferFunction* GetColorFunction();
+
+  // Description:
+  // Set/Get the opacity function
+  void SetOpacityFunction(vtkPiecewiseFunction* pwf);
+  vtkPiecewiseFunction* GetOpacityFunction();
+
+  // Description:
+  // Set/Get number of colors the functions are sampled with (default: 256)
+  void SetNumberOfColors(int n);
+  int GetNumberOfColors();
+
+  // Description:
+  // Get the table the functions are sampled into, shared by the slices
+  vtkGetObjectMacro(LookupTable, vtkRGBATransferTable);
+
+  // Description:
+  // Get the number of slices the last execution recomputed
+  vtkGetMacro(NumberOfUpdatedPlanes, int);
+
+  // Description:
+  // Include the compact mask and lookup table modification times
+  unsigned long GetMTime();
+
+protected:
+  vtkImageMaskedMPRToRGBA();
+  ~vtkImageMaskedMPRToRGBA();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info);
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector);
+
+  virtual int RequestUpdateExtent(vtkInformation* request,
+                                  vtkInformationVector** inputVector,
+                                  vtkInformationVector* outputVector);
+
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  // Description:
+  // Hand the inputs and settings to the slice filters, shallow copying the
+  // inputs again only when they changed
+  void ConfigurePlanes(vtkImageData* volume, vtkImageData* mask);
+
+  // Description:
+  // Update one of the slices to recompute, on a thread of its own
+  static VTK_THREAD_RETURN_TYPE UpdatePlaneThread(void* arg);
+
+  vtkImageCompactMask* CompactMask;
+  double Crosshair[3];
+  int InterpolationMode;
+  double BackgroundValue;
+  double SlabThickness;
+  int SlabMode;
+  int NumberOfThreads;
+  int NumberOfUpdatedPlanes;
+  vtkRGBATransferTable* LookupTable;
+
+  vtkImageMaskedMPRToRGBAInternals* Internals;
+
+private:
+  vtkImageMaskedMPRToRGBA(const vtkImageMaskedMPRToRGBA&); // Not implemented
+  void operator=(const vtkImageMaskedMPRToRGBA&); // Not implemented
+};
+
+#endif //__vtkImageMaskedMPRToRGBA_h
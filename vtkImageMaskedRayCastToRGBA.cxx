@@ -0,0 +1,617 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMaskedRayCastToRGBA.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageMaskedRayCastToRGBA.h"
+
+#include "vtkImageMacrocellGrid.h"
+#include "vtkRGBATransferTable.h"
+
+#include <vtkCamera.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+#include <cmath>
+
+vtkStandardNewMacro(vtkImageMaskedRayCastToRGBA);
+vtkCxxSetObjectMacro(vtkImageMaskedRayCastToRGBA, Camera, vtkCamera);
+
+//-----------------------------------------------------------------------------
+// Everything the per-thread kernel needs, gathered once per thread
+struct vtkImageMaskedRayCastParameters
+{
+  const double* RayMatrix;
+  int Size[2];
+
+  int Extent[6];
+  vtkIdType Increments[3];
+  double Spacing[3];
+  int Linear;
+
+  const unsigned char* Mask;
+  vtkIdType MaskIncrements[3];
+
+  // Box the rays are clipped to, in continuous indices
+  double Box[6];
+  double SampleDistance;
+
+  const vtkRGBATransferTable* Table;
+  const unsigned char* TableEntries;
+  const float* SampleTable;
+
+  // Grid of bricks, NULL when empty space is not skipped
+  const vtkImageMacrocellGrid* Grid;
+  int BrickSize;
+  int GridDimensions[3];
+};
+
+//-----------------------------------------------------------------------------
+// Sample the volume at a continuous index inside the extent
+template <class T>
+static inline double vtkRayCastSample(
+  const T* ptr, const double x[3], const vtkImageMaskedRayCastParameters& p)
+{
+  const int* ext = p.Extent;
+  const vtkIdType* inc = p.Increments;
+  if (!p.Linear)
+    {
+    vtkIdType offset = 0;
+    for (int c = 0; c < 3; ++c)
+      {
+      int i = vtkMath::Floor(x[c] + 0.5);
+      i = (i < ext[2*c] ? ext[2*c] : (i > ext[2*c+1] ? ext[2*c+1] : i));
+      offset += (i - ext[2*c])*inc[c];
+      }
+    return ptr[offset];
+    }
+
+  vtkIdType offset[2][3];
+  double f[3];
+  for (int c = 0; c < 3; ++c)
+    {
+    double lo = ext[2*c];
+    double hi = ext[2*c+1];
+    double xc = (x[c] < lo ? lo : (x[c] > hi ? hi : x[c]));
+    int i0 = vtkMath::Floor(xc);
+    int i1 = (i0 < ext[2*c+1] ? i0 + 1 : i0);
+    f[c] = xc - i0;
+    offset[0][c] = (i0 - ext[2*c])*inc[c];
+    offset[1][c] = (i1 - ext[2*c])*inc[c];
+    }
+  double v[2][2][2];
+  for (int k = 0; k < 2; ++k)
+    {
+    for (int j = 0; j < 2; ++j)
+      {
+      const T* row = ptr + offset[k][2] + offset[j][1];
+      v[k][j][0] = row[offset[0][0]];
+      v[k][j][1] = row[offset[1][0]];
+      }
+    }
+  double v00 = v[0][0][0] + f[0]*(v[0][0][1] - v[0][0][0]);
+  double v01 = v[0][1][0] + f[0]*(v[0][1][1] - v[0][1][0]);
+  double v10 = v[1][0][0] + f[0]*(v[1][0][1] - v[1][0][0]);
+  double v11 = v[1][1][0] + f[0]*(v[1][1][1] - v[1][1][0]);
+  double v0 = v00 + f[1]*(v01 - v00);
+  double v1 = v10 + f[1]*(v11 - v10);
+  return v0 + f[2]*(v1 - v0);
+}
+
+//-----------------------------------------------------------------------------
+// Map a point in normalized device coordinates to a continuous index
+static inline void vtkRayCastUnproject(const double m[16], double x,
+                                       double y, double z, double out[3])
+{
+  double w = m[12]*x + m[13]*y + m[14]*z + m[15];
+  for (int c = 0; c < 3; ++c)
+    {
+    out[c] = (m[4*c]*x + m[4*c+1]*y + m[4*c+2]*z + m[4*c+3]) / w;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Clip the segment start + s*dir, s in [s0, s1], to a box. Returns 0 when
+// the segment misses it.
+static inline int vtkRayCastClip(const double start[3], const double dir[3],
+                                 const double box[6], double& s0,
+                                 double& s1)
+{
+  for (int c = 0; c < 3; ++c)
+    {
+    if (dir[c] == 0.0)
+      {
+      if (start[c] < box[2*c] || start[c] > box[2*c+1])
+        {
+        return 0;
+        }
+      continue;
+      }
+    double a = (box[2*c] - start[c]) / dir[c];
+    double b = (box[2*c+1] - start[c]) / dir[c];
+    s0 = std::max(s0, std::min(a, b));
+    s1 = std::min(s1, std::max(a, b));
+    }
+  return (s0 <= s1);
+}
+
+//-----------------------------------------------------------------------------
+template <class T>
+static vtkIdType vtkImageMaskedRayCastExecute(
+  const vtkImageMaskedRayCastParameters& p, const T* inPtr,
+  vtkImageData* output, int outExt[6])
+{
+  vtkIdType numSamples = 0;
+  const int* ext = p.Extent;
+  const int brickSize = p.BrickSize;
+  for (int j = outExt[2]; j <= outExt[3]; ++j)
+    {
+    unsigned char* outPtr = static_cast<unsigned char*>(
+      output->GetScalarPointer(outExt[0], j, 0));
+    double y = 2.0*(j + 0.5)/p.Size[1] - 1.0;
+    for (int i = outExt[0]; i <= outExt[1]; ++i, outPtr += 4)
+      {
+      double x = 2.0*(i + 0.5)/p.Size[0] - 1.0;
+      double start[3], end[3], dir[3];
+      vtkRayCastUnproject(p.RayMatrix, x, y, -1.0, start);
+      vtkRayCastUnproject(p.RayMatrix, x, y, 1.0, end);
+      double length = 0.0;
+      for (int c = 0; c < 3; ++c)
+        {
+        dir[c] = end[c] - start[c];
+        length += dir[c]*p.Spacing[c]*dir[c]*p.Spacing[c];
+        }
+      length = sqrt(length);
+
+      // Samples lie at multiples of the sample distance from the near
+      // plane, whichever part of the ray is skipped
+      double color[3] = { 0.0, 0.0, 0.0 };
+      double alpha = 0.0;
+      double s0 = 0.0;
+      double s1 = 1.0;
+      if (length > 0.0 && vtkRayCastClip(start, dir, p.Box, s0, s1))
+        {
+        double ds = p.SampleDistance / length;
+        vtkIdType k1 = static_cast<vtkIdType>(floor(s1 / ds));
+        for (vtkIdType k = static_cast<vtkIdType>(ceil(s0 / ds)); k <= k1;
+             ++k)
+          {
+          double s = k*ds;
+          double pos[3];
+          for (int c = 0; c < 3; ++c)
+            {
+            pos[c] = start[c] + s*dir[c];
+            }
+
+          if (p.Grid)
+            {
+            int brick[3];
+            for (int c = 0; c < 3; ++c)
+              {
+              int b = vtkMath::Floor((pos[c] - ext[2*c]) / brickSize);
+              brick[c] = (b < 0 ? 0 : (b >= p.GridDimensions[c] ?
+                                       p.GridDimensions[c] - 1 : b));
+              }
+            if (!p.Grid->IsBrickVisible(brick[0], brick[1], brick[2]))
+              {
+              // Jump to the first sample past the brick
+              double exit = VTK_DOUBLE_MAX;
+              for (int c = 0; c < 3; ++c)
+                {
+                if (dir[c] != 0.0)
+                  {
+                  double side = ext[2*c] +
+                    (brick[c] + (dir[c] > 0.0 ? 1 : 0))*brickSize;
+                  exit = std::min(exit, (side - start[c]) / dir[c]);
+                  }
+                }
+              vtkIdType next = static_cast<vtkIdType>(ceil(exit / ds));
+              k = (next > k ? next - 1 : k);
+              continue;
+              }
+            }
+
+          if (p.Mask)
+            {
+            vtkIdType offset = 0;
+            for (int c = 0; c < 3; ++c)
+              {
+              int m = vtkMath::Floor(pos[c] + 0.5);
+              m = (m < ext[2*c] ? ext[2*c] : (m > ext[2*c+1] ?
+                                              ext[2*c+1] : m));
+              offset += (m - ext[2*c])*p.MaskIncrements[c];
+              }
+            if (!p.Mask[offset])
+              {
+              continue;
+              }
+            }
+
+          ++numSamples;
+          double value = vtkRayCastSample(inPtr, pos, p);
+          const float* rgba = p.SampleTable +
+            (p.Table->MapValue(value) - p.TableEntries);
+          if (rgba[3] <= 0.0f)
+            {
+            continue;
+            }
+          double w = (1.0 - alpha)*rgba[3];
+          color[0] += w*rgba[0];
+          color[1] += w*rgba[1];
+          color[2] += w*rgba[2];
+          alpha += w;
+          if (alpha > 0.99)
+            {
+            break;
+            }
+          }
+        }
+
+      for (int c = 0; c < 3; ++c)
+        {
+        outPtr[c] = static_cast<unsigned char>(
+          std::min(color[c], 1.0)*255.0 + 0.5);
+        }
+      outPtr[3] = static_cast<unsigned char>(std::min(alpha, 1.0)*255.0 + 0.5);
+      }
+    }
+  return numSamples;
+}
+
+//-----------------------------------------------------------------------------
+vtkImageMaskedRayCastToRGBA::vtkImageMaskedRayCastToRGBA()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetNumberOfOutputPorts(1);
+
+  this->Camera = NULL;
+  this->OutputSize[0] = 256;
+  this->OutputSize[1] = 256;
+  this->SampleDistance = 1.0;
+  this->ScalarOpacityUnitDistance = 1.0;
+  this->InterpolationMode = LINEAR;
+  this->UseEmptySpaceSkipping = 1;
+  this->LookupTable = vtkRGBATransferTable::New();
+  this->LookupTable->SetNumberOfColors(1024);
+  this->MacrocellGrid = vtkImageMacrocellGrid::New();
+  this->NumberOfSamples = 0;
+  for (int i = 0; i < 16; ++i)
+    {
+    this->RayMatrix[i] = (i % 5 == 0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkImageMaskedRayCastToRGBA::~vtkImageMaskedRayCastToRGBA()
+{
+  this->SetCamera(NULL);
+  this->LookupTable->Delete();
+  this->LookupTable = NULL;
+  this->MacrocellGrid->Delete();
+  this->MacrocellGrid = NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedRayCastToRGBA::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Camera: " << this->Camera << "\n";
+  os << indent << "OutputSize: " << this->OutputSize[0] << " "
+     << this->OutputSize[1] << "\n";
+  os << indent << "SampleDistance: " << this->SampleDistance << "\n";
+  os << indent << "ScalarOpacityUnitDistance: "
+     << this->ScalarOpacityUnitDistance << "\n";
+  os << indent << "InterpolationMode: " << this->InterpolationMode << "\n";
+  os << indent << "UseEmptySpaceSkipping: "
+     << this->UseEmptySpaceSkipping << "\n";
+  os << indent << "NumberOfSamples: " << this->NumberOfSamples << "\n";
+  os << indent << "LookupTable: ";
+  this->LookupTable->PrintSelf(os, indent.GetNextIndent());
+  os << indent << "MacrocellGrid: ";
+  this->MacrocellGrid->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedRayCastToRGBA::SetMaskInputData(vtkImageData* mask)
+{
+  this->SetInputData(1, mask);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedRayCastToRGBA::SetMaskInputConnection(
+  vtkAlgorithmOutput* port)
+{
+  this->SetInputConnection(1, port);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedRayCastToRGBA::SetColorFunction(
+  vtkColorTransferFunction* cf)
+{
+  this->LookupTable->SetColorFunction(cf);
+}
+
+//----------------------------------------------------------------------------
+vtkColorTransferFunction* vtkImageMaskedRayCastToRGBA::GetColorFunction()
+{
+  return this->LookupTable->GetColorFunction();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedRayCastToRGBA::SetOpacityFunction(
+  vtkPiecewiseFunction* pwf)
+{
+  this->LookupTable->SetOpacityFunction(pwf);
+}
+
+//----------------------------------------------------------------------------
+vtkPiecewiseFunction* vtkImageMaskedRayCastToRGBA::GetOpacityFunction()
+{
+  return this->LookupTable->GetOpacityFunction();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedRayCastToRGBA::SetNumberOfColors(int n)
+{
+  this->LookupTable->SetNumberOfColors(n);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedRayCastToRGBA::GetNumberOfColors()
+{
+  return this->LookupTable->GetNumberOfColors();
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImageMaskedRayCastToRGBA::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  if (this->Camera && this->Camera->GetMTime() > mTime)
+    {
+    mTime = this->Camera->GetMTime();
+    }
+  if (this->LookupTable->GetMTime() > mTime)
+    {
+    mTime = this->LookupTable->GetMTime();
+    }
+  if (this->MacrocellGrid->GetMTime() > mTime)
+    {
+    mTime = this->MacrocellGrid->GetMTime();
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedRayCastToRGBA::FillInputPortInformation(
+  int port, vtkInformation* info)
+{
+  this->Superclass::FillInputPortInformation(port, info);
+  if (port == 1)
+    {
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedRayCastToRGBA::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  int outExt[6] = { 0, this->OutputSize[0] - 1,
+                    0, this->OutputSize[1] - 1, 0, 0 };
+  double origin[3] = { 0.0, 0.0, 0.0 };
+  double spacing[3] = { 1.0, 1.0, 1.0 };
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), outExt, 6);
+  outInfo->Set(vtkDataObject::ORIGIN(), origin, 3);
+  outInfo->Set(vtkDataObject::SPACING(), spacing, 3);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedRayCastToRGBA::RequestUpdateExtent(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* vtkNotUsed(outputVector))
+{
+  // Any pixel may see any voxel
+  for (int port = 0; port < 2; ++port)
+    {
+    for (int i = 0; i < inputVector[port]->GetNumberOfInformationObjects();
+         ++i)
+      {
+      vtkInformation* inInfo = inputVector[port]->GetInformationObject(i);
+      int wholeExt[6];
+      inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),
+                  wholeExt);
+      inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+                  wholeExt, 6);
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedRayCastToRGBA::RequestData(
+  vtkInformation* request,
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkImageData* volume = vtkImageData::GetData(inputVector[0]);
+  vtkImageData* mask = vtkImageData::GetData(inputVector[1]);
+  if (!this->Camera)
+    {
+    vtkErrorMacro(<< "No camera specified");
+    return 0;
+    }
+  if (!volume || volume->GetNumberOfPoints() == 0)
+    {
+    vtkErrorMacro(<< "No volume to render");
+    return 0;
+    }
+  if (mask)
+    {
+    int extent[6], maskExtent[6];
+    volume->GetExtent(extent);
+    mask->GetExtent(maskExtent);
+    if (!std::equal(extent, extent + 6, maskExtent) ||
+        mask->GetScalarType() != VTK_UNSIGNED_CHAR)
+      {
+      vtkErrorMacro(<< "Mask must be of type unsigned char and have the "
+                    << "extent of the volume");
+      return 0;
+      }
+    }
+
+  // The table and the grid are shared by all threads and must be up to
+  // date before they start
+  this->LookupTable->Build();
+  if (this->UseEmptySpaceSkipping)
+    {
+    if (!this->MacrocellGrid->Build(volume, mask))
+      {
+      return 0;
+      }
+    this->MacrocellGrid->Classify(this->LookupTable);
+    }
+
+  const unsigned char* entries = this->LookupTable->GetTable();
+  double* range = this->LookupTable->GetRange();
+  size_t numEntries = static_cast<size_t>(
+    this->LookupTable->MapValue(range[1]) - entries) / 4 + 1;
+  double exponent = this->SampleDistance / this->ScalarOpacityUnitDistance;
+  this->SampleTable.resize(4*numEntries);
+  for (size_t e = 0; e < numEntries; ++e)
+    {
+    for (int c = 0; c < 3; ++c)
+      {
+      this->SampleTable[4*e+c] = entries[4*e+c] / 255.0f;
+      }
+    double opacity = entries[4*e+3] / 255.0;
+    this->SampleTable[4*e+3] =
+      static_cast<float>(1.0 - pow(1.0 - opacity, exponent));
+    }
+
+  // From normalized device coordinates to world coordinates, then to
+  // continuous indices
+  double aspect = static_cast<double>(this->OutputSize[0]) /
+    this->OutputSize[1];
+  double unproject[16];
+  vtkMatrix4x4::Invert(
+    *this->Camera->GetCompositeProjectionTransformMatrix(aspect, -1, 1)
+    ->Element, unproject);
+  double* origin = volume->GetOrigin();
+  double* spacing = volume->GetSpacing();
+  double toIndex[16];
+  for (int i = 0; i < 16; ++i)
+    {
+    toIndex[i] = (i % 5 == 0);
+    }
+  for (int c = 0; c < 3; ++c)
+    {
+    toIndex[5*c] = 1.0 / spacing[c];
+    toIndex[4*c+3] = -origin[c] / spacing[c];
+    }
+  vtkMatrix4x4::Multiply4x4(toIndex, unproject, this->RayMatrix);
+
+  this->ThreadSamples.assign(this->GetNumberOfThreads(), 0);
+  int ret = this->Superclass::RequestData(request, inputVector, outputVector);
+  this->NumberOfSamples = 0;
+  for (size_t t = 0; t < this->ThreadSamples.size(); ++t)
+    {
+    this->NumberOfSamples += this->ThreadSamples[t];
+    }
+  return ret;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedRayCastToRGBA::ThreadedRequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* vtkNotUsed(outputVector),
+  vtkImageData*** inData,
+  vtkImageData** outData,
+  int outExt[6], int threadId)
+{
+  vtkImageData* volume = inData[0][0];
+  vtkImageData* mask = vtkImageData::GetData(inputVector[1]);
+  vtkImageData* output = outData[0];
+  if (!volume || outExt[0] > outExt[1] || outExt[2] > outExt[3])
+    {
+    return;
+    }
+
+  vtkImageMaskedRayCastParameters p;
+  p.RayMatrix = this->RayMatrix;
+  p.Size[0] = this->OutputSize[0];
+  p.Size[1] = this->OutputSize[1];
+  volume->GetExtent(p.Extent);
+  volume->GetIncrements(p.Increments[0], p.Increments[1], p.Increments[2]);
+  volume->GetSpacing(p.Spacing);
+  p.Linear = (this->InterpolationMode == LINEAR);
+  p.Mask = NULL;
+  if (mask)
+    {
+    p.Mask = static_cast<const unsigned char*>(mask->GetScalarPointer());
+    mask->GetIncrements(p.MaskIncrements[0], p.MaskIncrements[1],
+                        p.MaskIncrements[2]);
+    }
+
+  // Trilinear samples are taken up to the last voxel, nearest mask samples
+  // up to half a voxel past the voxels inside
+  for (int c = 0; c < 3; ++c)
+    {
+    p.Box[2*c] = p.Extent[2*c];
+    p.Box[2*c+1] = p.Extent[2*c+1];
+    }
+  p.Grid = NULL;
+  p.BrickSize = 1;
+  p.GridDimensions[0] = p.GridDimensions[1] = p.GridDimensions[2] = 1;
+  if (this->UseEmptySpaceSkipping)
+    {
+    const int* bounds = this->MacrocellGrid->GetMaskBounds();
+    for (int c = 0; c < 3; ++c)
+      {
+      p.Box[2*c] = std::max(p.Box[2*c], bounds[2*c] - 0.5);
+      p.Box[2*c+1] = std::min(p.Box[2*c+1], bounds[2*c+1] + 0.5);
+      }
+    p.Grid = this->MacrocellGrid;
+    p.BrickSize = this->MacrocellGrid->GetBrickSize();
+    this->MacrocellGrid->GetGridDimensions(p.GridDimensions);
+    }
+  p.SampleDistance = this->SampleDistance;
+  p.Table = this->LookupTable;
+  p.TableEntries = this->LookupTable->GetTable();
+  p.SampleTable = &this->SampleTable[0];
+
+  vtkIdType numSamples = 0;
+  void* inPtr = volume->GetScalarPointer();
+  switch (volume->GetScalarType())
+    {
+    vtkTemplateMacro(
+      numSamples = vtkImageMaskedRayCastExecute(
+        p, static_cast<VTK_TT*>(inPtr), output, outExt));
+    default:
+      vtkErrorMacro(<< "Execute: Unknown input ScalarType");
+      return;
+    }
+  this->ThreadSamples[threadId] = numSamples;
+}
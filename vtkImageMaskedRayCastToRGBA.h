@@ -0,0 +1,197 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMaskedRayCastToRGBA.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageMaskedRayCastToRGBA - CPU volume ray caster that honours a
+// binary mask and skips empty space.
+//
+// .SECTION Description
+// vtkImageMaskedRayCastToRGBA renders a volume seen from a vtkCamera into
+// an RGBA image of OutputSize pixels, without OpenGL. It composites the
+// samples front to back like vtkGPUVolumeRayCastMapper does with a binary
+// mask: samples whose nearest mask voxel is zero are skipped, the opacity
+// of the others is corrected for SampleDistance relative to
+// ScalarOpacityUnitDistance, and rays stop once their opacity exceeds 0.99.
+// The color of the output is premultiplied by its alpha, so the image is
+// the rendering over a black background.
+//
+// The first input is the volume, the optional second input is the binary
+// mask, of type unsigned char and with the extent of the volume as the GPU
+// mapper requires.
+//
+// When UseEmptySpaceSkipping is on (the default), rays are clipped to the
+// bounding box of the voxels inside the mask before they start, and cross
+// the bricks of a vtkImageMacrocellGrid that hold no visible sample in one
+// step. Samples stay on the same positions along each ray, so the image is
+// identical with and without skipping.
+//
+// The camera clipping range is honoured: rays run from the near to the far
+// plane, so set it the way the renderer would, e.g. with
+// vtkRenderer::ResetCameraClippingRange().
+//
+// .SECTION see also
+// vtkGPUVolumeRayCastMapper vtkImageMacrocellGrid vtkRGBATransferTable
+
+#ifndef __vtkImageMaskedRayCastToRGBA_h
+#define __vtkImageMaskedRayCastToRGBA_h
+
+#include <vtkThreadedImageAlgorithm.h>
+
+#include <vector>
+
+// Forward declarations
+class vtkAlgorithmOutput;
+class vtkCamera;
+class vtkColorTransferFunction;
+class vtkImageData;
+class vtkImageMacrocellGrid;
+class vtkInformation;
+class vtkInformationVector;
+class vtkPiecewiseFunction;
+class vtkRGBATransferTable;
+
+class vtkImageMaskedRayCastToRGBA : public vtkThreadedImageAlgorithm
+{
+public:
+  static vtkImageMaskedRayCastToRGBA* New();
+  vtkTypeMacro(vtkImageMaskedRayCastToRGBA, vtkThreadedImageAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set the binary mask. The mask must be of type VTK_UNSIGNED_CHAR and
+  // have the extent of the volume.
+  void SetMaskInputData(vtkImageData* mask);
+  void SetMaskInputConnection(vtkAlgorithmOutput* port);
+
+  // Description:
+  // Set/Get the camera the volume is seen from
+  virtual void SetCamera(vtkCamera* camera);
+  vtkGetObjectMacro(Camera, vtkCamera);
+
+  // Description:
+  // Set/Get the size of the output image in pixels (default: 256 x 256)
+  vtkSetVector2Macro(OutputSize, int);
+  vtkGetVector2Macro(OutputSize, int);
+
+  // Description:
+  // Set/Get the distance between two samples along a ray, in world
+  // coordinates (default: 1)
+  vtkSetClampMacro(SampleDistance, double, 1e-6, VTK_DOUBLE_MAX);
+  vtkGetMacro(SampleDistance, double);
+
+  // Description:
+  // Set/Get the distance over which the opacity of the opacity function
+  // is reached, as vtkVolumeProperty::SetScalarOpacityUnitDistance()
+  // (default: 1)
+  vtkSetClampMacro(ScalarOpacityUnitDistance, double, 1e-6, VTK_DOUBLE_MAX);
+  vtkGetMacro(ScalarOpacityUnitDistance, double);
+
+  // Description:
+  // Set/Get the interpolation mode of the volume (default: linear). The
+  // mask is always sampled at the nearest voxel.
+  enum
+    {
+    NEAREST = 0,
+    LINEAR
+    };
+  vtkSetClampMacro(InterpolationMode, int, NEAREST, LINEAR);
+  vtkGetMacro(InterpolationMode, int);
+  void SetInterpolationModeToNearestNeighbor()
+    { this->SetInterpolationMode(NEAREST); }
+  void SetInterpolationModeToLinear()
+    { this->SetInterpolationMode(LINEAR); }
+
+  // Description:
+  // Enable/Disable skipping the bricks without visible samples and the
+  // space outside of the mask (default: on)
+  vtkSetMacro(UseEmptySpaceSkipping, int);
+  vtkGetMacro(UseEmptySpaceSkipping, int);
+  vtkBooleanMacro(UseEmptySpaceSkipping, int);
+
+  // Description:
+  // Get the grid of bricks used to skip empty space, e.g. to change the
+  // brick size
+  vtkGetObjectMacro(MacrocellGrid, vtkImageMacrocellGrid);
+
+  // Description:
+  // Set/Get the color transfer function
+  void SetColorFunction(vtkColorTransferFunction* cf);
+  vtkColorTransferFunction* GetColorFunction();
+
+  // Description:
+  // Set/Get the opacity function
+  void SetOpacityFunction(vtkPiecewiseFunction* pwf);
+  vtkPiecewiseFunction* GetOpacityFunction();
+
+  // Description:
+  // Set/Get number of colors the functions are sampled with (default: 1024)
+  void SetNumberOfColors(int n);
+  int GetNumberOfColors();
+
+  // Description:
+  // Get the number of samples taken by the last execution
+  vtkGetMacro(NumberOfSamples, vtkIdType);
+
+  // Description:
+  // Include the camera, lookup table and macrocell grid modification times
+  unsigned long GetMTime();
+
+protected:
+  vtkImageMaskedRayCastToRGBA();
+  ~vtkImageMaskedRayCastToRGBA();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info);
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector);
+
+  virtual int RequestUpdateExtent(vtkInformation* request,
+                                  vtkInformationVector** inputVector,
+                                  vtkInformationVector* outputVector);
+
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  virtual void ThreadedRequestData(vtkInformation* request,
+                                   vtkInformationVector** inputVector,
+                                   vtkInformationVector* outputVector,
+                                   vtkImageData*** inData,
+                                   vtkImageData** outData,
+                                   int outExt[6], int threadId);
+
+  vtkCamera* Camera;
+  int OutputSize[2];
+  double SampleDistance;
+  double ScalarOpacityUnitDistance;
+  int InterpolationMode;
+  int UseEmptySpaceSkipping;
+  vtkRGBATransferTable* LookupTable;
+  vtkImageMacrocellGrid* MacrocellGrid;
+  vtkIdType NumberOfSamples;
+
+  // Computed in RequestData for the threads: the matrix from normalized
+  // device coordinates to continuous volume indices, the table entries as
+  // floats with the opacity corrected for the sample distance, and the
+  // number of samples taken by each thread
+  double RayMatrix[16];
+  std::vector<float> SampleTable;
+  std::vector<vtkIdType> ThreadSamples;
+
+private:
+  vtkImageMaskedRayCastToRGBA(const vtkImageMaskedRayCastToRGBA&); // Not implemented
+  void operator=(const vtkImageMaskedRayCastToRGBA&); // Not implemented
+};
+
+#endif //__vtkImageMaskedRayCastToRGBA_h
@@ -0,0 +1,1154 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMaskedResliceToRGBA.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageMaskedResliceToRGBA.h"
+
+#include "vtkImageBrickedVolume.h"
+#include "vtkImageCompactMask.h"
+#include "vtkImagePlaneSampler.h"
+#include "vtkRGBATransferTable.h"
+
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+vtkStandardNewMacro(vtkImageMaskedResliceToRGBA);
+vtkCxxSetObjectMacro(vtkImageMaskedResliceToRGBA, ResliceAxes, vtkMatrix4x4);
+vtkCxxSetObjectMacro(vtkImageMaskedResliceToRGBA, CompactMask,
+                     vtkImageCompactMask);
+
+//-----------------------------------------------------------------------------
+// Everything the per-thread kernel needs, gathered once per thread
+struct vtkImageMaskedResliceToRGBAParameters
+{
+  double Start[3];
+  double RowStep[3];
+  double ColumnStep[3];
+  double LayerStep[3];
+  int Extent[6];
+
+  // Number of layers of the slab and how their samples are combined
+  int SlabSamples;
+  int SlabMode;
+
+  // Samplers of the volume and the mask image in the image layout
+  const vtkImagePlaneSampler* Sampler;
+  const vtkImagePlaneSampler* MaskSampler;
+
+  // Bricks the volume and the mask image are read from instead, if any
+  const vtkImageBrickedVolume* Bricks;
+  const vtkImageBrickedVolume* MaskBricks;
+  int BrickShift;
+
+  int HasMask;
+  const unsigned char* Mask;
+  const vtkImageCompactMask* CompactMask;
+  int MaskScanlineAligned;
+  double MaskStart[3];
+  double MaskRowStep[3];
+  double MaskColumnStep[3];
+  double MaskLayerStep[3];
+  int MaskExtent[6];
+
+  int Linear;
+  vtkRGBATransferTable* Table;
+  unsigned char Background[4];
+
+  // Checked before every row so that a running execution can be abandoned
+  const int* AbortExecute;
+};
+
+//-----------------------------------------------------------------------------
+// Return 1 when the nearest voxel of a continuous index lies in the extent
+static inline int vtkNearestIndex(const double x[3], const int extent[6],
+                                  int idx[3])
+{
+  for (int c = 0; c < 3; ++c)
+    {
+    if (x[c] < extent[2*c] - 0.5 || x[c] >= extent[2*c+1] + 0.5)
+      {
+      return 0;
+      }
+    idx[c] = vtkMath::Floor(x[c] + 0.5);
+    }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+// Projections of a slab, starting from the identity of their combination
+struct vtkSlabMax
+{
+  static double Identity() { return -VTK_DOUBLE_MAX; }
+  static double Combine(double total, double value)
+    {
+    return (value > total ? value : total);
+    }
+};
+
+struct vtkSlabMin
+{
+  static double Identity() { return VTK_DOUBLE_MAX; }
+  static double Combine(double total, double value)
+    {
+    return (value < total ? value : total);
+    }
+};
+
+struct vtkSlabSum
+{
+  static double Identity() { return 0.0; }
+  static double Combine(double total, double value)
+    {
+    return total + value;
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Combine the samples of a layer into the totals of a row. The samples
+// outside of the mask are replaced by the identity with a select instead of
+// skipped, so that the loop has no branch and vectorizes.
+template <class TProjection>
+static void vtkSlabAccumulateRow(const double* values,
+                                 const unsigned char* inside, int n,
+                                 double* totals, int* counts)
+{
+  for (int i = 0; i < n; ++i)
+    {
+    int in = (inside[i] != 0);
+    double value = (in ? values[i] : TProjection::Identity());
+    totals[i] = TProjection::Combine(totals[i], value);
+    counts[i] += in;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Return the identity of the combination of a slab mode
+static inline double vtkSlabIdentity(int mode)
+{
+  return (mode == vtkImageMaskedResliceToRGBA::SLAB_MAX ?
+          vtkSlabMax::Identity() :
+          (mode == vtkImageMaskedResliceToRGBA::SLAB_MIN ?
+           vtkSlabMin::Identity() : vtkSlabSum::Identity()));
+}
+
+//-----------------------------------------------------------------------------
+// Combine a sample of the slab into the samples combined so far
+static inline void vtkSlabAccumulate(int mode, double value, double& total,
+                                     int& count)
+{
+  if (mode == vtkImageMaskedResliceToRGBA::SLAB_MAX)
+    {
+    total = vtkSlabMax::Combine(total, value);
+    }
+  else if (mode == vtkImageMaskedResliceToRGBA::SLAB_MIN)
+    {
+    total = vtkSlabMin::Combine(total, value);
+    }
+  else
+    {
+    total = vtkSlabSum::Combine(total, value);
+    }
+  ++count;
+}
+
+//-----------------------------------------------------------------------------
+// Return the value of a pixel from the samples of the slab combined into it
+static inline double vtkSlabResult(int mode, double total, int count)
+{
+  return (mode == vtkImageMaskedResliceToRGBA::SLAB_MEAN ?
+          total / count : total);
+}
+
+//-----------------------------------------------------------------------------
+// Sample the volume at a continuous index, reading the voxels from bricks.
+// Return 0 outside of the extent. The eight voxels of a trilinear sample
+// are usually in the same brick, at fixed strides from the first one.
+template <class T>
+static int vtkSampleBrickedVolume(
+  const T* ptr, const double x[3],
+  const vtkImageMaskedResliceToRGBAParameters& p, double& value)
+{
+  const int* ext = p.Extent;
+  const vtkImageBrickedVolume* bricks = p.Bricks;
+
+  if (!p.Linear)
+    {
+    int idx[3];
+    if (!vtkNearestIndex(x, ext, idx))
+      {
+      return 0;
+      }
+    value = ptr[bricks->GetOffset(idx[0] - ext[0], idx[1] - ext[2],
+                                  idx[2] - ext[4])];
+    return 1;
+    }
+
+  const double tol = 1e-6;
+  int i0[3], i1[3];
+  double f[3];
+  int sameBrick = 1;
+  for (int c = 0; c < 3; ++c)
+    {
+    double lo = ext[2*c];
+    double hi = ext[2*c+1];
+    if (x[c] < lo - tol || x[c] > hi + tol)
+      {
+      return 0;
+      }
+    double xc = (x[c] < lo ? lo : (x[c] > hi ? hi : x[c]));
+    int i = vtkMath::Floor(xc);
+    f[c] = xc - i;
+    i0[c] = i - ext[2*c];
+    i1[c] = (i < ext[2*c+1] ? i0[c] + 1 : i0[c]);
+    sameBrick = sameBrick &&
+      (i0[c] >> p.BrickShift) == (i1[c] >> p.BrickShift);
+    }
+
+  double v[2][2][2];
+  if (sameBrick)
+    {
+    const vtkIdType size = static_cast<vtkIdType>(1) << p.BrickShift;
+    const T* base = ptr + bricks->GetOffset(i0[0], i0[1], i0[2]);
+    vtkIdType dx = i1[0] - i0[0];
+    vtkIdType dy = (i1[1] - i0[1])*size;
+    vtkIdType dz = (i1[2] - i0[2])*size*size;
+    for (int k = 0; k < 2; ++k)
+      {
+      for (int j = 0; j < 2; ++j)
+        {
+        const T* row = base + k*dz + j*dy;
+        v[k][j][0] = row[0];
+        v[k][j][1] = row[dx];
+        }
+      }
+    }
+  else
+    {
+    for (int k = 0; k < 2; ++k)
+      {
+      int z = (k ? i1[2] : i0[2]);
+      for (int j = 0; j < 2; ++j)
+        {
+        int y = (j ? i1[1] : i0[1]);
+        v[k][j][0] = ptr[bricks->GetOffset(i0[0], y, z)];
+        v[k][j][1] = ptr[bricks->GetOffset(i1[0], y, z)];
+        }
+      }
+    }
+  double v00 = v[0][0][0] + f[0]*(v[0][0][1] - v[0][0][0]);
+  double v01 = v[0][1][0] + f[0]*(v[0][1][1] - v[0][1][0]);
+  double v10 = v[1][0][0] + f[0]*(v[1][0][1] - v[1][0][0]);
+  double v11 = v[1][1][0] + f[0]*(v[1][1][1] - v[1][1][0]);
+  double v0 = v00 + f[1]*(v01 - v00);
+  double v1 = v10 + f[1]*(v11 - v10);
+  value = v0 + f[2]*(v1 - v0);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+// Clip pixels [first, last] of row j of layer k of the slab to the volume
+// and to the mask image, flag the pixels inside the mask and sample them in
+// runs. Flags and values are indexed from pixel x0. Return 0 when no pixel
+// of the row is inside.
+static int vtkImageMaskedResliceToRGBALayer(
+  const vtkImageMaskedResliceToRGBAParameters& p, int j, int k, int x0,
+  int& first, int& last, unsigned char* inside, double* values,
+  std::vector<int>& spans)
+{
+  if (!p.Sampler->ClipRow(j, k, first, last) ||
+      (p.MaskSampler && !p.MaskSampler->ClipRow(j, k, first, last)))
+    {
+    return 0;
+    }
+  int a = first - x0;
+  int b = last - x0;
+
+  // Test the mask first so that masked out pixels are never sampled
+  if (p.MaskSampler)
+    {
+    p.MaskSampler->SampleRow(j, k, first, last, values + a);
+    for (int i = a; i <= b; ++i)
+      {
+      inside[i] = (values[i] != 0.0);
+      }
+    }
+  else if (p.CompactMask && p.MaskScanlineAligned)
+    {
+    // The row runs along a scanline of the compact mask, fetch its spans
+    // once and skip the row if it is empty
+    double m[3];
+    for (int c = 0; c < 3; ++c)
+      {
+      m[c] = p.MaskStart[c] + j*p.MaskColumnStep[c] + k*p.MaskLayerStep[c];
+      }
+    int numRowSpans = p.CompactMask->GetScanlineSpans(
+      vtkMath::Floor(m[1] + 0.5), vtkMath::Floor(m[2] + 0.5), spans);
+    if (numRowSpans == 0)
+      {
+      return 0;
+      }
+    for (int i = a; i <= b; ++i)
+      {
+      inside[i] = vtkImageCompactMask::SpansContain(
+        &spans[0], numRowSpans,
+        vtkMath::Floor(m[0] + (x0 + i)*p.MaskRowStep[0] + 0.5));
+      }
+    }
+  else if (p.CompactMask)
+    {
+    for (int i = a; i <= b; ++i)
+      {
+      double m[3];
+      int idx[3];
+      for (int c = 0; c < 3; ++c)
+        {
+        m[c] = p.MaskStart[c] + (x0 + i)*p.MaskRowStep[c] +
+          j*p.MaskColumnStep[c] + k*p.MaskLayerStep[c];
+        }
+      inside[i] = (vtkNearestIndex(m, p.MaskExtent, idx) &&
+                   p.CompactMask->IsInside(idx[0], idx[1], idx[2]));
+      }
+    }
+  else
+    {
+    memset(inside + a, 1, b - a + 1);
+    }
+
+  int found = 0;
+  for (int i = a; i <= b; )
+    {
+    if (!inside[i])
+      {
+      ++i;
+      continue;
+      }
+    int end = i;
+    while (end < b && inside[end + 1])
+      {
+      ++end;
+      }
+    p.Sampler->SampleRow(j, k, x0 + i, x0 + end, values + i);
+    found = 1;
+    i = end + 1;
+    }
+  return found;
+}
+
+//-----------------------------------------------------------------------------
+// Kernel for the image layout. Each row is clipped to the volume and to the
+// mask image before sampling, then the pixels inside the mask are sampled
+// in runs. The layers of a slab are sampled one after the other for each
+// row, while the voxels around the row are still in the cache.
+static void vtkImageMaskedResliceToRGBARows(
+  const vtkImageMaskedResliceToRGBAParameters& p, vtkImageData* output,
+  int outExt[6])
+{
+  int width = outExt[1] - outExt[0] + 1;
+  std::vector<double> values(width);
+  std::vector<unsigned char> inside(width);
+  std::vector<double> totals(width);
+  std::vector<int> counts(width);
+  std::vector<int> spans;
+  for (int j = outExt[2]; j <= outExt[3]; ++j)
+    {
+    if (*p.AbortExecute)
+      {
+      return;
+      }
+    unsigned char* outPtr = static_cast<unsigned char*>(
+      output->GetScalarPointer(outExt[0], j, outExt[4]));
+    for (int i = 0; i < width; ++i)
+      {
+      memcpy(outPtr + 4*i, p.Background, 4);
+      }
+
+    if (p.SlabSamples == 1)
+      {
+      int first = outExt[0];
+      int last = outExt[1];
+      if (!vtkImageMaskedResliceToRGBALayer(p, j, 0, outExt[0], first,
+                                            last, &inside[0], &values[0],
+                                            spans))
+        {
+        continue;
+        }
+      for (int i = first - outExt[0]; i <= last - outExt[0]; ++i)
+        {
+        if (inside[i])
+          {
+          memcpy(outPtr + 4*i, p.Table->MapValue(values[i]), 4);
+          }
+        }
+      continue;
+      }
+
+    std::fill(totals.begin(), totals.end(), vtkSlabIdentity(p.SlabMode));
+    std::fill(counts.begin(), counts.end(), 0);
+    for (int k = 0; k < p.SlabSamples; ++k)
+      {
+      int first = outExt[0];
+      int last = outExt[1];
+      if (!vtkImageMaskedResliceToRGBALayer(p, j, k, outExt[0], first,
+                                            last, &inside[0], &values[0],
+                                            spans))
+        {
+        continue;
+        }
+      int offset = first - outExt[0];
+      int n = last - first + 1;
+      switch (p.SlabMode)
+        {
+        case vtkImageMaskedResliceToRGBA::SLAB_MAX:
+          vtkSlabAccumulateRow<vtkSlabMax>(&values[offset], &inside[offset],
+                                           n, &totals[offset],
+                                           &counts[offset]);
+          break;
+        case vtkImageMaskedResliceToRGBA::SLAB_MIN:
+          vtkSlabAccumulateRow<vtkSlabMin>(&values[offset], &inside[offset],
+                                           n, &totals[offset],
+                                           &counts[offset]);
+          break;
+        default:
+          vtkSlabAccumulateRow<vtkSlabSum>(&values[offset], &inside[offset],
+                                           n, &totals[offset],
+                                           &counts[offset]);
+          break;
+        }
+      }
+    for (int i = 0; i < width; ++i)
+      {
+      if (counts[i] > 0)
+        {
+        memcpy(outPtr + 4*i, p.Table->MapValue(
+                 vtkSlabResult(p.SlabMode, totals[i], counts[i])), 4);
+        }
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Kernel for the bricked layout, testing and sampling pixel by pixel
+template <class T>
+static void vtkImageMaskedResliceToRGBAExecute(
+  const vtkImageMaskedResliceToRGBAParameters& p, const T* inPtr,
+  vtkImageData* output, int outExt[6])
+{
+  std::vector<int> spans;
+  for (int j = outExt[2]; j <= outExt[3]; ++j)
+    {
+    if (*p.AbortExecute)
+      {
+      return;
+      }
+    unsigned char* outPtr = static_cast<unsigned char*>(
+      output->GetScalarPointer(outExt[0], j, outExt[4]));
+
+    // When the output row runs along a scanline of the compact mask, fetch
+    // its spans once and skip the row if it is empty
+    const int* rowSpans = NULL;
+    int numRowSpans = 0;
+    if (p.CompactMask && p.MaskScanlineAligned && p.SlabSamples == 1)
+      {
+      double m[3];
+      for (int c = 1; c < 3; ++c)
+        {
+        m[c] = p.MaskStart[c] + outExt[0]*p.MaskRowStep[c] +
+          j*p.MaskColumnStep[c];
+        }
+      numRowSpans = p.CompactMask->GetScanlineSpans(
+        vtkMath::Floor(m[1] + 0.5), vtkMath::Floor(m[2] + 0.5), spans);
+      if (numRowSpans == 0)
+        {
+        for (int i = outExt[0]; i <= outExt[1]; ++i, outPtr += 4)
+          {
+          outPtr[0] = p.Background[0];
+          outPtr[1] = p.Background[1];
+          outPtr[2] = p.Background[2];
+          outPtr[3] = p.Background[3];
+          }
+        continue;
+        }
+      rowSpans = &spans[0];
+      }
+
+    for (int i = outExt[0]; i <= outExt[1]; ++i, outPtr += 4)
+      {
+      double total = vtkSlabIdentity(p.SlabMode);
+      int count = 0;
+      for (int k = 0; k < p.SlabSamples; ++k)
+        {
+        // Test the mask first so that masked out samples are never taken
+        int inside = 1;
+        if (rowSpans)
+          {
+          double m = p.MaskStart[0] + i*p.MaskRowStep[0] +
+            j*p.MaskColumnStep[0];
+          inside = vtkImageCompactMask::SpansContain(
+            rowSpans, numRowSpans, vtkMath::Floor(m + 0.5));
+          }
+        else if (p.HasMask)
+          {
+          double m[3];
+          int idx[3];
+          for (int c = 0; c < 3; ++c)
+            {
+            m[c] = p.MaskStart[c] + i*p.MaskRowStep[c] +
+              j*p.MaskColumnStep[c] + k*p.MaskLayerStep[c];
+            }
+          const int* mext = p.MaskExtent;
+          if (!vtkNearestIndex(m, mext, idx))
+            {
+            inside = 0;
+            }
+          else if (p.CompactMask)
+            {
+            inside = p.CompactMask->IsInside(idx[0], idx[1], idx[2]);
+            }
+          else
+            {
+            inside = p.Mask[p.MaskBricks->GetOffset(idx[0] - mext[0],
+                                                    idx[1] - mext[2],
+                                                    idx[2] - mext[4])] != 0;
+            }
+          }
+
+        double x[3], value;
+        for (int c = 0; c < 3; ++c)
+          {
+          x[c] = p.Start[c] + i*p.RowStep[c] + j*p.ColumnStep[c] +
+            k*p.LayerStep[c];
+          }
+        if (inside && vtkSampleBrickedVolume(inPtr, x, p, value))
+          {
+          vtkSlabAccumulate(p.SlabMode, value, total, count);
+          }
+        }
+
+      const unsigned char* rgba = (count > 0 ?
+        p.Table->MapValue(vtkSlabResult(p.SlabMode, total, count)) :
+        p.Background);
+      outPtr[0] = rgba[0];
+      outPtr[1] = rgba[1];
+      outPtr[2] = rgba[2];
+      outPtr[3] = rgba[3];
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkImageMaskedResliceToRGBA::vtkImageMaskedResliceToRGBA()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetNumberOfOutputPorts(1);
+
+  this->ResliceAxes = vtkMatrix4x4::New();
+  this->CompactMask = NULL;
+  this->InterpolationMode = LINEAR;
+  this->BackgroundValue = 0.0;
+  this->SlabThickness = 0.0;
+  this->SlabMode = SLAB_MAX;
+  this->LookupTable = vtkRGBATransferTable::New();
+  this->UseBrickedLayout = 0;
+  this->BrickSize = 16;
+  this->BrickOrder = vtkImageBrickedVolume::LINEAR;
+  this->VolumeBricks = vtkImageBrickedVolume::New();
+  this->MaskBricks = vtkImageBrickedVolume::New();
+  this->VolumeSampler = vtkImagePlaneSampler::New();
+  this->MaskSampler = vtkImagePlaneSampler::New();
+  this->MaskSampler->SetInterpolationMode(vtkImagePlaneSampler::NEAREST);
+
+  for (int i = 0; i < 3; ++i)
+    {
+    this->OutputOrigin[i] = 0.0;
+    this->OutputSpacing[i] = 1.0;
+    }
+  this->SlabSpacing = 1.0;
+  this->SlabNumberOfSamples = 1;
+}
+
+//-----------------------------------------------------------------------------
+vtkImageMaskedResliceToRGBA::~vtkImageMaskedResliceToRGBA()
+{
+  this->SetResliceAxes(NULL);
+  this->SetCompactMask(NULL);
+  this->LookupTable->UnRegister(this);
+  this->LookupTable = NULL;
+  this->VolumeBricks->Delete();
+  this->VolumeBricks = NULL;
+  this->MaskBricks->Delete();
+  this->MaskBricks = NULL;
+  this->VolumeSampler->Delete();
+  this->VolumeSampler = NULL;
+  this->MaskSampler->Delete();
+  this->MaskSampler = NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "InterpolationMode: " << this->InterpolationMode << "\n";
+  os << indent << "BackgroundValue: " << this->BackgroundValue << "\n";
+  os << indent << "SlabThickness: " << this->SlabThickness << "\n";
+  os << indent << "SlabMode: "
+     << (this->SlabMode == SLAB_MAX ? "Max" :
+         (this->SlabMode == SLAB_MIN ? "Min" : "Mean")) << "\n";
+  os << indent << "SlabNumberOfSamples: " << this->SlabNumberOfSamples
+     << "\n";
+  os << indent << "ResliceAxes: " << this->ResliceAxes << "\n";
+  os << indent << "CompactMask: " << this->CompactMask << "\n";
+  os << indent << "UseBrickedLayout: " << this->UseBrickedLayout << "\n";
+  os << indent << "BrickSize: " << this->BrickSize << "\n";
+  os << indent << "BrickOrder: "
+     << (this->BrickOrder == vtkImageBrickedVolume::MORTON ?
+         "Morton" : "Linear") << "\n";
+  os << indent << "LookupTable: ";
+  this->LookupTable->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::SetMaskInputData(vtkImageData* mask)
+{
+  this->SetInputData(1, mask);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::SetMaskInputConnection(
+  vtkAlgorithmOutput* port)
+{
+  this->SetInputConnection(1, port);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::SetResliceAxesDirectionCosines(
+  double x0, double x1, double x2,
+  double y0, double y1, double y2,
+  double z0, double z1, double z2)
+{
+  if (!this->ResliceAxes)
+    {
+    vtkMatrix4x4* axes = vtkMatrix4x4::New();
+    this->SetResliceAxes(axes);
+    axes->Delete();
+    }
+  this->ResliceAxes->SetElement(0, 0, x0);
+  this->ResliceAxes->SetElement(1, 0, x1);
+  this->ResliceAxes->SetElement(2, 0, x2);
+  this->ResliceAxes->SetElement(3, 0, 0);
+  this->ResliceAxes->SetElement(0, 1, y0);
+  this->ResliceAxes->SetElement(1, 1, y1);
+  this->ResliceAxes->SetElement(2, 1, y2);
+  this->ResliceAxes->SetElement(3, 1, 0);
+  this->ResliceAxes->SetElement(0, 2, z0);
+  this->ResliceAxes->SetElement(1, 2, z1);
+  this->ResliceAxes->SetElement(2, 2, z2);
+  this->ResliceAxes->SetElement(3, 2, 0);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::SetResliceAxesOrigin(double x, double y,
+                                                       double z)
+{
+  if (!this->ResliceAxes)
+    {
+    vtkMatrix4x4* axes = vtkMatrix4x4::New();
+    this->SetResliceAxes(axes);
+    axes->Delete();
+    }
+  this->ResliceAxes->SetElement(0, 3, x);
+  this->ResliceAxes->SetElement(1, 3, y);
+  this->ResliceAxes->SetElement(2, 3, z);
+  this->ResliceAxes->SetElement(3, 3, 1);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::SetColorFunction(
+  vtkColorTransferFunction* cf)
+{
+  this->LookupTable->SetColorFunction(cf);
+}
+
+//----------------------------------------------------------------------------
+vtkColorTransferFunction* vtkImageMaskedResliceToRGBA::GetColorFunction()
+{
+  return this->LookupTable->GetColorFunction();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::SetOpacityFunction(
+  vtkPiecewiseFunction* pwf)
+{
+  this->LookupTable->SetOpacityFunction(pwf);
+}
+
+//----------------------------------------------------------------------------
+vtkPiecewiseFunction* vtkImageMaskedResliceToRGBA::GetOpacityFunction()
+{
+  return this->LookupTable->GetOpacityFunction();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::SetNumberOfColors(int n)
+{
+  this->LookupTable->SetNumberOfColors(n);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedResliceToRGBA::GetNumberOfColors()
+{
+  return this->LookupTable->GetNumberOfColors();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::SetLookupTable(vtkRGBATransferTable* table)
+{
+  if (table == this->LookupTable)
+    {
+    return;
+    }
+  vtkRGBATransferTable* previous = this->LookupTable;
+  if (table)
+    {
+    table->Register(this);
+    this->LookupTable = table;
+    }
+  else
+    {
+    this->LookupTable = vtkRGBATransferTable::New();
+    }
+  previous->UnRegister(this);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImageMaskedResliceToRGBA::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  if (this->ResliceAxes && this->ResliceAxes->GetMTime() > mTime)
+    {
+    mTime = this->ResliceAxes->GetMTime();
+    }
+  if (this->CompactMask && this->CompactMask->GetMTime() > mTime)
+    {
+    mTime = this->CompactMask->GetMTime();
+    }
+  if (this->LookupTable->GetMTime() > mTime)
+    {
+    mTime = this->LookupTable->GetMTime();
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedResliceToRGBA::FillInputPortInformation(
+  int port, vtkInformation* info)
+{
+  this->Superclass::FillInputPortInformation(port, info);
+  if (port == 1)
+    {
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedResliceToRGBA::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+
+  int inExt[6];
+  double inOrigin[3], inSpacing[3];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), inExt);
+  inInfo->Get(vtkDataObject::ORIGIN(), inOrigin);
+  inInfo->Get(vtkDataObject::SPACING(), inSpacing);
+
+  int outExt[6];
+  double outOrigin[3], outSpacing[3];
+  this->ComputeOutputInformation(inExt, inOrigin, inSpacing, outExt,
+                                 outOrigin, outSpacing);
+
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), outExt, 6);
+  outInfo->Set(vtkDataObject::ORIGIN(), outOrigin, 3);
+  outInfo->Set(vtkDataObject::SPACING(), outSpacing, 3);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::ComputeOutputInformation(
+  const int inExt[6], const double inOrigin[3], const double inSpacing[3],
+  int outExt[6], double outOrigin[3], double outSpacing[3])
+{
+  vtkMatrix4x4* inverse = vtkMatrix4x4::New();
+  if (this->ResliceAxes)
+    {
+    vtkMatrix4x4::Invert(this->ResliceAxes, inverse);
+    }
+
+  // Bounds of the input volume in the reslice frame
+  double bounds[6] = { VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX,
+                       VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX,
+                       VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  for (int corner = 0; corner < 8; ++corner)
+    {
+    double world[4], p[4];
+    for (int c = 0; c < 3; ++c)
+      {
+      world[c] = inOrigin[c] + inSpacing[c]*inExt[2*c + ((corner >> c) & 1)];
+      }
+    world[3] = 1.0;
+    inverse->MultiplyPoint(world, p);
+    for (int c = 0; c < 3; ++c)
+      {
+      bounds[2*c] = (p[c] < bounds[2*c] ? p[c] : bounds[2*c]);
+      bounds[2*c+1] = (p[c] > bounds[2*c+1] ? p[c] : bounds[2*c+1]);
+      }
+    }
+  inverse->Delete();
+
+  // The spacing along each output axis is the input spacing weighted by
+  // the squared direction cosines, as in vtkImageReslice. The layers of the
+  // slab are spaced the same way along the normal.
+  std::fill(outExt, outExt + 6, 0);
+  double axisSpacing[3];
+  for (int a = 0; a < 3; ++a)
+    {
+    double s = 0.0;
+    double norm = 0.0;
+    for (int c = 0; c < 3; ++c)
+      {
+      double d = (this->ResliceAxes ?
+                  this->ResliceAxes->GetElement(c, a) : (c == a));
+      s += d*d*fabs(inSpacing[c]);
+      norm += d*d;
+      }
+    axisSpacing[a] = (norm > 0.0 ? s / norm : 1.0);
+    }
+  for (int a = 0; a < 2; ++a)
+    {
+    this->OutputSpacing[a] = axisSpacing[a];
+    this->OutputOrigin[a] = bounds[2*a];
+    outExt[2*a+1] = vtkMath::Floor(
+      (bounds[2*a+1] - bounds[2*a]) / this->OutputSpacing[a] + 0.5);
+    }
+  this->OutputOrigin[2] = 0.0;
+  this->OutputSpacing[2] = 1.0;
+  this->SlabSpacing = axisSpacing[2];
+  this->SlabNumberOfSamples = 1 + vtkMath::Floor(
+    this->SlabThickness / this->SlabSpacing);
+  std::copy(this->OutputOrigin, this->OutputOrigin + 3, outOrigin);
+  std::copy(this->OutputSpacing, this->OutputSpacing + 3, outSpacing);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedResliceToRGBA::RequestUpdateExtent(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  int outExt[6];
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), outExt);
+
+  // Only request the slab of each input that the requested part of the
+  // slice passes through, so that large volumes can be streamed
+  for (int port = 0; port < 2; ++port)
+    {
+    for (int i = 0; i < inputVector[port]->GetNumberOfInformationObjects();
+         ++i)
+      {
+      vtkInformation* inInfo = inputVector[port]->GetInformationObject(i);
+      int wholeExt[6], inExt[6];
+      double origin[3], spacing[3];
+      inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),
+                  wholeExt);
+      inInfo->Get(vtkDataObject::ORIGIN(), origin);
+      inInfo->Get(vtkDataObject::SPACING(), spacing);
+      // The mask is always sampled at the nearest voxel, and not at all
+      // when the compact mask replaces it
+      int linear = (port == 0 && this->InterpolationMode == LINEAR);
+      this->ComputeInputUpdateExtent(outExt, origin, spacing, wholeExt,
+                                     linear, inExt);
+      // Bricks are built once from the whole inputs
+      if (this->UseBrickedLayout)
+        {
+        std::copy(wholeExt, wholeExt + 6, inExt);
+        }
+      if (port == 1 && this->CompactMask)
+        {
+        inExt[1] = inExt[0] - 1;
+        }
+      inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+                  inExt, 6);
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::ComputeInputUpdateExtent(
+  const int outExt[6], const double origin[3], const double spacing[3],
+  const int wholeExt[6], int linear, int inExt[6])
+{
+  double start[3], rowStep[3], columnStep[3], layerStep[3];
+  this->ComputeIndexSteps(origin, spacing, start, rowStep, columnStep,
+                          layerStep);
+
+  // The sampled positions are linear in the output indices, so their
+  // bounding box is the one of the corners of the output extent on the
+  // first and last layers of the slab
+  double lo[3] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX };
+  double hi[3] = { -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  for (int corner = 0; corner < 8; ++corner)
+    {
+    int i = outExt[(corner & 1)];
+    int j = outExt[2 + ((corner >> 1) & 1)];
+    int k = ((corner >> 2) & 1)*(this->SlabNumberOfSamples - 1);
+    for (int c = 0; c < 3; ++c)
+      {
+      double x = start[c] + i*rowStep[c] + j*columnStep[c] +
+        k*layerStep[c];
+      lo[c] = (x < lo[c] ? x : lo[c]);
+      hi[c] = (x > hi[c] ? x : hi[c]);
+      }
+    }
+
+  // Linear sampling also reads the voxel after the one the position is in
+  int empty = 0;
+  for (int c = 0; c < 3; ++c)
+    {
+    if (linear)
+      {
+      inExt[2*c] = vtkMath::Floor(lo[c]);
+      inExt[2*c+1] = vtkMath::Floor(hi[c]) + 1;
+      }
+    else
+      {
+      inExt[2*c] = vtkMath::Floor(lo[c] + 0.5);
+      inExt[2*c+1] = vtkMath::Floor(hi[c] + 0.5);
+      }
+    inExt[2*c] = (inExt[2*c] < wholeExt[2*c] ? wholeExt[2*c] : inExt[2*c]);
+    inExt[2*c+1] = (inExt[2*c+1] > wholeExt[2*c+1] ?
+                    wholeExt[2*c+1] : inExt[2*c+1]);
+    empty = empty || inExt[2*c] > inExt[2*c+1];
+    }
+
+  // Request nothing when the slice misses the input
+  if (empty)
+    {
+    for (int c = 0; c < 3; ++c)
+      {
+      inExt[2*c] = wholeExt[2*c];
+      inExt[2*c+1] = wholeExt[2*c] - 1;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMaskedResliceToRGBA::RequestData(
+  vtkInformation* request,
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  // The table is shared by all threads and must be up to date before they
+  // start
+  this->LookupTable->Build();
+
+  vtkImageData* mask = vtkImageData::GetData(inputVector[1]);
+  if (mask && !this->CompactMask &&
+      mask->GetScalarType() != VTK_UNSIGNED_CHAR)
+    {
+    vtkErrorMacro(<< "Mask must be of type unsigned char, got "
+                  << mask->GetScalarTypeAsString());
+    return 0;
+    }
+
+  // The bricks are shared by all threads too
+  vtkImageData* volume = vtkImageData::GetData(inputVector[0]);
+  if (this->UseBrickedLayout && volume && volume->GetNumberOfPoints() > 0)
+    {
+    this->VolumeBricks->SetBrickSize(this->BrickSize);
+    this->VolumeBricks->SetBrickOrder(this->BrickOrder);
+    if (!this->VolumeBricks->ImportImage(volume))
+      {
+      return 0;
+      }
+    if (mask && !this->CompactMask && mask->GetNumberOfPoints() > 0)
+      {
+      this->MaskBricks->SetBrickSize(this->BrickSize);
+      this->MaskBricks->SetBrickOrder(this->BrickOrder);
+      if (!this->MaskBricks->ImportImage(mask))
+        {
+        return 0;
+        }
+      }
+    }
+
+  // So are the samplers of the image layout, which walk the same plane in
+  // the index space of each input
+  double start[3], rowStep[3], columnStep[3], layerStep[3];
+  if (volume)
+    {
+    this->ComputeIndexSteps(volume->GetOrigin(), volume->GetSpacing(),
+                            start, rowStep, columnStep, layerStep);
+    this->VolumeSampler->SetImage(volume);
+    this->VolumeSampler->SetPlane(start, rowStep, columnStep);
+    this->VolumeSampler->SetLayerStep(layerStep);
+    this->VolumeSampler->SetInterpolationMode(
+      this->InterpolationMode == LINEAR ?
+      vtkImagePlaneSampler::LINEAR : vtkImagePlaneSampler::NEAREST);
+    }
+  if (mask && !this->CompactMask)
+    {
+    this->ComputeIndexSteps(mask->GetOrigin(), mask->GetSpacing(),
+                            start, rowStep, columnStep, layerStep);
+    this->MaskSampler->SetImage(mask);
+    this->MaskSampler->SetPlane(start, rowStep, columnStep);
+    this->MaskSampler->SetLayerStep(layerStep);
+    }
+
+  return this->Superclass::RequestData(request, inputVector, outputVector);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::ComputeIndexSteps(const double origin[3],
+                                                    const double spacing[3],
+                                                    double start[3],
+                                                    double rowStep[3],
+                                                    double columnStep[3],
+                                                    double layerStep[3])
+{
+  // The slab is centered on the slice
+  vtkMatrix4x4* axes = this->ResliceAxes;
+  double offset = -0.5*(this->SlabNumberOfSamples - 1)*this->SlabSpacing;
+  for (int c = 0; c < 3; ++c)
+    {
+    double u = (axes ? axes->GetElement(c, 0) : (c == 0));
+    double v = (axes ? axes->GetElement(c, 1) : (c == 1));
+    double w = (axes ? axes->GetElement(c, 2) : (c == 2));
+    double o = (axes ? axes->GetElement(c, 3) : 0.0);
+    double world = o + u*this->OutputOrigin[0] + v*this->OutputOrigin[1] +
+      w*offset;
+    start[c] = (world - origin[c]) / spacing[c];
+    rowStep[c] = u*this->OutputSpacing[0] / spacing[c];
+    columnStep[c] = v*this->OutputSpacing[1] / spacing[c];
+    layerStep[c] = w*this->SlabSpacing / spacing[c];
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMaskedResliceToRGBA::ThreadedRequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* vtkNotUsed(outputVector),
+  vtkImageData*** inData,
+  vtkImageData** outData,
+  int outExt[6], int vtkNotUsed(threadId))
+{
+  vtkImageData* volume = inData[0][0];
+  vtkImageData* mask = vtkImageData::GetData(inputVector[1]);
+  vtkImageData* output = outData[0];
+  if (!volume || outExt[0] > outExt[1] || outExt[2] > outExt[3])
+    {
+    return;
+    }
+
+  vtkImageMaskedResliceToRGBAParameters p;
+  this->ComputeIndexSteps(volume->GetOrigin(), volume->GetSpacing(),
+                          p.Start, p.RowStep, p.ColumnStep, p.LayerStep);
+  volume->GetExtent(p.Extent);
+  p.SlabSamples = this->SlabNumberOfSamples;
+  p.SlabMode = this->SlabMode;
+  p.Sampler = this->VolumeSampler;
+  p.MaskSampler = NULL;
+  p.Bricks = NULL;
+  p.MaskBricks = NULL;
+  p.BrickShift = 0;
+  void* inPtr = volume->GetScalarPointer();
+  if (this->UseBrickedLayout && volume->GetNumberOfPoints() > 0)
+    {
+    p.Bricks = this->VolumeBricks;
+    p.BrickShift = this->VolumeBricks->GetBrickShift();
+    inPtr = this->VolumeBricks->GetScalarPointer();
+    }
+
+  // A mask with an empty extent masks out the whole slice
+  p.HasMask = (mask != NULL || this->CompactMask != NULL);
+  p.Mask = NULL;
+  p.CompactMask = this->CompactMask;
+  p.MaskScanlineAligned = 0;
+  if (this->CompactMask)
+    {
+    this->ComputeIndexSteps(this->CompactMask->GetOrigin(),
+                            this->CompactMask->GetSpacing(),
+                            p.MaskStart, p.MaskRowStep, p.MaskColumnStep,
+                            p.MaskLayerStep);
+    this->CompactMask->GetExtent(p.MaskExtent);
+    p.MaskScanlineAligned =
+      (p.MaskRowStep[1] == 0.0 && p.MaskRowStep[2] == 0.0);
+    }
+  else if (mask)
+    {
+    p.MaskSampler = this->MaskSampler;
+    if (p.Bricks && mask->GetNumberOfPoints() > 0)
+      {
+      p.MaskBricks = this->MaskBricks;
+      p.Mask = static_cast<const unsigned char*>(
+        this->MaskBricks->GetScalarPointer());
+      }
+    this->ComputeIndexSteps(mask->GetOrigin(), mask->GetSpacing(),
+                            p.MaskStart, p.MaskRowStep, p.MaskColumnStep,
+                            p.MaskLayerStep);
+    mask->GetExtent(p.MaskExtent);
+    }
+
+  p.Linear = (this->InterpolationMode == LINEAR);
+  p.Table = this->LookupTable;
+  const unsigned char* background =
+    this->LookupTable->MapValue(this->BackgroundValue);
+  for (int c = 0; c < 4; ++c)
+    {
+    p.Background[c] = background[c];
+    }
+  p.AbortExecute = &this->AbortExecute;
+
+  if (!p.Bricks)
+    {
+    vtkImageMaskedResliceToRGBARows(p, output, outExt);
+    return;
+    }
+
+  switch (volume->GetScalarType())
+    {
+    vtkTemplateMacro(
+      vtkImageMaskedResliceToRGBAExecute(p, static_cast<VTK_TT*>(inPtr),
+                                         output, outExt));
+    default:
+      vtkErrorMacro(<< "Execute: Unknown input ScalarType");
+      return;
+    }
+}
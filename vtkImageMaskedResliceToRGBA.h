@@ -0,0 +1,285 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageMaskedResliceToRGBA.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageMaskedResliceToRGBA - reslice a volume, apply a binary
+// mask and map the result to RGBA in a single pass.
+//
+// .SECTION Description
+// vtkImageMaskedResliceToRGBA replaces the chain vtkImageReslice (volume),
+// vtkImageReslice (mask), vtkImageShiftScale, vtkImageMathematics and
+// vtkImageMapToRGBA with one threaded filter. For every output pixel the
+// volume and the mask are sampled at the same reslice coordinates and the
+// volume value is mapped through the color and opacity functions straight
+// into the RGBA output. No intermediate image is allocated.
+//
+// The first input is the volume. The optional second input is a binary
+// mask with any geometry; a pixel is inside the mask when the mask voxel
+// nearest to it is not zero. A vtkImageCompactMask can be given instead of
+// the mask image with SetCompactMask(). Pixels outside the mask or outside
+// the volume get the color of BackgroundValue (default: 0), which is what
+// the masked slice of the multi-stage pipeline was colored with.
+//
+// The output is a single slice in the coordinate frame of the reslice axes,
+// with the same conventions as vtkImageReslice with an output
+// dimensionality of 2.
+//
+// Only the slab of voxels that the requested output extent passes through
+// is requested from each input, so a streaming reader or a
+// vtkImageShapeMaskSource upstream only loads or generates the few slices
+// around the reslice plane instead of the whole volume.
+//
+// With a SlabThickness, each pixel combines the samples of the volume taken
+// across the slab along the normal of the slice, one input spacing apart,
+// into their maximum, minimum or mean. The mask is tested at every sample,
+// so only the voxels inside it contribute, and pixels without any sample
+// inside get the background color. The slab is computed in the same single
+// pass over the output rows, layer after layer of each row, so that every
+// layer reuses the voxels the previous one brought into the cache.
+//
+// Each output row is first clipped to the pixels that sample the volume and
+// the mask image, then the pixels inside the mask are sampled in runs by
+// vtkImagePlaneSampler, which walks the plane with precomputed index steps
+// and uses AVX2 gathers for 16 bit and float volumes when built for them.
+//
+// With UseBrickedLayout on, the volume and the mask are copied once into
+// vtkImageBrickedVolume bricks and sampled from there, so that sagittal,
+// coronal and oblique slices read memory as efficiently as axial ones. The
+// whole inputs are then requested, to be bricked once for all slices.
+//
+// .SECTION see also
+// vtkImageReslice vtkImageMapToRGBA vtkRGBATransferTable vtkImagePlaneSampler
+
+#ifndef __vtkImageMaskedResliceToRGBA_h
+#define __vtkImageMaskedResliceToRGBA_h
+
+#include <vtkThreadedImageAlgorithm.h>
+
+#include "vtkImageBrickedVolume.h" // For the brick orders
+
+// Forward declarations
+class vtkAlgorithmOutput;
+class vtkColorTransferFunction;
+class vtkImageCompactMask;
+class vtkImageData;
+class vtkImagePlaneSampler;
+class vtkInformation;
+class vtkInformationVector;
+class vtkMatrix4x4;
+class vtkPiecewiseFunction;
+class vtkRGBATransferTable;
+
+class vtkImageMaskedResliceToRGBA : public vtkThreadedImageAlgorithm
+{
+public:
+  static vtkImageMaskedResliceToRGBA* New();
+  vtkTypeMacro(vtkImageMaskedResliceToRGBA, vtkThreadedImageAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set the binary mask. The mask must be of type VTK_UNSIGNED_CHAR.
+  void SetMaskInputData(vtkImageData* mask);
+  void SetMaskInputConnection(vtkAlgorithmOutput* port);
+
+  // Description:
+  // Set/Get a compact mask to use instead of the mask input. When set, it
+  // takes precedence over the mask input. For slices whose rows run along
+  // the mask scanlines, whole rows that fall on empty scanlines are filled
+  // with the background color without sampling the volume.
+  virtual void SetCompactMask(vtkImageCompactMask* mask);
+  vtkGetObjectMacro(CompactMask, vtkImageCompactMask);
+
+  // Description:
+  // Set/Get the reslice axes. The first two columns are the directions of
+  // the slice rows and columns, the fourth column is a point on the slice.
+  virtual void SetResliceAxes(vtkMatrix4x4* axes);
+  vtkGetObjectMacro(ResliceAxes, vtkMatrix4x4);
+
+  // Description:
+  // Convenience methods to set the reslice axes like vtkImageReslice
+  void SetResliceAxesDirectionCosines(double x0, double x1, double x2,
+                                      double y0, double y1, double y2,
+                                      double z0, double z1, double z2);
+  void SetResliceAxesOrigin(double x, double y, double z);
+
+  // Description:
+  // Set/Get the interpolation mode of the volume (default: linear)
+  enum
+    {
+    NEAREST = 0,
+    LINEAR
+    };
+  vtkSetClampMacro(InterpolationMode, int, NEAREST, LINEAR);
+  vtkGetMacro(InterpolationMode, int);
+  void SetInterpolationModeToNearestNeighbor()
+    { this->SetInterpolationMode(NEAREST); }
+  void SetInterpolationModeToLinear()
+    { this->SetInterpolationMode(LINEAR); }
+
+  // Description:
+  // Set/Get the thickness of the slab in world units, centered on the slice
+  // (default: 0, a single slice)
+  vtkSetClampMacro(SlabThickness, double, 0.0, VTK_DOUBLE_MAX);
+  vtkGetMacro(SlabThickness, double);
+
+  // Description:
+  // Set/Get how the samples across the slab are combined (default:
+  // maximum intensity projection)
+  enum
+    {
+    SLAB_MAX = 0,
+    SLAB_MIN,
+    SLAB_MEAN
+    };
+  vtkSetClampMacro(SlabMode, int, SLAB_MAX, SLAB_MEAN);
+  vtkGetMacro(SlabMode, int);
+  void SetSlabModeToMax() { this->SetSlabMode(SLAB_MAX); }
+  void SetSlabModeToMin() { this->SetSlabMode(SLAB_MIN); }
+  void SetSlabModeToMean() { this->SetSlabMode(SLAB_MEAN); }
+
+  // Description:
+  // Get the number of samples taken across the slab, computed with the
+  // output information
+  vtkGetMacro(SlabNumberOfSamples, int);
+
+  // Description:
+  // Set/Get the scalar value whose color is given to masked out pixels
+  vtkSetMacro(BackgroundValue, double);
+  vtkGetMacro(BackgroundValue, double);
+
+  // Description:
+  // Enable/Disable sampling the volume and the mask image from bricked
+  // copies (default: off)
+  vtkSetMacro(UseBrickedLayout, int);
+  vtkGetMacro(UseBrickedLayout, int);
+  vtkBooleanMacro(UseBrickedLayout, int);
+
+  // Description:
+  // Set/Get the size of the bricks, a power of two (default: 16), and the
+  // order of the bricks in memory (default: linear)
+  vtkSetClampMacro(BrickSize, int, 1, 256);
+  vtkGetMacro(BrickSize, int);
+  vtkSetClampMacro(BrickOrder, int, vtkImageBrickedVolume::LINEAR,
+                   vtkImageBrickedVolume::MORTON);
+  vtkGetMacro(BrickOrder, int);
+  void SetBrickOrderToLinear()
+    { this->SetBrickOrder(vtkImageBrickedVolume::LINEAR); }
+  void SetBrickOrderToMorton()
+    { this->SetBrickOrder(vtkImageBrickedVolume::MORTON); }
+
+  // Description:
+  // Set/Get the color transfer function
+  void SetColorFunction(vtkColorTransferFunction* cf);
+  vtkColorTransferFunction* GetColorFunction();
+
+  // Description:
+  // Set/Get the opacity function
+  void SetOpacityFunction(vtkPiecewiseFunction* pwf);
+  vtkPiecewiseFunction* GetOpacityFunction();
+
+  // Description:
+  // Set/Get number of colors the functions are sampled with (default: 256)
+  void SetNumberOfColors(int n);
+  int GetNumberOfColors();
+
+  // Description:
+  // Set/Get the table the functions are sampled into. Filters given the
+  // same table share its functions and sample them once. NULL gives the
+  // filter a table of its own again.
+  void SetLookupTable(vtkRGBATransferTable* table);
+  vtkGetObjectMacro(LookupTable, vtkRGBATransferTable);
+
+  // Description:
+  // Compute the whole extent, origin and spacing of the output for a volume
+  // with the given whole extent, origin and spacing. This is what
+  // RequestInformation() does, for filters that drive several slices.
+  void ComputeOutputInformation(const int inExt[6], const double inOrigin[3],
+                                const double inSpacing[3], int outExt[6],
+                                double outOrigin[3], double outSpacing[3]);
+
+  // Description:
+  // Include the reslice axes, compact mask and lookup table modification
+  // times
+  unsigned long GetMTime();
+
+protected:
+  vtkImageMaskedResliceToRGBA();
+  ~vtkImageMaskedResliceToRGBA();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info);
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector);
+
+  virtual int RequestUpdateExtent(vtkInformation* request,
+                                  vtkInformationVector** inputVector,
+                                  vtkInformationVector* outputVector);
+
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  virtual void ThreadedRequestData(vtkInformation* request,
+                                   vtkInformationVector** inputVector,
+                                   vtkInformationVector* outputVector,
+                                   vtkImageData*** inData,
+                                   vtkImageData** outData,
+                                   int outExt[6], int threadId);
+
+  // Description:
+  // Compute the continuous index of output pixel (0, 0) of the first layer
+  // of the slab in an image with the given origin and spacing, and the
+  // index steps for one output pixel along the rows and columns and for
+  // one layer of the slab.
+  void ComputeIndexSteps(const double origin[3], const double spacing[3],
+                         double start[3], double rowStep[3],
+                         double columnStep[3], double layerStep[3]);
+
+  // Description:
+  // Compute the extent of an input that the output extent outExt samples,
+  // clamped to the input's whole extent. The extent is empty when the
+  // slice misses the input.
+  void ComputeInputUpdateExtent(const int outExt[6], const double origin[3],
+                                const double spacing[3],
+                                const int wholeExt[6], int linear,
+                                int inExt[6]);
+
+  vtkMatrix4x4* ResliceAxes;
+  vtkImageCompactMask* CompactMask;
+  int InterpolationMode;
+  double BackgroundValue;
+  double SlabThickness;
+  int SlabMode;
+  vtkRGBATransferTable* LookupTable;
+
+  int UseBrickedLayout;
+  int BrickSize;
+  int BrickOrder;
+  vtkImageBrickedVolume* VolumeBricks;
+  vtkImageBrickedVolume* MaskBricks;
+  vtkImagePlaneSampler* VolumeSampler;
+  vtkImagePlaneSampler* MaskSampler;
+
+  // Output geometry in the reslice frame, computed in RequestInformation
+  double OutputOrigin[3];
+  double OutputSpacing[3];
+  double SlabSpacing;
+  int SlabNumberOfSamples;
+
+private:
+  vtkImageMaskedResliceToRGBA(const vtkImageMaskedResliceToRGBA&); // Not implemented
+  void operator=(const vtkImageMaskedResliceToRGBA&); // Not implemented
+};
+
+#endif //__vtkImageMaskedResliceToRGBA_h
@@ -0,0 +1,597 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageParallelClip.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageParallelClip.h"
+
+#include <vtkAbstractTransform.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkClipDataSet.h>
+#include <vtkDataSetTriangleFilter.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkImplicitFunction.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkLinearTransform.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnstructuredGrid.h>
+
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+vtkStandardNewMacro(vtkImageParallelClip);
+vtkCxxSetObjectMacro(vtkImageParallelClip, ClipFunction, vtkImplicitFunction);
+
+// Name of the clip values array passed to the piece filters
+static const char* vtkImageParallelClipValues = "vtkImageParallelClipValues";
+
+//-----------------------------------------------------------------------------
+// Evaluates the clip function on a range of z slices. Matrix, when set, is
+// the linear transform of the function.
+class vtkImageParallelClipEvaluateFunctor
+{
+public:
+  vtkImplicitFunction* Function;
+  const double* Matrix;
+  int Extent[6];
+  double Origin[3];
+  double Spacing[3];
+  double* Values;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    int nx = this->Extent[1] - this->Extent[0] + 1;
+    int ny = this->Extent[3] - this->Extent[2] + 1;
+    double* v = this->Values + begin*nx*ny;
+    for (vtkIdType k = begin; k < end; ++k)
+      {
+      double x[3], xt[3];
+      x[2] = this->Origin[2] + (this->Extent[4] + k)*this->Spacing[2];
+      for (int j = this->Extent[2]; j <= this->Extent[3]; ++j)
+        {
+        x[1] = this->Origin[1] + j*this->Spacing[1];
+        for (int i = this->Extent[0]; i <= this->Extent[1]; ++i)
+          {
+          x[0] = this->Origin[0] + i*this->Spacing[0];
+          double* p = x;
+          if (this->Matrix)
+            {
+            const double* m = this->Matrix;
+            for (int c = 0; c < 3; ++c)
+              {
+              xt[c] = m[4*c]*x[0] + m[4*c+1]*x[1] + m[4*c+2]*x[2] + m[4*c+3];
+              }
+            p = xt;
+            }
+          *v++ = this->Function->EvaluateFunction(p);
+          }
+        }
+      }
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Copy count consecutive tuples starting at offset of every data array
+static void vtkImageParallelClipCopyTuples(vtkDataSetAttributes* in,
+                                           vtkDataSetAttributes* out,
+                                           vtkIdType offset,
+                                           vtkIdType count)
+{
+  for (int a = 0; a < in->GetNumberOfArrays(); ++a)
+    {
+    vtkDataArray* array = in->GetArray(a);
+    if (!array)
+      {
+      continue;
+      }
+    int nc = array->GetNumberOfComponents();
+    vtkDataArray* copy = array->NewInstance();
+    copy->SetName(array->GetName());
+    copy->SetNumberOfComponents(nc);
+    copy->SetNumberOfTuples(count);
+    memcpy(copy->GetVoidPointer(0), array->GetVoidPointer(offset*nc),
+           count*nc*array->GetDataTypeSize());
+    int index = out->AddArray(copy);
+    copy->Delete();
+    int attribute = in->IsArrayAnAttribute(a);
+    if (attribute >= 0)
+      {
+      out->SetActiveAttribute(index, attribute);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// A slab of the input and its clipped output
+struct vtkImageParallelClipPiece
+{
+  int Extent[6];
+  vtkSmartPointer<vtkUnstructuredGrid> Output;
+
+  // Output point id of every piece point, and first id owned by the piece
+  std::vector<vtkIdType> PointIds;
+  vtkIdType FirstPointId;
+  vtkIdType FirstCellId;
+  vtkIdType FirstConnectivityId;
+
+  // Output arrays matching the piece arrays, by name
+  std::vector<std::pair<vtkDataArray*, vtkDataArray*> > PointArrays;
+  std::vector<std::pair<vtkDataArray*, vtkDataArray*> > CellArrays;
+};
+
+//-----------------------------------------------------------------------------
+// Clips and tetrahedralizes a range of pieces, each with its own filters
+class vtkImageParallelClipPieceFunctor
+{
+public:
+  vtkImageData* Input;
+  vtkDataArray* Values;
+  double Value;
+  int InsideOut;
+  int Tetrahedralize;
+  std::vector<vtkImageParallelClipPiece>* Pieces;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType p = begin; p < end; ++p)
+      {
+      this->ClipPiece((*this->Pieces)[p]);
+      }
+    }
+
+  void ClipPiece(vtkImageParallelClipPiece& piece)
+    {
+    int inExt[6];
+    this->Input->GetExtent(inExt);
+    vtkIdType sliceSize =
+      static_cast<vtkIdType>(inExt[1] - inExt[0] + 1) *
+      (inExt[3] - inExt[2] + 1);
+    vtkIdType cellSliceSize =
+      static_cast<vtkIdType>(inExt[1] - inExt[0]) * (inExt[3] - inExt[2]);
+    vtkIdType slices = piece.Extent[5] - piece.Extent[4];
+
+    // The slab is contiguous in the input arrays
+    vtkNew<vtkImageData> slab;
+    slab->SetExtent(piece.Extent);
+    slab->SetOrigin(this->Input->GetOrigin());
+    slab->SetSpacing(this->Input->GetSpacing());
+    vtkIdType firstSlice = piece.Extent[4] - inExt[4];
+    vtkImageParallelClipCopyTuples(this->Input->GetPointData(),
+                                   slab->GetPointData(),
+                                   firstSlice*sliceSize,
+                                   (slices + 1)*sliceSize);
+    vtkImageParallelClipCopyTuples(this->Input->GetCellData(),
+                                   slab->GetCellData(),
+                                   firstSlice*cellSliceSize,
+                                   slices*cellSliceSize);
+
+    vtkNew<vtkDoubleArray> values;
+    values->SetName(vtkImageParallelClipValues);
+    values->SetNumberOfTuples((slices + 1)*sliceSize);
+    memcpy(values->GetVoidPointer(0),
+           this->Values->GetVoidPointer(firstSlice*sliceSize),
+           (slices + 1)*sliceSize*sizeof(double));
+    slab->GetPointData()->AddArray(values.GetPointer());
+
+    vtkNew<vtkClipDataSet> clip;
+    clip->SetInputData(slab.GetPointer());
+    clip->SetInputArrayToProcess(0, 0, 0,
+                                 vtkDataObject::FIELD_ASSOCIATION_POINTS,
+                                 vtkImageParallelClipValues);
+    clip->SetValue(this->Value);
+    clip->SetInsideOut(this->InsideOut);
+    clip->GenerateClipScalarsOff();
+
+    piece.Output = vtkSmartPointer<vtkUnstructuredGrid>::New();
+    if (this->Tetrahedralize)
+      {
+      vtkNew<vtkDataSetTriangleFilter> tetrahedralize;
+      tetrahedralize->SetInputConnection(clip->GetOutputPort());
+      tetrahedralize->Update();
+      piece.Output->ShallowCopy(tetrahedralize->GetOutput());
+      }
+    else
+      {
+      clip->Update();
+      piece.Output->ShallowCopy(clip->GetOutput());
+      }
+    piece.Output->GetPointData()->RemoveArray(vtkImageParallelClipValues);
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Copies the points, cells and attributes of a range of pieces to their
+// place in the output
+class vtkImageParallelClipMergeFunctor
+{
+public:
+  std::vector<vtkImageParallelClipPiece>* Pieces;
+  vtkPoints* Points;
+  vtkUnsignedCharArray* Types;
+  vtkIdTypeArray* Locations;
+  vtkIdTypeArray* Connectivity;
+
+  static void CopyTuple(vtkDataArray* in, vtkIdType inId,
+                        vtkDataArray* out, vtkIdType outId)
+    {
+    int nc = in->GetNumberOfComponents();
+    int size = nc*in->GetDataTypeSize();
+    memcpy(static_cast<char*>(out->GetVoidPointer(0)) + outId*size,
+           static_cast<char*>(in->GetVoidPointer(0)) + inId*size, size);
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType p = begin; p < end; ++p)
+      {
+      vtkImageParallelClipPiece& piece = (*this->Pieces)[p];
+      vtkUnstructuredGrid* grid = piece.Output;
+
+      // Points owned by the piece, the shared ones were copied by the
+      // previous piece
+      vtkIdType numPoints = grid->GetNumberOfPoints();
+      vtkDataArray* points = (numPoints > 0 ? grid->GetPoints()->GetData() :
+                              NULL);
+      for (vtkIdType i = 0; i < numPoints; ++i)
+        {
+        vtkIdType id = piece.PointIds[i];
+        if (id < piece.FirstPointId)
+          {
+          continue;
+          }
+        CopyTuple(points, i, this->Points->GetData(), id);
+        for (size_t a = 0; a < piece.PointArrays.size(); ++a)
+          {
+          CopyTuple(piece.PointArrays[a].first, i,
+                    piece.PointArrays[a].second, id);
+          }
+        }
+
+      // Cells, with their point ids renumbered
+      vtkIdType numCells = grid->GetNumberOfCells();
+      if (numCells == 0)
+        {
+        continue;
+        }
+      const vtkIdType* in = grid->GetCells()->GetPointer();
+      const unsigned char* types = grid->GetCellTypesArray()->GetPointer(0);
+      vtkIdType* out =
+        this->Connectivity->GetPointer(piece.FirstConnectivityId);
+      vtkIdType location = piece.FirstConnectivityId;
+      for (vtkIdType c = 0; c < numCells; ++c)
+        {
+        vtkIdType cellId = piece.FirstCellId + c;
+        this->Types->SetValue(cellId, types[c]);
+        this->Locations->SetValue(cellId, location);
+        vtkIdType npts = *in++;
+        *out++ = npts;
+        for (vtkIdType i = 0; i < npts; ++i)
+          {
+          *out++ = piece.PointIds[*in++];
+          }
+        location += npts + 1;
+        for (size_t a = 0; a < piece.CellArrays.size(); ++a)
+          {
+          CopyTuple(piece.CellArrays[a].first, c,
+                    piece.CellArrays[a].second, cellId);
+          }
+        }
+      }
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Create the output arrays from the arrays of a piece
+static void vtkImageParallelClipAllocate(vtkDataSetAttributes* in,
+                                         vtkDataSetAttributes* out,
+                                         vtkIdType count)
+{
+  for (int a = 0; a < in->GetNumberOfArrays(); ++a)
+    {
+    vtkDataArray* array = in->GetArray(a);
+    if (!array || !array->GetName())
+      {
+      continue;
+      }
+    vtkDataArray* copy = array->NewInstance();
+    copy->SetName(array->GetName());
+    copy->SetNumberOfComponents(array->GetNumberOfComponents());
+    copy->SetNumberOfTuples(count);
+    int index = out->AddArray(copy);
+    copy->Delete();
+    int attribute = in->IsArrayAnAttribute(a);
+    if (attribute >= 0)
+      {
+      out->SetActiveAttribute(index, attribute);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Match the arrays of a piece with the output arrays of the same name
+static void vtkImageParallelClipMatchArrays(
+  vtkDataSetAttributes* in, vtkDataSetAttributes* out,
+  std::vector<std::pair<vtkDataArray*, vtkDataArray*> >& arrays)
+{
+  arrays.clear();
+  for (int a = 0; a < out->GetNumberOfArrays(); ++a)
+    {
+    vtkDataArray* outArray = out->GetArray(a);
+    vtkDataArray* inArray = in->GetArray(outArray->GetName());
+    if (inArray && inArray->GetDataType() == outArray->GetDataType() &&
+        inArray->GetNumberOfComponents() ==
+        outArray->GetNumberOfComponents())
+      {
+      arrays.push_back(std::make_pair(inArray, outArray));
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkImageParallelClip::vtkImageParallelClip()
+{
+  this->ClipFunction = NULL;
+  this->Value = 0.0;
+  this->InsideOut = 0;
+  this->Tetrahedralize = 1;
+  this->NumberOfPieces = 64;
+}
+
+//-----------------------------------------------------------------------------
+vtkImageParallelClip::~vtkImageParallelClip()
+{
+  this->SetClipFunction(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageParallelClip::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ClipFunction: " << this->ClipFunction << "\n";
+  os << indent << "Value: " << this->Value << "\n";
+  os << indent << "InsideOut: " << this->InsideOut << "\n";
+  os << indent << "Tetrahedralize: " << this->Tetrahedralize << "\n";
+  os << indent << "NumberOfPieces: " << this->NumberOfPieces << "\n";
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImageParallelClip::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  if (this->ClipFunction && this->ClipFunction->GetMTime() > mTime)
+    {
+    mTime = this->ClipFunction->GetMTime();
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageParallelClip::FillInputPortInformation(int vtkNotUsed(port),
+                                                   vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageParallelClip::ComputeClipValues(vtkImageData* input,
+                                             vtkDataArray* values)
+{
+  vtkImageParallelClipEvaluateFunctor functor;
+  functor.Function = this->ClipFunction;
+  functor.Matrix = NULL;
+  input->GetExtent(functor.Extent);
+  input->GetOrigin(functor.Origin);
+  input->GetSpacing(functor.Spacing);
+  functor.Values = static_cast<double*>(values->GetVoidPointer(0));
+  vtkIdType numSlices = functor.Extent[5] - functor.Extent[4] + 1;
+
+  double matrix[16];
+  vtkAbstractTransform* transform = this->ClipFunction->GetTransform();
+  if (transform)
+    {
+    vtkLinearTransform* linear = vtkLinearTransform::SafeDownCast(transform);
+    if (!linear)
+      {
+      // Other transforms are not known to be thread safe
+      vtkIdType numPts = input->GetNumberOfPoints();
+      for (vtkIdType id = 0; id < numPts; ++id)
+        {
+        double x[3];
+        input->GetPoint(id, x);
+        functor.Values[id] = this->ClipFunction->FunctionValue(x);
+        }
+      return;
+      }
+    linear->Update();
+    vtkMatrix4x4* m = linear->GetMatrix();
+    for (int i = 0; i < 16; ++i)
+      {
+      matrix[i] = m->GetElement(i / 4, i % 4);
+      }
+    functor.Matrix = matrix;
+    }
+
+  vtkSMPTools::For(0, numSlices, 1, functor);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageParallelClip::RequestData(vtkInformation* vtkNotUsed(request),
+                                      vtkInformationVector** inputVector,
+                                      vtkInformationVector* outputVector)
+{
+  vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+  vtkUnstructuredGrid* output = vtkUnstructuredGrid::GetData(outputVector);
+  if (!input || !output)
+    {
+    return 0;
+    }
+  if (!this->ClipFunction)
+    {
+    vtkErrorMacro(<< "No clip function specified");
+    return 0;
+    }
+
+  int extent[6];
+  input->GetExtent(extent);
+  if (extent[0] >= extent[1] || extent[2] >= extent[3] ||
+      extent[4] >= extent[5])
+    {
+    vtkErrorMacro(<< "The input must be a 3D image");
+    return 0;
+    }
+
+  vtkNew<vtkDoubleArray> values;
+  values->SetNumberOfTuples(input->GetNumberOfPoints());
+  this->ComputeClipValues(input, values.GetPointer());
+
+  // Split the cells along z into slabs, independently of the threads
+  int numCellSlices = extent[5] - extent[4];
+  int numPieces = (this->NumberOfPieces < numCellSlices ?
+                   this->NumberOfPieces : numCellSlices);
+  std::vector<vtkImageParallelClipPiece> pieces(numPieces);
+  for (int p = 0; p < numPieces; ++p)
+    {
+    memcpy(pieces[p].Extent, extent, sizeof(extent));
+    pieces[p].Extent[4] = extent[4] + p*numCellSlices/numPieces;
+    pieces[p].Extent[5] = extent[4] + (p + 1)*numCellSlices/numPieces;
+    }
+
+  vtkImageParallelClipPieceFunctor clipFunctor;
+  clipFunctor.Input = input;
+  clipFunctor.Values = values.GetPointer();
+  clipFunctor.Value = this->Value;
+  clipFunctor.InsideOut = this->InsideOut;
+  clipFunctor.Tetrahedralize = this->Tetrahedralize;
+  clipFunctor.Pieces = &pieces;
+  vtkSMPTools::For(0, numPieces, 1, clipFunctor);
+
+  // Number the output points in piece order. A point on the plane a slab
+  // shares with the previous one takes the id the previous slab gave it.
+  typedef std::map<std::pair<double, std::pair<double, double> >,
+                   vtkIdType> PlaneMap;
+  PlaneMap previousTop;
+  double origin[3], spacing[3];
+  input->GetOrigin(origin);
+  input->GetSpacing(spacing);
+  double tol = 1e-6*fabs(spacing[2]);
+  vtkIdType numPoints = 0;
+  vtkIdType numCells = 0;
+  vtkIdType numEntries = 0;
+  int templatePiece = -1;
+  for (int p = 0; p < numPieces; ++p)
+    {
+    vtkImageParallelClipPiece& piece = pieces[p];
+    vtkUnstructuredGrid* grid = piece.Output;
+    double zBottom = origin[2] + piece.Extent[4]*spacing[2];
+    double zTop = origin[2] + piece.Extent[5]*spacing[2];
+    vtkIdType n = grid->GetNumberOfPoints();
+    PlaneMap top;
+
+    piece.FirstPointId = numPoints;
+    piece.PointIds.resize(n);
+    for (vtkIdType i = 0; i < n; ++i)
+      {
+      double x[3];
+      grid->GetPoint(i, x);
+      PlaneMap::key_type key(x[2], std::make_pair(x[0], x[1]));
+      vtkIdType id = -1;
+      if (fabs(x[2] - zBottom) <= tol)
+        {
+        PlaneMap::iterator it = previousTop.find(key);
+        if (it != previousTop.end())
+          {
+          id = it->second;
+          }
+        }
+      if (id < 0)
+        {
+        id = numPoints++;
+        }
+      piece.PointIds[i] = id;
+      if (fabs(x[2] - zTop) <= tol)
+        {
+        top[key] = id;
+        }
+      }
+    previousTop.swap(top);
+
+    piece.FirstCellId = numCells;
+    piece.FirstConnectivityId = numEntries;
+    numCells += grid->GetNumberOfCells();
+    numEntries += grid->GetCells()->GetNumberOfConnectivityEntries();
+    if (templatePiece < 0 && n > 0)
+      {
+      templatePiece = p;
+      }
+    }
+
+  if (templatePiece < 0)
+    {
+    return 1;
+    }
+
+  // Allocate the output and copy the pieces in parallel
+  vtkUnstructuredGrid* templateGrid = pieces[templatePiece].Output;
+  vtkNew<vtkPoints> points;
+  points->SetDataType(templateGrid->GetPoints()->GetDataType());
+  points->SetNumberOfPoints(numPoints);
+  vtkImageParallelClipAllocate(templateGrid->GetPointData(),
+                               output->GetPointData(), numPoints);
+  vtkImageParallelClipAllocate(templateGrid->GetCellData(),
+                               output->GetCellData(), numCells);
+  for (int p = 0; p < numPieces; ++p)
+    {
+    vtkImageParallelClipMatchArrays(pieces[p].Output->GetPointData(),
+                                    output->GetPointData(),
+                                    pieces[p].PointArrays);
+    vtkImageParallelClipMatchArrays(pieces[p].Output->GetCellData(),
+                                    output->GetCellData(),
+                                    pieces[p].CellArrays);
+    }
+
+  vtkNew<vtkUnsignedCharArray> types;
+  types->SetNumberOfTuples(numCells);
+  vtkNew<vtkIdTypeArray> locations;
+  locations->SetNumberOfTuples(numCells);
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfTuples(numEntries);
+
+  vtkImageParallelClipMergeFunctor mergeFunctor;
+  mergeFunctor.Pieces = &pieces;
+  mergeFunctor.Points = points.GetPointer();
+  mergeFunctor.Types = types.GetPointer();
+  mergeFunctor.Locations = locations.GetPointer();
+  mergeFunctor.Connectivity = connectivity.GetPointer();
+  vtkSMPTools::For(0, numPieces, 1, mergeFunctor);
+
+  vtkNew<vtkCellArray> cells;
+  cells->SetCells(numCells, connectivity.GetPointer());
+  output->SetPoints(points.GetPointer());
+  output->SetCells(types.GetPointer(), locations.GetPointer(),
+                   cells.GetPointer());
+  return 1;
+}
@@ -0,0 +1,117 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageParallelClip.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageParallelClip - clip and tetrahedralize a volume with an
+// implicit function on several threads.
+//
+// .SECTION Description
+// vtkImageParallelClip produces the output of vtkClipDataSet followed by
+// vtkDataSetTriangleFilter on a vtkImageData, using all the threads of
+// vtkSMPTools.
+//
+// The implicit function is evaluated at every point in parallel. Functions
+// without a transform or with a linear transform are evaluated with
+// EvaluateFunction() on transformed points, which is thread safe for the
+// VTK implicit functions; other transforms are evaluated on one thread.
+//
+// The volume is then split into NumberOfPieces slabs along z that are
+// clipped and tetrahedralized independently, each by its own filters. The
+// pieces are merged in order into a single vtkUnstructuredGrid, merging the
+// points that neighbouring slabs share on their common plane. The
+// decomposition does not depend on the number of threads, so the output is
+// identical whatever the number of threads and from one run to the next.
+//
+// .SECTION see also
+// vtkClipDataSet vtkDataSetTriangleFilter vtkImageHybridClip vtkSMPTools
+
+#ifndef __vtkImageParallelClip_h
+#define __vtkImageParallelClip_h
+
+#include <vtkUnstructuredGridAlgorithm.h>
+
+// Forward declarations
+class vtkDataArray;
+class vtkImageData;
+class vtkImplicitFunction;
+class vtkInformation;
+class vtkInformationVector;
+
+class vtkImageParallelClip : public vtkUnstructuredGridAlgorithm
+{
+public:
+  static vtkImageParallelClip* New();
+  vtkTypeMacro(vtkImageParallelClip, vtkUnstructuredGridAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/Get the implicit function to clip with
+  virtual void SetClipFunction(vtkImplicitFunction* function);
+  vtkGetObjectMacro(ClipFunction, vtkImplicitFunction);
+
+  // Description:
+  // Set/Get the clipping value of the implicit function (default: 0)
+  vtkSetMacro(Value, double);
+  vtkGetMacro(Value, double);
+
+  // Description:
+  // Set/Get whether the points where the function is lower than Value are
+  // kept instead of the ones where it is greater (default: off)
+  vtkSetMacro(InsideOut, int);
+  vtkGetMacro(InsideOut, int);
+  vtkBooleanMacro(InsideOut, int);
+
+  // Description:
+  // Set/Get whether the clipped cells are converted to tetrahedra
+  // (default: on)
+  vtkSetMacro(Tetrahedralize, int);
+  vtkGetMacro(Tetrahedralize, int);
+  vtkBooleanMacro(Tetrahedralize, int);
+
+  // Description:
+  // Set/Get the number of slabs the volume is split into (default: 64).
+  // It is clamped to the number of cells along z. It changes the order of
+  // the output points and cells, but not the number of threads.
+  vtkSetClampMacro(NumberOfPieces, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfPieces, int);
+
+  // Description:
+  // Include the clip function modification time
+  unsigned long GetMTime();
+
+protected:
+  vtkImageParallelClip();
+  ~vtkImageParallelClip();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info);
+
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  // Description:
+  // Evaluate the clip function at every point of the input
+  void ComputeClipValues(vtkImageData* input, vtkDataArray* values);
+
+  vtkImplicitFunction* ClipFunction;
+  double Value;
+  int InsideOut;
+  int Tetrahedralize;
+  int NumberOfPieces;
+
+private:
+  vtkImageParallelClip(const vtkImageParallelClip&); // Not implemented
+  void operator=(const vtkImageParallelClip&); // Not implemented
+};
+
+#endif //__vtkImageParallelClip_h
@@ -0,0 +1,580 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageParallelXMLReader.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageParallelXMLReader.h"
+
+#include <vtkByteSwap.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkVersionMacros.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLDataParser.h>
+#include <vtkZLibDataCompressor.h>
+
+#if VTK_MAJOR_VERSION > 8 || \
+    (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 2)
+#define VTK_IMAGE_PARALLEL_XML_READER_LZ4
+#include <vtkLZ4DataCompressor.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+vtkStandardNewMacro(vtkImageParallelXMLReader);
+
+//-----------------------------------------------------------------------------
+// Geometry of the image and layout of its scalars in the file. The blocks
+// are stored one after the other in a stream that starts at StreamPosition
+// in the file, base64 encoded or not. Block b takes the bytes
+// [BlockOffsets[b], BlockOffsets[b+1]) of the decoded stream and inflates
+// to BlockSizes[b] bytes at OutputOffsets[b] in the scalars.
+class vtkImageParallelXMLReaderInternals
+{
+public:
+  int WholeExtent[6];
+  double Origin[3];
+  double Spacing[3];
+  int ScalarType;
+  int NumberOfComponents;
+  std::string Name;
+  std::string Compressor;
+  bool Base64;
+  bool SwapBytes;
+  vtkTypeInt64 StreamPosition;
+  std::vector<vtkTypeInt64> BlockOffsets;
+  std::vector<vtkTypeInt64> BlockSizes;
+  std::vector<vtkTypeInt64> OutputOffsets;
+};
+
+//-----------------------------------------------------------------------------
+static int vtkImageParallelXMLReaderBase64Value(unsigned char c)
+{
+  if (c >= 'A' && c <= 'Z')
+    {
+    return c - 'A';
+    }
+  if (c >= 'a' && c <= 'z')
+    {
+    return c - 'a' + 26;
+    }
+  if (c >= '0' && c <= '9')
+    {
+    return c - '0' + 52;
+    }
+  return (c == '+' ? 62 : (c == '/' ? 63 : -1));
+}
+
+//-----------------------------------------------------------------------------
+// Decode whole quartets of base64 characters, return the number of bytes
+// decoded. Stops at padding or at the first invalid character.
+static size_t vtkImageParallelXMLReaderDecode(const unsigned char* in,
+                                              size_t numChars,
+                                              unsigned char* out)
+{
+  size_t n = 0;
+  for (size_t i = 0; i + 4 <= numChars; i += 4, in += 4)
+    {
+    int a = vtkImageParallelXMLReaderBase64Value(in[0]);
+    int b = vtkImageParallelXMLReaderBase64Value(in[1]);
+    if (a < 0 || b < 0)
+      {
+      break;
+      }
+    out[n++] = static_cast<unsigned char>((a << 2) | (b >> 4));
+    int c = vtkImageParallelXMLReaderBase64Value(in[2]);
+    if (c < 0)
+      {
+      break;
+      }
+    out[n++] = static_cast<unsigned char>(((b & 0xf) << 4) | (c >> 2));
+    int d = vtkImageParallelXMLReaderBase64Value(in[3]);
+    if (d < 0)
+      {
+      break;
+      }
+    out[n++] = static_cast<unsigned char>(((c & 0x3) << 6) | d);
+    }
+  return n;
+}
+
+//-----------------------------------------------------------------------------
+static vtkDataCompressor* vtkImageParallelXMLReaderNewCompressor(
+  const std::string& name)
+{
+  if (name == "vtkZLibDataCompressor")
+    {
+    return vtkZLibDataCompressor::New();
+    }
+#ifdef VTK_IMAGE_PARALLEL_XML_READER_LZ4
+  if (name == "vtkLZ4DataCompressor")
+    {
+    return vtkLZ4DataCompressor::New();
+    }
+#endif
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Decodes and inflates a range of blocks into the scalars
+class vtkImageParallelXMLReaderFunctor
+{
+public:
+  const vtkImageParallelXMLReaderInternals* Info;
+  // The encoded stream, from its first byte
+  const unsigned char* Stream;
+  unsigned char* Output;
+  unsigned char* Status;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    const vtkImageParallelXMLReaderInternals* info = this->Info;
+    vtkSmartPointer<vtkDataCompressor> compressor;
+    if (!info->Compressor.empty())
+      {
+      compressor.TakeReference(
+        vtkImageParallelXMLReaderNewCompressor(info->Compressor));
+      }
+    std::vector<unsigned char> decoded;
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      vtkTypeInt64 first = info->BlockOffsets[b];
+      size_t size = static_cast<size_t>(info->BlockOffsets[b + 1] - first);
+      size_t outSize = static_cast<size_t>(info->BlockSizes[b]);
+      unsigned char* out = this->Output + info->OutputOffsets[b];
+
+      // A block starts in the middle of a quartet of characters unless its
+      // offset is a multiple of 3
+      const unsigned char* in = this->Stream + first;
+      if (info->Base64)
+        {
+        vtkTypeInt64 quartet = first / 3;
+        size_t skip = static_cast<size_t>(first - 3*quartet);
+        size_t numChars = 4*((skip + size + 2)/3);
+        decoded.resize(3*(numChars/4));
+        size_t n = vtkImageParallelXMLReaderDecode(
+          this->Stream + 4*quartet, numChars, &decoded[0]);
+        if (n < skip + size)
+          {
+          this->Status[b] = 0;
+          continue;
+          }
+        in = &decoded[skip];
+        }
+
+      if (compressor)
+        {
+        this->Status[b] =
+          (compressor->Uncompress(in, size, out, outSize) == outSize);
+        }
+      else
+        {
+        memcpy(out, in, size);
+        this->Status[b] = 1;
+        }
+      }
+    }
+};
+
+//-----------------------------------------------------------------------------
+vtkImageParallelXMLReader::vtkImageParallelXMLReader()
+{
+  this->FileName = NULL;
+  this->BlockSize = 3 << 18;
+  this->Internals = new vtkImageParallelXMLReaderInternals;
+  this->SetNumberOfInputPorts(0);
+}
+
+//-----------------------------------------------------------------------------
+vtkImageParallelXMLReader::~vtkImageParallelXMLReader()
+{
+  this->SetFileName(NULL);
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageParallelXMLReader::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: "
+     << (this->FileName ? this->FileName : "(none)") << "\n";
+  os << indent << "BlockSize: " << this->BlockSize << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkImageParallelXMLReader::CanReadFile(const char* fileName)
+{
+  vtkImageParallelXMLReaderInternals info;
+  return (fileName && this->ReadHeader(fileName, &info, 0));
+}
+
+//----------------------------------------------------------------------------
+int vtkImageParallelXMLReader::ReadHeader(
+  const char* fileName, vtkImageParallelXMLReaderInternals* info,
+  int reportErrors)
+{
+  vtkSmartPointer<vtkXMLDataParser> parser =
+    vtkSmartPointer<vtkXMLDataParser>::New();
+  parser->SetFileName(fileName);
+  const char* error = NULL;
+  vtkXMLDataElement* root = (parser->Parse() ? parser->GetRootElement() :
+                             NULL);
+  vtkXMLDataElement* image =
+    (root ? root->FindNestedElementWithName("ImageData") : NULL);
+  vtkXMLDataElement* appended =
+    (root ? root->FindNestedElementWithName("AppendedData") : NULL);
+  vtkXMLDataElement* piece =
+    (image ? image->FindNestedElementWithName("Piece") : NULL);
+  vtkXMLDataElement* pointData =
+    (piece ? piece->FindNestedElementWithName("PointData") : NULL);
+  if (!root || strcmp(root->GetName(), "VTKFile") != 0 || !image ||
+      !piece || !pointData || !appended)
+    {
+    error = "is not an image data file with appended data";
+    }
+
+  // The active scalars, or the first array
+  vtkXMLDataElement* array = NULL;
+  const char* scalarsName =
+    (pointData ? pointData->GetAttribute("Scalars") : NULL);
+  for (int i = 0; !error && i < pointData->GetNumberOfNestedElements(); ++i)
+    {
+    vtkXMLDataElement* element = pointData->GetNestedElement(i);
+    const char* name = element->GetAttribute("Name");
+    if (strcmp(element->GetName(), "DataArray") == 0 &&
+        (!array || (scalarsName && name && strcmp(name, scalarsName) == 0)))
+      {
+      array = element;
+      }
+    }
+  int numberOfPieces = 0;
+  for (int i = 0; !error && i < image->GetNumberOfNestedElements(); ++i)
+    {
+    numberOfPieces +=
+      (strcmp(image->GetNestedElement(i)->GetName(), "Piece") == 0);
+    }
+  if (!error && (!array || numberOfPieces != 1))
+    {
+    error = "does not hold a single piece with point scalars";
+    }
+
+  // Scalar type, from the names vtkXMLWriter uses
+  static const char* typeNames[] =
+    { "Int8", "UInt8", "Int16", "UInt16", "Int32", "UInt32", "Int64",
+      "UInt64", "Float32", "Float64" };
+  static const int types[] =
+    { VTK_TYPE_INT8, VTK_TYPE_UINT8, VTK_TYPE_INT16, VTK_TYPE_UINT16,
+      VTK_TYPE_INT32, VTK_TYPE_UINT32, VTK_TYPE_INT64, VTK_TYPE_UINT64,
+      VTK_TYPE_FLOAT32, VTK_TYPE_FLOAT64 };
+  const char* typeName = (array ? array->GetAttribute("type") : NULL);
+  info->ScalarType = VTK_VOID;
+  for (int i = 0; typeName && i < 10; ++i)
+    {
+    if (strcmp(typeName, typeNames[i]) == 0)
+      {
+      info->ScalarType = types[i];
+      }
+    }
+  const char* format = (array ? array->GetAttribute("format") : NULL);
+  const char* offsetString = (array ? array->GetAttribute("offset") : NULL);
+  if (!error && (info->ScalarType == VTK_VOID || !format ||
+                 strcmp(format, "appended") != 0 || !offsetString))
+    {
+    error = "does not store its scalars in appended format";
+    }
+
+  const char* compressor = (root ? root->GetAttribute("compressor") : NULL);
+  info->Compressor = (compressor ? compressor : "");
+  vtkDataCompressor* probe =
+    vtkImageParallelXMLReaderNewCompressor(info->Compressor);
+  if (!error && compressor && !probe)
+    {
+    error = "uses an unsupported compressor";
+    }
+  if (probe)
+    {
+    probe->Delete();
+    }
+
+  if (error)
+    {
+    if (reportErrors)
+      {
+      vtkErrorMacro(<< fileName << " " << error
+                    << ", read it with vtkXMLImageDataReader");
+      }
+    return 0;
+    }
+
+  // Geometry
+  std::fill(info->Origin, info->Origin + 3, 0.0);
+  std::fill(info->Spacing, info->Spacing + 3, 1.0);
+  int pieceExtent[6];
+  if (image->GetVectorAttribute("WholeExtent", 6, info->WholeExtent) != 6 ||
+      piece->GetVectorAttribute("Extent", 6, pieceExtent) != 6 ||
+      !std::equal(pieceExtent, pieceExtent + 6, info->WholeExtent))
+    {
+    if (reportErrors)
+      {
+      vtkErrorMacro(<< fileName << ": the piece is not the whole extent");
+      }
+    return 0;
+    }
+  image->GetVectorAttribute("Origin", 3, info->Origin);
+  image->GetVectorAttribute("Spacing", 3, info->Spacing);
+  info->NumberOfComponents = 1;
+  array->GetScalarAttribute("NumberOfComponents", info->NumberOfComponents);
+  const char* name = array->GetAttribute("Name");
+  info->Name = (name ? name : "");
+
+  const char* byteOrder = root->GetAttribute("byte_order");
+#ifdef VTK_WORDS_BIGENDIAN
+  info->SwapBytes = (!byteOrder || strcmp(byteOrder, "BigEndian") != 0);
+#else
+  info->SwapBytes = (byteOrder && strcmp(byteOrder, "BigEndian") == 0);
+#endif
+  const char* headerType = root->GetAttribute("header_type");
+  size_t headerSize = (headerType && strcmp(headerType, "UInt64") == 0 ?
+                       8 : 4);
+  const char* encoding = appended->GetAttribute("encoding");
+  info->Base64 = (!encoding || strcmp(encoding, "raw") != 0);
+
+  vtkTypeInt64 offset = 0;
+  std::istringstream offsetStream(offsetString);
+  offsetStream >> offset;
+  vtkTypeInt64 position = parser->GetAppendedDataPosition() + offset;
+
+  // Read the header words: the data size for uncompressed arrays, the
+  // number of blocks, their size, the size of the last one and the
+  // compressed sizes for compressed arrays
+  std::ifstream file(fileName, std::ios::in | std::ios::binary);
+  int compressed = !info->Compressor.empty();
+  size_t numWords = (compressed ? 3 : 1);
+  std::vector<vtkTypeUInt64> words;
+  for (int pass = 0; pass < 1 + compressed; ++pass)
+    {
+    size_t numBytes = numWords*headerSize;
+    size_t numEncoded = (info->Base64 ? 4*((numBytes + 2)/3) : numBytes);
+    std::vector<unsigned char> encoded(numEncoded);
+    std::vector<unsigned char> bytes(numEncoded);
+    file.seekg(static_cast<std::streamoff>(position));
+    file.read(reinterpret_cast<char*>(&encoded[0]),
+              static_cast<std::streamsize>(numEncoded));
+    int valid = !file.fail();
+    if (valid && info->Base64)
+      {
+      valid = (vtkImageParallelXMLReaderDecode(&encoded[0], numEncoded,
+                                               &bytes[0]) >= numBytes);
+      }
+    else
+      {
+      bytes.swap(encoded);
+      }
+    if (!valid)
+      {
+      if (reportErrors)
+        {
+        vtkErrorMacro(<< fileName << ": cannot read the array header");
+        }
+      return 0;
+      }
+    if (info->SwapBytes)
+      {
+      vtkByteSwap::SwapVoidRange(&bytes[0], numWords, headerSize);
+      }
+    words.resize(numWords);
+    for (size_t i = 0; i < numWords; ++i)
+      {
+      if (headerSize == 8)
+        {
+        memcpy(&words[i], &bytes[8*i], 8);
+        }
+      else
+        {
+        vtkTypeUInt32 word;
+        memcpy(&word, &bytes[4*i], 4);
+        words[i] = word;
+        }
+      }
+    if (compressed && pass == 0)
+      {
+      numWords = 3 + static_cast<size_t>(words[0]);
+      }
+    else
+      {
+      position += static_cast<vtkTypeInt64>(numEncoded);
+      }
+    }
+
+  vtkIdType numberOfValues = info->NumberOfComponents;
+  for (int i = 0; i < 3; ++i)
+    {
+    numberOfValues *= info->WholeExtent[2*i+1] - info->WholeExtent[2*i] + 1;
+    }
+  vtkTypeUInt64 dataSize = static_cast<vtkTypeUInt64>(numberOfValues)*
+    vtkDataArray::GetDataTypeSize(info->ScalarType);
+
+  // An uncompressed array is one stream with its header, cut in chunks
+  info->BlockOffsets.clear();
+  info->BlockSizes.clear();
+  info->OutputOffsets.clear();
+  vtkTypeUInt64 total = 0;
+  if (compressed)
+    {
+    info->StreamPosition = position;
+    vtkTypeInt64 streamOffset = 0;
+    for (size_t b = 0; b < static_cast<size_t>(words[0]); ++b)
+      {
+      vtkTypeUInt64 size = (b + 1 == words[0] && words[2] ? words[2] :
+                            words[1]);
+      info->BlockOffsets.push_back(streamOffset);
+      info->BlockSizes.push_back(static_cast<vtkTypeInt64>(size));
+      info->OutputOffsets.push_back(static_cast<vtkTypeInt64>(total));
+      streamOffset += static_cast<vtkTypeInt64>(words[3 + b]);
+      total += size;
+      }
+    info->BlockOffsets.push_back(streamOffset);
+    }
+  else
+    {
+    info->StreamPosition = position - static_cast<vtkTypeInt64>(
+      info->Base64 ? 4*((headerSize + 2)/3) : headerSize);
+    total = words[0];
+    for (vtkTypeUInt64 start = 0; start < total; start += this->BlockSize)
+      {
+      vtkTypeUInt64 size = std::min(static_cast<vtkTypeUInt64>(
+        this->BlockSize), total - start);
+      info->BlockOffsets.push_back(
+        static_cast<vtkTypeInt64>(headerSize + start));
+      info->BlockSizes.push_back(static_cast<vtkTypeInt64>(size));
+      info->OutputOffsets.push_back(static_cast<vtkTypeInt64>(start));
+      }
+    info->BlockOffsets.push_back(
+      static_cast<vtkTypeInt64>(headerSize + total));
+    }
+  if (total != dataSize)
+    {
+    if (reportErrors)
+      {
+      vtkErrorMacro(<< fileName << ": the size of the scalars does not "
+                    << "match the extent");
+      }
+    return 0;
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageParallelXMLReader::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  if (!this->FileName)
+    {
+    vtkErrorMacro(<< "No FileName set");
+    return 0;
+    }
+  vtkImageParallelXMLReaderInternals* info = this->Internals;
+  if (!this->ReadHeader(this->FileName, info, 1))
+    {
+    info->BlockOffsets.clear();
+    return 0;
+    }
+
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),
+               info->WholeExtent, 6);
+  outInfo->Set(vtkDataObject::ORIGIN(), info->Origin, 3);
+  outInfo->Set(vtkDataObject::SPACING(), info->Spacing, 3);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, info->ScalarType,
+                                              info->NumberOfComponents);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageParallelXMLReader::RequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkImageData* output = vtkImageData::GetData(outInfo);
+  const vtkImageParallelXMLReaderInternals* info = this->Internals;
+  if (info->BlockOffsets.empty())
+    {
+    return 0;
+    }
+
+  vtkDataArray* scalars = vtkDataArray::CreateDataArray(info->ScalarType);
+  scalars->SetName(info->Name.c_str());
+  scalars->SetNumberOfComponents(info->NumberOfComponents);
+  int extent[6];
+  std::copy(info->WholeExtent, info->WholeExtent + 6, extent);
+  output->SetExtent(extent);
+  scalars->SetNumberOfTuples(output->GetNumberOfPoints());
+  output->GetPointData()->SetScalars(scalars);
+  scalars->Delete();
+  unsigned char* outPtr =
+    static_cast<unsigned char*>(scalars->GetVoidPointer(0));
+  size_t numBlocks = info->BlockSizes.size();
+  if (numBlocks == 0)
+    {
+    return 1;
+    }
+
+  // Read all the blocks at once, the rest is done in parallel
+  std::ifstream file(this->FileName, std::ios::in | std::ios::binary);
+  vtkTypeInt64 streamSize = info->BlockOffsets.back();
+  size_t encodedSize = static_cast<size_t>(
+    info->Base64 ? 4*((streamSize + 2)/3) : streamSize);
+  std::vector<unsigned char> stream(encodedSize);
+  file.seekg(static_cast<std::streamoff>(info->StreamPosition));
+  if (!file.read(reinterpret_cast<char*>(&stream[0]),
+                 static_cast<std::streamsize>(encodedSize)))
+    {
+    vtkErrorMacro(<< "Cannot read the scalars of " << this->FileName);
+    return 0;
+    }
+
+  std::vector<unsigned char> status(numBlocks, 0);
+  vtkImageParallelXMLReaderFunctor functor;
+  functor.Info = info;
+  functor.Stream = &stream[0];
+  functor.Output = outPtr;
+  functor.Status = &status[0];
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numBlocks), 1, functor);
+  if (std::find(status.begin(), status.end(), 0) != status.end())
+    {
+    vtkErrorMacro(<< "Cannot decompress the scalars of " << this->FileName);
+    return 0;
+    }
+
+  if (info->SwapBytes)
+    {
+    vtkByteSwap::SwapVoidRange(outPtr, scalars->GetNumberOfValues(),
+                               scalars->GetDataTypeSize());
+    }
+  return 1;
+}
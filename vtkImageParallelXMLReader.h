@@ -0,0 +1,97 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageParallelXMLReader.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageParallelXMLReader - read the scalars of a .vti file,
+// decompressing its blocks on all threads.
+//
+// .SECTION Description
+// vtkXMLImageDataReader decompresses the blocks of an appended data array
+// one after the other, into a temporary buffer that is then copied. The
+// blocks are compressed independently though, and the header of the array
+// gives the size of each, so vtkImageParallelXMLReader reads the
+// compressed array in one go and decodes and inflates its blocks with
+// vtkSMPTools, each directly into its place in the output scalars.
+//
+// Only the active point scalars of a single piece image stored in appended
+// format are read, encoded in base64 or raw, compressed with
+// vtkZLibDataCompressor, vtkLZ4DataCompressor (VTK 8.2 and later) or not
+// compressed at all. Uncompressed arrays are decoded in chunks of
+// BlockSize bytes on all threads as well. Other arrays are ignored, and
+// files that cannot be read this way are reported as errors: read them
+// with vtkXMLImageDataReader.
+//
+// The whole extent is always produced.
+//
+// .SECTION see also
+// vtkXMLImageDataReader vtkZLibDataCompressor vtkImageMappedRawReader
+
+#ifndef __vtkImageParallelXMLReader_h
+#define __vtkImageParallelXMLReader_h
+
+#include <vtkImageAlgorithm.h>
+
+// Forward declarations
+class vtkImageParallelXMLReaderInternals;
+class vtkInformation;
+class vtkInformationVector;
+
+class vtkImageParallelXMLReader : public vtkImageAlgorithm
+{
+public:
+  static vtkImageParallelXMLReader* New();
+  vtkTypeMacro(vtkImageParallelXMLReader, vtkImageAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/Get the name of the file to read
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+
+  // Description:
+  // Return 1 if the file is a .vti file whose scalars this reader can read
+  int CanReadFile(const char* fileName);
+
+  // Description:
+  // Set/Get the size of the chunks uncompressed arrays are decoded in
+  // (default: 768 KiB)
+  vtkSetClampMacro(BlockSize, int, 1, VTK_INT_MAX);
+  vtkGetMacro(BlockSize, int);
+
+protected:
+  vtkImageParallelXMLReader();
+  ~vtkImageParallelXMLReader();
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector);
+
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  // Parse the XML of the file and the header of its scalars into info,
+  // return 0 on error
+  int ReadHeader(const char* fileName,
+                 vtkImageParallelXMLReaderInternals* info, int reportErrors);
+
+  char* FileName;
+  int BlockSize;
+  vtkImageParallelXMLReaderInternals* Internals;
+
+private:
+  vtkImageParallelXMLReader(const vtkImageParallelXMLReader&); // Not implemented
+  void operator=(const vtkImageParallelXMLReader&); // Not implemented
+};
+
+#endif //__vtkImageParallelXMLReader_h
@@ -0,0 +1,562 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImagePlaneCutter.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImagePlaneCutter.h"
+
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPlane.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+vtkStandardNewMacro(vtkImagePlaneCutter);
+vtkCxxSetObjectMacro(vtkImagePlaneCutter, Plane, vtkPlane);
+
+//-----------------------------------------------------------------------------
+// Return the axis an index space plane normal is parallel to, or -1
+static int vtkImagePlaneCutterAlignedAxis(const double n[3])
+{
+  for (int a = 0; a < 3; ++a)
+    {
+    double tol = 1e-12*fabs(n[a]);
+    if (n[a] != 0.0 && fabs(n[(a + 1) % 3]) <= tol &&
+        fabs(n[(a + 2) % 3]) <= tol)
+      {
+      return a;
+      }
+    }
+  return -1;
+}
+
+//-----------------------------------------------------------------------------
+vtkImagePlaneCutter::vtkImagePlaneCutter()
+{
+  this->Plane = NULL;
+  this->ViewedPointData = vtkPointData::New();
+}
+
+//-----------------------------------------------------------------------------
+vtkImagePlaneCutter::~vtkImagePlaneCutter()
+{
+  this->SetPlane(NULL);
+  this->ViewedPointData->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkImagePlaneCutter::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Plane: " << this->Plane << "\n";
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImagePlaneCutter::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  if (this->Plane && this->Plane->GetMTime() > mTime)
+    {
+    mTime = this->Plane->GetMTime();
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkImagePlaneCutter::FillInputPortInformation(int vtkNotUsed(port),
+                                                  vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImagePlaneCutter::ComputeIndexPlane(const double origin[3],
+                                            const double spacing[3],
+                                            double n[3], double& d)
+{
+  // n . (origin + ijk*spacing - planeOrigin)
+  double* normal = this->Plane->GetNormal();
+  double* planeOrigin = this->Plane->GetOrigin();
+  d = 0.0;
+  for (int a = 0; a < 3; ++a)
+    {
+    n[a] = normal[a]*spacing[a];
+    d += normal[a]*(origin[a] - planeOrigin[a]);
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkImagePlaneCutter::RequestUpdateExtent(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* vtkNotUsed(outputVector))
+{
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  int wholeExt[6], inExt[6];
+  double origin[3], spacing[3];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExt);
+  inInfo->Get(vtkDataObject::ORIGIN(), origin);
+  inInfo->Get(vtkDataObject::SPACING(), spacing);
+  for (int i = 0; i < 6; ++i)
+    {
+    inExt[i] = wholeExt[i];
+    }
+  if (!this->Plane)
+    {
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), inExt, 6);
+    return 1;
+    }
+
+  double n[3], d;
+  this->ComputeIndexPlane(origin, spacing, n, d);
+
+  // Bounding box of the points where the plane meets the edges of the
+  // whole extent
+  double lo[3] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX };
+  double hi[3] = { -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  for (int c = 0; c < 8; ++c)
+    {
+    for (int b = 0; b < 3; ++b)
+      {
+      if (c & (1 << b))
+        {
+        continue;
+        }
+      double x0[3], x1[3];
+      for (int a = 0; a < 3; ++a)
+        {
+        x0[a] = wholeExt[2*a + ((c >> a) & 1)];
+        x1[a] = wholeExt[2*a + (((c | (1 << b)) >> a) & 1)];
+        }
+      double f0 = d + n[0]*x0[0] + n[1]*x0[1] + n[2]*x0[2];
+      double f1 = d + n[0]*x1[0] + n[1]*x1[1] + n[2]*x1[2];
+      if ((f0 < 0.0) == (f1 < 0.0) && f0 != 0.0 && f1 != 0.0)
+        {
+        continue;
+        }
+      double s = (f0 == f1 ? 0.0 : f0/(f0 - f1));
+      for (int a = 0; a < 3; ++a)
+        {
+        double x = x0[a] + s*(x1[a] - x0[a]);
+        lo[a] = (x < lo[a] ? x : lo[a]);
+        hi[a] = (x > hi[a] ? x : hi[a]);
+        }
+      }
+    }
+
+  if (lo[0] > hi[0])
+    {
+    // The plane misses the volume
+    inExt[1] = inExt[0] - 1;
+    }
+  else
+    {
+    for (int a = 0; a < 3; ++a)
+      {
+      int i0 = static_cast<int>(floor(lo[a]));
+      int i1 = static_cast<int>(ceil(hi[a]));
+      inExt[2*a] = (i0 > wholeExt[2*a] ? i0 : wholeExt[2*a]);
+      inExt[2*a+1] = (i1 < wholeExt[2*a+1] ? i1 : wholeExt[2*a+1]);
+      }
+    }
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), inExt, 6);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImagePlaneCutter::RequestData(vtkInformation* vtkNotUsed(request),
+                                     vtkInformationVector** inputVector,
+                                     vtkInformationVector* outputVector)
+{
+  vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+  vtkPolyData* output = vtkPolyData::GetData(outputVector);
+  if (!input || !output)
+    {
+    return 0;
+    }
+  this->ViewedPointData->Initialize();
+  if (!this->Plane)
+    {
+    vtkErrorMacro(<< "No plane specified");
+    return 0;
+    }
+
+  int extent[6];
+  input->GetExtent(extent);
+  if (extent[0] > extent[1] || extent[2] > extent[3] ||
+      extent[4] > extent[5])
+    {
+    return 1;
+    }
+
+  double n[3], d;
+  this->ComputeIndexPlane(input->GetOrigin(), input->GetSpacing(), n, d);
+  int axis = vtkImagePlaneCutterAlignedAxis(n);
+  if (axis >= 0)
+    {
+    this->CutAligned(input, axis, -d/n[axis], output);
+    }
+  else
+    {
+    this->CutOblique(input, n, d, output);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImagePlaneCutter::CutAligned(vtkImageData* input, int axis,
+                                     double t, vtkPolyData* output)
+{
+  int extent[6];
+  input->GetExtent(extent);
+
+  // Snap to the grid plane within a small tolerance
+  int k = static_cast<int>(floor(t));
+  double f = t - k;
+  if (f > 1.0 - 1e-6)
+    {
+    ++k;
+    f = 0.0;
+    }
+  else if (f < 1e-6)
+    {
+    f = 0.0;
+    }
+  if (k < extent[2*axis] || k > extent[2*axis+1] ||
+      (k == extent[2*axis+1] && f > 0.0))
+    {
+    return;
+    }
+
+  // The two in-plane axes, in memory order
+  int u = (axis == 0 ? 1 : 0);
+  int v = (axis == 2 ? 1 : 2);
+  int nu = extent[2*u+1] - extent[2*u] + 1;
+  int nv = extent[2*v+1] - extent[2*v] + 1;
+  vtkIdType numPts = static_cast<vtkIdType>(nu)*nv;
+  double origin[3], spacing[3];
+  input->GetOrigin(origin);
+  input->GetSpacing(spacing);
+
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(numPts);
+  double x[3];
+  x[axis] = origin[axis] + (k + f)*spacing[axis];
+  vtkIdType id = 0;
+  for (int j = extent[2*v]; j <= extent[2*v+1]; ++j)
+    {
+    x[v] = origin[v] + j*spacing[v];
+    for (int i = extent[2*u]; i <= extent[2*u+1]; ++i, ++id)
+      {
+      x[u] = origin[u] + i*spacing[u];
+      points->SetPoint(id, x);
+      }
+    }
+  output->SetPoints(points.GetPointer());
+
+  vtkNew<vtkCellArray> polys;
+  if (nu > 1 && nv > 1)
+    {
+    polys->Allocate(polys->EstimateSize((nu - 1)*(nv - 1), 4));
+    for (int j = 0; j < nv - 1; ++j)
+      {
+      for (int i = 0; i < nu - 1; ++i)
+        {
+        vtkIdType quad[4];
+        quad[0] = static_cast<vtkIdType>(j)*nu + i;
+        quad[1] = quad[0] + 1;
+        quad[2] = quad[1] + nu;
+        quad[3] = quad[0] + nu;
+        polys->InsertNextCell(4, quad);
+        }
+      }
+    }
+  output->SetPolys(polys.GetPointer());
+
+  vtkPointData* inPD = input->GetPointData();
+  vtkPointData* outPD = output->GetPointData();
+  int ijk[3];
+  ijk[axis] = k;
+  if (f == 0.0 && axis == 2)
+    {
+    // The slice is contiguous in the input arrays, share it
+    this->ViewedPointData->ShallowCopy(inPD);
+    vtkIdType offset = (k - extent[4])*numPts;
+    for (int a = 0; a < inPD->GetNumberOfArrays(); ++a)
+      {
+      vtkDataArray* array = inPD->GetArray(a);
+      if (!array)
+        {
+        continue;
+        }
+      int nc = array->GetNumberOfComponents();
+      vtkDataArray* view = array->NewInstance();
+      view->SetName(array->GetName());
+      view->SetNumberOfComponents(nc);
+      view->SetVoidArray(array->GetVoidPointer(offset*nc), numPts*nc, 1);
+      int index = outPD->AddArray(view);
+      view->Delete();
+      int attribute = inPD->IsArrayAnAttribute(a);
+      if (attribute >= 0)
+        {
+        outPD->SetActiveAttribute(index, attribute);
+        }
+      }
+    }
+  else
+    {
+    if (f == 0.0)
+      {
+      outPD->CopyAllocate(inPD, numPts);
+      }
+    else
+      {
+      outPD->InterpolateAllocate(inPD, numPts);
+      }
+    vtkIdType step = 1;
+    for (int a = 0; a < axis; ++a)
+      {
+      step *= extent[2*a+1] - extent[2*a] + 1;
+      }
+    id = 0;
+    for (ijk[v] = extent[2*v]; ijk[v] <= extent[2*v+1]; ++ijk[v])
+      {
+      for (ijk[u] = extent[2*u]; ijk[u] <= extent[2*u+1]; ++ijk[u], ++id)
+        {
+        vtkIdType inId = input->ComputePointId(ijk);
+        if (f == 0.0)
+          {
+          outPD->CopyData(inPD, inId, id);
+          }
+        else
+          {
+          outPD->InterpolateEdge(inPD, id, inId, inId + step, f);
+          }
+        }
+      }
+    }
+
+  // Each quad takes the data of the voxel above it, or below it on the
+  // last grid plane
+  vtkCellData* inCD = input->GetCellData();
+  vtkCellData* outCD = output->GetCellData();
+  vtkIdType numCells = polys->GetNumberOfCells();
+  if (inCD->GetNumberOfArrays() > 0 && numCells > 0)
+    {
+    outCD->CopyAllocate(inCD, numCells);
+    ijk[axis] = (k < extent[2*axis+1] || k == extent[2*axis] ? k : k - 1);
+    id = 0;
+    for (ijk[v] = extent[2*v]; ijk[v] < extent[2*v+1]; ++ijk[v])
+      {
+      for (ijk[u] = extent[2*u]; ijk[u] < extent[2*u+1]; ++ijk[u], ++id)
+        {
+        outCD->CopyData(inCD, input->ComputeCellId(ijk), id);
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImagePlaneCutter::CutOblique(vtkImageData* input, const double n[3],
+                                     double d, vtkPolyData* output)
+{
+  int extent[6];
+  input->GetExtent(extent);
+  double origin[3], spacing[3];
+  input->GetOrigin(origin);
+  input->GetSpacing(spacing);
+
+  // Walk the columns of voxels along the axis the plane is the most
+  // perpendicular to, where it crosses a handful of voxels each
+  int a = 0;
+  for (int b = 1; b < 3; ++b)
+    {
+    a = (fabs(n[b]) > fabs(n[a]) ? b : a);
+    }
+  int u = (a + 1) % 3;
+  int v = (a + 2) % 3;
+  if (extent[2*a] == extent[2*a+1] || extent[2*u] == extent[2*u+1] ||
+      extent[2*v] == extent[2*v+1])
+    {
+    return;
+    }
+
+  vtkIdType estimate = static_cast<vtkIdType>(
+    extent[2*u+1] - extent[2*u] + 1)*(extent[2*v+1] - extent[2*v] + 1);
+  vtkNew<vtkPoints> points;
+  points->Allocate(estimate);
+  vtkNew<vtkCellArray> polys;
+  polys->Allocate(polys->EstimateSize(estimate, 4));
+  vtkPointData* inPD = input->GetPointData();
+  vtkPointData* outPD = output->GetPointData();
+  vtkCellData* inCD = input->GetCellData();
+  vtkCellData* outCD = output->GetCellData();
+  outPD->InterpolateAllocate(inPD, estimate);
+  outCD->CopyAllocate(inCD, estimate);
+
+  // Output points by input point id and edge axis, -1 for the points that
+  // are input points
+  typedef std::map<std::pair<vtkIdType, int>, vtkIdType> PointMap;
+  PointMap pointMap;
+
+  int ijk[3];
+  for (ijk[v] = extent[2*v]; ijk[v] < extent[2*v+1]; ++ijk[v])
+    {
+    for (ijk[u] = extent[2*u]; ijk[u] < extent[2*u+1]; ++ijk[u])
+      {
+      // Range of the plane along the four edges of the column
+      double tMin = VTK_DOUBLE_MAX;
+      double tMax = -VTK_DOUBLE_MAX;
+      for (int c = 0; c < 4; ++c)
+        {
+        double t = -(d + n[u]*(ijk[u] + (c & 1)) +
+                     n[v]*(ijk[v] + (c >> 1)))/n[a];
+        tMin = (t < tMin ? t : tMin);
+        tMax = (t > tMax ? t : tMax);
+        }
+      int k0 = static_cast<int>(floor(tMin));
+      int k1 = static_cast<int>(floor(tMax));
+      k0 = (k0 > extent[2*a] ? k0 : extent[2*a]);
+      k1 = (k1 < extent[2*a+1] - 1 ? k1 : extent[2*a+1] - 1);
+
+      for (ijk[a] = k0; ijk[a] <= k1; ++ijk[a])
+        {
+        // Plane function and point id at the corners of the voxel
+        double f[8];
+        vtkIdType ids[8];
+        int negative = 0;
+        for (int c = 0; c < 8; ++c)
+          {
+          int corner[3] = { ijk[0] + (c & 1), ijk[1] + ((c >> 1) & 1),
+                            ijk[2] + ((c >> 2) & 1) };
+          f[c] = d + n[0]*corner[0] + n[1]*corner[1] + n[2]*corner[2];
+          ids[c] = input->ComputePointId(corner);
+          negative += (f[c] < 0.0);
+          }
+        if (negative == 0 || negative == 8)
+          {
+          continue;
+          }
+
+        // Intersect the twelve edges, sharing the points with the
+        // neighbouring voxels
+        vtkIdType polygon[12];
+        double angle[12];
+        double center[3] = { 0.0, 0.0, 0.0 };
+        double positions[12][3];
+        int size = 0;
+        for (int c = 0; c < 8; ++c)
+          {
+          for (int b = 0; b < 3; ++b)
+            {
+            int c1 = c | (1 << b);
+            if (c1 == c || (f[c] < 0.0) == (f[c1] < 0.0))
+              {
+              continue;
+              }
+            double s = f[c]/(f[c] - f[c1]);
+            PointMap::key_type key(ids[c], b);
+            if (s == 0.0)
+              {
+              key = PointMap::key_type(ids[c], -1);
+              }
+            else if (s == 1.0)
+              {
+              key = PointMap::key_type(ids[c1], -1);
+              }
+            double x[3];
+            for (int e = 0; e < 3; ++e)
+              {
+              double i0 = ijk[e] + ((c >> e) & 1);
+              double i1 = ijk[e] + ((c1 >> e) & 1);
+              x[e] = i0 + s*(i1 - i0);
+              }
+            vtkIdType id;
+            PointMap::iterator it = pointMap.find(key);
+            if (it != pointMap.end())
+              {
+              id = it->second;
+              }
+            else
+              {
+              double world[3];
+              for (int e = 0; e < 3; ++e)
+                {
+                world[e] = origin[e] + x[e]*spacing[e];
+                }
+              id = points->InsertNextPoint(world);
+              outPD->InterpolateEdge(inPD, id, ids[c], ids[c1], s);
+              pointMap[key] = id;
+              }
+            if (std::find(polygon, polygon + size, id) != polygon + size)
+              {
+              continue;
+              }
+            polygon[size] = id;
+            for (int e = 0; e < 3; ++e)
+              {
+              positions[size][e] = x[e];
+              center[e] += x[e];
+              }
+            ++size;
+            }
+          }
+        if (size < 3)
+          {
+          continue;
+          }
+
+        // The intersection of a plane and a box is convex, order its
+        // points by angle around their center
+        for (int e = 0; e < 3; ++e)
+          {
+          center[e] /= size;
+          }
+        for (int p = 0; p < size; ++p)
+          {
+          angle[p] = atan2(positions[p][v] - center[v],
+                           positions[p][u] - center[u]);
+          }
+        for (int p = 1; p < size; ++p)
+          {
+          for (int q = p; q > 0 && angle[q] < angle[q-1]; --q)
+            {
+            std::swap(angle[q], angle[q-1]);
+            std::swap(polygon[q], polygon[q-1]);
+            }
+          }
+        vtkIdType cellId = polys->InsertNextCell(size, polygon);
+        outCD->CopyData(inCD, input->ComputeCellId(ijk), cellId);
+        }
+      }
+    }
+
+  points->Squeeze();
+  outPD->Squeeze();
+  outCD->Squeeze();
+  output->SetPoints(points.GetPointer());
+  output->SetPolys(polys.GetPointer());
+}
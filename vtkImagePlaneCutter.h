@@ -0,0 +1,115 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImagePlaneCutter.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImagePlaneCutter - cut a vtkImageData with a plane, visiting only
+// the voxels the plane goes through.
+//
+// .SECTION Description
+// vtkImagePlaneCutter produces the same cut surface as vtkCutter with a
+// vtkPlane cut function on a vtkImageData, as a vtkPolyData with the input
+// point data interpolated on the surface and the cell data of the cut
+// voxels. Its cost scales with the area of the cut instead of the size of
+// the volume:
+//
+// When the plane is perpendicular to an axis, the slice is computed
+// directly as a grid of quads. If the plane lies on a grid plane, its point
+// data is copied, or when the plane is perpendicular to z, shared with the
+// input arrays without copy. Otherwise, it is interpolated between the two
+// neighbouring grid planes.
+//
+// Other planes are polygonized voxel by voxel, only visiting along each
+// column of voxels the few ones the plane crosses.
+//
+// Only the slab of the input that the plane goes through is requested
+// upstream.
+//
+// .SECTION Caveats
+// The point data of a z slice on a grid plane references the memory of the
+// input arrays. Modifying the input arrays in place modifies the output.
+//
+// .SECTION see also
+// vtkCutter vtkPlane vtkImageReslice
+
+#ifndef __vtkImagePlaneCutter_h
+#define __vtkImagePlaneCutter_h
+
+#include <vtkPolyDataAlgorithm.h>
+
+// Forward declarations
+class vtkImageData;
+class vtkInformation;
+class vtkInformationVector;
+class vtkPlane;
+class vtkPointData;
+class vtkPolyData;
+
+class vtkImagePlaneCutter : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkImagePlaneCutter* New();
+  vtkTypeMacro(vtkImagePlaneCutter, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/Get the plane to cut with
+  virtual void SetPlane(vtkPlane* plane);
+  vtkGetObjectMacro(Plane, vtkPlane);
+
+  // Description:
+  // Include the plane modification time
+  unsigned long GetMTime();
+
+protected:
+  vtkImagePlaneCutter();
+  ~vtkImagePlaneCutter();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info);
+
+  virtual int RequestUpdateExtent(vtkInformation* request,
+                                  vtkInformationVector** inputVector,
+                                  vtkInformationVector* outputVector);
+
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+
+  // Description:
+  // Compute the plane in the index space of an image, as the coefficients
+  // of n . ijk + d, of the same sign as the plane function
+  void ComputeIndexPlane(const double origin[3], const double spacing[3],
+                         double n[3], double& d);
+
+  // Description:
+  // Cut the input with a plane perpendicular to the given axis at the
+  // continuous index position t along that axis
+  void CutAligned(vtkImageData* input, int axis, double t,
+                  vtkPolyData* output);
+
+  // Description:
+  // Polygonize the voxels of the input that the index space plane n, d
+  // goes through
+  void CutOblique(vtkImageData* input, const double n[3], double d,
+                  vtkPolyData* output);
+
+  vtkPlane* Plane;
+
+  // Keeps the input arrays the output shares memory with alive
+  vtkPointData* ViewedPointData;
+
+private:
+  vtkImagePlaneCutter(const vtkImagePlaneCutter&); // Not implemented
+  void operator=(const vtkImagePlaneCutter&); // Not implemented
+};
+
+#endif //__vtkImagePlaneCutter_h
@@ -0,0 +1,508 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImagePlaneSampler.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImagePlaneSampler.h"
+
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+vtkStandardNewMacro(vtkImagePlaneSampler);
+
+// Linear samples slightly outside of the extent are kept, so that planes
+// lying exactly on the first or last voxel plane are sampled
+static const double vtkPlaneSamplerTolerance = 1e-6;
+
+//-----------------------------------------------------------------------------
+// A clipped row, as walked by the kernels
+struct vtkPlaneSamplerRow
+{
+  double X[3];
+  double Step[3];
+  int Extent[6];
+  vtkIdType Increments[3];
+  int Count;
+};
+
+//-----------------------------------------------------------------------------
+// Return 1 when the coordinate x along one axis lies in [lo, hi]
+static inline int vtkPlaneSamplerInside(double x, int lo, int hi,
+                                        int linear)
+{
+  if (linear)
+    {
+    return (x >= lo - vtkPlaneSamplerTolerance &&
+            x <= hi + vtkPlaneSamplerTolerance);
+    }
+  return (x >= lo - 0.5 && x < hi + 0.5);
+}
+
+//-----------------------------------------------------------------------------
+template <class T>
+static void vtkPlaneSamplerNearest(const T* ptr,
+                                   const vtkPlaneSamplerRow& row,
+                                   double* values)
+{
+  const int* ext = row.Extent;
+  const vtkIdType* inc = row.Increments;
+  double x[3] = { row.X[0], row.X[1], row.X[2] };
+  for (int n = 0; n < row.Count; ++n)
+    {
+    vtkIdType offset = 0;
+    for (int c = 0; c < 3; ++c)
+      {
+      // The walk may drift past the clipped bounds by a rounding error
+      int i = vtkMath::Floor(x[c] + 0.5);
+      i = (i < ext[2*c] ? ext[2*c] : (i > ext[2*c+1] ? ext[2*c+1] : i));
+      offset += (i - ext[2*c])*inc[c];
+      x[c] += row.Step[c];
+      }
+    values[n] = ptr[offset];
+    }
+}
+
+//-----------------------------------------------------------------------------
+template <class T>
+static void vtkPlaneSamplerLinear(const T* ptr, const vtkPlaneSamplerRow& row,
+                                  double* values)
+{
+  const int* ext = row.Extent;
+  const vtkIdType* inc = row.Increments;
+  double x[3] = { row.X[0], row.X[1], row.X[2] };
+  for (int n = 0; n < row.Count; ++n)
+    {
+    vtkIdType offset[2][3];
+    double f[3];
+    for (int c = 0; c < 3; ++c)
+      {
+      double lo = ext[2*c];
+      double hi = ext[2*c+1];
+      double xc = (x[c] < lo ? lo : (x[c] > hi ? hi : x[c]));
+      int i0 = vtkMath::Floor(xc);
+      int i1 = (i0 < ext[2*c+1] ? i0 + 1 : i0);
+      f[c] = xc - i0;
+      offset[0][c] = (i0 - ext[2*c])*inc[c];
+      offset[1][c] = (i1 - ext[2*c])*inc[c];
+      x[c] += row.Step[c];
+      }
+
+    double v[2][2][2];
+    for (int k = 0; k < 2; ++k)
+      {
+      for (int j = 0; j < 2; ++j)
+        {
+        const T* p = ptr + offset[k][2] + offset[j][1];
+        v[k][j][0] = p[offset[0][0]];
+        v[k][j][1] = p[offset[1][0]];
+        }
+      }
+    double v00 = v[0][0][0] + f[0]*(v[0][0][1] - v[0][0][0]);
+    double v01 = v[0][1][0] + f[0]*(v[0][1][1] - v[0][1][0]);
+    double v10 = v[1][0][0] + f[0]*(v[1][0][1] - v[1][0][0]);
+    double v11 = v[1][1][0] + f[0]*(v[1][1][1] - v[1][1][0]);
+    double v0 = v00 + f[1]*(v01 - v00);
+    double v1 = v10 + f[1]*(v11 - v10);
+    values[n] = v0 + f[2]*(v1 - v0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+template <class T>
+static void vtkPlaneSamplerExecute(const T* ptr, const vtkPlaneSamplerRow& row,
+                                   int linear, double* values)
+{
+  if (linear)
+    {
+    vtkPlaneSamplerLinear(ptr, row, values);
+    }
+  else
+    {
+    vtkPlaneSamplerNearest(ptr, row, values);
+    }
+}
+
+#if defined(__AVX2__)
+//-----------------------------------------------------------------------------
+// Load the voxels at offset and offset + 1 of 8 samples. The two 16 bit
+// voxels are read with a single 32 bit gather.
+static inline void vtkPlaneSamplerGather(const unsigned short* ptr,
+                                         __m256i offset, __m256& v0,
+                                         __m256& v1)
+{
+  __m256i pair = _mm256_i32gather_epi32(
+    reinterpret_cast<const int*>(ptr), offset, 2);
+  v0 = _mm256_cvtepi32_ps(
+    _mm256_and_si256(pair, _mm256_set1_epi32(0xffff)));
+  v1 = _mm256_cvtepi32_ps(_mm256_srli_epi32(pair, 16));
+}
+
+static inline void vtkPlaneSamplerGather(const short* ptr, __m256i offset,
+                                         __m256& v0, __m256& v1)
+{
+  __m256i pair = _mm256_i32gather_epi32(
+    reinterpret_cast<const int*>(ptr), offset, 2);
+  v0 = _mm256_cvtepi32_ps(
+    _mm256_srai_epi32(_mm256_slli_epi32(pair, 16), 16));
+  v1 = _mm256_cvtepi32_ps(_mm256_srai_epi32(pair, 16));
+}
+
+static inline void vtkPlaneSamplerGather(const float* ptr, __m256i offset,
+                                         __m256& v0, __m256& v1)
+{
+  v0 = _mm256_i32gather_ps(ptr, offset, 4);
+  v1 = _mm256_i32gather_ps(ptr + 1, offset, 4);
+}
+
+//-----------------------------------------------------------------------------
+static inline __m256 vtkPlaneSamplerLerp(__m256 a, __m256 b, __m256 f)
+{
+  return _mm256_add_ps(a, _mm256_mul_ps(f, _mm256_sub_ps(b, a)));
+}
+
+//-----------------------------------------------------------------------------
+// Trilinear kernel for 8 pixels at a time, for single component images
+// with at least two voxels along x. Along x the voxels i and i + 1 are
+// gathered together, so i stops one voxel before the end of the row and
+// the fraction reaches 1 there instead: the gathers never read past the
+// row.
+template <class T>
+static void vtkPlaneSamplerLinearAVX2(const T* ptr,
+                                      const vtkPlaneSamplerRow& row,
+                                      double* values)
+{
+  const int* ext = row.Extent;
+  const __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  __m256i lo[3], hi[3], inc[3];
+  __m256 step[3];
+  for (int c = 0; c < 3; ++c)
+    {
+    lo[c] = _mm256_set1_epi32(ext[2*c]);
+    hi[c] = _mm256_set1_epi32(c == 0 ? ext[1] - 1 : ext[2*c+1]);
+    inc[c] = _mm256_set1_epi32(static_cast<int>(row.Increments[c]));
+    step[c] = _mm256_set1_ps(static_cast<float>(row.Step[c]));
+    }
+
+  int n = 0;
+  for (; n + 8 <= row.Count; n += 8)
+    {
+    __m256i offset = _mm256_setzero_si256();
+    __m256i next[3];
+    __m256 f[3];
+    for (int c = 0; c < 3; ++c)
+      {
+      __m256 x = _mm256_add_ps(
+        _mm256_set1_ps(static_cast<float>(row.X[c] + n*row.Step[c])),
+        _mm256_mul_ps(lane, step[c]));
+      __m256i i = _mm256_cvttps_epi32(_mm256_floor_ps(x));
+      i = _mm256_min_epi32(_mm256_max_epi32(i, lo[c]), hi[c]);
+      f[c] = _mm256_min_ps(
+        _mm256_max_ps(_mm256_sub_ps(x, _mm256_cvtepi32_ps(i)), zero), one);
+      offset = _mm256_add_epi32(offset, _mm256_mullo_epi32(
+        _mm256_sub_epi32(i, lo[c]), inc[c]));
+      // The step to the next voxel along y and z, none on the last one
+      next[c] = (c == 0 ? _mm256_setzero_si256() :
+        _mm256_and_si256(_mm256_cmpgt_epi32(hi[c], i), inc[c]));
+      }
+
+    __m256 a0, a1, b0, b1, c0, c1, d0, d1;
+    vtkPlaneSamplerGather(ptr, offset, a0, a1);
+    vtkPlaneSamplerGather(ptr, _mm256_add_epi32(offset, next[1]), b0, b1);
+    vtkPlaneSamplerGather(ptr, _mm256_add_epi32(offset, next[2]), c0, c1);
+    vtkPlaneSamplerGather(
+      ptr, _mm256_add_epi32(offset, _mm256_add_epi32(next[1], next[2])),
+      d0, d1);
+    __m256 v0 = vtkPlaneSamplerLerp(vtkPlaneSamplerLerp(a0, a1, f[0]),
+                                    vtkPlaneSamplerLerp(b0, b1, f[0]), f[1]);
+    __m256 v1 = vtkPlaneSamplerLerp(vtkPlaneSamplerLerp(c0, c1, f[0]),
+                                    vtkPlaneSamplerLerp(d0, d1, f[0]), f[1]);
+    __m256 v = vtkPlaneSamplerLerp(v0, v1, f[2]);
+    _mm256_storeu_pd(values + n, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+    _mm256_storeu_pd(values + n + 4,
+                     _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+    }
+
+  // Remaining pixels
+  vtkPlaneSamplerRow tail = row;
+  for (int c = 0; c < 3; ++c)
+    {
+    tail.X[c] = row.X[c] + n*row.Step[c];
+    }
+  tail.Count = row.Count - n;
+  vtkPlaneSamplerLinear(ptr, tail, values + n);
+}
+#endif
+
+//-----------------------------------------------------------------------------
+vtkImagePlaneSampler::vtkImagePlaneSampler()
+{
+  this->Scalars = NULL;
+  this->ScalarType = VTK_DOUBLE;
+  this->InterpolationMode = LINEAR;
+  for (int c = 0; c < 3; ++c)
+    {
+    this->Extent[2*c] = 0;
+    this->Extent[2*c+1] = -1;
+    this->Increments[c] = 0;
+    this->Start[c] = 0.0;
+    this->RowStep[c] = (c == 0);
+    this->ColumnStep[c] = (c == 1);
+    this->LayerStep[c] = 0.0;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImagePlaneSampler::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "InterpolationMode: " << this->InterpolationMode << "\n";
+  os << indent << "Extent: " << this->Extent[0] << " " << this->Extent[1]
+     << " " << this->Extent[2] << " " << this->Extent[3] << " "
+     << this->Extent[4] << " " << this->Extent[5] << "\n";
+  os << indent << "Start: " << this->Start[0] << " " << this->Start[1]
+     << " " << this->Start[2] << "\n";
+  os << indent << "RowStep: " << this->RowStep[0] << " "
+     << this->RowStep[1] << " " << this->RowStep[2] << "\n";
+  os << indent << "ColumnStep: " << this->ColumnStep[0] << " "
+     << this->ColumnStep[1] << " " << this->ColumnStep[2] << "\n";
+  os << indent << "LayerStep: " << this->LayerStep[0] << " "
+     << this->LayerStep[1] << " " << this->LayerStep[2] << "\n";
+  os << indent << "Vectorized: " << this->GetVectorized() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkImagePlaneSampler::SetImage(vtkImageData* image)
+{
+  this->Scalars = NULL;
+  this->ScalarType = VTK_DOUBLE;
+  for (int c = 0; c < 3; ++c)
+    {
+    this->Extent[2*c] = 0;
+    this->Extent[2*c+1] = -1;
+    this->Increments[c] = 0;
+    }
+  if (image && image->GetPointData()->GetScalars() &&
+      image->GetNumberOfPoints() > 0)
+    {
+    this->Scalars = image->GetScalarPointer();
+    this->ScalarType = image->GetScalarType();
+    image->GetExtent(this->Extent);
+    image->GetIncrements(this->Increments[0], this->Increments[1],
+                         this->Increments[2]);
+    }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImagePlaneSampler::SetPlane(const double start[3],
+                                    const double rowStep[3],
+                                    const double columnStep[3])
+{
+  for (int c = 0; c < 3; ++c)
+    {
+    this->Start[c] = start[c];
+    this->RowStep[c] = rowStep[c];
+    this->ColumnStep[c] = columnStep[c];
+    }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImagePlaneSampler::SetLayerStep(const double layerStep[3])
+{
+  for (int c = 0; c < 3; ++c)
+    {
+    this->LayerStep[c] = layerStep[c];
+    }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkImagePlaneSampler::GetVectorized() const
+{
+#if defined(__AVX2__)
+  // Offsets are 32 bit in the gathers: the offset of the last component of
+  // the last voxel must fit
+  vtkIdType last = this->Increments[0] - 1;
+  for (int c = 0; c < 3; ++c)
+    {
+    last += this->Increments[c]*(this->Extent[2*c+1] - this->Extent[2*c]);
+    }
+  return (this->Scalars != NULL && this->InterpolationMode == LINEAR &&
+          this->Increments[0] == 1 && this->Extent[1] > this->Extent[0] &&
+          last < VTK_INT_MAX &&
+          (this->ScalarType == VTK_UNSIGNED_SHORT ||
+           this->ScalarType == VTK_SHORT ||
+           this->ScalarType == VTK_FLOAT));
+#else
+  return 0;
+#endif
+}
+
+//----------------------------------------------------------------------------
+int vtkImagePlaneSampler::IsInside(int i, int j, int k) const
+{
+  if (!this->Scalars)
+    {
+    return 0;
+    }
+  int linear = (this->InterpolationMode == LINEAR);
+  for (int c = 0; c < 3; ++c)
+    {
+    double x = this->Start[c] + i*this->RowStep[c] + j*this->ColumnStep[c] +
+      k*this->LayerStep[c];
+    if (!vtkPlaneSamplerInside(x, this->Extent[2*c], this->Extent[2*c+1],
+                               linear))
+      {
+      return 0;
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImagePlaneSampler::ClipRow(int j, int k, int& first,
+                                  int& last) const
+{
+  if (!this->Scalars || first > last)
+    {
+    return 0;
+    }
+
+  // The samples of a row lie on a line, which crosses the slab of each
+  // axis along an interval of pixels
+  int linear = (this->InterpolationMode == LINEAR);
+  double margin = (linear ? vtkPlaneSamplerTolerance : 0.5);
+  double lo = first;
+  double hi = last;
+  for (int c = 0; c < 3; ++c)
+    {
+    double s = this->Start[c] + j*this->ColumnStep[c] +
+      k*this->LayerStep[c];
+    double r = this->RowStep[c];
+    if (r == 0.0)
+      {
+      if (!vtkPlaneSamplerInside(s, this->Extent[2*c], this->Extent[2*c+1],
+                                 linear))
+        {
+        return 0;
+        }
+      continue;
+      }
+    double t0 = (this->Extent[2*c] - margin - s) / r;
+    double t1 = (this->Extent[2*c+1] + margin - s) / r;
+    if (t0 > t1)
+      {
+      double t = t0;
+      t0 = t1;
+      t1 = t;
+      }
+    lo = std::max(lo, ceil(t0));
+    hi = std::min(hi, floor(t1));
+    }
+  if (lo > hi)
+    {
+    return 0;
+    }
+
+  // The interval is exact up to rounding, settle its ends with the test
+  // of single pixels
+  int i0 = static_cast<int>(lo);
+  int i1 = static_cast<int>(hi);
+  while (i0 <= i1 && !this->IsInside(i0, j, k))
+    {
+    ++i0;
+    }
+  while (i1 >= i0 && !this->IsInside(i1, j, k))
+    {
+    --i1;
+    }
+  if (i0 > i1)
+    {
+    return 0;
+    }
+  while (i0 > first && this->IsInside(i0 - 1, j, k))
+    {
+    --i0;
+    }
+  while (i1 < last && this->IsInside(i1 + 1, j, k))
+    {
+    ++i1;
+    }
+  first = i0;
+  last = i1;
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImagePlaneSampler::SampleRow(int j, int k, int first, int last,
+                                     double* values) const
+{
+  if (!this->Scalars || first > last)
+    {
+    return;
+    }
+
+  vtkPlaneSamplerRow row;
+  for (int c = 0; c < 3; ++c)
+    {
+    row.X[c] = this->Start[c] + first*this->RowStep[c] +
+      j*this->ColumnStep[c] + k*this->LayerStep[c];
+    row.Step[c] = this->RowStep[c];
+    row.Extent[2*c] = this->Extent[2*c];
+    row.Extent[2*c+1] = this->Extent[2*c+1];
+    row.Increments[c] = this->Increments[c];
+    }
+  row.Count = last - first + 1;
+
+#if defined(__AVX2__)
+  if (this->GetVectorized())
+    {
+    switch (this->ScalarType)
+      {
+      case VTK_UNSIGNED_SHORT:
+        vtkPlaneSamplerLinearAVX2(
+          static_cast<const unsigned short*>(this->Scalars), row, values);
+        return;
+      case VTK_SHORT:
+        vtkPlaneSamplerLinearAVX2(
+          static_cast<const short*>(this->Scalars), row, values);
+        return;
+      case VTK_FLOAT:
+        vtkPlaneSamplerLinearAVX2(
+          static_cast<const float*>(this->Scalars), row, values);
+        return;
+      }
+    }
+#endif
+
+  int linear = (this->InterpolationMode == LINEAR);
+  switch (this->ScalarType)
+    {
+    vtkTemplateMacro(
+      vtkPlaneSamplerExecute(static_cast<const VTK_TT*>(this->Scalars), row,
+                             linear, values));
+    default:
+      vtkGenericWarningMacro(<< "SampleRow: Unknown ScalarType");
+    }
+}
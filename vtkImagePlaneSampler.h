@@ -0,0 +1,123 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImagePlaneSampler.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImagePlaneSampler - sample an image along the rows of a plane.
+//
+// .SECTION Description
+// vtkImagePlaneSampler samples the first scalar component of an image on a
+// regular grid of pixels lying on a plane with any orientation. The plane
+// is given once by the continuous index of pixel (0, 0) and the index steps
+// for one pixel along the rows and the columns, so that no matrix is
+// applied per pixel. Slabs are sampled as layers of the plane, pixel
+// (i, j, k) lying k layer steps away from pixel (i, j) of layer 0.
+//
+// A row is first clipped with ClipRow() to the pixels whose samples lie in
+// the image, which is a single interval for any plane. SampleRow() then
+// walks the clipped interval incrementally without any bounds test.
+// Callers clip rows further, for instance to the inside of a mask, and only
+// sample what is left.
+//
+// The kernels are specialized for every scalar type. When the library is
+// built with AVX2 (see the ENABLE_AVX2 option of the project), trilinear
+// rows of single component unsigned short, short and float images are
+// sampled 8 pixels at a time with gathers. Other images and builds use
+// the scalar kernel, which gives the same values up to float rounding.
+//
+// The image is not referenced: it must not be modified or deleted while
+// rows are sampled. ClipRow() and SampleRow() may be called from several
+// threads at once.
+//
+// .SECTION see also
+// vtkImageMaskedResliceToRGBA vtkImageReslice
+
+#ifndef __vtkImagePlaneSampler_h
+#define __vtkImagePlaneSampler_h
+
+#include <vtkObject.h>
+
+// Forward declarations
+class vtkImageData;
+
+class vtkImagePlaneSampler : public vtkObject
+{
+public:
+  static vtkImagePlaneSampler* New();
+  vtkTypeMacro(vtkImagePlaneSampler, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set the image to sample. An image without scalars has no sample.
+  void SetImage(vtkImageData* image);
+
+  // Description:
+  // Set the continuous index of pixel (0, 0) and the index steps for one
+  // pixel along the rows and the columns of the plane
+  void SetPlane(const double start[3], const double rowStep[3],
+                const double columnStep[3]);
+
+  // Description:
+  // Set the index step from one layer of the plane to the next (default:
+  // none)
+  void SetLayerStep(const double layerStep[3]);
+
+  // Description:
+  // Set/Get the interpolation mode (default: linear). Nearest neighbor
+  // samples lie in the image up to half a voxel beyond its extent, linear
+  // samples up to a small tolerance.
+  enum
+    {
+    NEAREST = 0,
+    LINEAR
+    };
+  vtkSetClampMacro(InterpolationMode, int, NEAREST, LINEAR);
+  vtkGetMacro(InterpolationMode, int);
+
+  // Description:
+  // Return 1 when the sample of pixel (i, j, k) lies in the image
+  int IsInside(int i, int j, int k) const;
+
+  // Description:
+  // Clip pixels [first, last] of row j of layer k to the ones whose samples
+  // lie in the image. Return 0 when none do.
+  int ClipRow(int j, int k, int& first, int& last) const;
+
+  // Description:
+  // Sample pixels [first, last] of row j of layer k into values. The pixels
+  // must have been clipped by ClipRow().
+  void SampleRow(int j, int k, int first, int last, double* values) const;
+
+  // Description:
+  // Get whether SampleRow() runs the AVX2 kernel on the current image
+  int GetVectorized() const;
+
+protected:
+  vtkImagePlaneSampler();
+  ~vtkImagePlaneSampler() {}
+
+  const void* Scalars;
+  int ScalarType;
+  int Extent[6];
+  vtkIdType Increments[3];
+  double Start[3];
+  double RowStep[3];
+  double ColumnStep[3];
+  double LayerStep[3];
+  int InterpolationMode;
+
+private:
+  vtkImagePlaneSampler(const vtkImagePlaneSampler&); // Not implemented
+  void operator=(const vtkImagePlaneSampler&); // Not implemented
+};
+
+#endif //__vtkImagePlaneSampler_h
@@ -0,0 +1,313 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageShapeMaskSource.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImageShapeMaskSource.h"
+
+#include "vtkImageCompactMask.h"
+
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkSMPTools.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+vtkStandardNewMacro(vtkImageShapeMaskSource);
+
+//-----------------------------------------------------------------------------
+// Fills a range of scanlines of the output extent. Scanline r maps to the
+// row (j, k) = (ext[2] + r % ny, ext[4] + r / ny).
+class vtkImageShapeMaskSourceFunctor
+{
+public:
+  vtkImageShapeMaskSource* Self;
+  vtkImageData* Output;
+  int Extent[6];
+  unsigned char Inside;
+  unsigned char Outside;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    int rowLength = this->Extent[1] - this->Extent[0] + 1;
+    int numRows = this->Extent[3] - this->Extent[2] + 1;
+    for (vtkIdType r = begin; r < end; ++r)
+      {
+      int j = this->Extent[2] + static_cast<int>(r % numRows);
+      int k = this->Extent[4] + static_cast<int>(r / numRows);
+      unsigned char* row = static_cast<unsigned char*>(
+        this->Output->GetScalarPointer(this->Extent[0], j, k));
+
+      int range[2];
+      if (!this->Self->GetScanlineIndexRange(j, k, this->Extent[0],
+                                             this->Extent[1], range))
+        {
+        memset(row, this->Outside, rowLength);
+        continue;
+        }
+
+      int before = range[0] - this->Extent[0];
+      int inside = range[1] - range[0] + 1;
+      int after = this->Extent[1] - range[1];
+      memset(row, this->Outside, before);
+      memset(row + before, this->Inside, inside);
+      memset(row + before + inside, this->Outside, after);
+      }
+    }
+};
+
+//-----------------------------------------------------------------------------
+vtkImageShapeMaskSource::vtkImageShapeMaskSource()
+{
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(1);
+
+  this->ShapeType = CYLINDER;
+  for (int i = 0; i < 3; ++i)
+    {
+    this->WholeExtent[2*i] = 0;
+    this->WholeExtent[2*i+1] = 63;
+    this->Origin[i] = 0.0;
+    this->Spacing[i] = 1.0;
+    this->Center[i] = 31.5;
+    this->Normal[i] = 0.0;
+    this->BoxBounds[2*i] = 16.0;
+    this->BoxBounds[2*i+1] = 47.0;
+    }
+  this->Normal[2] = 1.0;
+  this->Radius = 16.0;
+  this->CylinderAxis = 2;
+
+  this->InsideValue = 255;
+  this->OutsideValue = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageShapeMaskSource::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ShapeType: " << this->ShapeType << "\n";
+  os << indent << "WholeExtent: (" << this->WholeExtent[0];
+  for (int i = 1; i < 6; ++i)
+    {
+    os << ", " << this->WholeExtent[i];
+    }
+  os << ")\n";
+  os << indent << "Origin: (" << this->Origin[0] << ", " << this->Origin[1]
+     << ", " << this->Origin[2] << ")\n";
+  os << indent << "Spacing: (" << this->Spacing[0] << ", "
+     << this->Spacing[1] << ", " << this->Spacing[2] << ")\n";
+  os << indent << "Center: (" << this->Center[0] << ", " << this->Center[1]
+     << ", " << this->Center[2] << ")\n";
+  os << indent << "Radius: " << this->Radius << "\n";
+  os << indent << "CylinderAxis: " << this->CylinderAxis << "\n";
+  os << indent << "BoxBounds: (" << this->BoxBounds[0];
+  for (int i = 1; i < 6; ++i)
+    {
+    os << ", " << this->BoxBounds[i];
+    }
+  os << ")\n";
+  os << indent << "Normal: (" << this->Normal[0] << ", " << this->Normal[1]
+     << ", " << this->Normal[2] << ")\n";
+  os << indent << "InsideValue: "
+     << static_cast<int>(this->InsideValue) << "\n";
+  os << indent << "OutsideValue: "
+     << static_cast<int>(this->OutsideValue) << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkImageShapeMaskSource::SetInformationFromImage(vtkImageData* image)
+{
+  if (!image)
+    {
+    return;
+    }
+  this->SetWholeExtent(image->GetExtent());
+  this->SetOrigin(image->GetOrigin());
+  this->SetSpacing(image->GetSpacing());
+}
+
+//----------------------------------------------------------------------------
+int vtkImageShapeMaskSource::GetScanlineInterval(double y, double z,
+                                                 double interval[2])
+{
+  const double inf = VTK_DOUBLE_MAX;
+  double dy = y - this->Center[1];
+  double dz = z - this->Center[2];
+  double r2 = this->Radius * this->Radius;
+
+  switch (this->ShapeType)
+    {
+    case CYLINDER:
+      {
+      double rem;
+      if (this->CylinderAxis == 0)
+        {
+        // The scanline runs along the cylinder axis
+        if (dy*dy + dz*dz > r2)
+          {
+          return 0;
+          }
+        interval[0] = -inf;
+        interval[1] = inf;
+        return 1;
+        }
+      rem = r2 - (this->CylinderAxis == 1 ? dz*dz : dy*dy);
+      if (rem < 0.0)
+        {
+        return 0;
+        }
+      double h = sqrt(rem);
+      interval[0] = this->Center[0] - h;
+      interval[1] = this->Center[0] + h;
+      return 1;
+      }
+    case SPHERE:
+      {
+      double rem = r2 - dy*dy - dz*dz;
+      if (rem < 0.0)
+        {
+        return 0;
+        }
+      double h = sqrt(rem);
+      interval[0] = this->Center[0] - h;
+      interval[1] = this->Center[0] + h;
+      return 1;
+      }
+    case BOX:
+      if (y < this->BoxBounds[2] || y > this->BoxBounds[3] ||
+          z < this->BoxBounds[4] || z > this->BoxBounds[5])
+        {
+        return 0;
+        }
+      interval[0] = this->BoxBounds[0];
+      interval[1] = this->BoxBounds[1];
+      return 1;
+    case PLANE:
+      {
+      // Inside where n.(p - c) <= 0, which is linear in x
+      double rest = this->Normal[1]*dy + this->Normal[2]*dz;
+      double nx = this->Normal[0];
+      if (nx == 0.0)
+        {
+        if (rest > 0.0)
+          {
+          return 0;
+          }
+        interval[0] = -inf;
+        interval[1] = inf;
+        return 1;
+        }
+      double x = this->Center[0] - rest / nx;
+      interval[0] = (nx > 0.0 ? -inf : x);
+      interval[1] = (nx > 0.0 ? x : inf);
+      return 1;
+      }
+    }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageShapeMaskSource::GetScanlineIndexRange(int j, int k,
+                                                   int xMin, int xMax,
+                                                   int range[2])
+{
+  double y = this->Origin[1] + j * this->Spacing[1];
+  double z = this->Origin[2] + k * this->Spacing[2];
+  double interval[2];
+  if (!this->GetScanlineInterval(y, z, interval))
+    {
+    return 0;
+    }
+
+  // Convert the world interval to continuous index coordinates, clamping
+  // first so that infinite intervals do not overflow the int conversion
+  double f0 = (interval[0] - this->Origin[0]) / this->Spacing[0];
+  double f1 = (interval[1] - this->Origin[0]) / this->Spacing[0];
+  if (f0 > f1)
+    {
+    std::swap(f0, f1);
+    }
+  f0 = std::max(f0, static_cast<double>(xMin) - 1.0);
+  f1 = std::min(f1, static_cast<double>(xMax) + 1.0);
+
+  range[0] = std::max(static_cast<int>(ceil(f0)), xMin);
+  range[1] = std::min(static_cast<int>(floor(f1)), xMax);
+  return range[0] <= range[1];
+}
+
+//----------------------------------------------------------------------------
+void vtkImageShapeMaskSource::GenerateCompactMask(vtkImageCompactMask* mask)
+{
+  if (!mask)
+    {
+    return;
+    }
+  mask->Initialize(this->WholeExtent, this->Origin, this->Spacing);
+
+  // Every shape has at most one inside span per scanline
+  const int* ext = this->WholeExtent;
+  for (int k = ext[4]; k <= ext[5]; ++k)
+    {
+    for (int j = ext[2]; j <= ext[3]; ++j)
+      {
+      int range[2];
+      if (this->GetScanlineIndexRange(j, k, ext[0], ext[1], range))
+        {
+        mask->SetScanlineSpans(j, k, range, 1);
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkImageShapeMaskSource::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),
+               this->WholeExtent, 6);
+  outInfo->Set(vtkDataObject::ORIGIN(), this->Origin, 3);
+  outInfo->Set(vtkDataObject::SPACING(), this->Spacing, 3);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 1);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageShapeMaskSource::ExecuteDataWithInformation(
+  vtkDataObject* output, vtkInformation* outInfo)
+{
+  vtkImageData* data = this->AllocateOutputData(output, outInfo);
+  if (!data || data->GetNumberOfPoints() == 0)
+    {
+    return;
+    }
+
+  vtkImageShapeMaskSourceFunctor functor;
+  functor.Self = this;
+  functor.Output = data;
+  data->GetExtent(functor.Extent);
+  functor.Inside = this->InsideValue;
+  functor.Outside = this->OutsideValue;
+
+  vtkIdType numRows =
+    static_cast<vtkIdType>(functor.Extent[3] - functor.Extent[2] + 1) *
+    (functor.Extent[5] - functor.Extent[4] + 1);
+  vtkSMPTools::For(0, numRows, functor);
+}
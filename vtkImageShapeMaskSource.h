@@ -0,0 +1,168 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImageShapeMaskSource.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImageShapeMaskSource - rasterize an analytic shape into a
+// binary vtkImageData mask.
+//
+// .SECTION Description
+// vtkImageShapeMaskSource produces a VTK_UNSIGNED_CHAR image where every
+// voxel inside (or on) the shape is set to InsideValue (default: 255, as
+// required by the GPU volume mapper binary mask) and every other voxel is
+// set to OutsideValue (default: 0).
+//
+// Supported shapes are an axis aligned cylinder, a sphere, an axis aligned
+// box and a plane half-space. Instead of evaluating an implicit function
+// per voxel, the inside interval of each x scanline is computed analytically
+// and filled with memset. Scanlines are distributed over threads with
+// vtkSMPTools.
+//
+// The output geometry (whole extent, origin and spacing) is set explicitly
+// or copied from an existing image with SetInformationFromImage(). Only the
+// update extent requested downstream is allocated and generated, so the
+// source can be streamed slab by slab along with the volume it masks.
+//
+// .SECTION see also
+// vtkImplicitFunction vtkCylinder vtkSphere vtkBox vtkPlane
+// vtkImageEllipsoidSource vtkImageCompactMask
+
+#ifndef __vtkImageShapeMaskSource_h
+#define __vtkImageShapeMaskSource_h
+
+#include <vtkImageAlgorithm.h>
+
+// Forward declarations
+class vtkImageCompactMask;
+class vtkImageData;
+class vtkInformation;
+class vtkInformationVector;
+
+class vtkImageShapeMaskSource : public vtkImageAlgorithm
+{
+public:
+  static vtkImageShapeMaskSource* New();
+  vtkTypeMacro(vtkImageShapeMaskSource, vtkImageAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  enum
+    {
+    CYLINDER = 0,
+    SPHERE,
+    BOX,
+    PLANE
+    };
+
+  // Description:
+  // Set/Get the shape to rasterize (default: CYLINDER)
+  vtkSetClampMacro(ShapeType, int, CYLINDER, PLANE);
+  vtkGetMacro(ShapeType, int);
+  void SetShapeTypeToCylinder() { this->SetShapeType(CYLINDER); }
+  void SetShapeTypeToSphere() { this->SetShapeType(SPHERE); }
+  void SetShapeTypeToBox() { this->SetShapeType(BOX); }
+  void SetShapeTypeToPlane() { this->SetShapeType(PLANE); }
+
+  // Description:
+  // Set/Get the geometry of the output image
+  vtkSetVector6Macro(WholeExtent, int);
+  vtkGetVector6Macro(WholeExtent, int);
+  vtkSetVector3Macro(Origin, double);
+  vtkGetVector3Macro(Origin, double);
+  vtkSetVector3Macro(Spacing, double);
+  vtkGetVector3Macro(Spacing, double);
+
+  // Description:
+  // Copy whole extent, origin and spacing from an existing image
+  void SetInformationFromImage(vtkImageData* image);
+
+  // Description:
+  // Set/Get the center of the cylinder or sphere, or a point on the plane.
+  // All shape parameters are in world coordinates.
+  vtkSetVector3Macro(Center, double);
+  vtkGetVector3Macro(Center, double);
+
+  // Description:
+  // Set/Get the radius of the cylinder or sphere
+  vtkSetMacro(Radius, double);
+  vtkGetMacro(Radius, double);
+
+  // Description:
+  // Set/Get the axis (0: x, 1: y, 2: z) the cylinder is aligned with
+  // (default: 2)
+  vtkSetClampMacro(CylinderAxis, int, 0, 2);
+  vtkGetMacro(CylinderAxis, int);
+
+  // Description:
+  // Set/Get the box bounds (xmin, xmax, ymin, ymax, zmin, zmax)
+  vtkSetVector6Macro(BoxBounds, double);
+  vtkGetVector6Macro(BoxBounds, double);
+
+  // Description:
+  // Set/Get the plane normal. Points on the side opposite to the normal
+  // are inside.
+  vtkSetVector3Macro(Normal, double);
+  vtkGetVector3Macro(Normal, double);
+
+  // Description:
+  // Set/Get the values written inside and outside the shape
+  vtkSetMacro(InsideValue, unsigned char);
+  vtkGetMacro(InsideValue, unsigned char);
+  vtkSetMacro(OutsideValue, unsigned char);
+  vtkGetMacro(OutsideValue, unsigned char);
+
+  // Description:
+  // Compute the world x interval of the scanline at (y, z) that lies inside
+  // the shape. Returns 0 if the scanline does not intersect the shape.
+  int GetScanlineInterval(double y, double z, double interval[2]);
+
+  // Description:
+  // Compute the inside index range [i0, i1] of the scanline at (j, k),
+  // clipped to the given x index range. Returns 0 if the range is empty.
+  int GetScanlineIndexRange(int j, int k, int xMin, int xMax,
+                            int range[2]);
+
+  // Description:
+  // Rasterize the shape over the whole extent into a compact mask, in the
+  // mask's current encoding, without allocating an image
+  void GenerateCompactMask(vtkImageCompactMask* mask);
+
+protected:
+  vtkImageShapeMaskSource();
+  ~vtkImageShapeMaskSource() {}
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector);
+
+  virtual void ExecuteDataWithInformation(vtkDataObject* output,
+                                          vtkInformation* outInfo);
+
+  int ShapeType;
+  int WholeExtent[6];
+  double Origin[3];
+  double Spacing[3];
+
+  double Center[3];
+  double Radius;
+  int CylinderAxis;
+  double BoxBounds[6];
+  double Normal[3];
+
+  unsigned char InsideValue;
+  unsigned char OutsideValue;
+
+private:
+  vtkImageShapeMaskSource(const vtkImageShapeMaskSource&); // Not implemented
+  void operator=(const vtkImageShapeMaskSource&); // Not implemented
+};
+
+#endif //__vtkImageShapeMaskSource_h
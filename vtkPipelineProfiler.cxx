@@ -0,0 +1,446 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkPipelineProfiler.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkPipelineProfiler.h"
+
+#include <vtkAlgorithm.h>
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
+#include <vtkDataObject.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkThreadedImageAlgorithm.h>
+#include <vtkTimerLog.h>
+#include <vtkWeakPointer.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+vtkStandardNewMacro(vtkPipelineProfiler);
+
+//-----------------------------------------------------------------------------
+struct vtkPipelineProfilerExecution
+{
+  std::string Name;
+  int Thread;
+  double Start;
+  double Wall;
+  double Cpu;
+  int Threads;
+  vtkIdType Bytes;
+};
+
+//-----------------------------------------------------------------------------
+struct vtkPipelineProfilerSummary
+{
+  std::string Name;
+  int Calls;
+  double Total;
+  double Max;
+  double Cpu;
+  int Threads;
+  vtkIdType Bytes;
+};
+
+//-----------------------------------------------------------------------------
+struct vtkPipelineProfilerObserved
+{
+  vtkWeakPointer<vtkObject> Object;
+  unsigned long StartTag;
+  unsigned long EndTag;
+};
+
+//-----------------------------------------------------------------------------
+class vtkPipelineProfilerInternals
+{
+public:
+  vtkNew<vtkMutexLock> Lock;
+  vtkNew<vtkCallbackCommand> Callback;
+  double Origin;
+
+  std::vector<vtkPipelineProfilerObserved> Observed;
+  std::map<vtkObject*, std::string> Names;
+
+  // Start wall and CPU times of the executions in progress, per stage and
+  // thread. Stages may be nested in themselves.
+  typedef std::pair<std::string, int> OpenKey;
+  std::map<OpenKey, std::vector<std::pair<double, double> > > Open;
+
+  std::vector<vtkMultiThreaderIDType> Threads;
+  std::vector<vtkPipelineProfilerExecution> Executions;
+
+  // Small index of the calling thread, call with Lock held
+  int GetThreadIndex()
+    {
+    vtkMultiThreaderIDType id = vtkMultiThreader::GetCurrentThreadID();
+    for (size_t i = 0; i < this->Threads.size(); ++i)
+      {
+      if (vtkMultiThreader::ThreadsEqual(this->Threads[i], id))
+        {
+        return static_cast<int>(i);
+        }
+      }
+    this->Threads.push_back(id);
+    return static_cast<int>(this->Threads.size()) - 1;
+    }
+};
+
+//-----------------------------------------------------------------------------
+static bool vtkPipelineProfilerLonger(const vtkPipelineProfilerSummary& a,
+                                      const vtkPipelineProfilerSummary& b)
+{
+  return a.Total > b.Total;
+}
+
+//-----------------------------------------------------------------------------
+static std::string vtkPipelineProfilerEscape(const std::string& s)
+{
+  std::string escaped;
+  for (size_t i = 0; i < s.size(); ++i)
+    {
+    if (s[i] == '"' || s[i] == '\\')
+      {
+      escaped += '\\';
+      }
+    if (static_cast<unsigned char>(s[i]) >= 0x20)
+      {
+      escaped += s[i];
+      }
+    }
+  return escaped;
+}
+
+//-----------------------------------------------------------------------------
+vtkPipelineProfiler::vtkPipelineProfiler()
+{
+  this->TraceFileName = NULL;
+  this->Internals = new vtkPipelineProfilerInternals;
+  this->Internals->Callback->SetCallback(vtkPipelineProfiler::HandleEvent);
+  this->Internals->Callback->SetClientData(this);
+  this->Internals->Origin = vtkTimerLog::GetUniversalTime();
+
+  const char* env = getenv("VTK_PIPELINE_PROFILE");
+  this->Enabled = (env && *env && strcmp(env, "0") != 0);
+  size_t length = (env ? strlen(env) : 0);
+  if (length > 5 && strcmp(env + length - 5, ".json") == 0)
+    {
+    this->SetTraceFileName(env);
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkPipelineProfiler::~vtkPipelineProfiler()
+{
+  for (size_t i = 0; i < this->Internals->Observed.size(); ++i)
+    {
+    vtkPipelineProfilerObserved& observed = this->Internals->Observed[i];
+    if (observed.Object)
+      {
+      observed.Object->RemoveObserver(observed.StartTag);
+      observed.Object->RemoveObserver(observed.EndTag);
+      }
+    }
+
+  if (this->Enabled && !this->Internals->Executions.empty())
+    {
+    this->PrintReport(cout);
+    if (this->TraceFileName &&
+        this->WriteChromeTrace(this->TraceFileName))
+      {
+      cout << "Pipeline trace written to " << this->TraceFileName << endl;
+      }
+    }
+
+  this->SetTraceFileName(NULL);
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Enabled: " << this->Enabled << "\n";
+  os << indent << "TraceFileName: "
+     << (this->TraceFileName ? this->TraceFileName : "(none)") << "\n";
+  os << indent << "Observed: " << this->Internals->Observed.size() << "\n";
+  os << indent << "Executions: " << this->Internals->Executions.size()
+     << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::Observe(vtkObject* object, const char* name)
+{
+  if (!this->Enabled || !object)
+    {
+    return;
+    }
+
+  vtkPipelineProfilerInternals* internals = this->Internals;
+  internals->Lock->Lock();
+  bool observed = (internals->Names.find(object) != internals->Names.end());
+  if (!observed || name)
+    {
+    internals->Names[object] = (name ? name : object->GetClassName());
+    }
+  internals->Lock->Unlock();
+  if (observed)
+    {
+    return;
+    }
+
+  vtkPipelineProfilerObserved entry;
+  entry.Object = object;
+  entry.StartTag = object->AddObserver(vtkCommand::StartEvent,
+                                       internals->Callback.GetPointer());
+  entry.EndTag = object->AddObserver(vtkCommand::EndEvent,
+                                     internals->Callback.GetPointer());
+  internals->Observed.push_back(entry);
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::ObservePipeline(vtkAlgorithm* algorithm)
+{
+  if (!this->Enabled || !algorithm)
+    {
+    return;
+    }
+
+  this->Observe(algorithm);
+  for (int port = 0; port < algorithm->GetNumberOfInputPorts(); ++port)
+    {
+    for (int i = 0; i < algorithm->GetNumberOfInputConnections(port); ++i)
+      {
+      this->ObservePipeline(algorithm->GetInputAlgorithm(port, i));
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::HandleEvent(vtkObject* caller,
+                                      unsigned long eventId,
+                                      void* clientData,
+                                      void* vtkNotUsed(callData))
+{
+  vtkPipelineProfiler* self = static_cast<vtkPipelineProfiler*>(clientData);
+  vtkPipelineProfilerInternals* internals = self->Internals;
+  internals->Lock->Lock();
+  std::map<vtkObject*, std::string>::iterator it =
+    internals->Names.find(caller);
+  std::string name = (it != internals->Names.end() ? it->second :
+                      std::string(caller->GetClassName()));
+  internals->Lock->Unlock();
+
+  if (eventId == vtkCommand::StartEvent)
+    {
+    self->Start(name.c_str());
+    return;
+    }
+
+  // The outputs are complete at the end of the execution
+  int threads = 1;
+  vtkIdType bytes = 0;
+  vtkAlgorithm* algorithm = vtkAlgorithm::SafeDownCast(caller);
+  if (algorithm)
+    {
+    vtkThreadedImageAlgorithm* threaded =
+      vtkThreadedImageAlgorithm::SafeDownCast(algorithm);
+    threads = (threaded ? threaded->GetNumberOfThreads() : 1);
+    for (int port = 0; port < algorithm->GetNumberOfOutputPorts(); ++port)
+      {
+      vtkDataObject* output = algorithm->GetOutputDataObject(port);
+      if (output)
+        {
+        bytes += static_cast<vtkIdType>(output->GetActualMemorySize())*1024;
+        }
+      }
+    }
+  self->End(name.c_str(), threads, bytes);
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::StartStage(const char* name)
+{
+  if (this->Enabled && name)
+    {
+    this->Start(name);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::EndStage(const char* name, vtkIdType bytes)
+{
+  if (this->Enabled && name)
+    {
+    this->End(name, 1, bytes);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::Start(const char* name)
+{
+  vtkPipelineProfilerInternals* internals = this->Internals;
+  internals->Lock->Lock();
+  int thread = internals->GetThreadIndex();
+  internals->Open[vtkPipelineProfilerInternals::OpenKey(name, thread)]
+    .push_back(std::make_pair(vtkTimerLog::GetUniversalTime(),
+                              vtkTimerLog::GetCPUTime()));
+  internals->Lock->Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::End(const char* name, int threads, vtkIdType bytes)
+{
+  double wall = vtkTimerLog::GetUniversalTime();
+  double cpu = vtkTimerLog::GetCPUTime();
+  vtkPipelineProfilerInternals* internals = this->Internals;
+  internals->Lock->Lock();
+  int thread = internals->GetThreadIndex();
+  std::vector<std::pair<double, double> >& open =
+    internals->Open[vtkPipelineProfilerInternals::OpenKey(name, thread)];
+  if (!open.empty())
+    {
+    vtkPipelineProfilerExecution execution;
+    execution.Name = name;
+    execution.Thread = thread;
+    execution.Start = open.back().first - internals->Origin;
+    execution.Wall = wall - open.back().first;
+    execution.Cpu = cpu - open.back().second;
+    execution.Threads = threads;
+    execution.Bytes = bytes;
+    internals->Executions.push_back(execution);
+    open.pop_back();
+    }
+  internals->Lock->Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::Reset()
+{
+  this->Internals->Lock->Lock();
+  this->Internals->Executions.clear();
+  this->Internals->Lock->Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::PrintReport(ostream &os)
+{
+  vtkPipelineProfilerInternals* internals = this->Internals;
+  internals->Lock->Lock();
+  std::map<std::string, size_t> index;
+  std::vector<vtkPipelineProfilerSummary> summaries;
+  double first = VTK_DOUBLE_MAX;
+  double last = 0.0;
+  for (size_t i = 0; i < internals->Executions.size(); ++i)
+    {
+    const vtkPipelineProfilerExecution& execution = internals->Executions[i];
+    std::map<std::string, size_t>::iterator it = index.find(execution.Name);
+    if (it == index.end())
+      {
+      vtkPipelineProfilerSummary summary;
+      summary.Name = execution.Name;
+      summary.Calls = 0;
+      summary.Total = 0.0;
+      summary.Max = 0.0;
+      summary.Cpu = 0.0;
+      summary.Threads = 0;
+      summary.Bytes = 0;
+      it = index.insert(std::make_pair(execution.Name,
+                                       summaries.size())).first;
+      summaries.push_back(summary);
+      }
+    vtkPipelineProfilerSummary& summary = summaries[it->second];
+    summary.Calls++;
+    summary.Total += execution.Wall;
+    summary.Max = std::max(summary.Max, execution.Wall);
+    summary.Cpu += execution.Cpu;
+    summary.Threads = std::max(summary.Threads, execution.Threads);
+    summary.Bytes += execution.Bytes;
+    first = std::min(first, execution.Start);
+    last = std::max(last, execution.Start + execution.Wall);
+    }
+  internals->Lock->Unlock();
+  std::sort(summaries.begin(), summaries.end(), vtkPipelineProfilerLonger);
+
+  os << "Pipeline profile: " << summaries.size() << " stages over "
+     << std::fixed << std::setprecision(3)
+     << (summaries.empty() ? 0.0 : last - first) << " s\n";
+  os << std::left << std::setw(32) << "stage" << std::right
+     << std::setw(7) << "calls" << std::setw(12) << "total ms"
+     << std::setw(11) << "mean ms" << std::setw(11) << "max ms"
+     << std::setw(9) << "threads" << std::setw(10) << "cpu/wall"
+     << std::setw(11) << "MiB" << "\n";
+  for (size_t i = 0; i < summaries.size(); ++i)
+    {
+    const vtkPipelineProfilerSummary& s = summaries[i];
+    os << std::left << std::setw(32) << s.Name.substr(0, 31) << std::right
+       << std::setw(7) << s.Calls
+       << std::setw(12) << 1000.0*s.Total
+       << std::setw(11) << 1000.0*s.Total/s.Calls
+       << std::setw(11) << 1000.0*s.Max
+       << std::setw(9) << s.Threads
+       << std::setw(10) << (s.Total > 0.0 ? s.Cpu/s.Total : 0.0)
+       << std::setw(11) << s.Bytes/(1024.0*1024.0) << "\n";
+    }
+  os.unsetf(std::ios::floatfield);
+  os << std::setprecision(6);
+}
+
+//----------------------------------------------------------------------------
+int vtkPipelineProfiler::WriteChromeTrace(const char* fileName)
+{
+  std::ofstream file(fileName);
+  if (!file)
+    {
+    vtkErrorMacro(<< "Cannot open " << fileName);
+    return 0;
+    }
+
+  // Complete events, times in microseconds
+  vtkPipelineProfilerInternals* internals = this->Internals;
+  internals->Lock->Lock();
+  file << "{\"traceEvents\":[\n";
+  file << std::fixed << std::setprecision(3);
+  for (size_t i = 0; i < internals->Executions.size(); ++i)
+    {
+    const vtkPipelineProfilerExecution& e = internals->Executions[i];
+    file << (i ? ",\n" : "")
+         << "{\"name\":\"" << vtkPipelineProfilerEscape(e.Name) << "\","
+         << "\"cat\":\"pipeline\",\"ph\":\"X\",\"pid\":1,"
+         << "\"tid\":" << e.Thread << ","
+         << "\"ts\":" << 1e6*e.Start << ","
+         << "\"dur\":" << 1e6*e.Wall << ","
+         << "\"args\":{\"threads\":" << e.Threads << ","
+         << "\"cpu_ms\":" << 1e3*e.Cpu << ","
+         << "\"bytes\":" << e.Bytes << "}}";
+    }
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  internals->Lock->Unlock();
+
+  file.close();
+  if (!file)
+    {
+    vtkErrorMacro(<< "Cannot write " << fileName);
+    return 0;
+    }
+  return 1;
+}
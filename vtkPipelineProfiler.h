@@ -0,0 +1,125 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkPipelineProfiler.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkPipelineProfiler - record the time, threads and memory of each
+// stage of a pipeline.
+//
+// .SECTION Description
+// vtkPipelineProfiler observes the StartEvent and EndEvent that algorithms
+// invoke around their RequestData, and that render windows invoke around
+// Render(), and records for each execution:
+//
+// - the wall time,
+// - the process CPU time, whose ratio to the wall time tells how many
+//   threads were busy (CPU time is only per process on POSIX systems, and
+//   includes the other threads of the process),
+// - the number of threads of vtkThreadedImageAlgorithm subclasses, 1 for
+//   other stages,
+// - the memory held by the outputs of algorithms at the end of the
+//   execution.
+//
+// Code outside of algorithms, such as a loop generating a mask, is recorded
+// between StartStage() and EndStage(). Stages may run on several threads
+// at once.
+//
+// Profiling is off unless the environment variable VTK_PIPELINE_PROFILE
+// is set when the profiler is created. "1" prints a summary per stage when
+// the profiler is deleted, a file name ending in .json writes the
+// executions there in the Chrome trace event format as well, to be opened
+// in chrome://tracing or Perfetto. When off, Observe() adds no observer
+// and the stage methods return at once, so the instrumentation can stay in
+// production code.
+//
+// .SECTION see also
+// vtkTimerLog vtkCommand
+
+#ifndef __vtkPipelineProfiler_h
+#define __vtkPipelineProfiler_h
+
+#include <vtkObject.h>
+
+// Forward declarations
+class vtkAlgorithm;
+class vtkPipelineProfilerInternals;
+
+class vtkPipelineProfiler : public vtkObject
+{
+public:
+  static vtkPipelineProfiler* New();
+  vtkTypeMacro(vtkPipelineProfiler, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Turn profiling on or off. Defaults to on when VTK_PIPELINE_PROFILE is
+  // set. Only objects observed while on are profiled.
+  vtkSetMacro(Enabled, int);
+  vtkGetMacro(Enabled, int);
+  vtkBooleanMacro(Enabled, int);
+
+  // Description:
+  // Set/Get the file the Chrome trace is written to when the profiler is
+  // deleted (default: VTK_PIPELINE_PROFILE when it ends in .json)
+  vtkSetStringMacro(TraceFileName);
+  vtkGetStringMacro(TraceFileName);
+
+  // Description:
+  // Record the executions of an algorithm or the renders of a render
+  // window, under name or the class name of the object
+  void Observe(vtkObject* object, const char* name = NULL);
+
+  // Description:
+  // Observe an algorithm and all the algorithms upstream of it
+  void ObservePipeline(vtkAlgorithm* algorithm);
+
+  // Description:
+  // Record the code run between these calls on the calling thread as the
+  // stage name, with the number of bytes it allocated or copied
+  void StartStage(const char* name);
+  void EndStage(const char* name, vtkIdType bytes = 0);
+
+  // Description:
+  // Print the total, mean and maximum time of each stage
+  void PrintReport(ostream &os);
+
+  // Description:
+  // Write the executions in the Chrome trace event format, return 0 on
+  // error
+  int WriteChromeTrace(const char* fileName);
+
+  // Description:
+  // Forget the executions recorded so far
+  void Reset();
+
+protected:
+  vtkPipelineProfiler();
+  ~vtkPipelineProfiler();
+
+  // Called by the observers
+  static void HandleEvent(vtkObject* caller, unsigned long eventId,
+                          void* clientData, void* callData);
+
+  // Record the start and end of an execution on the calling thread
+  void Start(const char* name);
+  void End(const char* name, int threads, vtkIdType bytes);
+
+  int Enabled;
+  char* TraceFileName;
+  vtkPipelineProfilerInternals* Internals;
+
+private:
+  vtkPipelineProfiler(const vtkPipelineProfiler&); // Not implemented
+  void operator=(const vtkPipelineProfiler&); // Not implemented
+};
+
+#endif //__vtkPipelineProfiler_h
@@ -0,0 +1,538 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkRGBATransferTable.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkRGBATransferTable.h"
+
+#include <vtkColorTransferFunction.h>
+#include <vtkLookupTable.h>
+#include <vtkObjectFactory.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+vtkStandardNewMacro(vtkRGBATransferTable);
+
+//-----------------------------------------------------------------------------
+// Samples the functions at the positions X0 + i*Dx, i in [begin, end), and
+// writes the requested channels of entries [begin, end) of Output
+class vtkRGBATransferTableSampler
+{
+public:
+  vtkColorTransferFunction* ColorFunction;
+  vtkPiecewiseFunction* OpacityFunction;
+  int SampleColor;
+  int SampleOpacity;
+  double X0;
+  double Dx;
+  unsigned char* Output;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    int n = static_cast<int>(end - begin);
+    double x1 = this->X0 + begin*this->Dx;
+    double x2 = this->X0 + (end - 1)*this->Dx;
+    unsigned char* out = this->Output + 4*begin;
+
+    if (this->SampleColor)
+      {
+      std::vector<double> rgb(3*static_cast<size_t>(n));
+      this->ColorFunction->GetTable(x1, x2, n, &rgb[0]);
+      for (int i = 0; i < n; ++i)
+        {
+        out[4*i] = static_cast<unsigned char>(rgb[3*i]*255.0 + 0.5);
+        out[4*i+1] = static_cast<unsigned char>(rgb[3*i+1]*255.0 + 0.5);
+        out[4*i+2] = static_cast<unsigned char>(rgb[3*i+2]*255.0 + 0.5);
+        }
+      }
+
+    if (this->SampleOpacity)
+      {
+      std::vector<double> alpha(static_cast<size_t>(n), 1.0);
+      if (this->OpacityFunction)
+        {
+        this->OpacityFunction->GetTable(x1, x2, n, &alpha[0]);
+        }
+      for (int i = 0; i < n; ++i)
+        {
+        out[4*i+3] = static_cast<unsigned char>(alpha[i]*255.0 + 0.5);
+        }
+      }
+    }
+};
+
+//-----------------------------------------------------------------------------
+static void vtkGetFunctionNodes(vtkColorTransferFunction* cf,
+                                std::vector<double>& nodes)
+{
+  int n = (cf ? cf->GetSize() : 0);
+  nodes.resize(6*static_cast<size_t>(n));
+  for (int i = 0; i < n; ++i)
+    {
+    cf->GetNodeValue(i, &nodes[6*i]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void vtkGetFunctionNodes(vtkPiecewiseFunction* pwf,
+                                std::vector<double>& nodes)
+{
+  int n = (pwf ? pwf->GetSize() : 0);
+  nodes.resize(4*static_cast<size_t>(n));
+  for (int i = 0; i < n; ++i)
+    {
+    pwf->GetNodeValue(i, &nodes[4*i]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Settings of the functions that are not in their nodes but change every
+// sample, such as the color space
+static void vtkGetFunctionSettings(vtkColorTransferFunction* cf,
+                                   vtkPiecewiseFunction* pwf,
+                                   std::vector<double>& settings)
+{
+  settings.clear();
+  if (cf)
+    {
+    settings.push_back(cf->GetColorSpace());
+    settings.push_back(cf->GetHSVWrap());
+    settings.push_back(cf->GetScale());
+    settings.push_back(cf->GetClamping());
+    }
+  if (pwf)
+    {
+    settings.push_back(pwf->GetClamping());
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Compute the scalar interval affected by the differences between two node
+// lists of a piecewise function. Nodes are stride doubles starting with
+// their position. Changing a node changes the function between its two
+// neighbours, so the interval runs from the last unchanged node before the
+// changes to the first unchanged node after them. Returns 0 when the lists
+// are identical.
+static int vtkGetChangedInterval(const std::vector<double>& oldNodes,
+                                 const std::vector<double>& newNodes,
+                                 size_t stride, double interval[2])
+{
+  size_t nOld = oldNodes.size() / stride;
+  size_t nNew = newNodes.size() / stride;
+
+  size_t prefix = 0;
+  while (prefix < nOld && prefix < nNew &&
+         std::equal(oldNodes.begin() + stride*prefix,
+                    oldNodes.begin() + stride*(prefix + 1),
+                    newNodes.begin() + stride*prefix))
+    {
+    ++prefix;
+    }
+  if (prefix == nOld && prefix == nNew)
+    {
+    return 0;
+    }
+
+  size_t suffix = 0;
+  while (suffix < nOld - prefix && suffix < nNew - prefix &&
+         std::equal(oldNodes.begin() + stride*(nOld - suffix - 1),
+                    oldNodes.begin() + stride*(nOld - suffix),
+                    newNodes.begin() + stride*(nNew - suffix - 1)))
+    {
+    ++suffix;
+    }
+
+  interval[0] = (prefix > 0 ? newNodes[stride*(prefix - 1)] :
+                 -VTK_DOUBLE_MAX);
+  interval[1] = (suffix > 0 ? newNodes[stride*(nNew - suffix)] :
+                 VTK_DOUBLE_MAX);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+vtkRGBATransferTable::vtkRGBATransferTable()
+{
+  this->ColorFunction = NULL;
+  this->OpacityFunction = NULL;
+  this->NumberOfColors = 256;
+
+  this->NumberOfBuiltColors = 0;
+  this->Range[0] = 0.0;
+  this->Range[1] = 1.0;
+  this->Scale = 0.0;
+  this->IntegerMin = 0;
+  this->IntegerExact = 0;
+  this->IntegerDataRange[0] = 0;
+  this->IntegerDataRange[1] = 0;
+  this->PendingBins[0] = 0;
+  this->PendingBins[1] = -1;
+}
+
+//-----------------------------------------------------------------------------
+vtkRGBATransferTable::~vtkRGBATransferTable()
+{
+  this->SetColorFunction(NULL);
+  this->SetOpacityFunction(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkRGBATransferTable::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfColors: " << this->NumberOfColors << "\n";
+  os << indent << "Range: (" << this->Range[0] << ", " << this->Range[1]
+     << ")\n";
+  os << indent << "ColorFunction: " << this->ColorFunction << "\n";
+  os << indent << "OpacityFunction: " << this->OpacityFunction << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkRGBATransferTable::SetColorFunction(vtkColorTransferFunction* cf)
+{
+  if (this->ColorFunction != cf)
+    {
+    if (this->ColorFunction != NULL)
+      {
+      this->ColorFunction->UnRegister(this);
+      }
+    this->ColorFunction = cf;
+    if (this->ColorFunction != NULL)
+      {
+      this->ColorFunction->Register(this);
+      }
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkRGBATransferTable::SetOpacityFunction(vtkPiecewiseFunction* pwf)
+{
+  if (this->OpacityFunction != pwf)
+    {
+    if (this->OpacityFunction != NULL)
+      {
+      this->OpacityFunction->UnRegister(this);
+      }
+    this->OpacityFunction = pwf;
+    if (this->OpacityFunction != NULL)
+      {
+      this->OpacityFunction->Register(this);
+      }
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkRGBATransferTable::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  if (this->ColorFunction && this->ColorFunction->GetMTime() > mTime)
+    {
+    mTime = this->ColorFunction->GetMTime();
+    }
+  if (this->OpacityFunction && this->OpacityFunction->GetMTime() > mTime)
+    {
+    mTime = this->OpacityFunction->GetMTime();
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkRGBATransferTable::UpdateChangedIntervals(
+  std::vector<double>& colorNodes, std::vector<double>& opacityNodes,
+  std::vector<double>& settings, unsigned long buildTime,
+  double colorInterval[2], double opacityInterval[2], int changed[2])
+{
+  std::vector<double> newColorNodes;
+  std::vector<double> newOpacityNodes;
+  std::vector<double> newSettings;
+  vtkGetFunctionNodes(this->ColorFunction, newColorNodes);
+  vtkGetFunctionNodes(this->OpacityFunction, newOpacityNodes);
+  vtkGetFunctionSettings(this->ColorFunction, this->OpacityFunction,
+                         newSettings);
+
+  changed[0] = vtkGetChangedInterval(colorNodes, newColorNodes, 6,
+                                     colorInterval);
+  changed[1] = vtkGetChangedInterval(opacityNodes, newOpacityNodes, 4,
+                                     opacityInterval);
+  colorNodes.swap(newColorNodes);
+  opacityNodes.swap(newOpacityNodes);
+
+  // A modification that does not show in the nodes, such as a new color
+  // space, affects the whole table, even when nodes changed too
+  int incremental = (newSettings == settings);
+  settings.swap(newSettings);
+  if (!changed[0] && this->ColorFunction &&
+      this->ColorFunction->GetMTime() > buildTime)
+    {
+    incremental = 0;
+    }
+  if (!changed[1] && this->OpacityFunction &&
+      this->OpacityFunction->GetMTime() > buildTime)
+    {
+    incremental = 0;
+    }
+  return incremental;
+}
+
+//----------------------------------------------------------------------------
+void vtkRGBATransferTable::SampleEntries(unsigned char* table, double x0,
+                                         double dx, int first, int last,
+                                         int color, int opacity)
+{
+  if (first > last)
+    {
+    return;
+    }
+  vtkRGBATransferTableSampler sampler;
+  sampler.ColorFunction = this->ColorFunction;
+  sampler.OpacityFunction = this->OpacityFunction;
+  sampler.SampleColor = color;
+  sampler.SampleOpacity = opacity;
+  sampler.X0 = x0;
+  sampler.Dx = dx;
+  sampler.Output = table;
+  // GetTable() into a caller's array only reads the nodes of the functions,
+  // so the chunks can sample them concurrently
+  vtkSMPTools::For(first, static_cast<vtkIdType>(last) + 1, sampler);
+}
+
+//----------------------------------------------------------------------------
+void vtkRGBATransferTable::Build()
+{
+  unsigned long buildTime = this->BuildTime.GetMTime();
+  if (!this->Table.empty() && buildTime > this->GetMTime())
+    {
+    return;
+    }
+
+  int n = this->NumberOfColors;
+  double range[2] = { 0.0, 1.0 };
+  if (this->ColorFunction)
+    {
+    this->ColorFunction->GetRange(range);
+    }
+  double dx = (range[1] - range[0]) / (n - 1);
+
+  double colorInterval[2], opacityInterval[2];
+  int changed[2];
+  int incremental = this->UpdateChangedIntervals(
+    this->BuiltColorNodes, this->BuiltOpacityNodes, this->BuiltSettings,
+    buildTime, colorInterval, opacityInterval, changed);
+
+  // Settings of the table itself, such as the number of colors or the
+  // functions, and a change of range affect every entry
+  incremental = incremental && !this->Table.empty() &&
+    this->ColorFunction && dx > 0.0 &&
+    this->Superclass::GetMTime() < buildTime &&
+    n == this->NumberOfBuiltColors &&
+    range[0] == this->Range[0] && range[1] == this->Range[1];
+
+  this->Table.resize(4*static_cast<size_t>(n));
+  unsigned char* table = &this->Table[0];
+  this->Range[0] = range[0];
+  this->Range[1] = range[1];
+  if (!incremental)
+    {
+    this->PendingBins[0] = 0;
+    this->PendingBins[1] = n - 1;
+    }
+
+  if (!this->ColorFunction)
+    {
+    vtkLookupTable* lut = vtkLookupTable::New();
+    lut->SetNumberOfTableValues(n);
+    lut->Build();
+    memcpy(table, lut->GetPointer(0), 4*static_cast<size_t>(n));
+    lut->Delete();
+    }
+  else if (!incremental)
+    {
+    this->SampleEntries(table, range[0], dx, 0, n - 1, 1, 1);
+    }
+  else
+    {
+    // Only resample the bins whose sample positions lie in the intervals
+    // affected by the changed nodes
+    for (int c = 0; c < 2; ++c)
+      {
+      if (!changed[c])
+        {
+        continue;
+        }
+      double* interval = (c == 0 ? colorInterval : opacityInterval);
+      double first = ceil((interval[0] - range[0]) / dx);
+      double last = floor((interval[1] - range[0]) / dx);
+      first = (first < 0.0 ? 0.0 : first);
+      last = (last > n - 1 ? n - 1 : last);
+      this->SampleEntries(table, range[0], dx, static_cast<int>(first),
+                          static_cast<int>(last), c == 0, c == 1);
+      if (first <= last)
+        {
+        this->AddPendingBins(static_cast<int>(first),
+                             static_cast<int>(last));
+        }
+      }
+    }
+
+  double width = this->Range[1] - this->Range[0];
+  this->Scale = (width > 0.0 ? n / width : 0.0);
+  this->NumberOfBuiltColors = n;
+  this->BuildTime.Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkRGBATransferTable::BuildIntegerTable(int typeMin, int typeMax)
+{
+  size_t n = static_cast<size_t>(typeMax - typeMin) + 1;
+  if (!this->IntegerExact && this->IntegerMin == typeMin &&
+      this->IntegerTable.size() == n &&
+      this->IntegerBuildTime.GetMTime() > this->BuildTime.GetMTime())
+    {
+    return;
+    }
+
+  // Only the integers that map into the bins resampled since the last
+  // expansion change, unless the layout of the expansion changed
+  int first = typeMin;
+  int last = typeMax;
+  if (!this->IntegerExact && this->IntegerMin == typeMin &&
+      this->IntegerTable.size() == n)
+    {
+    if (this->PendingBins[0] > this->PendingBins[1])
+      {
+      first = typeMax + 1;
+      }
+    else
+      {
+      // The first and last bins also hold the clamped integers. Elsewhere
+      // one integer of margin on each side covers the rounding of the bin
+      // edges, mapping extra integers again is harmless.
+      double binWidth = 1.0 / this->Scale;
+      if (this->PendingBins[0] > 0)
+        {
+        double x = floor(this->Range[0] + this->PendingBins[0]*binWidth);
+        first = (x - 1.0 <= typeMin ? typeMin :
+                 x - 1.0 > typeMax ? typeMax + 1 : static_cast<int>(x) - 1);
+        }
+      if (this->PendingBins[1] < this->NumberOfBuiltColors - 1)
+        {
+        double x = ceil(this->Range[0] +
+                        (this->PendingBins[1] + 1)*binWidth);
+        last = (x + 1.0 >= typeMax ? typeMax :
+                x + 1.0 < typeMin ? typeMin - 1 : static_cast<int>(x) + 1);
+        }
+      }
+    }
+
+  this->IntegerTable.resize(n);
+  this->IntegerMin = typeMin;
+  this->IntegerExact = 0;
+  for (int i = first; i <= last; ++i)
+    {
+    memcpy(&this->IntegerTable[i - typeMin],
+           this->MapValue(static_cast<double>(i)), 4);
+    }
+  this->PendingBins[0] = 0;
+  this->PendingBins[1] = -1;
+  this->IntegerBuildTime.Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkRGBATransferTable::BuildExactIntegerTable(int typeMin, int typeMax,
+                                                  int dataMin, int dataMax)
+{
+  if (!this->ColorFunction)
+    {
+    // Nothing to sample, use the default colors
+    this->Build();
+    this->BuildIntegerTable(typeMin, typeMax);
+    return;
+    }
+
+  dataMin = (dataMin < typeMin ? typeMin : dataMin);
+  dataMax = (dataMax > typeMax ? typeMax : dataMax);
+  dataMax = (dataMax < dataMin ? dataMin : dataMax);
+
+  // A table that already covers the data range exactly is kept as is, one
+  // that does not is grown to cover both ranges, so that inputs whose range
+  // varies from one execution to the next do not rebuild it every time
+  unsigned long buildTime = this->IntegerBuildTime.GetMTime();
+  size_t n = static_cast<size_t>(typeMax - typeMin) + 1;
+  int sameType = this->IntegerExact && this->IntegerMin == typeMin &&
+    this->IntegerTable.size() == n;
+  int sameLayout = sameType &&
+    this->IntegerDataRange[0] <= dataMin &&
+    this->IntegerDataRange[1] >= dataMax;
+  if (sameType)
+    {
+    dataMin = std::min(dataMin, this->IntegerDataRange[0]);
+    dataMax = std::max(dataMax, this->IntegerDataRange[1]);
+    }
+  if (sameLayout && buildTime > this->GetMTime())
+    {
+    return;
+    }
+
+  double colorInterval[2], opacityInterval[2];
+  int changed[2];
+  int incremental = this->UpdateChangedIntervals(
+    this->IntegerColorNodes, this->IntegerOpacityNodes,
+    this->IntegerSettings, buildTime, colorInterval, opacityInterval,
+    changed);
+  incremental = incremental && sameLayout &&
+    this->Superclass::GetMTime() < buildTime;
+
+  this->IntegerTable.resize(n);
+  this->IntegerMin = typeMin;
+  this->IntegerExact = 1;
+  this->IntegerDataRange[0] = dataMin;
+  this->IntegerDataRange[1] = dataMax;
+
+  vtkTypeUInt32* table = &this->IntegerTable[0];
+  vtkTypeUInt32* dataTable = table + (dataMin - typeMin);
+  unsigned char* entries = reinterpret_cast<unsigned char*>(dataTable);
+  int last = dataMax - dataMin;
+  if (!incremental)
+    {
+    this->SampleEntries(entries, dataMin, 1.0, 0, last, 1, 1);
+    }
+  else
+    {
+    // Only resample the integers in the intervals affected by the changed
+    // nodes
+    for (int c = 0; c < 2; ++c)
+      {
+      if (!changed[c])
+        {
+        continue;
+        }
+      double* interval = (c == 0 ? colorInterval : opacityInterval);
+      double first = ceil(interval[0] - dataMin);
+      double end = floor(interval[1] - dataMin);
+      first = (first < 0.0 ? 0.0 : first);
+      end = (end > last ? last : end);
+      this->SampleEntries(entries, dataMin, 1.0, static_cast<int>(first),
+                          static_cast<int>(end), c == 0, c == 1);
+      }
+    }
+
+  // Clamp the entries outside of the data range
+  std::fill(table, dataTable, dataTable[0]);
+  std::fill(dataTable + last + 1, table + n, dataTable[last]);
+
+  this->IntegerBuildTime.Modified();
+}
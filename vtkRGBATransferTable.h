@@ -0,0 +1,232 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkRGBATransferTable.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkRGBATransferTable - a flat RGBA8 table sampled from a
+// vtkColorTransferFunction and a vtkPiecewiseFunction.
+//
+// .SECTION Description
+// vtkRGBATransferTable samples a color and an opacity function into
+// NumberOfColors RGBA entries spread over the color function's range and
+// stores them as one contiguous unsigned char array. Filters use it to map
+// scalars straight into RGBA output buffers without going through a
+// vtkLookupTable and vtkImageMapToColors.
+//
+// Scalars are mapped the same way vtkLookupTable maps them: the index is
+// floor((v - range[0]) * NumberOfColors / (range[1] - range[0])), clamped
+// to the table. When no color function is set, the table holds the default
+// vtkLookupTable colors over the range [0, 1].
+//
+// For 8 and 16 bit integer scalars the table can be expanded to one entry
+// per integer value with BuildIntegerTable(), so that they are mapped with a
+// single lookup and no floating point conversion. BuildExactIntegerTable()
+// builds the same kind of table but samples the functions at every integer
+// of the data range, so that sharp opacity steps are not blurred by bins.
+//
+// The table is rebuilt lazily by Build() when the table or one of its
+// functions has been modified since the last build. When only control
+// points of the functions changed, only the entries between the neighbours
+// of the changed points are resampled, so editing a transfer function
+// interactively stays cheap even with large tables. The functions are
+// sampled with their bulk GetTable() APIs, split across threads with
+// vtkSMPTools.
+//
+// The Build methods are not thread safe; call them once before mapping
+// scalars from several threads.
+//
+// .SECTION see also
+// vtkLookupTable vtkColorTransferFunction vtkPiecewiseFunction
+// vtkImageMapToRGBA
+
+#ifndef __vtkRGBATransferTable_h
+#define __vtkRGBATransferTable_h
+
+#include <vtkObject.h>
+#include <vtkType.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Forward declarations
+class vtkColorTransferFunction;
+class vtkPiecewiseFunction;
+
+class vtkRGBATransferTable : public vtkObject
+{
+public:
+  static vtkRGBATransferTable* New();
+  vtkTypeMacro(vtkRGBATransferTable, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/Get the color transfer function
+  virtual void SetColorFunction(vtkColorTransferFunction* cf);
+  vtkGetObjectMacro(ColorFunction, vtkColorTransferFunction);
+
+  // Description:
+  // Set/Get the opacity function
+  virtual void SetOpacityFunction(vtkPiecewiseFunction* pwf);
+  vtkGetObjectMacro(OpacityFunction, vtkPiecewiseFunction);
+
+  // Description:
+  // Set/Get number of entries in the table (default: 256)
+  vtkSetClampMacro(NumberOfColors, int, 2, VTK_INT_MAX);
+  vtkGetMacro(NumberOfColors, int);
+
+  // Description:
+  // Rebuild the table if it is out of date
+  void Build();
+
+  // Description:
+  // Get the scalar range covered by the table. Valid after Build().
+  vtkGetVector2Macro(Range, double);
+
+  // Description:
+  // Get the RGBA8 entries. Valid after Build().
+  const unsigned char* GetTable()
+    {
+    return this->Table.empty() ? NULL : &this->Table[0];
+    }
+
+  // Description:
+  // Return the RGBA entry for a scalar value. Valid after Build().
+  const unsigned char* MapValue(double v) const
+    {
+    double d = (v - this->Range[0]) * this->Scale;
+    int last = this->NumberOfBuiltColors - 1;
+    int i = (d <= 0.0 ? 0 : (d >= last ? last : static_cast<int>(d)));
+    return &this->Table[4*i];
+    }
+
+  // Description:
+  // Map n scalars read with the given stride into n RGBA pixels
+  template <class T>
+  void MapScalars(const T* in, int inStride, unsigned char* out,
+                  vtkIdType n) const
+    {
+    for (vtkIdType i = 0; i < n; ++i, in += inStride, out += 4)
+      {
+      const unsigned char* rgba = this->MapValue(static_cast<double>(*in));
+      out[0] = rgba[0];
+      out[1] = rgba[1];
+      out[2] = rgba[2];
+      out[3] = rgba[3];
+      }
+    }
+
+  // Description:
+  // Expand the table to one entry per integer value in [typeMin, typeMax],
+  // the full range of an 8 or 16 bit integer type. Valid after Build();
+  // does nothing if the expansion is up to date.
+  void BuildIntegerTable(int typeMin, int typeMax);
+
+  // Description:
+  // Build a table with one entry per integer value in [typeMin, typeMax] by
+  // sampling the functions exactly at every integer of the data range
+  // [dataMin, dataMax], instead of expanding NumberOfColors bins. Entries
+  // outside of the sampled range are clamped. The sampled range only ever
+  // grows: a data range inside it reuses the table, one outside of it
+  // extends it to cover both.
+  void BuildExactIntegerTable(int typeMin, int typeMax,
+                              int dataMin, int dataMax);
+
+  // Description:
+  // Map n integer scalars read with the given stride into n RGBA pixels.
+  // Valid after BuildIntegerTable() or BuildExactIntegerTable() for the
+  // range of T. As the table covers the whole range of T, every scalar is
+  // mapped with one lookup and no arithmetic.
+  template <class T>
+  void MapIntegers(const T* in, int inStride, unsigned char* out,
+                   vtkIdType n) const
+    {
+    const vtkTypeUInt32* table = &this->IntegerTable[0] - this->IntegerMin;
+    for (vtkIdType i = 0; i < n; ++i, in += inStride, out += 4)
+      {
+      memcpy(out, table + *in, 4);
+      }
+    }
+
+  // Description:
+  // Include the functions' modification times
+  unsigned long GetMTime();
+
+protected:
+  vtkRGBATransferTable();
+  ~vtkRGBATransferTable();
+
+  // Description:
+  // Compare the current function nodes and settings with the ones stored
+  // at buildTime, compute the intervals affected by the color and opacity
+  // changes and store the current nodes and settings. Returns 0 when the
+  // changes cannot be handled by resampling these intervals.
+  int UpdateChangedIntervals(std::vector<double>& colorNodes,
+                             std::vector<double>& opacityNodes,
+                             std::vector<double>& settings,
+                             unsigned long buildTime,
+                             double colorInterval[2],
+                             double opacityInterval[2], int changed[2]);
+
+  // Description:
+  // Add bins [first, last] to the ones the integer expansion must update
+  void AddPendingBins(int first, int last)
+    {
+    if (this->PendingBins[0] > this->PendingBins[1])
+      {
+      this->PendingBins[0] = first;
+      this->PendingBins[1] = last;
+      }
+    else
+      {
+      this->PendingBins[0] = std::min(this->PendingBins[0], first);
+      this->PendingBins[1] = std::max(this->PendingBins[1], last);
+      }
+    }
+
+  // Description:
+  // Sample the color and/or opacity of entries [first, last] of a table
+  // whose entry i sits at the scalar x0 + i*dx
+  void SampleEntries(unsigned char* table, double x0, double dx,
+                     int first, int last, int color, int opacity);
+
+  vtkColorTransferFunction* ColorFunction;
+  vtkPiecewiseFunction* OpacityFunction;
+  int NumberOfColors;
+
+  std::vector<unsigned char> Table;
+  int NumberOfBuiltColors;
+  double Range[2];
+  double Scale;
+  vtkTimeStamp BuildTime;
+  std::vector<double> BuiltColorNodes;
+  std::vector<double> BuiltOpacityNodes;
+  std::vector<double> BuiltSettings;
+  // Bins resampled since the last integer expansion, empty when first is
+  // greater than last
+  int PendingBins[2];
+
+  std::vector<vtkTypeUInt32> IntegerTable;
+  int IntegerMin;
+  int IntegerExact;
+  int IntegerDataRange[2];
+  vtkTimeStamp IntegerBuildTime;
+  std::vector<double> IntegerColorNodes;
+  std::vector<double> IntegerOpacityNodes;
+  std::vector<double> IntegerSettings;
+
+private:
+  vtkRGBATransferTable(const vtkRGBATransferTable&); // Not implemented
+  void operator=(const vtkRGBATransferTable&); // Not implemented
+};
+
+#endif //__vtkRGBATransferTable_h